@@ -37,7 +37,7 @@ include(../../mne-cpp.pri)
 
 TEMPLATE = lib
 
-QT += network
+QT += network concurrent
 QT -= gui
 
 DEFINES += FIFF_LIBRARY
@@ -83,6 +83,7 @@ SOURCES += fiff.cpp \
     fiff_id.cpp \
     fiff_info.cpp \
     fiff_raw_dir.cpp \
+    fiff_raw_reader.cpp \
     fiff_dig_point.cpp \
     fiff_ch_pos.cpp \
     fiff_evoked_data.cpp \
@@ -109,6 +110,7 @@ HEADERS += fiff.h \
     fiff_raw_data.h \
     fiff_dir_entry.h \
     fiff_raw_dir.h \
+    fiff_raw_reader.h \
     fiff_dig_point.h \
     fiff_ch_pos.h \
     fiff_evoked_data.h \
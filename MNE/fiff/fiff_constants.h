@@ -63,7 +63,7 @@ namespace FIFFLIB
 #define FIFFV_NEXT_SEQ   0
 #define FIFFV_NEXT_NONE -1
 
-#define FIFFC_TAG_INFO_SIZE (sizeof(fiffTag) - sizeof(fiff_data_t *))
+#define FIFFC_TAG_INFO_SIZE 16 /* kind, type, size and next; 4*4 = 16 */
 #define FIFFC_DATA_OFFSET FIFFC_TAG_INFO_SIZE
 #define FIFFM_TAG_INFO(x) &((x)->kind)
 
@@ -586,6 +586,24 @@ namespace FIFFLIB
 //
 #define FIFF_MNE_RT_COMMAND         3700              /**< Fiff Real-Time Command */
 #define FIFF_MNE_RT_CLIENT_ID       3701              /**< Fiff Real-Time mne_t_server client id */
+#define FIFF_MNE_RT_DATA_BUFFER_PACK16   3702         /**< Fiff Real-Time raw buffer, 16 bit integers with per channel scales */
+#define FIFF_MNE_RT_DATA_BUFFER_PACK24   3703         /**< Fiff Real-Time raw buffer, 24 bit integers with per channel scales */
+#define FIFF_MNE_RT_DATA_BUFFER_LOSSLESS 3704         /**< Fiff Real-Time raw buffer, xor delta and deflate coded floats */
+
+//
+// Fiff Real-Time raw stream modes
+//
+#define FIFFV_MNE_RT_STREAM_FLOAT      0              /**< Raw buffers are sent as FIFF_DATA_BUFFER floats (default) */
+#define FIFFV_MNE_RT_STREAM_PACK16     1              /**< Raw buffers are sent as FIFF_MNE_RT_DATA_BUFFER_PACK16 */
+#define FIFFV_MNE_RT_STREAM_PACK24     2              /**< Raw buffers are sent as FIFF_MNE_RT_DATA_BUFFER_PACK24 */
+#define FIFFV_MNE_RT_STREAM_LOSSLESS   3              /**< Raw buffers are sent as FIFF_MNE_RT_DATA_BUFFER_LOSSLESS */
+
+//
+// Fiff Real-Time data client commands, sent by FIFF_MNE_RT_COMMAND (server side: MNE_RT_* in mne_rt_commands.h)
+//
+#define FIFFV_MNE_RT_GET_CLIENT_ID     1              /**< Request client id at mne_rt_server */
+#define FIFFV_MNE_RT_SET_CLIENT_ALIAS  2              /**< Set client alias at mne_rt_server */
+#define FIFFV_MNE_RT_SET_STREAM_MODE   3              /**< Set raw stream mode (FIFFV_MNE_RT_STREAM_*) at mne_rt_server */
 
 //
 // 3710... Real-Time Blocks
@@ -42,6 +42,8 @@
 #include "fiff_tag.h"
 #include "fiff_stream.h"
 
+#include <utils/parallel.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -49,6 +51,7 @@
 //=============================================================================================================
 
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -59,6 +62,11 @@ using namespace FIFFLIB;
 FiffRawData::FiffRawData()
 : first_samp(-1)
 , last_samp(-1)
+, m_pMappedFile(NULL)
+, m_iMappedSize(0)
+, m_bMultiplierCached(false)
+, m_iCachedCompKind(-1)
+, m_bFloatMultiplierCached(false)
 {
 
 }
@@ -69,6 +77,11 @@ FiffRawData::FiffRawData()
 FiffRawData::FiffRawData(QIODevice &p_IODevice)
 : first_samp(-1)
 , last_samp(-1)
+, m_pMappedFile(NULL)
+, m_iMappedSize(0)
+, m_bMultiplierCached(false)
+, m_iCachedCompKind(-1)
+, m_bFloatMultiplierCached(false)
 {
     if(!FiffStream::setup_read_raw(p_IODevice, *this))
     {
@@ -89,6 +102,11 @@ FiffRawData::FiffRawData(const FiffRawData &p_FiffRawData)
 , rawdir(p_FiffRawData.rawdir)
 , proj(p_FiffRawData.proj)
 , comp(p_FiffRawData.comp)
+, m_pMappedFile(NULL)
+, m_iMappedSize(0)
+, m_bMultiplierCached(false)
+, m_iCachedCompKind(-1)
+, m_bFloatMultiplierCached(false)
 {
 
 }
@@ -98,7 +116,33 @@ FiffRawData::FiffRawData(const FiffRawData &p_FiffRawData)
 
 FiffRawData::~FiffRawData()
 {
+    unmapFile();
+}
+
+
+//*************************************************************************************************************
 
+FiffRawData& FiffRawData::operator= (const FiffRawData &rhs)
+{
+    if (this != &rhs) // protect against invalid self-assignment
+    {
+        unmapFile();
+
+        file = rhs.file;
+        info = rhs.info;
+        first_samp = rhs.first_samp;
+        last_samp = rhs.last_samp;
+        cals = rhs.cals;
+        rawdir = rhs.rawdir;
+        proj = rhs.proj;
+        comp = rhs.comp;
+
+        m_bMultiplierCached = false;
+        m_iCachedCompKind = -1;
+        m_bFloatMultiplierCached = false;
+    }
+    // to support chained assignment operators (a=b=c), always return *this
+    return *this;
 }
 
 
@@ -106,6 +150,9 @@ FiffRawData::~FiffRawData()
 
 void FiffRawData::clear()
 {
+    unmapFile();
+    m_bMultiplierCached = false;
+    m_bFloatMultiplierCached = false;
     info.clear();
     first_samp = -1;
     last_samp = -1;
@@ -120,11 +167,90 @@ void FiffRawData::clear()
 
 bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel)
 {
-    bool projAvailable = true;
+    if(!prepare_segment(from, to, sel))
+        return false;
+    //
+    //  Initialize the data and calibration vector
+    //
+    if (sel.size() == 0)
+        data = MatrixXd(this->info.nchan, to-from+1);
+    else
+        data = MatrixXd(sel.size(),to-from+1);
+//            data->setZero();
 
-    if (this->proj.size() == 0)
-        projAvailable = false;
+    if(!read_raw_buffers(data, 0, from, to, sel, m_matCachedCal, m_matCachedMult, m_matCachedMultDense))
+        return false;
+
+    printf(" [done]\n");
+
+//        fclose(fid);
+
+    times = MatrixXd(1, to-from+1);
+
+    for (qint32 i = 0; i < times.cols(); ++i)
+        times(0, i) = ((float)(from+i)) / this->info.sfreq;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_segment(MatrixXf& data, MatrixXd& times, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel)
+{
+    if(!prepare_segment(from, to, sel))
+        return false;
+
+    if (sel.size() == 0)
+        data = MatrixXf(this->info.nchan, to-from+1);
+    else
+        data = MatrixXf(sel.size(),to-from+1);
+
+    //
+    //  The multiplier is set up in double precision, convert it only once
+    //
+    if(!m_bFloatMultiplierCached)
+    {
+        m_matCachedCalFloat = m_matCachedCal.cast<float>();
+        m_matCachedMultFloat = m_matCachedMult.cast<float>();
+        m_matCachedMultDenseFloat = m_matCachedMultDense.cast<float>();
+        m_bFloatMultiplierCached = true;
+    }
+
+    if(!read_raw_buffers(data, 0, from, to, sel, m_matCachedCalFloat, m_matCachedMultFloat, m_matCachedMultDenseFloat))
+        return false;
+
+    printf(" [done]\n");
+
+    times = MatrixXd(1, to-from+1);
+
+    for (qint32 i = 0; i < times.cols(); ++i)
+        times(0, i) = ((float)(from+i)) / this->info.sfreq;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_segment_times(MatrixXd& data, MatrixXd& times, float from, float to, const RowVectorXi& sel)
+{
+    //
+    //   Convert to samples
+    //
+    from = floor(from*this->info.sfreq);
+    to   = ceil(to*this->info.sfreq);
+    //
+    //   Read it
+    //
+    return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
+}
+
+
+//*************************************************************************************************************
 
+bool FiffRawData::prepare_segment(fiff_int_t& from, fiff_int_t& to, const RowVectorXi& sel)
+{
     if(from == -1)
         from = this->first_samp;
     if(to == -1)
@@ -143,12 +269,68 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
         return false;
     }
     printf("Reading %d ... %d  =  %9.3f ... %9.3f secs...", from, to, ((float)from)/this->info.sfreq, ((float)to)/this->info.sfreq);
+
     //
-    //  Initialize the data and calibration vector
+    //  Set up the multiplier only if the selection, projection, compensation or calibration changed
     //
+    if(!multiplier_cached(sel))
+    {
+        make_multiplier(sel, m_matCachedCal, m_matCachedMult, m_matCachedMultDense);
+
+        m_vecCachedSel = sel;
+        m_vecCachedCals = this->cals;
+        m_matCachedProj = this->proj;
+        m_iCachedCompKind = this->comp.kind;
+        m_matCachedComp = this->comp.kind != -1 ? this->comp.data->data : MatrixXd();
+        m_bMultiplierCached = true;
+        m_bFloatMultiplierCached = false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawData::multiplier_cached(const RowVectorXi& sel) const
+{
+    if(!m_bMultiplierCached)
+        return false;
+
+    if(m_vecCachedSel.size() != sel.size() || m_vecCachedSel != sel)
+        return false;
+
+    if(m_vecCachedCals.size() != this->cals.size() || m_vecCachedCals != this->cals)
+        return false;
+
+    if(m_matCachedProj.rows() != this->proj.rows() || m_matCachedProj.cols() != this->proj.cols() || m_matCachedProj != this->proj)
+        return false;
+
+    if(m_iCachedCompKind != this->comp.kind)
+        return false;
+
+    if(this->comp.kind != -1)
+    {
+        const MatrixXd& compData = this->comp.data->data;
+        if(m_matCachedComp.rows() != compData.rows() || m_matCachedComp.cols() != compData.cols() || m_matCachedComp != compData)
+            return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawData::make_multiplier(const RowVectorXi& sel, SparseMatrix<double>& cal, SparseMatrix<double>& mult, MatrixXd& multDense) const
+{
+    bool projAvailable = true;
+
+    if (this->proj.size() == 0)
+        projAvailable = false;
+
     qint32 nchan = this->info.nchan;
-    qint32 dest  = 0;//1;
-    qint32 i, k, r;
+    qint32 i, k;
 
     typedef Eigen::Triplet<double> T;
     std::vector<T> tripletList;
@@ -156,7 +338,7 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
     for(i = 0; i < nchan; ++i)
         tripletList.push_back(T(i, i, this->cals[i]));
 
-    SparseMatrix<double> cal(nchan, nchan);
+    cal = SparseMatrix<double>(nchan, nchan);
     cal.setFromTriplets(tripletList.begin(), tripletList.end());
 //    cal.makeCompressed();
 
@@ -164,8 +346,6 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
     //
     if (sel.size() == 0)
     {
-        data = MatrixXd(nchan, to-from+1);
-//            data->setZero();
         if (projAvailable || this->comp.kind != -1)
         {
             if (!projAvailable)
@@ -178,9 +358,6 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
     }
     else
     {
-        data = MatrixXd(sel.size(),to-from+1);
-//            data->setZero();
-
         MatrixXd selVect(sel.size(), nchan);
 
         selVect.setZero();
@@ -221,23 +398,61 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
         }
     }
 
-    bool do_debug = false;
+    //
+    // Projectors are usually dense, in that case a dense product is much faster than a sparse one
+    //
+    qint64 nnz = 0;
+    for(i = 0; i < mult_full.rows(); ++i)
+        for(k = 0; k < mult_full.cols(); ++k)
+            if(mult_full(i,k) != 0)
+                ++nnz;
+
+    if(nnz > 0 && nnz >= 0.25 * mult_full.rows() * mult_full.cols())
+    {
+        mult = SparseMatrix<double>();
+        multDense = mult_full;
+        return;
+    }
+    multDense = MatrixXd();
+
     //
     // Make mult sparse
     //
     tripletList.clear();
-    tripletList.reserve(mult_full.rows()*mult_full.cols());
+    tripletList.reserve(nnz);
     for(i = 0; i < mult_full.rows(); ++i)
         for(k = 0; k < mult_full.cols(); ++k)
             if(mult_full(i,k) != 0)
                 tripletList.push_back(T(i, k, mult_full(i,k)));
 
-    SparseMatrix<double> mult(mult_full.rows(),mult_full.cols());
+    mult = SparseMatrix<double>(mult_full.rows(),mult_full.cols());
     if(tripletList.size() > 0)
         mult.setFromTriplets(tripletList.begin(), tripletList.end());
 //    mult.makeCompressed();
+}
+
+
+//*************************************************************************************************************
+
+template<typename Scalar>
+bool FiffRawData::read_raw_buffers(Matrix<Scalar, Dynamic, Dynamic>& data, fiff_int_t dest, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel, const SparseMatrix<Scalar>& cal, const SparseMatrix<Scalar>& mult, const Matrix<Scalar, Dynamic, Dynamic>& multDense)
+{
+    const fiff_int_t dest0 = dest;
+    qint32 nchan = this->info.nchan;
+    qint32 i, k, r;
+
+    bool do_debug = false;
+
+    bool hasMult = mult.cols() > 0 || multDense.cols() > 0;
 
     //
+    //  The mapping is gone if somebody closed the file in the meantime
+    //
+    if (m_pMappedFile && !this->file->device()->isOpen())
+    {
+        m_pMappedFile = NULL;
+        m_iMappedSize = 0;
+    }
 
     FiffStream::SPtr fid;
     if (!this->file->device()->isOpen())
@@ -253,18 +468,55 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
         fid = this->file;
     }
 
-    MatrixXd one;
+    //
+    //  Calibration of the output rows, used when decoding straight from the mapping
+    //
+    Matrix<Scalar, 1, Dynamic> selCals;
+    if (m_pMappedFile && !hasMult)
+    {
+        if (sel.size() == 0)
+            selCals = this->cals.cast<Scalar>();
+        else
+        {
+            selCals.resize(sel.size());
+            for(i = 0; i < sel.size(); ++i)
+                selCals[i] = (Scalar)this->cals[sel[i]];
+        }
+    }
+
+    //
+    //  The raw directory is sorted, find the first buffer we need
+    //
+    qint32 lower = 0;
+    qint32 upper = this->rawdir.size();
+    while(lower < upper)
+    {
+        qint32 middle = (lower + upper) / 2;
+        if(this->rawdir[middle].last >= from)
+            upper = middle;
+        else
+            lower = middle + 1;
+    }
+
+    Matrix<Scalar, Dynamic, Dynamic> one;
+    QList<MappedBuffer> mappedBuffers;
     bool doing_whole;
     fiff_int_t first_pick, last_pick, picksamp;
-    for(k = 0; k < this->rawdir.size(); ++k)
+    for(k = lower; k < this->rawdir.size(); ++k)
     {
         FiffRawDir thisRawDir = this->rawdir[k];
         //
         //  Do we need this buffer
         //
-        if (thisRawDir.last > from)
+        if (thisRawDir.last >= from)
         {
-            if (thisRawDir.ent.kind == -1)
+            if (m_pMappedFile)
+            {
+                //
+                //  Nothing to read here, only the picked samples are decoded from the mapping below
+                //
+            }
+            else if (thisRawDir.ent.kind == -1)
             {
                 //
                 //  Take the easy route: skip is translated to zeros
@@ -287,16 +539,16 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
                 //   Depending on the state of the projection and selection
                 //   we proceed a little bit differently
                 //
-                if (mult.cols() == 0)
+                if (!hasMult)
                 {
                     if (sel.cols() == 0)
                     {
                         if (t_pTag->type == FIFFT_DAU_PACK16)
-                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
+                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<Scalar>();
                         else if(t_pTag->type == FIFFT_INT)
-                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
+                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<Scalar>();
                         else if(t_pTag->type == FIFFT_FLOAT)
-                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
+                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<Scalar>();
                         else
                             printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
                     }
@@ -304,25 +556,25 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
                     {
 
                         //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
-                        MatrixXd newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
+                        Matrix<Scalar, Dynamic, Dynamic> newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
 
                         if (t_pTag->type == FIFFT_DAU_PACK16)
                         {
-                            MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
+                            Matrix<Scalar, Dynamic, Dynamic> tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<Scalar>();
 
                             for(r = 0; r < sel.size(); ++r)
                                 newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
                         }
                         else if(t_pTag->type == FIFFT_INT)
                         {
-                            MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
+                            Matrix<Scalar, Dynamic, Dynamic> tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<Scalar>();
 
                             for(r = 0; r < sel.size(); ++r)
                                 newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
                         }
                         else if(t_pTag->type == FIFFT_FLOAT)
                         {
-                            MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
+                            Matrix<Scalar, Dynamic, Dynamic> tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<Scalar>();
 
                             for(r = 0; r < sel.size(); ++r)
                                 newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
@@ -335,14 +587,25 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
                         one = cal*newData;
                     }
                 }
+                else if (multDense.cols() > 0)
+                {
+                    if (t_pTag->type == FIFFT_DAU_PACK16)
+                        one = multDense*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<Scalar>();
+                    else if(t_pTag->type == FIFFT_INT)
+                        one = multDense*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<Scalar>();
+                    else if(t_pTag->type == FIFFT_FLOAT)
+                        one = multDense*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<Scalar>();
+                    else
+                        printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
+                }
                 else
                 {
                     if (t_pTag->type == FIFFT_DAU_PACK16)
-                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
+                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<Scalar>();
                     else if(t_pTag->type == FIFFT_INT)
-                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
+                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<Scalar>();
                     else if(t_pTag->type == FIFFT_FLOAT)
-                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
+                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<Scalar>();
                     else
                         printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
                 }
@@ -407,10 +670,25 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
 
             if (picksamp > 0)
             {
+                if (m_pMappedFile)
+                {
+                    //
+                    //  The buffers are decoded below, in parallel
+                    //
+                    MappedBuffer mappedBuffer;
+                    mappedBuffer.iRawDir = k;
+                    mappedBuffer.iFirstPick = first_pick;
+                    mappedBuffer.iNumPick = picksamp;
+                    mappedBuffer.iDestCol = dest;
+                    mappedBuffers.append(mappedBuffer);
+                }
+                else
+                {
 //                    for(r = 0; r < data->rows(); ++r)
 //                        for(c = 0; c < picksamp; ++c)
 //                            (*data)(r,dest + c) = one(r,first_pick + c);
-                data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
+                    data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
+                }
 
                 dest += picksamp;
             }
@@ -419,18 +697,88 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
         //  Done?
         //
         if (thisRawDir.last >= to)
-        {
-            printf(" [done]\n");
             break;
+    }
+
+    if (mappedBuffers.size() > 0)
+    {
+        QAtomicInt failed(0);
+
+        MappedDecode<Scalar> decode;
+        decode.pRaw = this;
+        decode.pBuffers = &mappedBuffers;
+        decode.pSel = &sel;
+        decode.pSelCals = &selCals;
+        decode.pMult = &mult;
+        decode.pMultDense = &multDense;
+        decode.pData = &data;
+        decode.pFailed = &failed;
+
+        Parallel::parallelFor(mappedBuffers.size(), 1, decode);
+
+        //
+        //  A malformed buffer can't be decoded from the mapping, read the segment from the stream instead
+        //
+        if (failed.load() != 0)
+        {
+            unmapFile();
+            return read_raw_buffers(data, dest0, from, to, sel, cal, mult, multDense);
         }
     }
 
-//        fclose(fid);
+    return true;
+}
 
-    times = MatrixXd(1, to-from+1);
 
-    for (i = 0; i < times.cols(); ++i)
-        times(0, i) = ((float)(from+i)) / this->info.sfreq;
+//*************************************************************************************************************
+
+bool FiffRawData::mapFile()
+{
+    if(m_pMappedFile)
+        return true;
+
+    if(this->file.isNull() || !this->file->device())
+        return false;
+
+    QFile* t_pFile = qobject_cast<QFile*>(this->file->device());
+    if(!t_pFile)
+    {
+        printf("Raw data can only be mapped from a file.\n");
+        return false;
+    }
+
+    if (!t_pFile->isOpen() && !t_pFile->open(QIODevice::ReadOnly))
+    {
+        printf("Cannot open file %s\n",this->info.filename.toUtf8().constData());
+        return false;
+    }
+
+    qint64 t_iSize = t_pFile->size();
+    uchar* t_pMap = t_pFile->map(0, t_iSize);
+    if(!t_pMap)
+    {
+        printf("Cannot map file %s\n",this->info.filename.toUtf8().constData());
+        return false;
+    }
+
+    //
+    //  Make sure all data buffers are within the mapping
+    //
+    for(qint32 k = 0; k < this->rawdir.size(); ++k)
+    {
+        const FiffDirEntry& ent = this->rawdir[k].ent;
+        if(ent.kind == -1)
+            continue;
+        if(ent.pos < 0 || (qint64)ent.pos + FIFFC_DATA_OFFSET + ent.size > t_iSize)
+        {
+            printf("Raw data buffer %d exceeds the file %s\n", k, this->info.filename.toUtf8().constData());
+            t_pFile->unmap(t_pMap);
+            return false;
+        }
+    }
+
+    m_pMappedFile = t_pMap;
+    m_iMappedSize = t_iSize;
 
     return true;
 }
@@ -438,15 +786,162 @@ bool FiffRawData::read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t f
 
 //*************************************************************************************************************
 
-bool FiffRawData::read_raw_segment_times(MatrixXd& data, MatrixXd& times, float from, float to, const RowVectorXi& sel)
+void FiffRawData::unmapFile()
 {
+    if(!m_pMappedFile)
+        return;
+
+    QFile* t_pFile = this->file.isNull() ? NULL : qobject_cast<QFile*>(this->file->device());
+    if(t_pFile && t_pFile->isOpen())
+        t_pFile->unmap(m_pMappedFile);
+
+    m_pMappedFile = NULL;
+    m_iMappedSize = 0;
+}
+
+
+//*************************************************************************************************************
+
+template<typename Scalar>
+bool FiffRawData::read_mapped_buffer(const FiffRawDir& p_RawDir, fiff_int_t p_iFirstPick, fiff_int_t p_iNumPick, const RowVectorXi& p_vecSel, const Matrix<Scalar, 1, Dynamic>& p_vecScale, Matrix<Scalar, Dynamic, Dynamic>& p_matDest, fiff_int_t p_iDestCol) const
+{
+    const uchar* t_pBuffer = m_pMappedFile + p_RawDir.ent.pos + FIFFC_DATA_OFFSET;
+    fiff_int_t nchan = this->info.nchan;
+
     //
-    //   Convert to samples
+    //  The tag has to hold exactly the samples of the buffer, a truncated one would be decoded past its end
     //
-    from = floor(from*this->info.sfreq);
-    to   = ceil(to*this->info.sfreq);
+    qint64 t_iSampleSize;
+    switch(p_RawDir.ent.type)
+    {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            t_iSampleSize = sizeof(qint16);
+            break;
+        case FIFFT_INT:
+            t_iSampleSize = sizeof(qint32);
+            break;
+        case FIFFT_FLOAT:
+            t_iSampleSize = sizeof(float);
+            break;
+        default:
+            printf("Data Storage Format not known jet [4]!! Type: %d\n", p_RawDir.ent.type);
+            return false;
+    }
+
+    if((qint64)p_RawDir.ent.size != (qint64)nchan * p_RawDir.nsamp * t_iSampleSize)
+    {
+        printf("Size of raw data buffer at %d doesn't match its %d samples.\n", p_RawDir.ent.pos, p_RawDir.nsamp);
+        return false;
+    }
+
+    switch(p_RawDir.ent.type)
+    {
+        case FIFFT_DAU_PACK16:
+        case FIFFT_SHORT:
+            decode_big_endian<qint16, Scalar>(t_pBuffer, nchan, p_iFirstPick, p_iNumPick, p_vecSel, p_vecScale, p_matDest, p_iDestCol);
+            break;
+        case FIFFT_INT:
+            decode_big_endian<qint32, Scalar>(t_pBuffer, nchan, p_iFirstPick, p_iNumPick, p_vecSel, p_vecScale, p_matDest, p_iDestCol);
+            break;
+        case FIFFT_FLOAT:
+            decode_big_endian<float, Scalar>(t_pBuffer, nchan, p_iFirstPick, p_iNumPick, p_vecSel, p_vecScale, p_matDest, p_iDestCol);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename T, typename Scalar>
+void FiffRawData::decode_big_endian(const uchar* p_pBuffer, fiff_int_t p_iNChan, fiff_int_t p_iFirstPick, fiff_int_t p_iNumPick, const RowVectorXi& p_vecSel, const Matrix<Scalar, 1, Dynamic>& p_vecScale, Matrix<Scalar, Dynamic, Dynamic>& p_matDest, fiff_int_t p_iDestCol)
+{
     //
-    //   Read it
+    //  The samples are stored one after another, each containing all channels
     //
-    return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
+    const qint32 nrow = p_vecSel.size() > 0 ? p_vecSel.size() : p_iNChan;
+    const bool doScale = p_vecScale.size() > 0;
+
+    for(qint32 c = 0; c < p_iNumPick; ++c)
+    {
+        const uchar* t_pSample = p_pBuffer + (qint64)(p_iFirstPick + c) * p_iNChan * sizeof(T);
+        Scalar* t_pDest = p_matDest.data() + (qint64)(p_iDestCol + c) * p_matDest.rows();
+
+        if(p_vecSel.size() > 0)
+        {
+            for(qint32 r = 0; r < nrow; ++r)
+                t_pDest[r] = (Scalar)from_big_endian<T>(t_pSample + p_vecSel[r] * sizeof(T));
+        }
+        else
+        {
+            for(qint32 r = 0; r < nrow; ++r)
+                t_pDest[r] = (Scalar)from_big_endian<T>(t_pSample + r * sizeof(T));
+        }
+
+        if(doScale)
+            for(qint32 r = 0; r < nrow; ++r)
+                t_pDest[r] *= p_vecScale[r];
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename Scalar>
+void FiffRawData::MappedDecode<Scalar>::operator()(qint32 p_iFirst, qint32 p_iNum) const
+{
+    const qint32 nchan = pRaw->info.nchan;
+    const bool hasMult = pMult->cols() > 0 || pMultDense->cols() > 0;
+
+    Matrix<Scalar, Dynamic, Dynamic> one;
+    for(qint32 b = p_iFirst; b < p_iFirst + p_iNum; ++b)
+    {
+        const MappedBuffer& mappedBuffer = pBuffers->at(b);
+        const FiffRawDir& thisRawDir = pRaw->rawdir[mappedBuffer.iRawDir];
+        fiff_int_t picksamp = mappedBuffer.iNumPick;
+        fiff_int_t dest = mappedBuffer.iDestCol;
+
+        if (thisRawDir.ent.kind == -1)
+            pData->block(0,dest,pData->rows(),picksamp).setZero();
+        else if (!hasMult)
+        {
+            if(!pRaw->read_mapped_buffer(thisRawDir, mappedBuffer.iFirstPick, picksamp, *pSel, *pSelCals, *pData, dest))
+                pFailed->fetchAndStoreOrdered(1);
+        }
+        else
+        {
+            //
+            //  The multiplier needs all channels: decode and project tile by tile, so the decoded
+            //  samples are still in the cache when they are multiplied
+            //
+            const qint32 tileSize = 64;
+            one.resize(nchan, qMin(tileSize, picksamp));
+            for(qint32 t = 0; t < picksamp; t += tileSize)
+            {
+                qint32 ntile = qMin(tileSize, picksamp - t);
+                if(!pRaw->read_mapped_buffer(thisRawDir, mappedBuffer.iFirstPick + t, ntile, defaultRowVectorXi, Matrix<Scalar, 1, Dynamic>(), one, 0))
+                {
+                    pFailed->fetchAndStoreOrdered(1);
+                    break;
+                }
+                if (pMultDense->cols() > 0)
+                    pData->block(0,dest+t,pData->rows(),ntile).noalias() = (*pMultDense)*one.leftCols(ntile);
+                else
+                    pData->block(0,dest+t,pData->rows(),ntile) = (*pMult)*one.leftCols(ntile);
+            }
+        }
+    }
 }
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// EXPLICIT TEMPLATE INSTANTIATIONS
+//=============================================================================================================
+
+template bool FiffRawData::read_raw_buffers<double>(MatrixXd& data, fiff_int_t dest, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel, const SparseMatrix<double>& cal, const SparseMatrix<double>& mult, const MatrixXd& multDense);
+template bool FiffRawData::read_raw_buffers<float>(MatrixXf& data, fiff_int_t dest, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel, const SparseMatrix<float>& cal, const SparseMatrix<float>& mult, const MatrixXf& multDense);
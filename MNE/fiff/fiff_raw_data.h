@@ -61,9 +61,11 @@
 // Qt INCLUDES
 //=============================================================================================================
 
+#include <QAtomicInt>
 #include <QFile>
 #include <QList>
 #include <QSharedPointer>
+#include <QtEndian>
 
 
 //*************************************************************************************************************
@@ -93,6 +95,8 @@ using namespace Eigen;
 */
 class FIFFSHARED_EXPORT FiffRawData
 {
+    friend class FiffRawReader;
+
 public:
     typedef QSharedPointer<FiffRawData> SPtr;               /**< Shared pointer type for FiffRawData. */
     typedef QSharedPointer<const FiffRawData> ConstSPtr;    /**< Const shared pointer type for FiffRawData. */
@@ -121,10 +125,21 @@ public:
 
     //=========================================================================================================
     /**
-    * Destroys the FiffInfo.
+    * Destroys the FiffRawData and releases its memory mapping.
     */
     ~FiffRawData();
 
+    //=========================================================================================================
+    /**
+    * Assignment Operator. Like the copy constructor, the mapping of rhs isn't shared; the mapping of this raw
+    * data is released and the cached multiplier is set up again on the next read.
+    *
+    * @param[in] rhs     FiffRawData which should be assigned.
+    *
+    * @return the copied raw data
+    */
+    FiffRawData& operator= (const FiffRawData &rhs);
+
     //=========================================================================================================
     /**
     * Initializes the fiff raw measurement data.
@@ -158,6 +173,22 @@ public:
     */
     bool read_raw_segment(MatrixXd& data, MatrixXd& times, fiff_int_t from = -1, fiff_int_t to = -1, const RowVectorXi& sel = defaultRowVectorXi);
 
+    //=========================================================================================================
+    /**
+    * Read a specific raw data segment in single precision. The raw buffers are decoded, calibrated and projected
+    * in float, which halves the memory traffic compared to the double precision read. The multiplier itself is
+    * set up in double precision and converted once.
+    *
+    * @param[out] data      returns the data matrix (channels x samples)
+    * @param[out] times     returns the time values corresponding to the samples
+    * @param[in] from       first sample to include. If omitted, defaults to the first sample in data (optional)
+    * @param[in] to         last sample to include. If omitted, defaults to the last sample in data (optional)
+    * @param[in] sel        channel selection vector (optional)
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool read_raw_segment(MatrixXf& data, MatrixXd& times, fiff_int_t from = -1, fiff_int_t to = -1, const RowVectorXi& sel = defaultRowVectorXi);
+
     //=========================================================================================================
     /**
     * ### MNE toolbox root function ###: Implementation of the fiff_read_raw_segment function
@@ -174,6 +205,175 @@ public:
     */
     bool read_raw_segment_times(MatrixXd& data, MatrixXd& times, float from, float to, const RowVectorXi& sel = defaultRowVectorXi);
 
+    //=========================================================================================================
+    /**
+    * Maps the raw data file into memory. As long as the file is mapped, read_raw_segment decodes the raw data
+    * buffers straight from the mapping into the output matrix, without creating intermediate tags. Only the
+    * selected channels and samples are decoded. The device of the raw data stream has to be a QFile; the file
+    * stays open until unmapFile is called. Copies of the raw data are not mapped.
+    *
+    * @return true if the file was mapped, false otherwise
+    */
+    bool mapFile();
+
+    //=========================================================================================================
+    /**
+    * Releases the memory mapping established by mapFile. read_raw_segment falls back to tag based reading.
+    */
+    void unmapFile();
+
+    //=========================================================================================================
+    /**
+    * True if the raw data file is memory mapped.
+    *
+    * @return true if the raw data file is memory mapped
+    */
+    inline bool isMapped() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Checks and clips the segment boundaries and updates the cached multiplier if the selection, calibration,
+    * projection or compensation changed.
+    *
+    * @param[in, out] from  first sample to include; -1 for the first sample in data
+    * @param[in, out] to    last sample to include; -1 for the last sample in data
+    * @param[in] sel        channel selection vector
+    *
+    * @return true if there is data in the range, false otherwise
+    */
+    bool prepare_segment(fiff_int_t& from, fiff_int_t& to, const RowVectorXi& sel);
+
+    //=========================================================================================================
+    /**
+    * True if the multiplier cached by read_raw_segment was set up for the given selection and for the current
+    * calibration, projection and compensation.
+    *
+    * @param[in] sel        channel selection vector
+    *
+    * @return true if the cached multiplier can be used
+    */
+    bool multiplier_cached(const RowVectorXi& sel) const;
+
+    //=========================================================================================================
+    /**
+    * Sets up the calibration and the combined projection, compensation and calibration multiplier for the given
+    * channel selection. If neither a projector nor a compensator is present, mult and multDense are empty and cal
+    * has to be applied after the selection. Otherwise the multiplier is stored dense, if at least a quarter of its
+    * elements are nonzero, and sparse otherwise.
+    *
+    * @param[in] sel        channel selection vector; all channels if empty
+    * @param[out] cal       the sparse calibration matrix
+    * @param[out] mult      the sparse multiplier (proj * comp * cal), restricted to the selected rows
+    * @param[out] multDense the dense multiplier; empty if mult is used
+    */
+    void make_multiplier(const RowVectorXi& sel, SparseMatrix<double>& cal, SparseMatrix<double>& mult, MatrixXd& multDense) const;
+
+    //=========================================================================================================
+    /**
+    * Reads, calibrates and projects the samples from ... to of all raw buffers involved and writes them to data,
+    * starting at column dest. data has to be allocated by the caller (rows: selected channels). from and to have
+    * to be checked against first_samp and last_samp beforehand.
+    *
+    * Scalar is the precision of the output, either float or double.
+    *
+    * @param[out] data      the data matrix to write to
+    * @param[in] dest       first column of data to write to
+    * @param[in] from       first sample to read
+    * @param[in] to         last sample to read
+    * @param[in] sel        channel selection vector; all channels if empty
+    * @param[in] cal        calibration matrix set up by make_multiplier
+    * @param[in] mult       sparse multiplier set up by make_multiplier
+    * @param[in] multDense  dense multiplier set up by make_multiplier
+    *
+    * @return true if succeeded, false otherwise
+    */
+    template<typename Scalar>
+    bool read_raw_buffers(Matrix<Scalar, Dynamic, Dynamic>& data, fiff_int_t dest, fiff_int_t from, fiff_int_t to, const RowVectorXi& sel, const SparseMatrix<Scalar>& cal, const SparseMatrix<Scalar>& mult, const Matrix<Scalar, Dynamic, Dynamic>& multDense);
+
+    //=========================================================================================================
+    /**
+    * Decodes a range of samples of a raw data buffer straight from the memory mapped file.
+    *
+    * @param[in] p_RawDir       Raw directory entry of the buffer to decode
+    * @param[in] p_iFirstPick   First sample within the buffer to decode
+    * @param[in] p_iNumPick     Number of samples to decode
+    * @param[in] p_vecSel       Channels to decode; all channels if empty
+    * @param[in] p_vecScale     Scaling for each decoded channel (e.g. calibration); no scaling if empty
+    * @param[out] p_matDest     Destination matrix, decoded channels are written to the rows
+    * @param[in] p_iDestCol     First destination column
+    *
+    * @return true if succeeded, false otherwise
+    */
+    template<typename Scalar>
+    bool read_mapped_buffer(const FiffRawDir& p_RawDir, fiff_int_t p_iFirstPick, fiff_int_t p_iNumPick, const RowVectorXi& p_vecSel, const Matrix<Scalar, 1, Dynamic>& p_vecScale, Matrix<Scalar, Dynamic, Dynamic>& p_matDest, fiff_int_t p_iDestCol) const;
+
+    //=========================================================================================================
+    /**
+    * Converts big endian sample data of type T, stored channel after channel for each sample, to Scalar.
+    *
+    * @param[in] p_pBuffer      Start of the buffer data in the mapping
+    * @param[in] p_iNChan       Number of channels stored in the buffer
+    * @param[in] p_iFirstPick   First sample to decode
+    * @param[in] p_iNumPick     Number of samples to decode
+    * @param[in] p_vecSel       Channels to decode; all channels if empty
+    * @param[in] p_vecScale     Scaling for each decoded channel; no scaling if empty
+    * @param[out] p_matDest     Destination matrix
+    * @param[in] p_iDestCol     First destination column
+    */
+    template<typename T, typename Scalar>
+    static void decode_big_endian(const uchar* p_pBuffer, fiff_int_t p_iNChan, fiff_int_t p_iFirstPick, fiff_int_t p_iNumPick, const RowVectorXi& p_vecSel, const Matrix<Scalar, 1, Dynamic>& p_vecScale, Matrix<Scalar, Dynamic, Dynamic>& p_matDest, fiff_int_t p_iDestCol);
+
+    //=========================================================================================================
+    /**
+    * Reads a single big endian value of type T.
+    *
+    * @param[in] p_pData    Pointer to the big endian value
+    *
+    * @return the value in host byte order
+    */
+    template<typename T>
+    static inline T from_big_endian(const uchar* p_pData);
+
+    //=========================================================================================================
+    /**
+    * Samples of a raw data buffer to decode from the memory mapped file.
+    */
+    struct MappedBuffer
+    {
+        qint32 iRawDir;         /**< Index of the buffer in the raw directory. */
+        fiff_int_t iFirstPick;  /**< First sample within the buffer to decode. */
+        fiff_int_t iNumPick;    /**< Number of samples to decode. */
+        fiff_int_t iDestCol;    /**< First destination column. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Decodes, calibrates and projects a range of mapped buffers, for multi-threaded reading. The buffers
+    * write to disjoint columns of the destination.
+    */
+    template<typename Scalar>
+    struct MappedDecode
+    {
+        const FiffRawData* pRaw;                            /**< The raw data, holding the mapping. */
+        const QList<MappedBuffer>* pBuffers;                /**< The buffers to decode. */
+        const RowVectorXi* pSel;                            /**< Channel selection; all channels if empty. */
+        const Matrix<Scalar, 1, Dynamic>* pSelCals;         /**< Calibration of the selected channels, used without multiplier. */
+        const SparseMatrix<Scalar>* pMult;                  /**< Sparse multiplier; empty if not used. */
+        const Matrix<Scalar, Dynamic, Dynamic>* pMultDense; /**< Dense multiplier; empty if not used. */
+        Matrix<Scalar, Dynamic, Dynamic>* pData;            /**< Destination matrix. */
+        QAtomicInt* pFailed;                                /**< Set if a buffer couldn't be decoded. */
+
+        //=====================================================================================================
+        /**
+        * Decodes the buffers p_iFirst ... p_iFirst+p_iNum-1.
+        *
+        * @param[in] p_iFirst   First buffer to decode
+        * @param[in] p_iNum     Number of buffers to decode
+        */
+        void operator()(qint32 p_iFirst, qint32 p_iNum) const;
+    };
+
 public:
     FiffStream::SPtr file;      /**< replaces fid */
     FiffInfo info;              /**< Fiff measurement information */
@@ -183,8 +383,59 @@ public:
     QList<FiffRawDir> rawdir;   /**< Special fiff diretory entry for raw data. */
     MatrixXd proj;              /**< SSP operator to apply to the data. */
     FiffCtfComp comp;           /**< Comepnsator. */
+
+private:
+    uchar* m_pMappedFile;       /**< Start of the memory mapped raw data file; NULL if not mapped. */
+    qint64 m_iMappedSize;       /**< Size of the memory mapping in bytes. */
+
+    bool m_bMultiplierCached;               /**< Whether the cached multiplier was set up. */
+    RowVectorXi m_vecCachedSel;             /**< Channel selection of the cached multiplier. */
+    RowVectorXd m_vecCachedCals;            /**< Calibration of the cached multiplier. */
+    MatrixXd m_matCachedProj;               /**< Projector of the cached multiplier. */
+    fiff_int_t m_iCachedCompKind;           /**< Compensator kind of the cached multiplier. */
+    MatrixXd m_matCachedComp;               /**< Compensator of the cached multiplier. */
+    SparseMatrix<double> m_matCachedCal;    /**< Cached calibration matrix. */
+    SparseMatrix<double> m_matCachedMult;   /**< Cached sparse multiplier. */
+    MatrixXd m_matCachedMultDense;          /**< Cached dense multiplier. */
+
+    bool m_bFloatMultiplierCached;                  /**< Whether the single precision copy of the cached multiplier is up to date. */
+    SparseMatrix<float> m_matCachedCalFloat;        /**< Single precision copy of the cached calibration matrix. */
+    SparseMatrix<float> m_matCachedMultFloat;       /**< Single precision copy of the cached sparse multiplier. */
+    MatrixXf m_matCachedMultDenseFloat;             /**< Single precision copy of the cached dense multiplier. */
 };
 
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool FiffRawData::isMapped() const
+{
+    return m_pMappedFile != NULL;
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+inline T FiffRawData::from_big_endian(const uchar* p_pData)
+{
+    return qFromBigEndian<T>(p_pData);
+}
+
+
+//*************************************************************************************************************
+
+template<>
+inline float FiffRawData::from_big_endian<float>(const uchar* p_pData)
+{
+    quint32 t_iBits = qFromBigEndian<quint32>(p_pData);
+    float t_fValue;
+    memcpy(&t_fValue, &t_iBits, sizeof(float));
+    return t_fValue;
+}
+
 } // NAMESPACE
 
 #endif // FIFF_RAW_DATA_H
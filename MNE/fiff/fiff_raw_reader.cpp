@@ -0,0 +1,161 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_reader.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the FiffRawReader Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_raw_reader.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cstring>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FiffRawReader::FiffRawReader(FiffRawData& p_FiffRawData, fiff_int_t p_iChunkSize, fiff_int_t p_iOverlap, const RowVectorXi& p_vecSel, fiff_int_t p_iFrom, fiff_int_t p_iTo)
+: m_pFiffRawData(&p_FiffRawData)
+, m_vecSel(p_vecSel)
+, m_iChunkSize(p_iChunkSize)
+, m_iOverlap(p_iOverlap)
+, m_iFrom(p_iFrom)
+, m_iTo(p_iTo)
+, m_iFirst(-1)
+, m_iLast(-1)
+{
+    if(m_iChunkSize < 1)
+    {
+        printf("Chunk size has to be at least one sample. Using 1.\n");
+        m_iChunkSize = 1;
+    }
+    if(m_iOverlap < 0 || m_iOverlap >= m_iChunkSize)
+    {
+        printf("Overlap has to be smaller than the chunk size. Using no overlap.\n");
+        m_iOverlap = 0;
+    }
+
+    if(m_iFrom == -1 || m_iFrom < m_pFiffRawData->first_samp)
+        m_iFrom = m_pFiffRawData->first_samp;
+    if(m_iTo == -1 || m_iTo > m_pFiffRawData->last_samp)
+        m_iTo = m_pFiffRawData->last_samp;
+
+    reset();
+}
+
+
+//*************************************************************************************************************
+
+FiffRawReader::~FiffRawReader()
+{
+
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawReader::reset()
+{
+    m_iFirst = -1;
+    m_iLast = -1;
+
+    m_pFiffRawData->make_multiplier(m_vecSel, m_matCal, m_matMult, m_matMultDense);
+
+    fiff_int_t nrow = m_vecSel.size() > 0 ? m_vecSel.size() : m_pFiffRawData->info.nchan;
+    fiff_int_t ncol = m_iFrom <= m_iTo ? qMin(m_iChunkSize, m_iTo - m_iFrom + 1) : 0;
+    m_matData.resize(nrow, ncol);
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawReader::readNext()
+{
+    if(atEnd())
+        return false;
+
+    fiff_int_t first, last, keep;
+
+    if(m_iLast < 0)
+    {
+        first = m_iFrom;
+        keep = 0;
+    }
+    else
+    {
+        first = m_iFirst + m_iChunkSize - m_iOverlap;
+        keep = m_iOverlap;
+    }
+    last = qMin(first + m_iChunkSize - 1, m_iTo);
+
+    //
+    //  Move the overlap to the front of the buffer
+    //
+    if(keep > 0)
+    {
+        qint64 rows = m_matData.rows();
+        memmove(m_matData.data(), m_matData.data() + (m_matData.cols() - keep) * rows, keep * rows * sizeof(double));
+    }
+
+    //
+    //  Only the last chunk may be shorter
+    //
+    if(m_matData.cols() != last - first + 1)
+        m_matData.conservativeResize(m_matData.rows(), last - first + 1);
+
+    if(!m_pFiffRawData->read_raw_buffers(m_matData, keep, first + keep, last, m_vecSel, m_matCal, m_matMult, m_matMultDense))
+        return false;
+
+    m_iFirst = first;
+    m_iLast = last;
+
+    return true;
+}
@@ -0,0 +1,247 @@
+//=============================================================================================================
+/**
+* @file     fiff_raw_reader.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FiffRawReader class declaration.
+*
+*/
+
+#ifndef FIFF_RAW_READER_H
+#define FIFF_RAW_READER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fiff_global.h"
+#include "fiff_types.h"
+#include "fiff_raw_data.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FIFFLIB
+//=============================================================================================================
+
+namespace FIFFLIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Iterates over the raw data of a FiffRawData in chunks of fixed size which may overlap. All chunks are decoded
+* into the same preallocated buffer, only the samples which are not part of the overlap are read. The
+* calibration, projection and compensation multiplier is set up once, so whole recordings can be processed in
+* constant memory.
+*
+* @brief Chunked, streaming reader of fiff raw data
+*/
+class FIFFSHARED_EXPORT FiffRawReader
+{
+public:
+    typedef QSharedPointer<FiffRawReader> SPtr;             /**< Shared pointer type for FiffRawReader. */
+    typedef QSharedPointer<const FiffRawReader> ConstSPtr;  /**< Const shared pointer type for FiffRawReader. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a chunked reader. The raw data have to outlive the reader. Changes of the projector or the
+    * compensator of the raw data take effect after reset.
+    *
+    * @param[in] p_FiffRawData  raw data to read from
+    * @param[in] p_iChunkSize   number of samples per chunk
+    * @param[in] p_iOverlap     number of samples two consecutive chunks have in common (optional, default = 0)
+    * @param[in] p_vecSel       channel selection vector (optional)
+    * @param[in] p_iFrom        first sample to read. If omitted, defaults to the first sample in data (optional)
+    * @param[in] p_iTo          last sample to read. If omitted, defaults to the last sample in data (optional)
+    */
+    FiffRawReader(FiffRawData& p_FiffRawData, fiff_int_t p_iChunkSize, fiff_int_t p_iOverlap = 0, const RowVectorXi& p_vecSel = defaultRowVectorXi, fiff_int_t p_iFrom = -1, fiff_int_t p_iTo = -1);
+
+    //=========================================================================================================
+    /**
+    * Destroys the reader.
+    */
+    ~FiffRawReader();
+
+    //=========================================================================================================
+    /**
+    * Rewinds the reader to the first chunk and sets up the multiplier again.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * True if all chunks were read.
+    *
+    * @return true if all chunks were read
+    */
+    inline bool atEnd() const;
+
+    //=========================================================================================================
+    /**
+    * Reads the next chunk into the chunk buffer. The last chunk may hold less than chunkSize samples.
+    *
+    * @return true if a chunk was read, false at the end of the data or on failure
+    */
+    bool readNext();
+
+    //=========================================================================================================
+    /**
+    * Returns the current chunk (selected channels x samples). The buffer is overwritten by the next readNext.
+    *
+    * @return the current chunk
+    */
+    inline const MatrixXd& data() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the first sample of the current chunk.
+    *
+    * @return the first sample of the current chunk; -1 if no chunk was read yet
+    */
+    inline fiff_int_t first() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the last sample of the current chunk.
+    *
+    * @return the last sample of the current chunk; -1 if no chunk was read yet
+    */
+    inline fiff_int_t last() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of samples per chunk.
+    *
+    * @return the number of samples per chunk
+    */
+    inline fiff_int_t chunkSize() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of samples two consecutive chunks have in common.
+    *
+    * @return the overlap in samples
+    */
+    inline fiff_int_t overlap() const;
+
+private:
+    FiffRawData* m_pFiffRawData;    /**< The raw data to read from. */
+    RowVectorXi m_vecSel;           /**< Channel selection. */
+    fiff_int_t m_iChunkSize;        /**< Number of samples per chunk. */
+    fiff_int_t m_iOverlap;          /**< Number of samples two consecutive chunks have in common. */
+    fiff_int_t m_iFrom;             /**< First sample to read. */
+    fiff_int_t m_iTo;               /**< Last sample to read. */
+    fiff_int_t m_iFirst;            /**< First sample of the current chunk. */
+    fiff_int_t m_iLast;             /**< Last sample of the current chunk. */
+    SparseMatrix<double> m_matCal;  /**< Calibration matrix. */
+    SparseMatrix<double> m_matMult; /**< Sparse projection, compensation and calibration multiplier. */
+    MatrixXd m_matMultDense;        /**< Dense projection, compensation and calibration multiplier. */
+    MatrixXd m_matData;             /**< The chunk buffer. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline bool FiffRawReader::atEnd() const
+{
+    return m_iFrom > m_iTo || m_iLast >= m_iTo;
+}
+
+
+//*************************************************************************************************************
+
+inline const MatrixXd& FiffRawReader::data() const
+{
+    return m_matData;
+}
+
+
+//*************************************************************************************************************
+
+inline fiff_int_t FiffRawReader::first() const
+{
+    return m_iFirst;
+}
+
+
+//*************************************************************************************************************
+
+inline fiff_int_t FiffRawReader::last() const
+{
+    return m_iLast;
+}
+
+
+//*************************************************************************************************************
+
+inline fiff_int_t FiffRawReader::chunkSize() const
+{
+    return m_iChunkSize;
+}
+
+
+//*************************************************************************************************************
+
+inline fiff_int_t FiffRawReader::overlap() const
+{
+    return m_iOverlap;
+}
+
+} // NAMESPACE
+
+#endif // FIFF_RAW_READER_H
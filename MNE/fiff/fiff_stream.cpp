@@ -48,6 +48,7 @@
 #include "fiff_cov.h"
 
 #include <utils/mnemath.h>
+#include <utils/ioutils.h>
 
 
 //*************************************************************************************************************
@@ -58,6 +59,15 @@
 #include <QFile>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <math.h>
+#include <limits>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
@@ -1966,6 +1976,25 @@ void FiffStream::write_dig_point(const FiffDigPoint& dig)
 }
 
 
+//*************************************************************************************************************
+
+template<typename T>
+void FiffStream::write_big_endian(const T* p_pData, qint64 p_iCount)
+{
+    const qint64 t_iChunk = ScratchSize / sizeof(T);
+    qint64 t_iSize = qMin(t_iChunk, p_iCount)*sizeof(T);
+    if(m_qByteArrayScratch.size() < t_iSize)
+        m_qByteArrayScratch.resize(t_iSize);
+
+    for(qint64 i = 0; i < p_iCount; i += t_iChunk)
+    {
+        qint64 t_iNum = qMin(t_iChunk, p_iCount - i);
+        IOUtils::to_big_endian(p_pData + i, t_iNum, m_qByteArrayScratch.data());
+        this->writeRawData(m_qByteArrayScratch.constData(), t_iNum*sizeof(T));
+    }
+}
+
+
 //*************************************************************************************************************
 
 void FiffStream::write_double(fiff_int_t kind, const double* data, fiff_int_t nel)
@@ -1977,10 +2006,7 @@ void FiffStream::write_double(fiff_int_t kind, const double* data, fiff_int_t ne
     *this << (qint32)datasize;
     *this << (qint32)FIFFV_NEXT_SEQ;
 
-//    this->setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-    for(qint32 i = 0; i < nel; ++i)
-        *this << data[i];
+    this->write_big_endian(data, nel);
 }
 
 
@@ -1995,10 +2021,7 @@ void FiffStream::write_float(fiff_int_t kind, const float* data, fiff_int_t nel)
     *this << (qint32)datasize;
     *this << (qint32)FIFFV_NEXT_SEQ;
 
-//    this->setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-    for(qint32 i = 0; i < nel; ++i)
-        *this << data[i];
+    this->write_big_endian(data, nel);
 }
 
 
@@ -2018,17 +2041,14 @@ void FiffStream::write_float_matrix(fiff_int_t kind, const MatrixXf& mat)
     *this << (qint32)datasize;
     *this << (qint32)FIFFV_NEXT_SEQ;
 
-    qint32 i;
-    for(i = 0; i < numel; ++i)
-        *this << mat.data()[i];
+    this->write_big_endian(mat.data(), numel);
 
     qint32 dims[3];
     dims[0] = mat.cols();
     dims[1] = mat.rows();
     dims[2] = 2;
 
-    for(i = 0; i < 3; ++i)
-        *this << dims[i];
+    this->write_big_endian(dims, 3);
 }
 
 
@@ -2082,16 +2102,20 @@ void FiffStream::write_float_sparse_ccs(fiff_int_t kind, const SparseMatrix<floa
     *this << (qint32)FIFFV_NEXT_SEQ;
 
     //
-    //  The data values
-    //
-    for(i = 0; i < s.size(); ++i)
-        *this << s[i].value();
-
-    //
-    //  Row indices
+    //  The data values and row indices
     //
+    std::vector<float> values(s.size());
+    std::vector<qint32> inds(s.size());
     for(i = 0; i < s.size(); ++i)
-        *this << s[i].row();
+    {
+        values[i] = s[i].value();
+        inds[i] = s[i].row();
+    }
+    if(!s.empty())
+    {
+        this->write_big_endian(&values[0], values.size());
+        this->write_big_endian(&inds[0], inds.size());
+    }
 
     //
     //  Pointers
@@ -2109,8 +2133,7 @@ void FiffStream::write_float_sparse_ccs(fiff_int_t kind, const SparseMatrix<floa
        if(ptrs[k-1] < 0)
           ptrs[k-1] = ptrs[k];
     //
-    for(i = 0; i < (quint32)ptrs.size(); ++i)
-        *this << ptrs[i];
+    this->write_big_endian(ptrs.data(), ptrs.size());
     //
     //   Dimensions
     //
@@ -2120,8 +2143,7 @@ void FiffStream::write_float_sparse_ccs(fiff_int_t kind, const SparseMatrix<floa
     dims[2] = mat.cols();
     dims[3] = 2;
 
-    for(i = 0; i < 4; ++i)
-        *this << dims[i];
+    this->write_big_endian(dims, 4);
 }
 
 
@@ -2175,16 +2197,20 @@ void FiffStream::write_float_sparse_rcs(fiff_int_t kind, const SparseMatrix<floa
     *this << (qint32)FIFFV_NEXT_SEQ;
 
     //
-    //  The data values
-    //
-    for(i = 0; i < s.size(); ++i)
-        *this << s[i].value();
-
-    //
-    //  Column indices
+    //  The data values and column indices
     //
+    std::vector<float> values(s.size());
+    std::vector<qint32> inds(s.size());
     for(i = 0; i < s.size(); ++i)
-        *this << s[i].col();
+    {
+        values[i] = s[i].value();
+        inds[i] = s[i].col();
+    }
+    if(!s.empty())
+    {
+        this->write_big_endian(&values[0], values.size());
+        this->write_big_endian(&inds[0], inds.size());
+    }
 
     //
     //  Pointers
@@ -2204,8 +2230,7 @@ void FiffStream::write_float_sparse_rcs(fiff_int_t kind, const SparseMatrix<floa
           ptrs[k-1] = ptrs[k];
 
     //
-    for(i = 0; i < (quint32)ptrs.size(); ++i)
-        *this << ptrs[i];
+    this->write_big_endian(ptrs.data(), ptrs.size());
 
     //
     //  Dimensions
@@ -2216,8 +2241,7 @@ void FiffStream::write_float_sparse_rcs(fiff_int_t kind, const SparseMatrix<floa
     dims[2] = mat.cols();
     dims[3] = 2;
 
-    for(i = 0; i < 4; ++i)
-        *this << dims[i];
+    this->write_big_endian(dims, 4);
 }
 
 
@@ -2343,8 +2367,7 @@ void FiffStream::write_int(fiff_int_t kind, const fiff_int_t* data, fiff_int_t n
     *this << (qint32)datasize;
     *this << (qint32)FIFFV_NEXT_SEQ;
 
-    for(qint32 i = 0; i < nel; ++i)
-        *this << data[i];
+    this->write_big_endian(data, nel);
 }
 
 
@@ -2364,17 +2387,14 @@ void FiffStream::write_int_matrix(fiff_int_t kind, const MatrixXi& mat)
     *this << (qint32)datasize;
     *this << (qint32)FIFFV_NEXT_SEQ;
 
-    qint32 i;
-    for(i = 0; i < numel; ++i)
-        *this << mat.data()[i];
+    this->write_big_endian(mat.data(), numel);
 
     qint32 dims[3];
     dims[0] = mat.cols();
     dims[1] = mat.rows();
     dims[2] = 2;
 
-    for(i = 0; i < 3; ++i)
-        *this << dims[i];
+    this->write_big_endian(dims, 3);
 }
 
 
@@ -2487,3 +2507,122 @@ void FiffStream::write_rt_command(fiff_int_t command, const QString& data)
 
     this->writeRawData(data.toUtf8().constData(),datasize);
 }
+
+
+//*************************************************************************************************************
+
+void FiffStream::write_rt_raw_buffer(const MatrixXf& buf, fiff_int_t mode)
+{
+    if(mode != FIFFV_MNE_RT_STREAM_PACK16 && mode != FIFFV_MNE_RT_STREAM_PACK24 && mode != FIFFV_MNE_RT_STREAM_LOSSLESS)
+    {
+        this->write_float(FIFF_DATA_BUFFER, buf.data(), buf.size());
+        return;
+    }
+
+    qint32 nChannels = buf.rows();
+    qint32 nSamples = buf.cols();
+    qint64 n = buf.size();
+    qint32 dims[2];
+    dims[0] = nChannels;
+    dims[1] = nSamples;
+
+    qint32 c, s;
+    qint64 k;
+    quint32 t_iBits;
+
+    if(mode == FIFFV_MNE_RT_STREAM_LOSSLESS)
+    {
+        //
+        // Xor of consecutive samples: unchanged sign, exponent and leading mantissa bits become zeros, which
+        // deflate well once the bytes are grouped by significance
+        //
+        QByteArray t_qByteArrayPlanes(4*n, 0);
+        uchar* t_pPlanes = (uchar*)t_qByteArrayPlanes.data();
+        for(c = 0, k = 0; c < nChannels; ++c)
+        {
+            quint32 t_iPrevBits = 0;
+            for(s = 0; s < nSamples; ++s, ++k)
+            {
+                memcpy(&t_iBits, &buf(c,s), sizeof(float));
+                quint32 t_iXor = t_iBits ^ t_iPrevBits;
+                t_iPrevBits = t_iBits;
+                t_pPlanes[k] = t_iXor >> 24;
+                t_pPlanes[n+k] = t_iXor >> 16;
+                t_pPlanes[2*n+k] = t_iXor >> 8;
+                t_pPlanes[3*n+k] = t_iXor;
+            }
+        }
+        QByteArray t_qByteArrayDeflated = qCompress(t_qByteArrayPlanes, 1);
+
+        *this << (qint32)FIFF_MNE_RT_DATA_BUFFER_LOSSLESS;
+        *this << (qint32)FIFFT_VOID;
+        *this << (qint32)(8 + t_qByteArrayDeflated.size());
+        *this << (qint32)FIFFV_NEXT_SEQ;
+
+        this->write_big_endian(dims, 2);
+        this->writeRawData(t_qByteArrayDeflated.constData(), t_qByteArrayDeflated.size());
+        return;
+    }
+
+    //
+    // Per channel scales from the finite samples, small integer channels are kept exact; NaN and Inf samples
+    // (saturated or dropped channels) are sent as zeros, they would turn the scale or the rounding invalid
+    //
+    qint32 t_iBytes = mode == FIFFV_MNE_RT_STREAM_PACK24 ? 3 : 2;
+    float t_fMax = mode == FIFFV_MNE_RT_STREAM_PACK24 ? 8388607.0f : 32767.0f;
+    const float t_fFiniteMax = std::numeric_limits<float>::max();
+
+    VectorXf t_vecScales(nChannels);
+    VectorXf t_vecInvScales(nChannels);
+    for(c = 0; c < nChannels; ++c)
+    {
+        float t_fMaxAbs = 0;
+        bool t_bIntegral = true;
+        for(s = 0; s < nSamples; ++s)
+        {
+            float t_fValue = buf(c,s);
+            if(!(qAbs(t_fValue) <= t_fFiniteMax))
+                continue;
+            t_fMaxAbs = qMax(t_fMaxAbs, qAbs(t_fValue));
+            t_bIntegral = t_bIntegral && t_fValue == floorf(t_fValue);
+        }
+        if((t_bIntegral && t_fMaxAbs <= t_fMax) || t_fMaxAbs == 0)
+            t_vecScales[c] = 1.0f;
+        else
+            t_vecScales[c] = t_fMaxAbs / t_fMax;
+        t_vecInvScales[c] = 1.0f / t_vecScales[c];
+    }
+
+    QByteArray t_qByteArrayPacked(t_iBytes*n, 0);
+    uchar* t_pPacked = (uchar*)t_qByteArrayPacked.data();
+    const float* t_pData = buf.data();
+    for(s = 0; s < nSamples; ++s)
+    {
+        for(c = 0; c < nChannels; ++c, t_pPacked += t_iBytes)
+        {
+            float t_fValue = *t_pData++;
+            qint32 t_iValue = qAbs(t_fValue) <= t_fFiniteMax ? qRound(t_fValue * t_vecInvScales[c]) : 0;
+            t_iValue = qBound((qint32)-t_fMax, t_iValue, (qint32)t_fMax);
+            if(t_iBytes == 3)
+            {
+                t_pPacked[0] = t_iValue >> 16;
+                t_pPacked[1] = t_iValue >> 8;
+                t_pPacked[2] = t_iValue;
+            }
+            else
+            {
+                t_pPacked[0] = t_iValue >> 8;
+                t_pPacked[1] = t_iValue;
+            }
+        }
+    }
+
+    *this << (qint32)(mode == FIFFV_MNE_RT_STREAM_PACK24 ? FIFF_MNE_RT_DATA_BUFFER_PACK24 : FIFF_MNE_RT_DATA_BUFFER_PACK16);
+    *this << (qint32)FIFFT_VOID;
+    *this << (qint32)(8 + 4*nChannels + t_qByteArrayPacked.size());
+    *this << (qint32)FIFFV_NEXT_SEQ;
+
+    this->write_big_endian(dims, 2);
+    this->write_big_endian(t_vecScales.data(), nChannels);
+    this->writeRawData(t_qByteArrayPacked.constData(), t_qByteArrayPacked.size());
+}
@@ -663,6 +663,35 @@ public:
     * @param[in] data       The string data to write
     */
     void write_rt_command(fiff_int_t command, const QString& data);
+
+    //=========================================================================================================
+    /**
+    * Writes a real-time raw buffer in the given raw stream mode, decoded by FiffTag::toRtRawBuffer:
+    * FIFFV_MNE_RT_STREAM_FLOAT writes a FIFF_DATA_BUFFER float tag. FIFFV_MNE_RT_STREAM_PACK16/PACK24 write the
+    * dimensions, a scale per channel and the data rounded to 16/24 bit integers; channels holding small integers
+    * only (e.g. stimulus channels) get the scale 1 and are exact. FIFFV_MNE_RT_STREAM_LOSSLESS writes the
+    * dimensions and the deflated xor of consecutive samples of each channel, with the bytes grouped by
+    * significance.
+    *
+    * @param[in] buf    The raw buffer (channels x samples)
+    * @param[in] mode   The raw stream mode
+    */
+    void write_rt_raw_buffer(const MatrixXf& buf, fiff_int_t mode);
+
+private:
+    //=========================================================================================================
+    /**
+    * Writes an array in big endian byte order. The array is swapped chunk wise into the scratch buffer and each
+    * chunk is written with a single writeRawData, instead of streaming the elements one by one.
+    *
+    * @param[in] p_pData    Array of 2, 4 or 8 byte elements
+    * @param[in] p_iCount   Number of elements
+    */
+    template<typename T>
+    void write_big_endian(const T* p_pData, qint64 p_iCount);
+
+    static const qint32 ScratchSize = 65536;    /**< Maximal size of the scratch buffer in bytes. */
+    QByteArray m_qByteArrayScratch;             /**< Reusable scratch buffer of the bulk writers. */
 };
 
 } // NAMESPACE
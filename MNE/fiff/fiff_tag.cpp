@@ -49,6 +49,7 @@
 //=============================================================================================================
 
 #include <QTcpSocket>
+#include <QtEndian>
 
 
 //*************************************************************************************************************
@@ -469,9 +470,7 @@ void FiffTag::convert_matrix_from_file_data(FiffTag::SPtr tag)
 {
     int ndim;
     int k;
-    int *dimp,*data,kind,np,nz;
-    float *fdata;
-    double *ddata;
+    int *dimp,kind,np,nz;
     unsigned int tsize = tag->size();
 
     if (fiff_type_fundamental(tag->type) != FIFFTS_FS_MATRIX)
@@ -511,26 +510,19 @@ void FiffTag::convert_matrix_from_file_data(FiffTag::SPtr tag)
         /*
          * Take care of the indices
         */
-        for (data = (int *)(tag->data())+nz, k = 0; k < np; k++)
-            IOUtils::swap_intp(data+k);
+        IOUtils::swap_array((int *)(tag->data())+nz, np);
         np = nz;
     }
     /*
      * Now convert data...
      */
     kind = fiff_type_base(tag->type);
-    if (kind == FIFFT_INT) {
-        for (data = (int *)(tag->data()), k = 0; k < np; k++)
-            IOUtils::swap_intp(data+k);
-    }
-    else if (kind == FIFFT_FLOAT) {
-        for (fdata = (float *)(tag->data()), k = 0; k < np; k++)
-            IOUtils::swap_floatp(fdata+k);
-    }
-    else if (kind == FIFFT_DOUBLE) {
-        for (ddata = (double *)(tag->data()), k = 0; k < np; k++)
-            IOUtils::swap_doublep(ddata+k);
-    }
+    if (kind == FIFFT_INT)
+        IOUtils::swap_array((int *)(tag->data()), np);
+    else if (kind == FIFFT_FLOAT)
+        IOUtils::swap_array((float *)(tag->data()), np);
+    else if (kind == FIFFT_DOUBLE)
+        IOUtils::swap_array((double *)(tag->data()), np);
     return;
 }
 
@@ -544,9 +536,7 @@ void FiffTag::convert_matrix_to_file_data(FiffTag::SPtr tag)
 {
     int ndim;
     int k;
-    int *dimp,*data,kind,np;
-    float *fdata;
-    double *ddata;
+    int *dimp,kind,np;
     unsigned int tsize = tag->size();
 
     if (fiff_type_fundamental(tag->type) != FIFFTS_FS_MATRIX)
@@ -588,26 +578,16 @@ void FiffTag::convert_matrix_to_file_data(FiffTag::SPtr tag)
     * Now convert data...
     */
     kind = fiff_type_base(tag->type);
-    if (kind == FIFFT_INT) {
-        for (data = (int *)(tag->data()), k = 0; k < np; k++)
-            IOUtils::swap_intp(data+k);
-    }
-    else if (kind == FIFFT_FLOAT) {
-        for (fdata = (float *)(tag->data()), k = 0; k < np; k++)
-            IOUtils::swap_floatp(fdata+k);
-    }
-    else if (kind == FIFFT_DOUBLE) {
-        for (ddata = (double *)(tag->data()), k = 0; k < np; k++)
-            IOUtils::swap_doublep(ddata+k);
-    }
-    else if (kind == FIFFT_COMPLEX_FLOAT) {
-        for (fdata = (float *)(tag->data()), k = 0; k < 2*np; k++)
-            IOUtils::swap_floatp(fdata+k);
-    }
-    else if (kind == FIFFT_COMPLEX_DOUBLE) {
-        for (ddata = (double *)(tag->data()), k = 0; k < 2*np; k++)
-            IOUtils::swap_doublep(ddata+k);
-    }
+    if (kind == FIFFT_INT)
+        IOUtils::swap_array((int *)(tag->data()), np);
+    else if (kind == FIFFT_FLOAT)
+        IOUtils::swap_array((float *)(tag->data()), np);
+    else if (kind == FIFFT_DOUBLE)
+        IOUtils::swap_array((double *)(tag->data()), np);
+    else if (kind == FIFFT_COMPLEX_FLOAT)
+        IOUtils::swap_array((float *)(tag->data()), 2*np);
+    else if (kind == FIFFT_COMPLEX_DOUBLE)
+        IOUtils::swap_array((double *)(tag->data()), 2*np);
     return;
 }
 
@@ -621,9 +601,7 @@ void FiffTag::convert_tag_data(FiffTag::SPtr tag, int from_endian, int to_endian
     char           *offset;
     fiff_int_t     *ithis;
     fiff_short_t   *sthis;
-    fiff_long_t    *lthis;
     float          *fthis;
-    double         *dthis;
 //    fiffDirEntry   dethis;
 //    fiffId         idthis;
 //    fiffChInfoRec* chthis;//FiffChInfo*     chthis;//ToDo adapt parsing to the new class
@@ -657,37 +635,32 @@ void FiffTag::convert_tag_data(FiffTag::SPtr tag, int from_endian, int to_endian
     case FIFFT_JULIAN :
     case FIFFT_UINT :
         np = tag->size()/sizeof(fiff_int_t);
-        for (ithis = (fiff_int_t *)tag->data(), k = 0; k < np; k++, ithis++)
-            IOUtils::swap_intp(ithis);
+        IOUtils::swap_array((fiff_int_t *)tag->data(), np);
         break;
 
     case FIFFT_LONG :
     case FIFFT_ULONG :
         np = tag->size()/sizeof(fiff_long_t);
-        for (lthis = (fiff_long_t *)tag->data(), k = 0; k < np; k++, lthis++)
-            IOUtils::swap_longp(lthis);
+        IOUtils::swap_array((fiff_long_t *)tag->data(), np);
         break;
 
     case FIFFT_SHORT :
     case FIFFT_DAU_PACK16 :
     case FIFFT_USHORT :
         np = tag->size()/sizeof(fiff_short_t);
-        for (sthis = (fiff_short_t *)tag->data(), k = 0; k < np; k++, sthis++)
-            *sthis = IOUtils::swap_short(*sthis);
+        IOUtils::swap_array((fiff_short_t *)tag->data(), np);
         break;
 
     case FIFFT_FLOAT :
     case FIFFT_COMPLEX_FLOAT :
         np = tag->size()/sizeof(fiff_float_t);
-        for (fthis = (fiff_float_t *)tag->data(), k = 0; k < np; k++, fthis++)
-            IOUtils::swap_floatp(fthis);
+        IOUtils::swap_array((fiff_float_t *)tag->data(), np);
         break;
 
     case FIFFT_DOUBLE :
     case FIFFT_COMPLEX_DOUBLE :
         np = tag->size()/sizeof(fiff_double_t);
-        for (dthis = (fiff_double_t *)tag->data(), k = 0; k < np; k++, dthis++)
-            IOUtils::swap_doublep(dthis);
+        IOUtils::swap_array((fiff_double_t *)tag->data(), np);
         break;
 
     case FIFFT_OLD_PACK :
@@ -699,8 +672,7 @@ void FiffTag::convert_tag_data(FiffTag::SPtr tag, int from_endian, int to_endian
         IOUtils::swap_floatp(fthis+1);
         sthis = (short *)(fthis+2);
         np = (tag->size() - 2*sizeof(float))/sizeof(short);
-        for (k = 0; k < np; k++,sthis++)
-            *sthis = IOUtils::swap_short(*sthis);
+        IOUtils::swap_array(sthis, np);
         break;
 
     case FIFFT_DIR_ENTRY_STRUCT :
@@ -866,6 +838,102 @@ void FiffTag::convert_tag_data(FiffTag::SPtr tag, int from_endian, int to_endian
     return;
 }
 
+//*************************************************************************************************************
+
+bool FiffTag::toRtRawBuffer(MatrixXf& p_matData, qint32 p_nChannels) const
+{
+    const uchar* t_pData = (const uchar*)this->constData();
+
+    if(this->kind == FIFF_DATA_BUFFER)
+    {
+        if(this->isMatrix() || this->getType() != FIFFT_FLOAT || p_nChannels <= 0)
+            return false;
+        qint32 nSamples = (this->size()/4)/p_nChannels;
+        p_matData = Map<const MatrixXf>((const float*)t_pData, p_nChannels, nSamples);
+        return true;
+    }
+
+    if((this->kind != FIFF_MNE_RT_DATA_BUFFER_PACK16 && this->kind != FIFF_MNE_RT_DATA_BUFFER_PACK24
+        && this->kind != FIFF_MNE_RT_DATA_BUFFER_LOSSLESS) || this->size() < 2*(int)sizeof(qint32))
+        return false;
+
+    //
+    // Dimensions
+    //
+    qint32 nChannels = qFromBigEndian<qint32>(t_pData);
+    qint32 nSamples = qFromBigEndian<qint32>(t_pData + 4);
+    qint64 n = (qint64)nChannels*nSamples;
+    t_pData += 8;
+    if(nChannels < 0 || nSamples < 0)
+        return false;
+
+    qint32 c, s;
+    qint64 k;
+    quint32 t_iBits;
+
+    if(this->kind == FIFF_MNE_RT_DATA_BUFFER_LOSSLESS)
+    {
+        //
+        // Inflate the significance planes and undo the xor of consecutive samples
+        //
+        QByteArray t_qByteArrayPlanes = qUncompress(t_pData, this->size() - 8);
+        if(t_qByteArrayPlanes.size() != 4*n)
+            return false;
+        const uchar* t_pPlanes = (const uchar*)t_qByteArrayPlanes.constData();
+
+        p_matData.resize(nChannels, nSamples);
+        for(c = 0, k = 0; c < nChannels; ++c)
+        {
+            t_iBits = 0;
+            for(s = 0; s < nSamples; ++s, ++k)
+            {
+                t_iBits ^= ((quint32)t_pPlanes[k] << 24) | ((quint32)t_pPlanes[n+k] << 16)
+                        | ((quint32)t_pPlanes[2*n+k] << 8) | (quint32)t_pPlanes[3*n+k];
+                memcpy(&p_matData(c,s), &t_iBits, sizeof(float));
+            }
+        }
+        return true;
+    }
+
+    //
+    // Packed integers with per channel scales
+    //
+    qint32 t_iBytes = this->kind == FIFF_MNE_RT_DATA_BUFFER_PACK24 ? 3 : 2;
+    if(this->size() < 8 + 4*nChannels + t_iBytes*n)
+        return false;
+
+    VectorXf t_vecScales(nChannels);
+    for(c = 0; c < nChannels; ++c, t_pData += 4)
+    {
+        t_iBits = qFromBigEndian<quint32>(t_pData);
+        memcpy(&t_vecScales[c], &t_iBits, sizeof(float));
+    }
+
+    p_matData.resize(nChannels, nSamples);
+    float* t_pMat = p_matData.data();
+    if(t_iBytes == 2)
+    {
+        for(s = 0; s < nSamples; ++s)
+            for(c = 0; c < nChannels; ++c, t_pData += 2)
+                *t_pMat++ = (qint16)qFromBigEndian<quint16>(t_pData) * t_vecScales[c];
+    }
+    else
+    {
+        for(s = 0; s < nSamples; ++s)
+        {
+            for(c = 0; c < nChannels; ++c, t_pData += 3)
+            {
+                qint32 t_iValue = ((qint32)t_pData[0] << 16) | ((qint32)t_pData[1] << 8) | (qint32)t_pData[2];
+                if(t_iValue & 0x800000)
+                    t_iValue -= 0x1000000;
+                *t_pMat++ = t_iValue * t_vecScales[c];
+            }
+        }
+    }
+    return true;
+}
+
+
 //*************************************************************************************************************
 //fiff_type_spec
 
@@ -495,6 +495,19 @@ public:
     */
     inline SparseMatrix<double> toSparseFloatMatrix() const;
 
+    //=========================================================================================================
+    /**
+    * Decodes a real-time raw buffer, sent in any of the raw stream modes (see FiffStream::write_rt_raw_buffer):
+    * a FIFF_DATA_BUFFER float tag, a FIFF_MNE_RT_DATA_BUFFER_PACK16/PACK24 or a FIFF_MNE_RT_DATA_BUFFER_LOSSLESS
+    * tag.
+    *
+    * @param[out] p_matData     The decoded raw buffer (channels x samples)
+    * @param[in] p_nChannels    Number of channels, needed by FIFF_DATA_BUFFER tags only
+    *
+    * @return true if the tag is a valid raw buffer, false otherwise
+    */
+    bool toRtRawBuffer(MatrixXf& p_matData, qint32 p_nChannels) const;
+
     //
     //from fiff_combat.c
     //
@@ -46,6 +46,7 @@
 #include "buffer.h"
 
 #include <typeinfo>
+#include <cstring>
 
 
 //*************************************************************************************************************
@@ -118,8 +119,20 @@ public:
     * Adds a whole matrix at the end buffer.
     *
     * @param [in] pMatrix pointer to a Matrix which should be apend to the end.
+    * @param [in] iTag    (optional) tag which travels with the matrix, e.g. its latency trace sequence; -1 by default.
     */
-    inline void push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix);
+    inline void push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix, qint32 iTag = -1);
+
+    //=========================================================================================================
+    /**
+    * Adds a whole matrix of another scalar type at the end buffer. The elements are converted while they are
+    * written to the buffer, without a converted copy of the matrix.
+    *
+    * @param [in] pMatrix pointer to a Matrix which should be apend to the end.
+    * @param [in] iTag    (optional) tag which travels with the matrix; -1 by default.
+    */
+    template<typename _Src>
+    inline void push(const Matrix<_Src, Dynamic, Dynamic>* pMatrix, qint32 iTag = -1);
 
     //=========================================================================================================
     /**
@@ -129,12 +142,42 @@ public:
     */
     inline Matrix<_Tp, Dynamic, Dynamic> pop();
 
+    //=========================================================================================================
+    /**
+    * Writes the first matrix (first in first out) to a caller owned matrix. Blocks until a matrix is available.
+    * The matrix is only reallocated if its dimensions do not match the buffer's ones.
+    *
+    * @param [out] matrix   the matrix to write the first matrix to.
+    * @param [out] pTag     (optional) receives the tag the matrix was pushed with.
+    */
+    inline void pop(Matrix<_Tp, Dynamic, Dynamic>& matrix, qint32* pTag = NULL);
+
+    //=========================================================================================================
+    /**
+    * Writes the first matrix (first in first out) to a caller owned matrix, if one becomes available within
+    * the given time. Consumer threads use this to check regularly whether they should stop.
+    *
+    * @param [out] matrix   the matrix to write the first matrix to; untouched if no matrix is available.
+    * @param [in] timeout   Time to wait for a matrix in milliseconds; 0 returns immediately, a negative value
+    *                       waits forever.
+    * @param [out] pTag     (optional) receives the tag the matrix was pushed with.
+    *
+    * @return true if a matrix was popped, false if the timeout expired.
+    */
+    inline bool tryPop(Matrix<_Tp, Dynamic, Dynamic>& matrix, int timeout = 0, qint32* pTag = NULL);
+
     //=========================================================================================================
     /**
     * Clears the buffer.
     */
     void clear();
 
+    //=========================================================================================================
+    /**
+    * Number of matrices currently stored, e.g. to monitor the queue depth of a consumer.
+    */
+    inline quint32 available() const;
+
     //=========================================================================================================
     /**
     * Size of the buffer.
@@ -156,20 +199,42 @@ public:
 private:
     //=========================================================================================================
     /**
-    * Returns the current circular index to the corresponding given index.
+    * Copies elements into the buffer at the current write position. The elements are copied in at most two
+    * contiguous blocks: up to the end of the buffer and from its start.
+    *
+    * @param [in] pData     Elements to copy.
+    * @param [in] uiSize    Number of elements.
+    */
+    inline void write(const _Tp* pData, unsigned int uiSize);
+
+    //=========================================================================================================
+    /**
+    * Converts elements of another scalar type into the buffer at the current write position, in at most two
+    * contiguous blocks.
     *
-    * @param [in] index which should be mapped.
-    * @return the mapped index.
+    * @param [in] pData     Elements to convert.
+    * @param [in] uiSize    Number of elements.
     */
-    inline unsigned int mapIndex(int& index);
+    template<typename _Src>
+    inline void write(const _Src* pData, unsigned int uiSize);
+
+    //=========================================================================================================
+    /**
+    * Copies elements out of the buffer from the current read position, in at most two contiguous blocks.
+    *
+    * @param [out] pData    Destination of the elements.
+    * @param [in] uiSize    Number of elements.
+    */
+    inline void read(_Tp* pData, unsigned int uiSize);
 
     unsigned int    m_uiMaxNumMatrices;         /**< Holds the maximal number of matrices.*/
     unsigned int    m_uiRows;                   /**< Holds the number rows.*/
     unsigned int    m_uiCols;                   /**< Holds the number cols.*/
     unsigned int    m_uiMaxNumElements;         /**< Holds the maximal number of buffer elements.*/
     _Tp*            m_pBuffer;                  /**< Holds the circular buffer.*/
-    int             m_iCurrentReadIndex;        /**< Holds the current read index.*/
-    int             m_iCurrentWriteIndex;       /**< Holds the current write index.*/
+    qint32*         m_pTags;                    /**< Holds the tag of each stored matrix, indexed by the matrix slot.*/
+    unsigned int    m_uiCurrentReadIndex;       /**< Holds the index of the next element to read.*/
+    unsigned int    m_uiCurrentWriteIndex;      /**< Holds the index of the next element to write.*/
     QSemaphore*     m_pFreeElements;            /**< Holds a semaphore which acquires free elements for thread safe writing. A semaphore is a generalization of a mutex.*/
     QSemaphore*     m_pUsedElements;            /**< Holds a semaphore which acquires written semaphore for thread safe reading.*/
 };
@@ -188,8 +253,9 @@ CircularMatrixBuffer<_Tp>::CircularMatrixBuffer(unsigned int uiMaxNumMatrices, u
 , m_uiCols(uiCols)
 , m_uiMaxNumElements(m_uiMaxNumMatrices*m_uiRows*m_uiCols)
 , m_pBuffer(new _Tp[m_uiMaxNumElements])
-, m_iCurrentReadIndex(-1)
-, m_iCurrentWriteIndex(-1)
+, m_pTags(new qint32[m_uiMaxNumMatrices])
+, m_uiCurrentReadIndex(0)
+, m_uiCurrentWriteIndex(0)
 , m_pFreeElements(new QSemaphore(m_uiMaxNumElements))
 , m_pUsedElements(new QSemaphore(0))
 {
@@ -205,20 +271,21 @@ CircularMatrixBuffer<_Tp>::~CircularMatrixBuffer()
     delete m_pFreeElements;
     delete m_pUsedElements;
     delete [] m_pBuffer;
+    delete [] m_pTags;
 }
 
 
 //*************************************************************************************************************
 
 template<typename _Tp>
-inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix, qint32 iTag)
 {
     unsigned int t_size = pMatrix->size();
     if(t_size == m_uiRows*m_uiCols)
     {
         m_pFreeElements->acquire(t_size);
-        for(unsigned int i = 0; i < t_size; ++i)
-            m_pBuffer[mapIndex(m_iCurrentWriteIndex)] = pMatrix->data()[i];
+        m_pTags[m_uiCurrentWriteIndex / t_size] = iTag;
+        write(pMatrix->data(), t_size);
         m_pUsedElements->release(t_size);
     }
 //    else
@@ -226,16 +293,30 @@ inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>*
 }
 
 
+//*************************************************************************************************************
+
+template<typename _Tp>
+template<typename _Src>
+inline void CircularMatrixBuffer<_Tp>::push(const Matrix<_Src, Dynamic, Dynamic>* pMatrix, qint32 iTag)
+{
+    unsigned int t_size = pMatrix->size();
+    if(t_size == m_uiRows*m_uiCols)
+    {
+        m_pFreeElements->acquire(t_size);
+        m_pTags[m_uiCurrentWriteIndex / t_size] = iTag;
+        write(pMatrix->data(), t_size);
+        m_pUsedElements->release(t_size);
+    }
+}
+
+
 //*************************************************************************************************************
 
 template<typename _Tp>
 inline Matrix<_Tp, Dynamic, Dynamic> CircularMatrixBuffer<_Tp>::pop()
 {
-    m_pUsedElements->acquire(m_uiRows*m_uiCols);
     Matrix<_Tp, Dynamic, Dynamic> matrix(m_uiRows, m_uiCols);
-    for(quint32 i = 0; i < m_uiRows*m_uiCols; ++i)
-        matrix.data()[i] = m_pBuffer[mapIndex(m_iCurrentReadIndex)];
-    m_pFreeElements->release(m_uiRows*m_uiCols);
+    pop(matrix);
 
     return matrix;
 }
@@ -244,9 +325,74 @@ inline Matrix<_Tp, Dynamic, Dynamic> CircularMatrixBuffer<_Tp>::pop()
 //*************************************************************************************************************
 
 template<typename _Tp>
-inline unsigned int CircularMatrixBuffer<_Tp>::mapIndex(int& index)
+inline void CircularMatrixBuffer<_Tp>::pop(Matrix<_Tp, Dynamic, Dynamic>& matrix, qint32* pTag)
+{
+    m_pUsedElements->acquire(m_uiRows*m_uiCols);
+    if(pTag)
+        *pTag = m_pTags[m_uiCurrentReadIndex / (m_uiRows*m_uiCols)];
+    matrix.resize(m_uiRows, m_uiCols);
+    read(matrix.data(), m_uiRows*m_uiCols);
+    m_pFreeElements->release(m_uiRows*m_uiCols);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool CircularMatrixBuffer<_Tp>::tryPop(Matrix<_Tp, Dynamic, Dynamic>& matrix, int timeout, qint32* pTag)
+{
+    if(!m_pUsedElements->tryAcquire(m_uiRows*m_uiCols, timeout))
+        return false;
+    if(pTag)
+        *pTag = m_pTags[m_uiCurrentReadIndex / (m_uiRows*m_uiCols)];
+    matrix.resize(m_uiRows, m_uiCols);
+    read(matrix.data(), m_uiRows*m_uiCols);
+    m_pFreeElements->release(m_uiRows*m_uiCols);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularMatrixBuffer<_Tp>::write(const _Tp* pData, unsigned int uiSize)
+{
+    unsigned int t_uiFirst = qMin(uiSize, m_uiMaxNumElements - m_uiCurrentWriteIndex);
+    memcpy(m_pBuffer + m_uiCurrentWriteIndex, pData, t_uiFirst * sizeof(_Tp));
+    if(t_uiFirst < uiSize)
+        memcpy(m_pBuffer, pData + t_uiFirst, (uiSize - t_uiFirst) * sizeof(_Tp));
+
+    m_uiCurrentWriteIndex = (m_uiCurrentWriteIndex + uiSize) % m_uiMaxNumElements;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+template<typename _Src>
+inline void CircularMatrixBuffer<_Tp>::write(const _Src* pData, unsigned int uiSize)
+{
+    unsigned int t_uiFirst = qMin(uiSize, m_uiMaxNumElements - m_uiCurrentWriteIndex);
+    Map< Matrix<_Tp, Dynamic, 1> >(m_pBuffer + m_uiCurrentWriteIndex, t_uiFirst) = Map< const Matrix<_Src, Dynamic, 1> >(pData, t_uiFirst).template cast<_Tp>();
+    if(t_uiFirst < uiSize)
+        Map< Matrix<_Tp, Dynamic, 1> >(m_pBuffer, uiSize - t_uiFirst) = Map< const Matrix<_Src, Dynamic, 1> >(pData + t_uiFirst, uiSize - t_uiFirst).template cast<_Tp>();
+
+    m_uiCurrentWriteIndex = (m_uiCurrentWriteIndex + uiSize) % m_uiMaxNumElements;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void CircularMatrixBuffer<_Tp>::read(_Tp* pData, unsigned int uiSize)
 {
-    return index = ++index % m_uiMaxNumElements;
+    unsigned int t_uiFirst = qMin(uiSize, m_uiMaxNumElements - m_uiCurrentReadIndex);
+    memcpy(pData, m_pBuffer + m_uiCurrentReadIndex, t_uiFirst * sizeof(_Tp));
+    if(t_uiFirst < uiSize)
+        memcpy(pData + t_uiFirst, m_pBuffer, (uiSize - t_uiFirst) * sizeof(_Tp));
+
+    m_uiCurrentReadIndex = (m_uiCurrentReadIndex + uiSize) % m_uiMaxNumElements;
 }
 
 
@@ -260,8 +406,18 @@ void CircularMatrixBuffer<_Tp>::clear()
     delete m_pUsedElements;
     m_pUsedElements = new QSemaphore(0);
 
-    m_iCurrentReadIndex = -1;
-    m_iCurrentWriteIndex = -1;
+    m_uiCurrentReadIndex = 0;
+    m_uiCurrentWriteIndex = 0;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 CircularMatrixBuffer<_Tp>::available() const
+{
+    unsigned int t_uiMatrixSize = m_uiRows*m_uiCols;
+    return t_uiMatrixSize > 0 ? m_pUsedElements->available() / t_uiMatrixSize : 0;
 }
 
 
@@ -69,6 +69,7 @@ SOURCES += \
 
 HEADERS += generics_global.h \
     circularmatrixbuffer.h \
+    lockfreematrixbuffer.h \
     circularbuffer.h \
     observerpattern.h \
     commandpattern.h \
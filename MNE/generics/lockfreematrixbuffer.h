@@ -0,0 +1,354 @@
+//=============================================================================================================
+/**
+* @file     lockfreematrixbuffer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief     LockFreeMatrixBuffer class declaration
+*
+*/
+
+#ifndef LOCKFREEMATRIXBUFFER_H
+#define LOCKFREEMATRIXBUFFER_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "generics_global.h"
+#include "buffer.h"
+
+#include <typeinfo>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE IOBuffer
+//=============================================================================================================
+
+namespace IOBuffer
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Lock-free single producer/single consumer ring of preallocated matrices. Other than CircularMatrixBuffer,
+* which copies the samples into a ring of elements guarded by two semaphores, the producer writes straight into
+* a slot matrix (acquireWrite/commitWrite) and the consumer reads straight from it (acquireRead/releaseRead).
+* The slots are handed over by an atomic head and tail index; nothing blocks, a full or an empty buffer is
+* reported by a NULL slot and it's up to the caller to retry or drop the data.
+*
+* Exactly one thread may produce and exactly one thread may consume at a time.
+*
+* @brief Lock-free single producer/single consumer matrix buffer
+*/
+template<typename _Tp>
+class LockFreeMatrixBuffer : public Buffer
+{
+public:
+    typedef QSharedPointer<LockFreeMatrixBuffer> SPtr;              /**< Shared pointer type for LockFreeMatrixBuffer. */
+    typedef QSharedPointer<const LockFreeMatrixBuffer> ConstSPtr;   /**< Const shared pointer type for LockFreeMatrixBuffer. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a LockFreeMatrixBuffer and allocates all slot matrices.
+    *
+    * @param [in] uiMaxNumMatrices  Number of matrices the buffer can hold.
+    * @param [in] uiRows            Number of rows.
+    * @param [in] uiCols            Number of columns.
+    */
+    explicit LockFreeMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols);
+
+    //=========================================================================================================
+    /**
+    * Producer: Returns the next free slot to write to.
+    *
+    * @return the slot matrix, NULL if the buffer is full.
+    */
+    inline Matrix<_Tp, Dynamic, Dynamic>* acquireWrite();
+
+    //=========================================================================================================
+    /**
+    * Producer: Hands the slot returned by acquireWrite over to the consumer.
+    */
+    inline void commitWrite();
+
+    //=========================================================================================================
+    /**
+    * Consumer: Returns the oldest written slot (first in first out).
+    *
+    * @return the slot matrix, NULL if the buffer is empty.
+    */
+    inline const Matrix<_Tp, Dynamic, Dynamic>* acquireRead();
+
+    //=========================================================================================================
+    /**
+    * Consumer: Hands the slot returned by acquireRead back to the producer.
+    */
+    inline void releaseRead();
+
+    //=========================================================================================================
+    /**
+    * Producer: Copies a matrix into the next free slot.
+    *
+    * @param [in] pMatrix   the matrix to append; has to have the dimensions of the buffer.
+    *
+    * @return true if the matrix was appended, false if the buffer is full or the dimensions do not match.
+    */
+    inline bool push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix);
+
+    //=========================================================================================================
+    /**
+    * Consumer: Copies the oldest matrix to a caller owned matrix.
+    *
+    * @param [out] matrix   the matrix to write to.
+    *
+    * @return true if a matrix was popped, false if the buffer is empty.
+    */
+    inline bool pop(Matrix<_Tp, Dynamic, Dynamic>& matrix);
+
+    //=========================================================================================================
+    /**
+    * Number of matrices currently stored. Exact only when called from the producer or the consumer thread.
+    */
+    inline quint32 available() const;
+
+    //=========================================================================================================
+    /**
+    * Size of the buffer.
+    */
+    inline quint32 size() const;
+
+    //=========================================================================================================
+    /**
+    * Rows of the stored matrices of the buffer.
+    */
+    inline quint32 rows() const;
+
+    //=========================================================================================================
+    /**
+    * Cols of the stored matrices of the buffer.
+    */
+    inline quint32 cols() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Returns the slot index following the given one.
+    *
+    * @param [in] index     the slot index.
+    *
+    * @return the next slot index.
+    */
+    inline int nextIndex(int index) const;
+
+    unsigned int    m_uiMaxNumMatrices;         /**< Holds the maximal number of matrices.*/
+    unsigned int    m_uiRows;                   /**< Holds the number rows.*/
+    unsigned int    m_uiCols;                   /**< Holds the number cols.*/
+    QVector<Matrix<_Tp, Dynamic, Dynamic> > m_qVecSlots;    /**< Holds the slots, one more than m_uiMaxNumMatrices to tell full from empty.*/
+    char            m_cPadHead[64];             /**< Keeps the head away from the slot data's cache line.*/
+    QAtomicInt      m_iHead;                    /**< Holds the next slot to write; written by the producer only.*/
+    char            m_cPadTail[64];             /**< Keeps head and tail on different cache lines.*/
+    QAtomicInt      m_iTail;                    /**< Holds the next slot to read; written by the consumer only.*/
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+template<typename _Tp>
+LockFreeMatrixBuffer<_Tp>::LockFreeMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols)
+: Buffer(typeid(_Tp).name())
+, m_uiMaxNumMatrices(uiMaxNumMatrices)
+, m_uiRows(uiRows)
+, m_uiCols(uiCols)
+, m_qVecSlots(uiMaxNumMatrices + 1, Matrix<_Tp, Dynamic, Dynamic>(uiRows, uiCols))
+, m_iHead(0)
+, m_iTail(0)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline Matrix<_Tp, Dynamic, Dynamic>* LockFreeMatrixBuffer<_Tp>::acquireWrite()
+{
+    int t_iHead = m_iHead.load();
+    if(nextIndex(t_iHead) == m_iTail.loadAcquire())
+        return NULL;
+
+    return &m_qVecSlots[t_iHead];
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void LockFreeMatrixBuffer<_Tp>::commitWrite()
+{
+    m_iHead.storeRelease(nextIndex(m_iHead.load()));
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline const Matrix<_Tp, Dynamic, Dynamic>* LockFreeMatrixBuffer<_Tp>::acquireRead()
+{
+    int t_iTail = m_iTail.load();
+    if(t_iTail == m_iHead.loadAcquire())
+        return NULL;
+
+    return &m_qVecSlots.at(t_iTail);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void LockFreeMatrixBuffer<_Tp>::releaseRead()
+{
+    m_iTail.storeRelease(nextIndex(m_iTail.load()));
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+{
+    if((unsigned int)pMatrix->rows() != m_uiRows || (unsigned int)pMatrix->cols() != m_uiCols)
+        return false;
+
+    Matrix<_Tp, Dynamic, Dynamic>* t_pSlot = acquireWrite();
+    if(!t_pSlot)
+        return false;
+
+    *t_pSlot = *pMatrix;
+    commitWrite();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeMatrixBuffer<_Tp>::pop(Matrix<_Tp, Dynamic, Dynamic>& matrix)
+{
+    const Matrix<_Tp, Dynamic, Dynamic>* t_pSlot = acquireRead();
+    if(!t_pSlot)
+        return false;
+
+    matrix = *t_pSlot;
+    releaseRead();
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeMatrixBuffer<_Tp>::available() const
+{
+    int t_iCount = m_iHead.loadAcquire() - m_iTail.loadAcquire();
+    return t_iCount < 0 ? t_iCount + m_qVecSlots.size() : t_iCount;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline int LockFreeMatrixBuffer<_Tp>::nextIndex(int index) const
+{
+    return index + 1 == m_qVecSlots.size() ? 0 : index + 1;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeMatrixBuffer<_Tp>::size() const
+{
+    return m_uiMaxNumMatrices;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeMatrixBuffer<_Tp>::rows() const
+{
+    return m_uiRows;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeMatrixBuffer<_Tp>::cols() const
+{
+    return m_uiCols;
+}
+
+} // NAMESPACE
+
+#endif // LOCKFREEMATRIXBUFFER_H
@@ -37,6 +37,7 @@ include(../../mne-cpp.pri)
 
 TEMPLATE = lib
 
+QT       += concurrent
 QT       -= gui
 
 DEFINES += INVERSE_LIBRARY
@@ -81,14 +82,16 @@ win32 {
 SOURCES += \
     sourceestimate.cpp \
     minimumNorm/minimumnorm.cpp \
-    rapMusic/rapmusic.cpp
+    rapMusic/rapmusic.cpp \
+    rapMusic/gold/rapmusic_gold.cpp
 
 HEADERS +=\
     inverse_global.h \
     IInverseAlgorithm.h \
     sourceestimate.h \
     minimumNorm/minimumnorm.h \
-    rapMusic/rapmusic.h
+    rapMusic/rapmusic.h \
+    rapMusic/gold/rapmusic_gold.h
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
 INCLUDEPATH += $${MNE_INCLUDE_DIR}
@@ -103,6 +106,10 @@ header_files_minimum_norm.path = $${MNE_INCLUDE_DIR}/inverse/minimumNorm
 header_files_rap_music.files = ./rapMusic/*.h
 header_files_rap_music.path = $${MNE_INCLUDE_DIR}/inverse/rapMusic
 
+header_files_rap_music_gold.files = ./rapMusic/gold/*.h
+header_files_rap_music_gold.path = $${MNE_INCLUDE_DIR}/inverse/rapMusic/gold
+
 INSTALLS += header_files
 INSTALLS += header_files_minimum_norm
 INSTALLS += header_files_rap_music
+INSTALLS += header_files_rap_music_gold
@@ -71,6 +71,10 @@ using namespace INVERSELIB;
 
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString method)
 : m_inverseOperator(p_inverseOperator)
+, m_bKernelCached(false)
+, m_iCachedNave(-1)
+, m_fCachedLambda(0)
+, m_bCachedPickNormal(false)
 {
     this->setRegularization(lambda);
     this->setMethod(method);
@@ -80,6 +84,10 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, bool dSPM, bool sLORETA)
 : m_inverseOperator(p_inverseOperator)
+, m_bKernelCached(false)
+, m_iCachedNave(-1)
+, m_fCachedLambda(0)
+, m_bCachedPickNormal(false)
 {
     this->setRegularization(lambda);
     this->setMethod(dSPM, sLORETA);
@@ -101,25 +109,122 @@ SourceEstimate MinimumNorm::calculateInverse(const FiffEvoked &p_fiffEvoked, boo
         return SourceEstimate();
     }
 
-    MNEInverseOperator inv = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
+    if(!setup_kernel(nave, pick_normal))
+        return SourceEstimate();
+
     //
     //   Pick the correct channels from the data
     //
-    FiffEvoked t_fiffEvoked = p_fiffEvoked.pick_channels(inv.noise_cov->names);
+    FiffEvoked t_fiffEvoked = p_fiffEvoked.pick_channels(m_inverseOperator.noise_cov->names);
 
     printf("Picked %d channels from the data\n",t_fiffEvoked.info.nchan);
+
+    //Results
+    float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
+    float tstep = 1/t_fiffEvoked.info.sfreq;
+
+    return apply_kernel(t_fiffEvoked.data.cast<float>(), tmin, tstep);
+}
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
+{
+    setup_kernel(nave, pick_normal);
+}
+
+
+//*************************************************************************************************************
+
+SourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin, float tstep) const
+{
+    return calculateInverse(MatrixXf(data.cast<float>()), tmin, tstep);
+}
+
+
+//*************************************************************************************************************
+
+SourceEstimate MinimumNorm::calculateInverse(const MatrixXf &data, float tmin, float tstep) const
+{
+    if(!m_bKernelCached)
+    {
+        qWarning("MinimumNorm::calculateInverse - Inverse not set up; call doInverseSetup first.");
+        return SourceEstimate();
+    }
+
+    if(data.rows() != m_matKernel.cols())
+    {
+        qWarning("MinimumNorm::calculateInverse - Dimension mismatch between data (%d channels) and kernel (%d channels).", (int)data.rows(), (int)m_matKernel.cols());
+        return SourceEstimate();
+    }
+
+    return apply_kernel(data, tmin, tstep);
+}
+
+
+//*************************************************************************************************************
+
+bool MinimumNorm::setup_kernel(qint32 nave, bool pick_normal) const
+{
+    if(m_bKernelCached && m_iCachedNave == nave && m_fCachedLambda == m_fLambda && m_sCachedMethod == m_sMethod && m_bCachedPickNormal == pick_normal)
+        return true;
+
+    m_bKernelCached = false;
+
+    MNEInverseOperator inv = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
+
     printf("Computing inverse...");
 
     MatrixXd K;
     SparseMatrix<double> noise_norm;
     QList<VectorXi> vertno;
     Label label;
-    inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
-    MatrixXd sol = K * t_fiffEvoked.data; //apply imaging kernel
-
-    if (inv.source_ori == FIFFV_MNE_FREE_ORI)
+    if(!inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno))
     {
+        printf("[failed]\n");
+        return false;
+    }
+
+    //
+    //   The kernel is applied in single precision, it's assembled in double precision
+    //
+    m_matKernel = K.cast<float>();
+    m_matNoiseNorm = inv.noisenorm;
+
+    m_qListVertices.clear();
+    for(qint32 h = 0; h < inv.src.size(); ++h)
+        m_qListVertices.push_back(inv.src[h].vertno);
+
+    m_iCachedNave = nave;
+    m_fCachedLambda = m_fLambda;
+    m_sCachedMethod = m_sMethod;
+    m_bCachedPickNormal = pick_normal;
+    m_bKernelCached = true;
+
+    //
+    //   apply_kernel runs for every data block and stays silent, the steps it applies are reported here
+    //
+    if (m_inverseOperator.source_ori == FIFFV_MNE_FREE_ORI)
         printf("combining the current components...");
+    if (m_bdSPM)
+        printf("(dSPM)...");
+    else if (m_bsLORETA)
+        printf("(sLORETA)...");
+    printf("[done]\n");
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+SourceEstimate MinimumNorm::apply_kernel(const MatrixXf &data, float tmin, float tstep) const
+{
+    MatrixXd sol = (m_matKernel * data).cast<double>(); //apply imaging kernel
+
+    if (m_inverseOperator.source_ori == FIFFV_MNE_FREE_ORI)
+    {
         MatrixXd sol1(sol.rows()/3,sol.cols());
         for(qint32 i = 0; i < sol.cols(); ++i)
         {
@@ -133,25 +238,14 @@ SourceEstimate MinimumNorm::calculateInverse(const FiffEvoked &p_fiffEvoked, boo
 
     if (m_bdSPM)
     {
-        printf("(dSPM)...");
-        sol = inv.noisenorm*sol;
+        sol = m_matNoiseNorm*sol;
     }
     else if (m_bsLORETA)
     {
-        printf("(sLORETA)...");
-        sol = inv.noisenorm*sol;
+        sol = m_matNoiseNorm*sol;
     }
-    printf("[done]\n");
-
-    //Results
-    float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
-    float tstep = 1/t_fiffEvoked.info.sfreq;
-
-    QList<VectorXi> t_qListVertices;
-    for(qint32 h = 0; h < inv.src.size(); ++h)
-        t_qListVertices.push_back(inv.src[h].vertno);
 
-    return SourceEstimate(sol, t_qListVertices, tmin, tstep);
+    return SourceEstimate(sol, m_qListVertices, tmin, tstep);
 }
 
 
@@ -123,6 +123,43 @@ public:
     */
     virtual SourceEstimate calculateInverse(const FiffEvoked &p_fiffEvoked, bool pick_normal = false) const;
 
+    //=========================================================================================================
+    /**
+    * Prepares the inverse operator and assembles the imaging kernel for the given number of averages and the
+    * current regularization and method. The kernel is cached; it's only rebuilt if one of those parameters
+    * changed. Has to be called before calculateInverse is applied to data blocks.
+    *
+    * @param[in] nave           Number of averages of the data the kernel is applied to
+    * @param[in] pick_normal    If True, rather than pooling the orientations by taking the norm, only the
+    *                           radial component is kept. This is only applied when working with loose orientations.
+    */
+    void doInverseSetup(qint32 nave, bool pick_normal = false);
+
+    //=========================================================================================================
+    /**
+    * Applies the imaging kernel prepared by doInverseSetup to a data block, e.g. of a real-time stream. The
+    * rows of the data have to match the channels of the inverse operator's noise covariance.
+    *
+    * @param[in] data       Data block (channels x samples)
+    * @param[in] tmin       Time of the first sample
+    * @param[in] tstep      Time between two samples
+    *
+    * @return the calculated source estimation; empty if the kernel is not set up or the channels don't match
+    */
+    SourceEstimate calculateInverse(const MatrixXd &data, float tmin, float tstep) const;
+
+    //=========================================================================================================
+    /**
+    * Single precision version of calculateInverse for data blocks.
+    *
+    * @param[in] data       Data block (channels x samples)
+    * @param[in] tmin       Time of the first sample
+    * @param[in] tstep      Time between two samples
+    *
+    * @return the calculated source estimation; empty if the kernel is not set up or the channels don't match
+    */
+    SourceEstimate calculateInverse(const MatrixXf &data, float tmin, float tstep) const;
+
     virtual const char* getName() const;
 
     virtual const MNESourceSpace& getSourceSpace() const;
@@ -153,11 +190,46 @@ public:
     void setRegularization(float lambda);
 
 private:
+    //=========================================================================================================
+    /**
+    * Prepares the inverse operator and assembles the imaging kernel, unless the cached kernel was set up for
+    * the same parameters. The channels are fixed by the inverse operator and the kernel always covers the
+    * whole source space.
+    *
+    * @param[in] nave           Number of averages
+    * @param[in] pick_normal    Keep only the radial component
+    *
+    * @return true if the kernel is available, false otherwise
+    */
+    bool setup_kernel(qint32 nave, bool pick_normal) const;
+
+    //=========================================================================================================
+    /**
+    * Applies the cached kernel, combines the current components of free orientations and applies the noise
+    * normalization.
+    *
+    * @param[in] data       Data block (channels x samples)
+    * @param[in] tmin       Time of the first sample
+    * @param[in] tstep      Time between two samples
+    *
+    * @return the calculated source estimation
+    */
+    SourceEstimate apply_kernel(const MatrixXf &data, float tmin, float tstep) const;
+
     MNEInverseOperator m_inverseOperator;   /**< The inverse operator */
     float m_fLambda;                        /**< Regularization parameter */
     QString m_sMethod;                      /**< Selected method */
     bool m_bsLORETA;                        /**< Do sLORETA method */
     bool m_bdSPM;                           /**< Do dSPM method */
+
+    mutable bool m_bKernelCached;           /**< Whether the kernel was set up */
+    mutable qint32 m_iCachedNave;           /**< Number of averages of the cached kernel */
+    mutable float m_fCachedLambda;          /**< Regularization of the cached kernel */
+    mutable QString m_sCachedMethod;        /**< Method of the cached kernel */
+    mutable bool m_bCachedPickNormal;       /**< Orientation pooling of the cached kernel */
+    mutable MatrixXf m_matKernel;           /**< The cached imaging kernel, in single precision */
+    mutable SparseMatrix<double> m_matNoiseNorm;    /**< Noise normalization of the cached kernel */
+    mutable QList<VectorXi> m_qListVertices;        /**< Source space vertices of the solution */
 };
 
 } //NAMESPACE
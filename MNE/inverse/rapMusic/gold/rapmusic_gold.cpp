@@ -0,0 +1,189 @@
+//=============================================================================================================
+/**
+* @file     rapmusic_gold.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    RapMusicGold class implementation.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "rapmusic_gold.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/SVD>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+bool RapMusicGold::scan(const MatrixXd &p_matLeadField, qint32 p_iOri, const MatrixXd &p_matData, qint32 p_iN, double p_dThr, bool p_bPairs, QList<RapMusic::Dipole> &p_qListDipoles)
+{
+    p_qListDipoles.clear();
+
+    const MatrixXd &G = p_matLeadField;
+    qint32 nchan = G.rows();
+    qint32 nsource = G.cols() / p_iOri;
+
+    if(p_iOri < 1 || nsource == 0 || p_matData.rows() != nchan || p_iN < 1)
+    {
+        printf("Error: RAP MUSIC gold got inconsistent input.\n");
+        return false;
+    }
+
+    qint32 t_iRank = p_iN;
+    if(t_iRank > nchan)
+        t_iRank = nchan;
+    if(t_iRank > p_matData.cols())
+        t_iRank = p_matData.cols();
+
+    //
+    //   Signal subspace: left singular vectors of the data
+    //
+    JacobiSVD<MatrixXd> t_svdData(p_matData, ComputeThinU);
+    MatrixXd t_matPhi_s = t_svdData.matrixU().leftCols(t_iRank);
+
+    MatrixXd t_matA(nchan, 0);                          // found topographies
+    MatrixXd t_matP = MatrixXd::Identity(nchan, nchan); // projector onto their orthogonal complement
+
+    for(qint32 r = 0; r < t_iRank; ++r)
+    {
+        JacobiSVD<MatrixXd> t_svdPhi(t_matP * t_matPhi_s, ComputeThinU);
+        MatrixXd t_matU_s = t_svdPhi.matrixU().leftCols(t_iRank - r);
+
+        double t_dBestCorr = -1;
+        qint32 t_iBest1 = -1;
+        qint32 t_iBest2 = -1;
+        VectorXd t_vecBestX;
+
+        for(qint32 i = 0; i < nsource; ++i)
+        {
+            if(!p_bPairs)
+            {
+                MatrixXd t_matG_c = G.middleCols(i*p_iOri, p_iOri);
+
+                VectorXd t_vecX;
+                double t_dCorr = subcorr(t_matP * t_matG_c, t_matG_c.norm(), t_matU_s, t_vecX);
+                if(t_dCorr > t_dBestCorr)
+                {
+                    t_dBestCorr = t_dCorr;
+                    t_iBest1 = i;
+                    t_vecBestX = t_vecX;
+                }
+                continue;
+            }
+
+            for(qint32 j = i + 1; j < nsource; ++j)
+            {
+                MatrixXd t_matG_c(nchan, 2*p_iOri);
+                t_matG_c << G.middleCols(i*p_iOri, p_iOri), G.middleCols(j*p_iOri, p_iOri);
+
+                VectorXd t_vecX;
+                double t_dCorr = subcorr(t_matP * t_matG_c, t_matG_c.norm(), t_matU_s, t_vecX);
+                if(t_dCorr > t_dBestCorr)
+                {
+                    t_dBestCorr = t_dCorr;
+                    t_iBest1 = i;
+                    t_iBest2 = j;
+                    t_vecBestX = t_vecX;
+                }
+            }
+        }
+
+        if(t_dBestCorr < p_dThr)
+            break;
+
+        RapMusic::Dipole t_dipole;
+        t_dipole.iIdx1 = t_iBest1;
+        t_dipole.iIdx2 = t_iBest2;
+        t_dipole.vecMoment1 = t_vecBestX.head(p_iOri);
+        if(t_iBest2 >= 0)
+            t_dipole.vecMoment2 = t_vecBestX.tail(p_iOri);
+        t_dipole.dCorr = t_dBestCorr;
+        p_qListDipoles.append(t_dipole);
+
+        VectorXd t_vecA = G.middleCols(t_iBest1*p_iOri, p_iOri) * t_dipole.vecMoment1;
+        if(t_iBest2 >= 0)
+            t_vecA += G.middleCols(t_iBest2*p_iOri, p_iOri) * t_dipole.vecMoment2;
+
+        t_matA.conservativeResize(nchan, r+1);
+        t_matA.col(r) = t_vecA;
+
+        //
+        //   P = I - A*pinv(A)
+        //
+        JacobiSVD<MatrixXd> t_svdA(t_matA, ComputeThinU);
+        MatrixXd t_matU_A = t_svdA.matrixU().leftCols(t_matA.cols());
+        t_matP = MatrixXd::Identity(nchan, nchan) - t_matU_A * t_matU_A.transpose();
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+double RapMusicGold::subcorr(const MatrixXd &p_matProjG_c, double p_dNorm, const MatrixXd &p_matU_s, VectorXd &p_vecX)
+{
+    JacobiSVD<MatrixXd> t_svdG(p_matProjG_c, ComputeThinU | ComputeThinV);
+    const VectorXd &t_vecS = t_svdG.singularValues();
+
+    qint32 t_iRank = 0;
+    while(t_iRank < t_vecS.size() && t_vecS[t_iRank] > 1e-6 * p_dNorm)
+        ++t_iRank;
+
+    if(t_iRank == 0)
+        return -1;
+
+    MatrixXd t_matC = t_svdG.matrixU().leftCols(t_iRank).transpose() * p_matU_s;
+    JacobiSVD<MatrixXd> t_svdC(t_matC, ComputeThinU);
+
+    p_vecX = t_svdG.matrixV().leftCols(t_iRank) * (t_svdC.matrixU().col(0).array() / t_vecS.head(t_iRank).array()).matrix();
+
+    return t_svdC.singularValues()[0];
+}
@@ -0,0 +1,123 @@
+//=============================================================================================================
+/**
+* @file     rapmusic_gold.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    RapMusicGold class declaration.
+*
+*/
+
+#ifndef RAPMUSIC_GOLD_H
+#define RAPMUSIC_GOLD_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../../inverse_global.h"
+#include "../rapmusic.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE INVERSELIB
+//=============================================================================================================
+
+namespace INVERSELIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Serial reference implementation of the RAP MUSIC scan, written down as in the paper: the projector and the
+* subspace correlations are computed with explicit SVDs for every candidate. It's slow, RapMusic is tested
+* against it.
+*
+* @brief RAP MUSIC reference implementation
+*/
+class INVERSESHARED_EXPORT RapMusicGold
+{
+public:
+    //=========================================================================================================
+    /**
+    * Runs the recursive scan on a data block.
+    *
+    * @param[in] p_matLeadField     Lead field (channels x sources*orientations)
+    * @param[in] p_iOri             Lead field columns per source (1 for fixed, 3 for free orientations)
+    * @param[in] p_matData          Data block (channels x samples)
+    * @param[in] p_iN               Rank of the signal subspace, which is the maximal number of recursions
+    * @param[in] p_dThr             Subspace correlation at which the recursion stops
+    * @param[in] p_bPairs           Scan source pairs instead of single sources
+    * @param[out] p_qListDipoles    The found dipoles in the order of the recursions
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool scan(const MatrixXd &p_matLeadField, qint32 p_iOri, const MatrixXd &p_matData, qint32 p_iN, double p_dThr, bool p_bPairs, QList<RapMusic::Dipole> &p_qListDipoles);
+
+    //=========================================================================================================
+    /**
+    * Computes the subspace correlation of a candidate, i.e. the largest singular value of Orth(P*G_c)'*U_s.
+    *
+    * @param[in] p_matProjG_c   Projected lead field of the candidate P*G_c
+    * @param[in] p_dNorm        Frobenius norm of the unprojected lead field of the candidate
+    * @param[in] p_matU_s       Orthonormal basis of the projected signal subspace
+    * @param[out] p_vecX        Lead field coefficients of the best topography
+    *
+    * @return the subspace correlation, -1 if the candidate was projected out completely
+    */
+    static double subcorr(const MatrixXd &p_matProjG_c, double p_dNorm, const MatrixXd &p_matU_s, VectorXd &p_vecX);
+};
+
+} //NAMESPACE
+
+#endif // RAPMUSIC_GOLD_H
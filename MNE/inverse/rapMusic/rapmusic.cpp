@@ -41,6 +41,27 @@
 #include "rapmusic.h"
 #include "../sourceestimate.h"
 
+#include <fiff/fiff_evoked.h>
+#include <utils/parallel.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/SVD>
+#include <Eigen/Eigenvalues>
+#include <Eigen/QR>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -48,6 +69,7 @@
 //=============================================================================================================
 
 using namespace INVERSELIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -56,17 +78,321 @@ using namespace INVERSELIB;
 //=============================================================================================================
 
 RapMusic::RapMusic()
+: m_iN(0)
+, m_dThreshold(0.5)
+, m_bPairs(false)
+, m_iOri(1)
+, m_iNumSources(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+RapMusic::RapMusic(const MNEForwardSolution &p_forwardSolution, qint32 p_iN, double p_dThr, bool p_bPairs)
+: m_iN(0)
+, m_dThreshold(0.5)
+, m_bPairs(false)
+, m_iOri(1)
+, m_iNumSources(0)
+{
+    init(p_forwardSolution, p_iN, p_dThr, p_bPairs);
+}
+
+
+//*************************************************************************************************************
+
+bool RapMusic::init(const MNEForwardSolution &p_forwardSolution, qint32 p_iN, double p_dThr, bool p_bPairs)
+{
+    m_iNumSources = 0;
+    m_matGram.resize(0,0);
+    m_qListVertices.clear();
+
+    if(p_forwardSolution.isEmpty() || !p_forwardSolution.sol || p_forwardSolution.sol->data.cols() == 0)
+    {
+        printf("Error: RAP MUSIC needs a forward solution.\n");
+        return false;
+    }
+    if(p_iN < 1)
+    {
+        printf("Error: The rank of the signal subspace has to be positive (%d).\n", p_iN);
+        return false;
+    }
+
+    m_ForwardSolution = p_forwardSolution;
+    m_iN = p_iN;
+    m_dThreshold = p_dThr;
+    m_bPairs = p_bPairs;
+
+    const MatrixXd &G = m_ForwardSolution.sol->data;
+    m_iOri = m_ForwardSolution.isFixedOrient() ? 1 : 3;
+
+    //
+    //   The Gram matrix doesn't change with the data, the recursions only subtract the projected part
+    //
+    if(m_bPairs)
+    {
+        if(G.cols() > RAPMUSIC_MAX_PAIR_COLUMNS)
+        {
+            printf("Error: The pair scan is limited to %d lead field columns (%d given), use a clustered forward solution.\n", RAPMUSIC_MAX_PAIR_COLUMNS, (qint32)G.cols());
+            return false;
+        }
+
+        m_matGram = MatrixXd::Zero(G.cols(), G.cols());
+        m_matGram.selfadjointView<Lower>().rankUpdate(G.transpose());
+    }
+    else
+        m_matGram = diag_blocks(G, m_iOri);
+
+    for(qint32 h = 0; h < m_ForwardSolution.src.size(); ++h)
+        m_qListVertices.push_back(m_ForwardSolution.src[h].vertno);
+
+    m_iNumSources = G.cols() / m_iOri;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+SourceEstimate RapMusic::calculateInverse(const FiffEvoked &p_fiffEvoked, bool pick_normal) const
 {
+    Q_UNUSED(pick_normal);
+
+    if(m_iNumSources == 0)
+    {
+        printf("Error: RAP MUSIC is not initialized.\n");
+        return SourceEstimate();
+    }
+
+    //
+    //   Pick the channels of the forward solution from the data
+    //
+    FiffEvoked t_fiffEvoked = p_fiffEvoked.pick_channels(m_ForwardSolution.sol->row_names);
+
+    if(t_fiffEvoked.info.ch_names != m_ForwardSolution.sol->row_names)
+    {
+        printf("Error: The data don't contain the channels of the forward solution in the same order.\n");
+        return SourceEstimate();
+    }
+
+    printf("Picked %d channels from the data\n",t_fiffEvoked.info.nchan);
+
+    float tmin = ((float)t_fiffEvoked.first) / t_fiffEvoked.info.sfreq;
+    float tstep = 1/t_fiffEvoked.info.sfreq;
+
+    return calculateInverse(t_fiffEvoked.data, tmin, tstep);
 }
 
 
 //*************************************************************************************************************
 
-SourceEstimate RapMusic::calculateInverse() const
+SourceEstimate RapMusic::calculateInverse(const MatrixXd &data, float tmin, float tstep) const
 {
-    SourceEstimate p_SourceEstimate;
+    QList<Dipole> t_qListDipoles;
+    if(!scan(data, t_qListDipoles))
+        return SourceEstimate();
+
+    const MatrixXd &G = m_ForwardSolution.sol->data;
+    MatrixXd t_matSol = MatrixXd::Zero(m_iNumSources, data.cols());
+
+    if(!t_qListDipoles.isEmpty())
+    {
+        //
+        //   Dipole amplitudes: least squares fit of the found topographies to the data
+        //
+        MatrixXd t_matA(G.rows(), t_qListDipoles.size());
+        for(qint32 i = 0; i < t_qListDipoles.size(); ++i)
+        {
+            const Dipole &t_dipole = t_qListDipoles[i];
+            t_matA.col(i) = G.middleCols(t_dipole.iIdx1*m_iOri, m_iOri) * t_dipole.vecMoment1;
+            if(t_dipole.iIdx2 >= 0)
+                t_matA.col(i) += G.middleCols(t_dipole.iIdx2*m_iOri, m_iOri) * t_dipole.vecMoment2;
+        }
+
+        MatrixXd t_matAmp = t_matA.colPivHouseholderQr().solve(data);
 
-    return p_SourceEstimate;
+        for(qint32 i = 0; i < t_qListDipoles.size(); ++i)
+        {
+            const Dipole &t_dipole = t_qListDipoles[i];
+            t_matSol.row(t_dipole.iIdx1) += t_dipole.vecMoment1.norm() * t_matAmp.row(i);
+            if(t_dipole.iIdx2 >= 0)
+                t_matSol.row(t_dipole.iIdx2) += t_dipole.vecMoment2.norm() * t_matAmp.row(i);
+        }
+    }
+
+    return SourceEstimate(t_matSol, m_qListVertices, tmin, tstep);
+}
+
+
+//*************************************************************************************************************
+
+bool RapMusic::scan(const MatrixXd &p_matData, QList<Dipole> &p_qListDipoles) const
+{
+    p_qListDipoles.clear();
+
+    if(m_iNumSources == 0)
+    {
+        printf("Error: RAP MUSIC is not initialized.\n");
+        return false;
+    }
+
+    const MatrixXd &G = m_ForwardSolution.sol->data;
+    qint32 nchan = G.rows();
+
+    if(p_matData.rows() != nchan || p_matData.cols() == 0)
+    {
+        printf("Error: The data (%d channels) don't match the forward solution (%d channels).\n", (qint32)p_matData.rows(), nchan);
+        return false;
+    }
+
+    qint32 t_iRank = m_iN;
+    if(t_iRank > nchan)
+        t_iRank = nchan;
+    if(t_iRank > p_matData.cols())
+        t_iRank = p_matData.cols();
+
+    MatrixXd t_matPhi_s = signal_subspace(p_matData, t_iRank);
+
+    //
+    //   Panels of the candidate sources; pair panels hold equal numbers of pairs, the k-th panel ends at the
+    //   first source n * (1 - sqrt(1 - k/panels))
+    //
+    qint32 t_iNumPanels = Parallel::numThreads() * 4;
+    if(t_iNumPanels < 1)
+        t_iNumPanels = 1;
+    if(t_iNumPanels > m_iNumSources)
+        t_iNumPanels = m_iNumSources;
+
+    MatrixXd t_matK, t_matB;
+
+    QList<ScanPanel> t_qListPanels;
+    qint32 t_iFirst = 0;
+    for(qint32 k = 1; k <= t_iNumPanels; ++k)
+    {
+        qint32 t_iLast;
+        if(k == t_iNumPanels)
+            t_iLast = m_iNumSources;
+        else if(m_bPairs)
+            t_iLast = (qint32)(m_iNumSources * (1.0 - sqrt(1.0 - (double)k / t_iNumPanels)));
+        else
+            t_iLast = (qint32)((qint64)m_iNumSources * k / t_iNumPanels);
+
+        if(t_iLast > t_iFirst)
+        {
+            ScanPanel t_panel;
+            t_panel.pRapMusic = this;
+            t_panel.pK = &t_matK;
+            t_panel.pB = &t_matB;
+            t_panel.iFirst = t_iFirst;
+            t_panel.iLast = t_iLast;
+            t_qListPanels.append(t_panel);
+        }
+        t_iFirst = t_iLast;
+    }
+
+    //
+    //   The lead field is only multiplied with the signal subspace and with each found topography; the
+    //   projected subspace correlations are assembled from these products
+    //
+    MatrixXd t_matPhiG = t_matPhi_s.transpose() * G;
+    MatrixXd t_matQ;    // orthonormal basis of the found topographies
+    MatrixXd t_matQG;   // Q'*G
+
+    for(qint32 r = 0; r < t_iRank; ++r)
+    {
+        //
+        //   Project the found topographies out of the signal subspace, which loses one dimension each
+        //   recursion: U_s = P*Phi_s*V*S^-1, so U_s'*G = S^-1*V'*(Phi_s'*G - (Q'*Phi_s)'*(Q'*G))
+        //
+        MatrixXd t_matW;
+        if(r == 0)
+            t_matW = t_matPhiG;
+        else
+        {
+            qint32 t_iDim = t_iRank - r;
+
+            MatrixXd t_matQPhi = t_matQ.transpose() * t_matPhi_s;
+            JacobiSVD<MatrixXd> t_svd(t_matPhi_s - t_matQ * t_matQPhi, ComputeThinV);
+            if(t_svd.singularValues()[t_iDim-1] <= 1e-12)
+                break;
+
+            MatrixXd t_matC = t_svd.matrixV().leftCols(t_iDim) * t_svd.singularValues().head(t_iDim).cwiseInverse().asDiagonal();
+            t_matW.noalias() = t_matC.transpose() * (t_matPhiG - t_matQPhi.transpose() * t_matQG);
+        }
+
+        //
+        //   K = G'*P*G = G'*G - (Q'*G)'*(Q'*G) and B = (U_s'*G)'*(U_s'*G) of all candidates
+        //
+        if(m_bPairs)
+        {
+            t_matK = m_matGram;
+            if(r > 0)
+                t_matK.selfadjointView<Lower>().rankUpdate(t_matQG.transpose(), -1.0);
+            t_matB = MatrixXd::Zero(G.cols(), G.cols());
+            t_matB.selfadjointView<Lower>().rankUpdate(t_matW.transpose());
+        }
+        else
+        {
+            t_matK = m_matGram;
+            if(r > 0)
+                t_matK -= diag_blocks(t_matQG, m_iOri);
+            t_matB = diag_blocks(t_matW, m_iOri);
+        }
+
+        Parallel::map(t_qListPanels, &RapMusic::scan_panel);
+
+        //
+        //   Best candidate; panels are in source order, so ties go to the lower source as in a serial scan
+        //
+        qint32 t_iBest = 0;
+        for(qint32 i = 1; i < t_qListPanels.size(); ++i)
+            if(t_qListPanels[i].dCorr > t_qListPanels[t_iBest].dCorr)
+                t_iBest = i;
+
+        const ScanPanel &t_best = t_qListPanels[t_iBest];
+        if(t_best.dCorr < m_dThreshold)
+            break;
+
+        Dipole t_dipole;
+        t_dipole.iIdx1 = t_best.iIdx1;
+        t_dipole.iIdx2 = t_best.iIdx2;
+        t_dipole.vecMoment1 = t_best.vecX.head(m_iOri);
+        if(t_best.iIdx2 >= 0)
+            t_dipole.vecMoment2 = t_best.vecX.tail(m_iOri);
+        t_dipole.dCorr = t_best.dCorr;
+        p_qListDipoles.append(t_dipole);
+
+        printf("RAP MUSIC recursion %d: source %d", r+1, t_dipole.iIdx1);
+        if(t_dipole.iIdx2 >= 0)
+            printf(" and %d", t_dipole.iIdx2);
+        printf(", correlation %f\n", t_dipole.dCorr);
+
+        //
+        //   Add the topography to the orthonormal basis; orthogonalized twice for numerical stability
+        //
+        VectorXd t_vecA = G.middleCols(t_dipole.iIdx1*m_iOri, m_iOri) * t_dipole.vecMoment1;
+        if(t_dipole.iIdx2 >= 0)
+            t_vecA += G.middleCols(t_dipole.iIdx2*m_iOri, m_iOri) * t_dipole.vecMoment2;
+
+        if(r > 0)
+        {
+            t_vecA -= t_matQ * (t_matQ.transpose() * t_vecA);
+            t_vecA -= t_matQ * (t_matQ.transpose() * t_vecA);
+        }
+
+        double t_dNorm = t_vecA.norm();
+        if(t_dNorm <= 0)
+            break;
+
+        t_matQ.conservativeResize(nchan, r+1);
+        t_matQ.col(r) = t_vecA / t_dNorm;
+
+        t_matQG.conservativeResize(r+1, G.cols());
+        t_matQG.row(r).noalias() = t_matQ.col(r).transpose() * G;
+    }
+
+    return true;
 }
 
 
@@ -84,3 +410,228 @@ const MNESourceSpace& RapMusic::getSourceSpace() const
 {
     return m_ForwardSolution.src;
 }
+
+
+//*************************************************************************************************************
+
+void RapMusic::scan_panel(ScanPanel &p_panel)
+{
+    const RapMusic *t_pRap = p_panel.pRapMusic;
+    const MatrixXd &t_matGram = t_pRap->m_matGram;
+    const MatrixXd &t_matK = *p_panel.pK;
+    const MatrixXd &t_matB = *p_panel.pB;
+    qint32 t_iOri = t_pRap->m_iOri;
+
+    p_panel.dCorr = -1;
+    p_panel.iIdx1 = -1;
+    p_panel.iIdx2 = -1;
+
+    CandidateMatrix t_matKc, t_matBc;
+    CandidateVector t_vecX;
+
+    if(!t_pRap->m_bPairs)
+    {
+        t_matKc.resize(t_iOri, t_iOri);
+        t_matBc.resize(t_iOri, t_iOri);
+
+        for(qint32 s = p_panel.iFirst; s < p_panel.iLast; ++s)
+        {
+            double t_dTrace = 0;
+            for(qint32 a = 0; a < t_iOri; ++a)
+            {
+                t_dTrace += t_matGram(a*t_iOri+a, s);
+                for(qint32 b = 0; b < t_iOri; ++b)
+                {
+                    t_matKc(a,b) = t_matK(a*t_iOri+b, s);
+                    t_matBc(a,b) = t_matB(a*t_iOri+b, s);
+                }
+            }
+
+            double t_dCorr = subcorr(t_matKc, t_matBc, t_dTrace, t_vecX);
+            if(t_dCorr > p_panel.dCorr)
+            {
+                p_panel.dCorr = t_dCorr;
+                p_panel.iIdx1 = s;
+                p_panel.vecX = t_vecX;
+            }
+        }
+    }
+    else
+    {
+        qint32 t_iDim = 2*t_iOri;
+        t_matKc.resize(t_iDim, t_iDim);
+        t_matBc.resize(t_iDim, t_iDim);
+
+        qint32 t_iCols[6];
+
+        for(qint32 i = p_panel.iFirst; i < p_panel.iLast; ++i)
+        {
+            for(qint32 j = i + 1; j < t_pRap->m_iNumSources; ++j)
+            {
+                for(qint32 a = 0; a < t_iOri; ++a)
+                {
+                    t_iCols[a] = i*t_iOri + a;
+                    t_iCols[t_iOri + a] = j*t_iOri + a;
+                }
+
+                //
+                //   Only the lower triangles are stored, the columns are ascending
+                //
+                double t_dTrace = 0;
+                for(qint32 b = 0; b < t_iDim; ++b)
+                {
+                    t_dTrace += t_matGram(t_iCols[b], t_iCols[b]);
+                    for(qint32 a = b; a < t_iDim; ++a)
+                    {
+                        t_matKc(a,b) = t_matKc(b,a) = t_matK(t_iCols[a], t_iCols[b]);
+                        t_matBc(a,b) = t_matBc(b,a) = t_matB(t_iCols[a], t_iCols[b]);
+                    }
+                }
+
+                double t_dCorr = subcorr(t_matKc, t_matBc, t_dTrace, t_vecX);
+                if(t_dCorr > p_panel.dCorr)
+                {
+                    p_panel.dCorr = t_dCorr;
+                    p_panel.iIdx1 = i;
+                    p_panel.iIdx2 = j;
+                    p_panel.vecX = t_vecX;
+                }
+            }
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+double RapMusic::subcorr(const CandidateMatrix &p_matK, const CandidateMatrix &p_matB, double p_dTrace, CandidateVector &p_vecX)
+{
+    if(p_dTrace <= 0)
+        return -1;
+
+    //
+    //   Whiten the candidate: T = V_r * D_r^(-1/2) spans the same space as Orth(P*G_c), dropping the
+    //   directions with a singular value below 1e-6 of the candidate's norm. Single free orientation sources
+    //   are decomposed in closed form.
+    //
+    qint32 t_iDim = p_matK.rows();
+    CandidateVector t_vecD;
+    CandidateMatrix t_matV;
+    if(t_iDim == 3)
+    {
+        SelfAdjointEigenSolver<Matrix3d> t_eigK;
+        t_eigK.computeDirect(Matrix3d(p_matK));
+        t_vecD = t_eigK.eigenvalues();
+        t_matV = t_eigK.eigenvectors();
+    }
+    else
+    {
+        SelfAdjointEigenSolver<CandidateMatrix> t_eigK(p_matK);
+        t_vecD = t_eigK.eigenvalues();
+        t_matV = t_eigK.eigenvectors();
+    }
+
+    double t_dTol = 1e-12 * p_dTrace;
+
+    qint32 t_iRank = 0;
+    CandidateMatrix t_matT(t_iDim, t_iDim);
+    for(qint32 i = t_iDim - 1; i >= 0; --i)
+    {
+        if(t_vecD[i] <= t_dTol)
+            break;
+        t_matT.col(t_iRank) = t_matV.col(i) / sqrt(t_vecD[i]);
+        ++t_iRank;
+    }
+
+    if(t_iRank == 0)
+        return -1;
+
+    CandidateMatrix t_matM(t_iRank, t_iRank);
+    t_matM.noalias() = t_matT.leftCols(t_iRank).transpose() * p_matB * t_matT.leftCols(t_iRank);
+
+    double t_dLambda;
+    if(t_iRank == 3)
+    {
+        SelfAdjointEigenSolver<Matrix3d> t_eigM;
+        t_eigM.computeDirect(Matrix3d(t_matM));
+        t_dLambda = t_eigM.eigenvalues()[2];
+        p_vecX.noalias() = t_matT.leftCols(3) * t_eigM.eigenvectors().col(2);
+    }
+    else
+    {
+        SelfAdjointEigenSolver<CandidateMatrix> t_eigM(t_matM);
+        t_dLambda = t_eigM.eigenvalues()[t_iRank-1];
+        p_vecX.noalias() = t_matT.leftCols(t_iRank) * t_eigM.eigenvectors().col(t_iRank-1);
+    }
+
+    if(t_dLambda <= 0)
+        return 0;
+
+    return t_dLambda < 1.0 ? sqrt(t_dLambda) : 1.0;
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd RapMusic::diag_blocks(const MatrixXd &p_matA, qint32 p_iOri)
+{
+    qint32 t_iRows = p_matA.rows();
+    qint32 t_iNumSources = p_matA.cols() / p_iOri;
+
+    MatrixXd t_matBlocks = MatrixXd::Zero(p_iOri*p_iOri, t_iNumSources);
+    if(t_iRows == 0)
+        return t_matBlocks;
+
+    for(qint32 a = 0; a < p_iOri; ++a)
+    {
+        Map<const MatrixXd, 0, OuterStride<> > t_matA_a(p_matA.data() + a*t_iRows, t_iRows, t_iNumSources, OuterStride<>(p_iOri*t_iRows));
+        for(qint32 b = a; b < p_iOri; ++b)
+        {
+            Map<const MatrixXd, 0, OuterStride<> > t_matA_b(p_matA.data() + b*t_iRows, t_iRows, t_iNumSources, OuterStride<>(p_iOri*t_iRows));
+            t_matBlocks.row(a*p_iOri+b) = t_matA_a.cwiseProduct(t_matA_b).colwise().sum();
+            if(b != a)
+                t_matBlocks.row(b*p_iOri+a) = t_matBlocks.row(a*p_iOri+b);
+        }
+    }
+
+    return t_matBlocks;
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd RapMusic::signal_subspace(const MatrixXd &p_matData, qint32 p_iRank)
+{
+    qint32 nchan = p_matData.rows();
+    qint32 nsamp = p_matData.cols();
+
+    //
+    //   Eigenvalues come in ascending order
+    //
+    if(nchan <= nsamp)
+    {
+        MatrixXd t_matCov = MatrixXd::Zero(nchan, nchan);
+        t_matCov.selfadjointView<Lower>().rankUpdate(p_matData);
+
+        SelfAdjointEigenSolver<MatrixXd> t_eig(t_matCov);
+        return t_eig.eigenvectors().rightCols(p_iRank).rowwise().reverse();
+    }
+    else
+    {
+        //
+        //   Fewer samples than channels: decompose D'*D, its eigenvectors map to the channel space by D*v/s
+        //
+        MatrixXd t_matGram = MatrixXd::Zero(nsamp, nsamp);
+        t_matGram.selfadjointView<Lower>().rankUpdate(p_matData.transpose());
+
+        SelfAdjointEigenSolver<MatrixXd> t_eig(t_matGram);
+        MatrixXd t_matPhi_s = p_matData * t_eig.eigenvectors().rightCols(p_iRank).rowwise().reverse();
+        for(qint32 i = 0; i < p_iRank; ++i)
+        {
+            double t_dNorm = t_matPhi_s.col(i).norm();
+            if(t_dNorm > 0)
+                t_matPhi_s.col(i) /= t_dNorm;
+        }
+        return t_matPhi_s;
+    }
+}
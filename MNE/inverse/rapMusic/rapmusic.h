@@ -47,6 +47,32 @@
 #include <mne/mne_forwardsolution.h>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+#include <QList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define RAPMUSIC_MAX_PAIR_COLUMNS  6000     /**< Lead field columns up to which pairs are scanned; the scan keeps
+                                                 three dense columns x columns matrices, 864 MB at the limit */
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE NAMESPACE INVERSELIB
@@ -61,28 +87,189 @@ namespace INVERSELIB
 //=============================================================================================================
 
 using namespace MNELIB;
+using namespace Eigen;
+
 
 //=============================================================================================================
 /**
-* RAP MUSIC algorithm ToDo: Paper references.
+* RAP MUSIC algorithm (Mosher, J.C. and Leahy, R.M., Source localization using recursively applied and projected
+* (RAP) MUSIC, IEEE Trans. Signal Process., 47(2), 332-340, 1999). The signal subspace is taken from the data
+* covariance. Each recursion scans the subspace correlation of all single sources, or of all source pairs to
+* localize correlated sources, projects the found topography out of the signal subspace and the lead field and
+* starts over. The scan is parallelised across the candidate sources; gold/rapmusic_gold.h holds the plain
+* reference implementation it's tested against.
 *
 * @brief RAP MUSIC
 */
 class INVERSESHARED_EXPORT RapMusic : public IInverseAlgorithm
 {
 public:
+    typedef QSharedPointer<RapMusic> SPtr;             /**< Shared pointer type for RapMusic. */
+    typedef QSharedPointer<const RapMusic> ConstSPtr;  /**< Const shared pointer type for RapMusic. */
+
+    //=========================================================================================================
+    /**
+    * A dipole, or a pair of dipoles, found by one recursion of the scan. The moments are the lead field
+    * coefficients of the source (1 for fixed, 3 for free orientations) which make up the found topography.
+    */
+    struct Dipole
+    {
+        qint32 iIdx1;           /**< Source index of the (first) dipole */
+        qint32 iIdx2;           /**< Source index of the second dipole of a pair, -1 for single dipoles */
+        VectorXd vecMoment1;    /**< Moment of the (first) dipole */
+        VectorXd vecMoment2;    /**< Moment of the second dipole of a pair, empty for single dipoles */
+        double dCorr;           /**< Subspace correlation */
+    };
+
+    //=========================================================================================================
+    /**
+    * Default constructor, init has to be called before the algorithm can be applied.
+    */
     RapMusic();
 
+    //=========================================================================================================
+    /**
+    * Constructs the RAP MUSIC algorithm
+    *
+    * @param[in] p_forwardSolution  The forward solution which is scanned. Pair scans are meant for clustered
+    *                               forward solutions, since the number of pairs grows quadratically.
+    * @param[in] p_iN               Rank of the signal subspace, which is the maximal number of recursions
+    * @param[in] p_dThr             Subspace correlation at which the recursion stops
+    * @param[in] p_bPairs           Scan source pairs instead of single sources
+    */
+    explicit RapMusic(const MNEForwardSolution &p_forwardSolution, qint32 p_iN = 2, double p_dThr = 0.5, bool p_bPairs = false);
+
     virtual ~RapMusic(){}
 
-    virtual SourceEstimate calculateInverse() const;
+    //=========================================================================================================
+    /**
+    * Initializes the RAP MUSIC algorithm and precomputes the Gram matrix of the lead field.
+    *
+    * @param[in] p_forwardSolution  The forward solution which is scanned
+    * @param[in] p_iN               Rank of the signal subspace, which is the maximal number of recursions
+    * @param[in] p_dThr             Subspace correlation at which the recursion stops
+    * @param[in] p_bPairs           Scan source pairs instead of single sources; fails for lead fields with more
+    *                               than RAPMUSIC_MAX_PAIR_COLUMNS columns
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool init(const MNEForwardSolution &p_forwardSolution, qint32 p_iN = 2, double p_dThr = 0.5, bool p_bPairs = false);
+
+    //=========================================================================================================
+    /**
+    * Localizes the dipoles of the evoked data. The channels are picked according to the forward solution.
+    *
+    * @param[in] p_fiffEvoked   Evoked data.
+    * @param[in] pick_normal    Not used, the found dipoles carry their orientation.
+    *
+    * @return the dipole amplitudes as source estimate, zero for all sources which were not found
+    */
+    virtual SourceEstimate calculateInverse(const FiffEvoked &p_fiffEvoked, bool pick_normal = false) const;
+
+    //=========================================================================================================
+    /**
+    * Localizes the dipoles of a data block, e.g. of a real-time stream. The rows of the data have to match the
+    * channels of the forward solution.
+    *
+    * @param[in] data       Data block (channels x samples)
+    * @param[in] tmin       Time of the first sample
+    * @param[in] tstep      Time between two samples
+    *
+    * @return the dipole amplitudes as source estimate; empty if the algorithm isn't initialized
+    */
+    SourceEstimate calculateInverse(const MatrixXd &data, float tmin, float tstep) const;
+
+    //=========================================================================================================
+    /**
+    * Runs the recursive scan on a data block.
+    *
+    * @param[in] p_matData          Data block (channels x samples)
+    * @param[out] p_qListDipoles    The found dipoles in the order of the recursions
+    *
+    * @return true if succeeded, false otherwise
+    */
+    bool scan(const MatrixXd &p_matData, QList<Dipole> &p_qListDipoles) const;
 
     virtual const char* getName() const;
 
     virtual const MNESourceSpace& getSourceSpace() const;
 
 private:
-    MNEForwardSolution m_ForwardSolution; /**< The Forward operator which should be scanned through*/
+    typedef Matrix<double, Dynamic, Dynamic, ColMajor, 6, 6> CandidateMatrix;  /**< Candidate matrices, no heap allocation. */
+    typedef Matrix<double, Dynamic, 1, ColMajor, 6, 1> CandidateVector;       /**< Candidate vectors, no heap allocation. */
+
+    //=========================================================================================================
+    /**
+    * Range of candidate sources of one scan job, with the best candidate found in it.
+    */
+    struct ScanPanel
+    {
+        const RapMusic *pRapMusic;  /**< The algorithm which holds the lead field Gram matrix */
+        const MatrixXd *pK;         /**< Projected lead field Gram matrix, laid out like m_matGram */
+        const MatrixXd *pB;         /**< Lead field Gram matrix in the signal subspace, laid out like m_matGram */
+        qint32 iFirst;              /**< First candidate source */
+        qint32 iLast;               /**< Candidate source after the last one */
+        double dCorr;               /**< Best subspace correlation, -1 if none */
+        qint32 iIdx1;               /**< First source of the best candidate */
+        qint32 iIdx2;               /**< Second source of the best candidate, -1 for single sources */
+        VectorXd vecX;              /**< Lead field coefficients of the best candidate */
+    };
+
+    //=========================================================================================================
+    /**
+    * Scans the candidates of a panel. Pair panels hold the first source of the pairs.
+    *
+    * @param[in, out] p_panel   The panel
+    */
+    static void scan_panel(ScanPanel &p_panel);
+
+    //=========================================================================================================
+    /**
+    * Computes the subspace correlation of a candidate, i.e. the largest singular value of Orth(P*G_c)'*U_s,
+    * from the projected Gram matrix K = G_c'*P*G_c and B = G_c'*U_s*U_s'*G_c as the largest eigenvalue of
+    * the pencil (B, K). Directions of G_c which were projected out are dropped.
+    *
+    * @param[in] p_matK         Projected Gram matrix of the candidate
+    * @param[in] p_matB         Signal subspace Gram matrix of the candidate
+    * @param[in] p_dTrace       Trace of the unprojected Gram matrix, reference for the dropped directions
+    * @param[out] p_vecX        Lead field coefficients of the best topography
+    *
+    * @return the subspace correlation
+    */
+    static double subcorr(const CandidateMatrix &p_matK, const CandidateMatrix &p_matB, double p_dTrace, CandidateVector &p_vecX);
+
+    //=========================================================================================================
+    /**
+    * Computes the diagonal source blocks A_s'*A_s of the Gram matrix of A. Entry (a,b) of block s is stored at
+    * (a*orientations+b, s), so each entry is computed for all sources at once with a strided column product.
+    *
+    * @param[in] p_matA     Matrix with orientations columns per source
+    * @param[in] p_iOri     Columns per source
+    *
+    * @return the diagonal blocks (orientations^2 x sources)
+    */
+    static MatrixXd diag_blocks(const MatrixXd &p_matA, qint32 p_iOri);
+
+    //=========================================================================================================
+    /**
+    * Computes the signal subspace of the data, i.e. the eigenvectors of the data covariance belonging to the
+    * largest eigenvalues. The smaller of the channel or sample Gram matrix is decomposed.
+    *
+    * @param[in] p_matData      Data block (channels x samples)
+    * @param[in] p_iRank        Rank of the signal subspace
+    *
+    * @return the signal subspace (channels x rank)
+    */
+    static MatrixXd signal_subspace(const MatrixXd &p_matData, qint32 p_iRank);
+
+    MNEForwardSolution m_ForwardSolution;   /**< The Forward operator which should be scanned through */
+    qint32 m_iN;                            /**< Rank of the signal subspace */
+    double m_dThreshold;                    /**< Subspace correlation at which the recursion stops */
+    bool m_bPairs;                          /**< Scan source pairs */
+    qint32 m_iOri;                          /**< Lead field columns per source */
+    qint32 m_iNumSources;                   /**< Number of sources */
+    MatrixXd m_matGram;                     /**< Lower triangle of the lead field Gram matrix for pair scans, its diagonal source blocks otherwise */
+    QList<VectorXi> m_qListVertices;        /**< Source space vertices of the solution */
 };
 
 } //NAMESPACE
@@ -48,6 +48,7 @@
 #include "mne_forwardsolution.h"
 #include "mne_hemisphere.h"
 #include "mne_sourcespace.h"
+#include "mne_cache.h"
 
 
 //*************************************************************************************************************
@@ -37,7 +37,7 @@ include(../../mne-cpp.pri)
 
 TEMPLATE = lib
 
-QT += network
+QT += network concurrent
 QT -= gui
 
 DEFINES += MNE_LIBRARY
@@ -83,7 +83,8 @@ SOURCES += \
     mne_inverse_operator.cpp \
     mne_epoch_data.cpp \
     mne_epoch_data_list.cpp \
-    mne_cluster_info.cpp
+    mne_cluster_info.cpp \
+    mne_cache.cpp
 
 HEADERS += \
     mne.h \
@@ -94,7 +95,8 @@ HEADERS += \
     mne_inverse_operator.h \
     mne_epoch_data.h \
     mne_epoch_data_list.h \
-    mne_cluster_info.h
+    mne_cluster_info.h \
+    mne_cache.h
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
 INCLUDEPATH += $${MNE_INCLUDE_DIR}
@@ -0,0 +1,1002 @@
+//=============================================================================================================
+/**
+* @file     mne_cache.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the MNECache Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "mne_cache.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cstring>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNELIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+void MNECache::setDirectory(const QString &p_sDirectory)
+{
+    if(!p_sDirectory.isEmpty() && !QDir().mkpath(p_sDirectory))
+        printf("Could not create the cache directory %s.\n", p_sDirectory.toUtf8().constData());
+
+    directoryRef() = p_sDirectory;
+}
+
+
+//*************************************************************************************************************
+
+QString MNECache::directory()
+{
+    if(!directoryRef().isEmpty())
+        return directoryRef();
+
+    return QString::fromLocal8Bit(qgetenv("MNE_CACHE_DIR"));
+}
+
+
+//*************************************************************************************************************
+
+QByteArray MNECache::key(QIODevice &p_IODevice, const QStringList &p_qListOptions)
+{
+    if(directory().isEmpty() || p_IODevice.isSequential())
+        return QByteArray();
+
+    //
+    //   Files are looked up by path, size and modification time first, so a warm read doesn't hash the file
+    //
+    QString t_sPreKeyFileName = preKeyFileName(p_IODevice, p_qListOptions);
+    if(!t_sPreKeyFileName.isEmpty())
+    {
+        QFile t_preKeyFile(t_sPreKeyFileName);
+        if(t_preKeyFile.open(QIODevice::ReadOnly))
+        {
+            QByteArray t_key = t_preKeyFile.read(41);
+            if(t_key.size() == 40)
+                return t_key;
+        }
+    }
+
+    bool t_bWasOpen = p_IODevice.isOpen();
+    qint64 t_iPos = t_bWasOpen ? p_IODevice.pos() : 0;
+
+    if(!t_bWasOpen && !p_IODevice.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash t_hash(QCryptographicHash::Sha1);
+    bool t_bOk = p_IODevice.seek(0) && t_hash.addData(&p_IODevice);
+    t_hash.addData(p_qListOptions.join("\n").toUtf8());
+    t_hash.addData(QByteArray::number(Version));
+
+    if(t_bWasOpen)
+        p_IODevice.seek(t_iPos);
+    else
+        p_IODevice.close();
+
+    if(!t_bOk)
+        return QByteArray();
+
+    QByteArray t_key = t_hash.result().toHex();
+
+    if(!t_sPreKeyFileName.isEmpty())
+    {
+        QSaveFile t_preKeyFile(t_sPreKeyFileName);
+        if(t_preKeyFile.open(QIODevice::WriteOnly))
+        {
+            t_preKeyFile.write(t_key);
+            t_preKeyFile.commit();
+        }
+    }
+
+    return t_key;
+}
+
+
+//*************************************************************************************************************
+
+bool MNECache::readForwardSolution(const QByteArray &p_key, MNEForwardSolution &fwd)
+{
+    return readEntry(p_key, "fwd", &fwd, 0);
+}
+
+
+//*************************************************************************************************************
+
+bool MNECache::writeForwardSolution(const QByteArray &p_key, const MNEForwardSolution &fwd)
+{
+    return writeEntry(p_key, "fwd", &fwd, 0);
+}
+
+
+//*************************************************************************************************************
+
+bool MNECache::readInverseOperator(const QByteArray &p_key, MNEInverseOperator &inv)
+{
+    return readEntry(p_key, "inv", 0, &inv);
+}
+
+
+//*************************************************************************************************************
+
+bool MNECache::writeInverseOperator(const QByteArray &p_key, const MNEInverseOperator &inv)
+{
+    return writeEntry(p_key, "inv", 0, &inv);
+}
+
+
+//*************************************************************************************************************
+
+QString& MNECache::directoryRef()
+{
+    static QString s_sDirectory;
+    return s_sDirectory;
+}
+
+
+//*************************************************************************************************************
+
+QString MNECache::preKeyFileName(QIODevice &p_IODevice, const QStringList &p_qListOptions)
+{
+    QFile* t_pFile = qobject_cast<QFile*>(&p_IODevice);
+    if(!t_pFile || t_pFile->fileName().isEmpty())
+        return QString();
+
+    QFileInfo t_fileInfo(*t_pFile);
+    if(!t_fileInfo.exists())
+        return QString();
+
+    // A file modified within the last seconds could still change without a new time stamp
+    qint64 t_iModified = t_fileInfo.lastModified().toMSecsSinceEpoch();
+    if(QDateTime::currentMSecsSinceEpoch() - t_iModified < 2000)
+        return QString();
+
+    QCryptographicHash t_hash(QCryptographicHash::Sha1);
+    t_hash.addData(t_fileInfo.absoluteFilePath().toUtf8());
+    t_hash.addData(QByteArray::number(t_fileInfo.size()));
+    t_hash.addData(QByteArray::number(t_iModified));
+    t_hash.addData(p_qListOptions.join("\n").toUtf8());
+    t_hash.addData(QByteArray::number(Version));
+
+    return QDir(directory()).filePath(QString("%1.key").arg(QString(t_hash.result().toHex())));
+}
+
+
+//*************************************************************************************************************
+
+bool MNECache::writeEntry(const QByteArray &p_key, const char* p_sKind, const MNEForwardSolution* p_pFwd, const MNEInverseOperator* p_pInv)
+{
+    QString t_sDirectory = directory();
+    if(p_key.isEmpty() || t_sDirectory.isEmpty())
+        return false;
+
+    QString t_sFileName = QDir(t_sDirectory).filePath(QString("%1.%2").arg(QString(p_key)).arg(p_sKind));
+
+    QSaveFile t_file(t_sFileName);
+    if(!t_file.open(QIODevice::WriteOnly))
+    {
+        printf("Could not create the cache entry %s.\n", t_sFileName.toUtf8().constData());
+        return false;
+    }
+
+    //
+    //   Header: the byte order marker rejects entries of machines with another byte order
+    //
+    t_file.write("MNECACHE", 8);
+    write(t_file, Version);
+    write(t_file, (qint32)0x01020304);
+    write(t_file, QString(p_sKind));
+    write(t_file, QString(p_key));
+
+    if(p_pFwd)
+    {
+        write(t_file, p_pFwd->info);
+        write(t_file, p_pFwd->source_ori);
+        write(t_file, p_pFwd->surf_ori);
+        write(t_file, p_pFwd->coord_frame);
+        write(t_file, p_pFwd->nsource);
+        write(t_file, p_pFwd->nchan);
+        write(t_file, p_pFwd->sol);
+        write(t_file, p_pFwd->sol_grad);
+        write(t_file, p_pFwd->mri_head_t);
+        write(t_file, p_pFwd->src);
+        write(t_file, p_pFwd->source_rr);
+        write(t_file, p_pFwd->source_nn);
+    }
+
+    if(p_pInv)
+    {
+        write(t_file, p_pInv->info);
+        write(t_file, p_pInv->methods);
+        write(t_file, p_pInv->source_ori);
+        write(t_file, p_pInv->nsource);
+        write(t_file, p_pInv->nchan);
+        write(t_file, p_pInv->coord_frame);
+        write(t_file, p_pInv->source_nn);
+        write(t_file, p_pInv->sing);
+        write(t_file, p_pInv->eigen_leads_weighted);
+        write(t_file, p_pInv->eigen_leads);
+        write(t_file, p_pInv->eigen_fields);
+        write(t_file, p_pInv->noise_cov);
+        write(t_file, p_pInv->source_cov);
+        write(t_file, p_pInv->orient_prior);
+        write(t_file, p_pInv->depth_prior);
+        write(t_file, p_pInv->fmri_prior);
+        write(t_file, p_pInv->src);
+        write(t_file, p_pInv->mri_head_t);
+        write(t_file, p_pInv->nave);
+        write(t_file, p_pInv->projs);
+        write(t_file, p_pInv->proj);
+        write(t_file, p_pInv->whitener);
+        write(t_file, p_pInv->reginv);
+        write(t_file, p_pInv->noisenorm);
+    }
+
+    if(!t_file.commit())
+    {
+        printf("Could not write the cache entry %s.\n", t_sFileName.toUtf8().constData());
+        return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MNECache::readEntry(const QByteArray &p_key, const char* p_sKind, MNEForwardSolution* p_pFwd, MNEInverseOperator* p_pInv)
+{
+    QString t_sDirectory = directory();
+    if(p_key.isEmpty() || t_sDirectory.isEmpty())
+        return false;
+
+    QFile t_file(QDir(t_sDirectory).filePath(QString("%1.%2").arg(QString(p_key)).arg(p_sKind)));
+    if(!t_file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 t_iSize = t_file.size();
+    uchar* t_pData = t_iSize > 0 ? t_file.map(0, t_iSize) : 0;
+    if(!t_pData)
+    {
+        t_file.close();
+        return false;
+    }
+
+    Cursor t_cursor;
+    t_cursor.pData = t_pData;
+    t_cursor.iPos = 0;
+    t_cursor.iSize = t_iSize;
+    t_cursor.bOk = true;
+
+    //
+    //   Header
+    //
+    const uchar* t_pMagic = take(t_cursor, 8);
+    qint32 t_iVersion, t_iByteOrder;
+    QString t_sKind, t_sKey;
+    read(t_cursor, t_iVersion);
+    read(t_cursor, t_iByteOrder);
+    read(t_cursor, t_sKind);
+    read(t_cursor, t_sKey);
+
+    bool t_bOk = t_cursor.bOk && memcmp(t_pMagic, "MNECACHE", 8) == 0 && t_iVersion == Version
+            && t_iByteOrder == 0x01020304 && t_sKind == QString(p_sKind) && t_sKey == QString(p_key);
+
+    //
+    //   Payload, read into a copy so a truncated entry leaves the target untouched
+    //
+    if(t_bOk && p_pFwd)
+    {
+        MNEForwardSolution t_fwd;
+        read(t_cursor, t_fwd.info);
+        read(t_cursor, t_fwd.source_ori);
+        read(t_cursor, t_fwd.surf_ori);
+        read(t_cursor, t_fwd.coord_frame);
+        read(t_cursor, t_fwd.nsource);
+        read(t_cursor, t_fwd.nchan);
+        read(t_cursor, t_fwd.sol);
+        read(t_cursor, t_fwd.sol_grad);
+        read(t_cursor, t_fwd.mri_head_t);
+        read(t_cursor, t_fwd.src);
+        read(t_cursor, t_fwd.source_rr);
+        read(t_cursor, t_fwd.source_nn);
+
+        t_bOk = t_cursor.bOk;
+        if(t_bOk)
+            *p_pFwd = t_fwd;
+    }
+
+    if(t_bOk && p_pInv)
+    {
+        MNEInverseOperator t_inv;
+        read(t_cursor, t_inv.info);
+        read(t_cursor, t_inv.methods);
+        read(t_cursor, t_inv.source_ori);
+        read(t_cursor, t_inv.nsource);
+        read(t_cursor, t_inv.nchan);
+        read(t_cursor, t_inv.coord_frame);
+        read(t_cursor, t_inv.source_nn);
+        read(t_cursor, t_inv.sing);
+        read(t_cursor, t_inv.eigen_leads_weighted);
+        read(t_cursor, t_inv.eigen_leads);
+        read(t_cursor, t_inv.eigen_fields);
+        read(t_cursor, t_inv.noise_cov);
+        read(t_cursor, t_inv.source_cov);
+        read(t_cursor, t_inv.orient_prior);
+        read(t_cursor, t_inv.depth_prior);
+        read(t_cursor, t_inv.fmri_prior);
+        read(t_cursor, t_inv.src);
+        read(t_cursor, t_inv.mri_head_t);
+        read(t_cursor, t_inv.nave);
+        read(t_cursor, t_inv.projs);
+        read(t_cursor, t_inv.proj);
+        read(t_cursor, t_inv.whitener);
+        read(t_cursor, t_inv.reginv);
+        read(t_cursor, t_inv.noisenorm);
+
+        t_bOk = t_cursor.bOk;
+        if(t_bOk)
+            *p_pInv = t_inv;
+    }
+
+    t_file.unmap(t_pData);
+    t_file.close();
+
+    if(!t_bOk)
+        printf("Cache entry %s is invalid, it is rewritten.\n", t_file.fileName().toUtf8().constData());
+
+    return t_bOk;
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::align(QIODevice &p_dev)
+{
+    static const char s_zeros[16] = {0};
+
+    qint64 t_iPad = (16 - p_dev.pos() % 16) % 16;
+    if(t_iPad > 0)
+        p_dev.write(s_zeros, t_iPad);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, qint32 p_iValue)
+{
+    p_dev.write((const char*)&p_iValue, sizeof(qint32));
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, float p_fValue)
+{
+    p_dev.write((const char*)&p_fValue, sizeof(float));
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const QString &p_sValue)
+{
+    write(p_dev, (qint32)p_sValue.size());
+    p_dev.write((const char*)p_sValue.constData(), p_sValue.size()*sizeof(QChar));
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const QStringList &p_qListValue)
+{
+    write(p_dev, (qint32)p_qListValue.size());
+    for(qint32 i = 0; i < p_qListValue.size(); ++i)
+        write(p_dev, p_qListValue[i]);
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+void MNECache::write(QIODevice &p_dev, const QList<T> &p_qListValue)
+{
+    write(p_dev, (qint32)p_qListValue.size());
+    for(qint32 i = 0; i < p_qListValue.size(); ++i)
+        write(p_dev, p_qListValue[i]);
+}
+
+
+//*************************************************************************************************************
+
+template<typename Derived>
+void MNECache::write(QIODevice &p_dev, const PlainObjectBase<Derived> &p_matValue)
+{
+    typedef typename Derived::Scalar Scalar;
+
+    write(p_dev, (qint32)p_matValue.rows());
+    write(p_dev, (qint32)p_matValue.cols());
+    write(p_dev, (qint32)sizeof(Scalar));
+    align(p_dev);
+    p_dev.write((const char*)p_matValue.data(), p_matValue.size()*sizeof(Scalar));
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+void MNECache::write(QIODevice &p_dev, const QSharedDataPointer<T> &p_pValue)
+{
+    write(p_dev, (qint32)(p_pValue.constData() != 0));
+    if(p_pValue.constData())
+        write(p_dev, *p_pValue.constData());
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const SparseMatrix<double> &p_matValue)
+{
+    typedef SparseMatrix<double>::Index Index;
+
+    SparseMatrix<double> t_matCompressed(p_matValue);
+    t_matCompressed.makeCompressed();
+
+    write(p_dev, (qint32)t_matCompressed.rows());
+    write(p_dev, (qint32)t_matCompressed.cols());
+    write(p_dev, (qint32)t_matCompressed.nonZeros());
+    write(p_dev, (qint32)sizeof(Index));
+    align(p_dev);
+    p_dev.write((const char*)t_matCompressed.outerIndexPtr(), (t_matCompressed.outerSize()+1)*sizeof(Index));
+    if(t_matCompressed.nonZeros() > 0)
+    {
+        align(p_dev);
+        p_dev.write((const char*)t_matCompressed.innerIndexPtr(), t_matCompressed.nonZeros()*sizeof(Index));
+        align(p_dev);
+        p_dev.write((const char*)t_matCompressed.valuePtr(), t_matCompressed.nonZeros()*sizeof(double));
+    }
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffId &p_id)
+{
+    write(p_dev, p_id.version);
+    write(p_dev, p_id.machid[0]);
+    write(p_dev, p_id.machid[1]);
+    write(p_dev, p_id.time.secs);
+    write(p_dev, p_id.time.usecs);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffCoordTrans &p_trans)
+{
+    write(p_dev, p_trans.from);
+    write(p_dev, p_trans.to);
+    write(p_dev, p_trans.trans);
+    write(p_dev, p_trans.invtrans);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffChInfo &p_chInfo)
+{
+    write(p_dev, p_chInfo.scanno);
+    write(p_dev, p_chInfo.logno);
+    write(p_dev, p_chInfo.kind);
+    write(p_dev, p_chInfo.range);
+    write(p_dev, p_chInfo.cal);
+    write(p_dev, p_chInfo.coil_type);
+    write(p_dev, p_chInfo.loc);
+    write(p_dev, p_chInfo.coil_trans);
+    write(p_dev, p_chInfo.eeg_loc);
+    write(p_dev, p_chInfo.coord_frame);
+    write(p_dev, p_chInfo.unit);
+    write(p_dev, p_chInfo.unit_mul);
+    write(p_dev, p_chInfo.ch_name);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffInfoBase &p_info)
+{
+    write(p_dev, p_info.filename);
+    write(p_dev, p_info.meas_id);
+    write(p_dev, p_info.nchan);
+    write(p_dev, p_info.chs);
+    write(p_dev, p_info.ch_names);
+    write(p_dev, p_info.dev_head_t);
+    write(p_dev, p_info.ctf_head_t);
+    write(p_dev, p_info.bads);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffNamedMatrix &p_matrix)
+{
+    write(p_dev, p_matrix.nrow);
+    write(p_dev, p_matrix.ncol);
+    write(p_dev, p_matrix.row_names);
+    write(p_dev, p_matrix.col_names);
+    write(p_dev, p_matrix.data);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffProj &p_proj)
+{
+    write(p_dev, p_proj.kind);
+    write(p_dev, p_proj.active);
+    write(p_dev, p_proj.desc);
+    write(p_dev, p_proj.data);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const FiffCov &p_cov)
+{
+    write(p_dev, p_cov.kind);
+    write(p_dev, p_cov.diag);
+    write(p_dev, p_cov.dim);
+    write(p_dev, p_cov.names);
+    write(p_dev, p_cov.data);
+    write(p_dev, p_cov.projs);
+    write(p_dev, p_cov.bads);
+    write(p_dev, p_cov.nfree);
+    write(p_dev, p_cov.eig);
+    write(p_dev, p_cov.eigvec);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const MNEHemisphere &p_hemisphere)
+{
+    write(p_dev, p_hemisphere.type);
+    write(p_dev, p_hemisphere.id);
+    write(p_dev, p_hemisphere.np);
+    write(p_dev, p_hemisphere.ntri);
+    write(p_dev, p_hemisphere.coord_frame);
+    write(p_dev, p_hemisphere.rr);
+    write(p_dev, p_hemisphere.nn);
+    write(p_dev, p_hemisphere.tris);
+    write(p_dev, p_hemisphere.nuse);
+    write(p_dev, p_hemisphere.inuse);
+    write(p_dev, p_hemisphere.vertno);
+    write(p_dev, p_hemisphere.nuse_tri);
+    write(p_dev, p_hemisphere.use_tris);
+    write(p_dev, p_hemisphere.nearest);
+    write(p_dev, p_hemisphere.nearest_dist);
+    write(p_dev, p_hemisphere.pinfo);
+    write(p_dev, p_hemisphere.patch_inds);
+    write(p_dev, p_hemisphere.dist_limit);
+    write(p_dev, p_hemisphere.dist);
+    write(p_dev, p_hemisphere.tri_cent);
+    write(p_dev, p_hemisphere.tri_nn);
+    write(p_dev, p_hemisphere.tri_area);
+    write(p_dev, p_hemisphere.use_tri_cent);
+    write(p_dev, p_hemisphere.use_tri_nn);
+    write(p_dev, p_hemisphere.use_tri_area);
+    write(p_dev, p_hemisphere.cluster_info.clusterVertnos);
+    write(p_dev, p_hemisphere.cluster_info.clusterDistances);
+    write(p_dev, p_hemisphere.cluster_info.clusterLabelIds);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::write(QIODevice &p_dev, const MNESourceSpace &p_sourceSpace)
+{
+    write(p_dev, p_sourceSpace.m_qListHemispheres);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::align(Cursor &p_cursor)
+{
+    p_cursor.iPos = (p_cursor.iPos + 15) & ~(qint64)15;
+}
+
+
+//*************************************************************************************************************
+
+const uchar* MNECache::take(Cursor &p_cursor, qint64 p_iBytes)
+{
+    if(!p_cursor.bOk || p_iBytes < 0 || p_cursor.iPos + p_iBytes > p_cursor.iSize)
+    {
+        p_cursor.bOk = false;
+        return 0;
+    }
+
+    const uchar* t_pData = p_cursor.pData + p_cursor.iPos;
+    p_cursor.iPos += p_iBytes;
+    return t_pData;
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, qint32 &p_iValue)
+{
+    const uchar* t_pData = take(p_cursor, sizeof(qint32));
+    p_iValue = 0;
+    if(t_pData)
+        memcpy(&p_iValue, t_pData, sizeof(qint32));
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, bool &p_bValue)
+{
+    qint32 t_iValue;
+    read(p_cursor, t_iValue);
+    p_bValue = t_iValue != 0;
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, float &p_fValue)
+{
+    const uchar* t_pData = take(p_cursor, sizeof(float));
+    p_fValue = 0;
+    if(t_pData)
+        memcpy(&p_fValue, t_pData, sizeof(float));
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, QString &p_sValue)
+{
+    qint32 t_iSize;
+    read(p_cursor, t_iSize);
+    const uchar* t_pData = take(p_cursor, (qint64)t_iSize*sizeof(QChar));
+    p_sValue = t_pData ? QString((const QChar*)t_pData, t_iSize) : QString();
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, QStringList &p_qListValue)
+{
+    qint32 t_iSize;
+    read(p_cursor, t_iSize);
+
+    p_qListValue.clear();
+    QString t_sValue;
+    for(qint32 i = 0; i < t_iSize && p_cursor.bOk; ++i)
+    {
+        read(p_cursor, t_sValue);
+        p_qListValue.append(t_sValue);
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+void MNECache::read(Cursor &p_cursor, QList<T> &p_qListValue)
+{
+    qint32 t_iSize;
+    read(p_cursor, t_iSize);
+
+    p_qListValue.clear();
+    for(qint32 i = 0; i < t_iSize && p_cursor.bOk; ++i)
+    {
+        T t_value;
+        read(p_cursor, t_value);
+        p_qListValue.append(t_value);
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename Derived>
+void MNECache::read(Cursor &p_cursor, PlainObjectBase<Derived> &p_matValue)
+{
+    typedef typename Derived::Scalar Scalar;
+
+    qint32 t_iRows, t_iCols, t_iScalarSize;
+    read(p_cursor, t_iRows);
+    read(p_cursor, t_iCols);
+    read(p_cursor, t_iScalarSize);
+
+    if(t_iRows < 0 || t_iCols < 0 || t_iScalarSize != (qint32)sizeof(Scalar)
+            || (Derived::RowsAtCompileTime != Dynamic && t_iRows != Derived::RowsAtCompileTime)
+            || (Derived::ColsAtCompileTime != Dynamic && t_iCols != Derived::ColsAtCompileTime))
+        p_cursor.bOk = false;
+
+    align(p_cursor);
+    const uchar* t_pData = take(p_cursor, (qint64)t_iRows*t_iCols*sizeof(Scalar));
+    if(!t_pData)
+        return;
+
+    p_matValue.resize(t_iRows, t_iCols);
+    memcpy(p_matValue.data(), t_pData, (size_t)p_matValue.size()*sizeof(Scalar));
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+void MNECache::read(Cursor &p_cursor, QSharedDataPointer<T> &p_pValue)
+{
+    bool t_bValid;
+    read(p_cursor, t_bValid);
+
+    p_pValue = QSharedDataPointer<T>(t_bValid ? new T() : 0);
+    if(t_bValid)
+        read(p_cursor, *p_pValue.data());
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, SparseMatrix<double> &p_matValue)
+{
+    typedef SparseMatrix<double>::Index Index;
+
+    qint32 t_iRows, t_iCols, t_iNonZeros, t_iIndexSize;
+    read(p_cursor, t_iRows);
+    read(p_cursor, t_iCols);
+    read(p_cursor, t_iNonZeros);
+    read(p_cursor, t_iIndexSize);
+
+    if(t_iRows < 0 || t_iCols < 0 || t_iNonZeros < 0 || t_iIndexSize != (qint32)sizeof(Index))
+        p_cursor.bOk = false;
+
+    // the matrices are column major, the outer dimension are the columns
+    align(p_cursor);
+    const uchar* t_pOuter = take(p_cursor, ((qint64)t_iCols+1)*sizeof(Index));
+    const uchar* t_pInner = 0;
+    const uchar* t_pValues = 0;
+    if(t_iNonZeros > 0)
+    {
+        align(p_cursor);
+        t_pInner = take(p_cursor, (qint64)t_iNonZeros*sizeof(Index));
+        align(p_cursor);
+        t_pValues = take(p_cursor, (qint64)t_iNonZeros*sizeof(double));
+    }
+    if(!p_cursor.bOk)
+        return;
+
+    //
+    //   Index arrays of a corrupted entry mustn't reach the matrix: the outer indices run from 0 to the number
+    //   of non-zeros, the inner indices ascend within each column and stay below the number of rows
+    //
+    const Index* t_pOuterIdx = (const Index*)t_pOuter;
+    const Index* t_pInnerIdx = (const Index*)t_pInner;
+    bool t_bValid = t_pOuterIdx[0] == 0 && t_pOuterIdx[t_iCols] == t_iNonZeros;
+    for(qint32 j = 0; j < t_iCols && t_bValid; ++j)
+    {
+        t_bValid = t_pOuterIdx[j] <= t_pOuterIdx[j+1];
+        for(Index i = t_pOuterIdx[j]; i < t_pOuterIdx[j+1] && t_bValid; ++i)
+            t_bValid = t_pInnerIdx[i] >= 0 && t_pInnerIdx[i] < t_iRows && (i == t_pOuterIdx[j] || t_pInnerIdx[i-1] < t_pInnerIdx[i]);
+    }
+    if(!t_bValid)
+    {
+        p_cursor.bOk = false;
+        return;
+    }
+
+    p_matValue.resize(t_iRows, t_iCols);
+    p_matValue.resizeNonZeros(t_iNonZeros);
+    memcpy(p_matValue.outerIndexPtr(), t_pOuter, ((size_t)t_iCols+1)*sizeof(Index));
+    if(t_iNonZeros > 0)
+    {
+        memcpy(p_matValue.innerIndexPtr(), t_pInner, (size_t)t_iNonZeros*sizeof(Index));
+        memcpy(p_matValue.valuePtr(), t_pValues, (size_t)t_iNonZeros*sizeof(double));
+    }
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffId &p_id)
+{
+    read(p_cursor, p_id.version);
+    read(p_cursor, p_id.machid[0]);
+    read(p_cursor, p_id.machid[1]);
+    read(p_cursor, p_id.time.secs);
+    read(p_cursor, p_id.time.usecs);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffCoordTrans &p_trans)
+{
+    read(p_cursor, p_trans.from);
+    read(p_cursor, p_trans.to);
+    read(p_cursor, p_trans.trans);
+    read(p_cursor, p_trans.invtrans);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffChInfo &p_chInfo)
+{
+    read(p_cursor, p_chInfo.scanno);
+    read(p_cursor, p_chInfo.logno);
+    read(p_cursor, p_chInfo.kind);
+    read(p_cursor, p_chInfo.range);
+    read(p_cursor, p_chInfo.cal);
+    read(p_cursor, p_chInfo.coil_type);
+    read(p_cursor, p_chInfo.loc);
+    read(p_cursor, p_chInfo.coil_trans);
+    read(p_cursor, p_chInfo.eeg_loc);
+    read(p_cursor, p_chInfo.coord_frame);
+    read(p_cursor, p_chInfo.unit);
+    read(p_cursor, p_chInfo.unit_mul);
+    read(p_cursor, p_chInfo.ch_name);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffInfoBase &p_info)
+{
+    read(p_cursor, p_info.filename);
+    read(p_cursor, p_info.meas_id);
+    read(p_cursor, p_info.nchan);
+    read(p_cursor, p_info.chs);
+    read(p_cursor, p_info.ch_names);
+    read(p_cursor, p_info.dev_head_t);
+    read(p_cursor, p_info.ctf_head_t);
+    read(p_cursor, p_info.bads);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffNamedMatrix &p_matrix)
+{
+    read(p_cursor, p_matrix.nrow);
+    read(p_cursor, p_matrix.ncol);
+    read(p_cursor, p_matrix.row_names);
+    read(p_cursor, p_matrix.col_names);
+    read(p_cursor, p_matrix.data);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffProj &p_proj)
+{
+    read(p_cursor, p_proj.kind);
+    read(p_cursor, p_proj.active);
+    read(p_cursor, p_proj.desc);
+    read(p_cursor, p_proj.data);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, FiffCov &p_cov)
+{
+    read(p_cursor, p_cov.kind);
+    read(p_cursor, p_cov.diag);
+    read(p_cursor, p_cov.dim);
+    read(p_cursor, p_cov.names);
+    read(p_cursor, p_cov.data);
+    read(p_cursor, p_cov.projs);
+    read(p_cursor, p_cov.bads);
+    read(p_cursor, p_cov.nfree);
+    read(p_cursor, p_cov.eig);
+    read(p_cursor, p_cov.eigvec);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, MNEHemisphere &p_hemisphere)
+{
+    read(p_cursor, p_hemisphere.type);
+    read(p_cursor, p_hemisphere.id);
+    read(p_cursor, p_hemisphere.np);
+    read(p_cursor, p_hemisphere.ntri);
+    read(p_cursor, p_hemisphere.coord_frame);
+    read(p_cursor, p_hemisphere.rr);
+    read(p_cursor, p_hemisphere.nn);
+    read(p_cursor, p_hemisphere.tris);
+    read(p_cursor, p_hemisphere.nuse);
+    read(p_cursor, p_hemisphere.inuse);
+    read(p_cursor, p_hemisphere.vertno);
+    read(p_cursor, p_hemisphere.nuse_tri);
+    read(p_cursor, p_hemisphere.use_tris);
+    read(p_cursor, p_hemisphere.nearest);
+    read(p_cursor, p_hemisphere.nearest_dist);
+    read(p_cursor, p_hemisphere.pinfo);
+    read(p_cursor, p_hemisphere.patch_inds);
+    read(p_cursor, p_hemisphere.dist_limit);
+    read(p_cursor, p_hemisphere.dist);
+    read(p_cursor, p_hemisphere.tri_cent);
+    read(p_cursor, p_hemisphere.tri_nn);
+    read(p_cursor, p_hemisphere.tri_area);
+    read(p_cursor, p_hemisphere.use_tri_cent);
+    read(p_cursor, p_hemisphere.use_tri_nn);
+    read(p_cursor, p_hemisphere.use_tri_area);
+    read(p_cursor, p_hemisphere.cluster_info.clusterVertnos);
+    read(p_cursor, p_hemisphere.cluster_info.clusterDistances);
+    read(p_cursor, p_hemisphere.cluster_info.clusterLabelIds);
+}
+
+
+//*************************************************************************************************************
+
+void MNECache::read(Cursor &p_cursor, MNESourceSpace &p_sourceSpace)
+{
+    read(p_cursor, p_sourceSpace.m_qListHemispheres);
+}
@@ -0,0 +1,305 @@
+//=============================================================================================================
+/**
+* @file     mne_cache.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    MNECache class declaration.
+*
+*/
+
+#ifndef MNE_CACHE_H
+#define MNE_CACHE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MNE INCLUDES
+//=============================================================================================================
+
+#include "mne_global.h"
+#include "mne_forwardsolution.h"
+#include "mne_inverse_operator.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFF INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_info_base.h>
+#include <fiff/fiff_named_matrix.h>
+#include <fiff/fiff_coord_trans.h>
+#include <fiff/fiff_proj.h>
+#include <fiff/fiff_cov.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QSharedDataPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE MNELIB
+//=============================================================================================================
+
+namespace MNELIB
+{
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FIFFLIB;
+
+
+//=============================================================================================================
+/**
+* On-disk cache of fully prepared forward solutions and inverse operators. A cache entry is keyed by the hash of
+* the fif file and the read options; the key of a file is remembered by its path, size and modification time, so
+* the file is only hashed again once it changed. A warm read skips parsing the fif tree and the preparation which
+* is done while reading (triangulation and patch info, source orientations, channel selection). The entries are
+* flat: scalars and strings are followed by the raw matrix data, aligned to 16 bytes, which is copied out of a
+* memory mapping of the file.
+*
+* The cache is opt-in: it is used by MNEForwardSolution::read and MNEInverseOperator::read_inverse_operator
+* once a directory is set, either by setDirectory or by the MNE_CACHE_DIR environment variable. Entries are
+* machine specific (native byte order) and are rewritten whenever they can't be read.
+*
+* @brief On-disk cache of forward solutions and inverse operators
+*/
+class MNESHARED_EXPORT MNECache
+{
+public:
+    //=========================================================================================================
+    /**
+    * Sets the cache directory, which is created if it doesn't exist. An empty directory disables the cache.
+    *
+    * @param[in] p_sDirectory   The cache directory
+    */
+    static void setDirectory(const QString &p_sDirectory);
+
+    //=========================================================================================================
+    /**
+    * Returns the cache directory, the MNE_CACHE_DIR environment variable if none was set.
+    *
+    * @return the cache directory, empty if the cache is disabled
+    */
+    static QString directory();
+
+    //=========================================================================================================
+    /**
+    * Computes the cache key of a fif file read with the given options. Files whose key was computed before and
+    * which weren't modified since aren't hashed again. The device is left as it was found, i.e. closed or open
+    * at the same position.
+    *
+    * @param[in] p_IODevice         The fif file
+    * @param[in] p_qListOptions     The read options, e.g. channel selection and orientation flags
+    *
+    * @return the cache key, empty if the cache is disabled or the device can't be hashed (sequential devices)
+    */
+    static QByteArray key(QIODevice &p_IODevice, const QStringList &p_qListOptions);
+
+    //=========================================================================================================
+    /**
+    * Reads a forward solution from the cache.
+    *
+    * @param[in] p_key      The cache key
+    * @param[out] fwd       The forward solution
+    *
+    * @return true if the entry exists and was read, false otherwise
+    */
+    static bool readForwardSolution(const QByteArray &p_key, MNEForwardSolution &fwd);
+
+    //=========================================================================================================
+    /**
+    * Writes a forward solution to the cache. The entry is committed atomically, so concurrent readers never
+    * see a partially written entry.
+    *
+    * @param[in] p_key      The cache key
+    * @param[in] fwd        The forward solution
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool writeForwardSolution(const QByteArray &p_key, const MNEForwardSolution &fwd);
+
+    //=========================================================================================================
+    /**
+    * Reads an inverse operator from the cache.
+    *
+    * @param[in] p_key      The cache key
+    * @param[out] inv       The inverse operator
+    *
+    * @return true if the entry exists and was read, false otherwise
+    */
+    static bool readInverseOperator(const QByteArray &p_key, MNEInverseOperator &inv);
+
+    //=========================================================================================================
+    /**
+    * Writes an inverse operator to the cache. The entry is committed atomically.
+    *
+    * @param[in] p_key      The cache key
+    * @param[in] inv        The inverse operator
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool writeInverseOperator(const QByteArray &p_key, const MNEInverseOperator &inv);
+
+private:
+    static const qint32 Version = 1;    /**< Version of the entry layout, entries of other versions are rewritten. */
+
+    //=========================================================================================================
+    /**
+    * Read position in a mapped cache entry. Reading past the end clears bOk, all further reads fail.
+    */
+    struct Cursor
+    {
+        const uchar* pData;     /**< Start of the entry, for the alignment of matrix data. */
+        qint64 iPos;            /**< Current read offset. */
+        qint64 iSize;           /**< Size of the entry. */
+        bool bOk;               /**< Whether all reads so far succeeded. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Returns the directory set by setDirectory.
+    *
+    * @return reference to the set directory
+    */
+    static QString& directoryRef();
+
+    //=========================================================================================================
+    /**
+    * Returns the file which remembers the cache key of a fif file, named by the hash of the file's path, size,
+    * modification time and the read options.
+    *
+    * @param[in] p_IODevice         The fif file
+    * @param[in] p_qListOptions     The read options
+    *
+    * @return the file name, empty if the device is no file or the file was modified within the last seconds
+    */
+    static QString preKeyFileName(QIODevice &p_IODevice, const QStringList &p_qListOptions);
+
+    //=========================================================================================================
+    /**
+    * Writes a cache entry of a forward solution or an inverse operator.
+    *
+    * @param[in] p_key      The cache key
+    * @param[in] p_sKind    Entry kind, "fwd" or "inv"
+    * @param[in] p_pFwd     The forward solution to write, or NULL
+    * @param[in] p_pInv     The inverse operator to write, or NULL
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool writeEntry(const QByteArray &p_key, const char* p_sKind, const MNEForwardSolution* p_pFwd, const MNEInverseOperator* p_pInv);
+
+    //=========================================================================================================
+    /**
+    * Maps and reads a cache entry of a forward solution or an inverse operator.
+    *
+    * @param[in] p_key      The cache key
+    * @param[in] p_sKind    Entry kind, "fwd" or "inv"
+    * @param[out] p_pFwd    The forward solution to read, or NULL
+    * @param[out] p_pInv    The inverse operator to read, or NULL
+    *
+    * @return true if succeeded, false otherwise
+    */
+    static bool readEntry(const QByteArray &p_key, const char* p_sKind, MNEForwardSolution* p_pFwd, MNEInverseOperator* p_pInv);
+
+    //=========================================================================================================
+    /**
+    * Writers of the flat layout: scalars in native byte order, strings and lists prefixed by their length,
+    * matrices by their dimensions and scalar size, followed by their raw data aligned to 16 bytes.
+    */
+    static void align(QIODevice &p_dev);
+    static void write(QIODevice &p_dev, qint32 p_iValue);
+    static void write(QIODevice &p_dev, float p_fValue);
+    static void write(QIODevice &p_dev, const QString &p_sValue);
+    static void write(QIODevice &p_dev, const QStringList &p_qListValue);
+    template<typename T> static void write(QIODevice &p_dev, const QList<T> &p_qListValue);
+    template<typename Derived> static void write(QIODevice &p_dev, const PlainObjectBase<Derived> &p_matValue);
+    template<typename T> static void write(QIODevice &p_dev, const QSharedDataPointer<T> &p_pValue);
+    static void write(QIODevice &p_dev, const SparseMatrix<double> &p_matValue);
+    static void write(QIODevice &p_dev, const FiffId &p_id);
+    static void write(QIODevice &p_dev, const FiffCoordTrans &p_trans);
+    static void write(QIODevice &p_dev, const FiffChInfo &p_chInfo);
+    static void write(QIODevice &p_dev, const FiffInfoBase &p_info);
+    static void write(QIODevice &p_dev, const FiffNamedMatrix &p_matrix);
+    static void write(QIODevice &p_dev, const FiffProj &p_proj);
+    static void write(QIODevice &p_dev, const FiffCov &p_cov);
+    static void write(QIODevice &p_dev, const MNEHemisphere &p_hemisphere);
+    static void write(QIODevice &p_dev, const MNESourceSpace &p_sourceSpace);
+
+    //=========================================================================================================
+    /**
+    * Readers of the flat layout, the counterparts of the writers.
+    */
+    static void align(Cursor &p_cursor);
+    static const uchar* take(Cursor &p_cursor, qint64 p_iBytes);
+    static void read(Cursor &p_cursor, qint32 &p_iValue);
+    static void read(Cursor &p_cursor, bool &p_bValue);
+    static void read(Cursor &p_cursor, float &p_fValue);
+    static void read(Cursor &p_cursor, QString &p_sValue);
+    static void read(Cursor &p_cursor, QStringList &p_qListValue);
+    template<typename T> static void read(Cursor &p_cursor, QList<T> &p_qListValue);
+    template<typename Derived> static void read(Cursor &p_cursor, PlainObjectBase<Derived> &p_matValue);
+    template<typename T> static void read(Cursor &p_cursor, QSharedDataPointer<T> &p_pValue);
+    static void read(Cursor &p_cursor, SparseMatrix<double> &p_matValue);
+    static void read(Cursor &p_cursor, FiffId &p_id);
+    static void read(Cursor &p_cursor, FiffCoordTrans &p_trans);
+    static void read(Cursor &p_cursor, FiffChInfo &p_chInfo);
+    static void read(Cursor &p_cursor, FiffInfoBase &p_info);
+    static void read(Cursor &p_cursor, FiffNamedMatrix &p_matrix);
+    static void read(Cursor &p_cursor, FiffProj &p_proj);
+    static void read(Cursor &p_cursor, FiffCov &p_cov);
+    static void read(Cursor &p_cursor, MNEHemisphere &p_hemisphere);
+    static void read(Cursor &p_cursor, MNESourceSpace &p_sourceSpace);
+};
+
+} // NAMESPACE
+
+#endif // MNE_CACHE_H
@@ -39,6 +39,7 @@
 //=============================================================================================================
 
 #include "mne_forwardsolution.h"
+#include "mne_cache.h"
 
 
 //*************************************************************************************************************
@@ -49,6 +50,7 @@
 #include <fs/colortable.h>
 #include <utils/mnemath.h>
 #include <utils/kmeans.h>
+#include <utils/parallel.h>
 
 
 //*************************************************************************************************************
@@ -57,6 +59,16 @@
 //=============================================================================================================
 
 #include <iostream>
+#include <algorithm>
+#include <limits>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
 
 
 //*************************************************************************************************************
@@ -223,26 +235,20 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(AnnotationSet &p
     //DEBUG END
 
 
-    KMeans t_kMeans(QString("sqeuclidean"), QString("sample"), 5);//QString("sqeuclidean")//QString("sample")//cityblock
-    MatrixXd t_LF_new;
+    QElapsedTimer t_timer;
+    t_timer.start();
 
-    qint32 count;
-    qint32 offset;
+    //
+    // Collect the regions of both hemispheres
+    //
+    QList<ClusterRegion> t_qListRegions;
 
     for(qint32 h = 0; h < this->src.size(); ++h )//obj.sizeForwardSolution)
     {
-        count = 0;
-        offset = 0;
-
         // Offset for continuous indexing;
-        if(h > 0)
-            for(qint32 j = 0; j < h; ++j)
-                offset += this->src[j].nuse;
-
-        if(h == 0)
-            printf("Cluster Left Hemisphere\n");
-        else
-            printf("Cluster Right Hemisphere\n");
+        qint32 offset = 0;
+        for(qint32 j = 0; j < h; ++j)
+            offset += this->src[j].nuse;
 
         Colortable t_CurrentColorTable = p_AnnotationSet[h].getColortable();
         VectorXi label_ids = t_CurrentColorTable.getLabelIds();
@@ -255,14 +261,14 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(AnnotationSet &p
             vertno_labeled[i] = p_AnnotationSet[h].getLabelIds()[this->src[h].vertno[i]];
 
         //iterate over labels
-        MatrixXd t_LF_partial;
         for (qint32 i = 0; i < label_ids.rows(); ++i)
         {
-
             if (label_ids[i] != 0)
             {
-                QString curr_name = t_CurrentColorTable.struct_names[i];//obj.label2AtlasName(label(i));
-                printf("\tCluster %d / %d %s...", i+1, label_ids.rows(), curr_name.toUtf8().constData());
+                ClusterRegion t_region;
+                t_region.iHemisphere = h;
+                t_region.iLabelId = label_ids[i];
+                t_region.sName = t_CurrentColorTable.struct_names[i];//obj.label2AtlasName(label(i));
 
                 //
                 // Get source space indeces
@@ -281,114 +287,156 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(AnnotationSet &p
                 }
                 idcs.conservativeResize(c);
 
-//                VectorXi idcs_triplet = tripletSelection(idcs);//ToDo obsolete: use block instead
+                if(c == 0)
+                {
+                    printf("\tCluster %s failed! Label contains no sources.\n", t_region.sName.toUtf8().constData());
+                    continue;
+                }
 
                 //get selected LF
-                MatrixXd t_LF(this->sol->data.rows(), idcs.rows()*3);
-
+                t_region.vecIdcs = idcs;
+                t_region.matLF = MatrixXd(this->sol->data.rows(), idcs.rows()*3);
                 for(qint32 j = 0; j < idcs.rows(); ++j)
-                    t_LF.block(0, j*3, t_LF.rows(), 3) = this->sol->data.block(0, (idcs[j]+offset)*3, t_LF.rows(), 3);
+                    t_region.matLF.block(0, j*3, t_region.matLF.rows(), 3) = this->sol->data.block(0, (idcs[j]+offset)*3, t_region.matLF.rows(), 3);
 
-                qint32 nSens = t_LF.rows();
-                qint32 nSources = t_LF.cols()/3;
-                qint32 nClusters = 0;
-
-                if (nSources > 0)
+                // Reshape Input data -> sources rows; sensors columns; shared by all replicates of the region
+                qint32 nSens = t_region.matLF.rows();
+                t_region.matSensLF = MatrixXd(idcs.rows(), 3*nSens);
+                for(qint32 j = 0; j < nSens; ++j)
                 {
-                    nClusters = ceil((double)nSources/(double)p_iClusterSize);
+                    for(qint32 k = 0; k < idcs.rows(); ++k)
+                        t_region.matSensLF.block(k,j*3,1,3) = t_region.matLF.block(j,k*3,1,3);
+                }
 
-                    printf("%d Cluster(s)... ", nClusters);
+                t_region.iClusters = ceil((double)idcs.rows()/(double)p_iClusterSize);
 
-                    t_LF_partial = MatrixXd::Zero(nSens,nClusters*3);
+                t_qListRegions.append(t_region);
+            }
+        }
+    }
 
-                    // Reshape Input data -> sources rows; sensors columns
-                    MatrixXd t_sensLF(t_LF.cols()/3, 3*nSens);
-                    for(qint32 j = 0; j < nSens; ++j)
-                    {
-                        for(qint32 k = 0; k < t_sensLF.rows(); ++k)
-                            t_sensLF.block(k,j*3,1,3) = t_LF.block(j,k*3,1,3);
-                    }
+    //
+    // Kmeans Reduction: all replicates of all regions are independent
+    //
+    const qint32 t_iReplicates = 5;
+    QAtomicInt t_iFinished(0);
 
-                    // Kmeans Reduction
-                    VectorXi roiIdx;
-                    MatrixXd ctrs;
-                    VectorXd sumd;
-                    MatrixXd D;
-
-                    t_kMeans.calculate(t_sensLF, nClusters, roiIdx, ctrs, sumd, D);
-
-                    //
-                    // Assign the centroid for each cluster to the partial LF
-                    //
-                    for(qint32 j = 0; j < nSens; ++j)
-                        for(qint32 k = 0; k < nClusters; ++k)
-                            t_LF_partial.block(j, k*3, 1, 3) = ctrs.block(k,j*3,1,3);
-
-                    //
-                    // Get cluster indizes and its distances to the centroid
-                    //
-                    for(qint32 j = 0; j < nClusters; ++j)
-                    {
-                        VectorXi clusterIdcs = VectorXi::Zero(roiIdx.rows());
-                        VectorXd clusterDistance = VectorXd::Zero(roiIdx.rows());
-                        qint32 nClusterIdcs = 0;
-                        for(qint32 k = 0; k < roiIdx.rows(); ++k)
-                        {
-                            if(roiIdx[k] == j)
-                            {
-                                clusterIdcs[nClusterIdcs] = idcs[k];
-                                clusterDistance[nClusterIdcs] = D(k,j);
-                                ++nClusterIdcs;
-                            }
-                        }
-                        clusterIdcs.conservativeResize(nClusterIdcs);
-                        p_fwdOut.src[h].cluster_info.clusterVertnos.append(clusterIdcs);
-                        p_fwdOut.src[h].cluster_info.clusterDistances.append(clusterDistance);
-                        p_fwdOut.src[h].cluster_info.clusterLabelIds.append(label_ids[i]);
-                    }
+    QList<ClusterReplicate> t_qListReplicates;
+    for(qint32 r = 0; r < t_qListRegions.size(); ++r)
+    {
+        for(qint32 rep = 0; rep < t_iReplicates; ++rep)
+        {
+            ClusterReplicate t_replicate;
+            t_replicate.pRegion = &t_qListRegions.at(r);
+            t_replicate.iSeed = r * t_iReplicates + rep + 1;
+            t_replicate.pFinished = &t_iFinished;
+            t_replicate.iNumReplicates = t_qListRegions.size() * t_iReplicates;
+            t_replicate.bSuccess = false;
+            t_qListReplicates.append(t_replicate);
+        }
+    }
 
-                    //
-                    // Assign partial LF to new LeadField
-                    //
-                    if(t_LF_partial.rows() > 0 && t_LF_partial.cols() > 0)
+    printf("Cluster %d regions (%d replicates each) on %d threads\n", t_qListRegions.size(), t_iReplicates, Parallel::numThreads());
+
+    Parallel::map(t_qListReplicates, &MNEForwardSolution::cluster_replicate);
+
+    //
+    // Assemble the clustered forward solution in the order of hemispheres and labels
+    //
+    MatrixXd t_LF_new;
+    qint32 t_iRegion = 0;
+
+    for(qint32 h = 0; h < this->src.size(); ++h )
+    {
+        qint32 count = 0;
+
+        for(; t_iRegion < t_qListRegions.size() && t_qListRegions[t_iRegion].iHemisphere == h; ++t_iRegion)
+        {
+            const ClusterRegion &t_region = t_qListRegions[t_iRegion];
+
+            // Best replicate
+            const ClusterReplicate* t_pBest = 0;
+            for(qint32 rep = 0; rep < t_iReplicates; ++rep)
+            {
+                const ClusterReplicate &t_replicate = t_qListReplicates[t_iRegion * t_iReplicates + rep];
+                if(t_replicate.bSuccess && (!t_pBest || t_replicate.sumd.sum() < t_pBest->sumd.sum()))
+                    t_pBest = &t_replicate;
+            }
+
+            if(!t_pBest)
+            {
+                printf("\tCluster %s failed! All k-means replicates produced empty clusters.\n", t_region.sName.toUtf8().constData());
+                continue;
+            }
+
+            const MatrixXd &t_LF = t_region.matLF;
+            const VectorXi &idcs = t_region.vecIdcs;
+            const VectorXi &roiIdx = t_pBest->roiIdx;
+            const MatrixXd &ctrs = t_pBest->ctrs;
+            const MatrixXd &D = t_pBest->D;
+            qint32 nSens = t_LF.rows();
+            qint32 nClusters = t_region.iClusters;
+
+            //
+            // Assign the centroid for each cluster to the partial LF
+            //
+            MatrixXd t_LF_partial = MatrixXd::Zero(nSens,nClusters*3);
+            for(qint32 j = 0; j < nSens; ++j)
+                for(qint32 k = 0; k < nClusters; ++k)
+                    t_LF_partial.block(j, k*3, 1, 3) = ctrs.block(k,j*3,1,3);
+
+            //
+            // Get cluster indizes and its distances to the centroid
+            //
+            for(qint32 j = 0; j < nClusters; ++j)
+            {
+                VectorXi clusterIdcs = VectorXi::Zero(roiIdx.rows());
+                VectorXd clusterDistance = VectorXd::Zero(roiIdx.rows());
+                qint32 nClusterIdcs = 0;
+                for(qint32 k = 0; k < roiIdx.rows(); ++k)
+                {
+                    if(roiIdx[k] == j)
                     {
-                        t_LF_new.conservativeResize(t_LF_partial.rows(), t_LF_new.cols() + t_LF_partial.cols());
-                        t_LF_new.block(0, t_LF_new.cols() - t_LF_partial.cols(), t_LF_new.rows(), t_LF_partial.cols()) = t_LF_partial;
-
-                        // Map the centroids to the closest rr
-                        for(qint32 k = 0; k < nClusters; ++k)
-                        {
-                            qint32 j = 0;
-
-                            double sqec = sqrt((t_LF.block(0, j*3, t_LF.rows(), 3) - t_LF_partial.block(0, k*3, t_LF_partial.rows(), 3)).array().pow(2).sum());
-                            double sqec_min = sqec;
-                            double j_min = j;
-                            for(qint32 j = 1; j < idcs.rows(); ++j)
-                            {
-                                sqec = sqrt((t_LF.block(0, j*3, t_LF.rows(), 3) - t_LF_partial.block(0, k*3, t_LF_partial.rows(), 3)).array().pow(2).sum());
-                                if(sqec < sqec_min)
-                                {
-                                    sqec_min = sqec;
-                                    j_min = j;
-                                }
-                            }
-
-                            // Take the closest coordinates
-                            qint32 sel_idx = idcs[j_min];
-                            //ToDo store this in cluster info
-//                            p_fwdOut.src[h].rr.row(count) = this->src[h].rr.row(sel_idx);
-//                            p_fwdOut.src[h].nn.row(count) = MatrixXd::Zero(1,3);
-
-                            p_fwdOut.src[h].vertno[count] = this->src[h].vertno[sel_idx];
-                            ++count;
-                        }
+                        clusterIdcs[nClusterIdcs] = idcs[k];
+                        clusterDistance[nClusterIdcs] = D(k,j);
+                        ++nClusterIdcs;
                     }
-                    printf("[done]\n");
                 }
-                else
+                clusterIdcs.conservativeResize(nClusterIdcs);
+                p_fwdOut.src[h].cluster_info.clusterVertnos.append(clusterIdcs);
+                p_fwdOut.src[h].cluster_info.clusterDistances.append(clusterDistance);
+                p_fwdOut.src[h].cluster_info.clusterLabelIds.append(t_region.iLabelId);
+            }
+
+            //
+            // Assign partial LF to new LeadField
+            //
+            t_LF_new.conservativeResize(t_LF_partial.rows(), t_LF_new.cols() + t_LF_partial.cols());
+            t_LF_new.block(0, t_LF_new.cols() - t_LF_partial.cols(), t_LF_new.rows(), t_LF_partial.cols()) = t_LF_partial;
+
+            // Map the centroids to the closest rr
+            for(qint32 k = 0; k < nClusters; ++k)
+            {
+                qint32 j_min = 0;
+                double sqec_min = std::numeric_limits<double>::max();
+                for(qint32 j = 0; j < idcs.rows(); ++j)
                 {
-                    printf("failed! Label contains no sources.\n");
+                    double sqec = (t_LF.block(0, j*3, t_LF.rows(), 3) - t_LF_partial.block(0, k*3, t_LF_partial.rows(), 3)).squaredNorm();
+                    if(sqec < sqec_min)
+                    {
+                        sqec_min = sqec;
+                        j_min = j;
+                    }
                 }
+
+                // Take the closest coordinates
+                qint32 sel_idx = idcs[j_min];
+                //ToDo store this in cluster info
+//                p_fwdOut.src[h].rr.row(count) = this->src[h].rr.row(sel_idx);
+//                p_fwdOut.src[h].nn.row(count) = MatrixXd::Zero(1,3);
+
+                p_fwdOut.src[h].vertno[count] = this->src[h].vertno[sel_idx];
+                ++count;
             }
         }
 
@@ -399,29 +447,10 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(AnnotationSet &p
 //        p_fwdOut.src[h].rr.conservativeResize(count, 3);
 //        p_fwdOut.src[h].nn.conservativeResize(count, 3);
         p_fwdOut.src[h].vertno.conservativeResize(count);
-
-//        p_fwdOut.src[h].nuse_tri = 0;
-//        p_fwdOut.src[h].use_tris = MatrixX3i(0,3);
-
-
-//        if(p_fwdOut.src[h].rr.rows() > 0 && p_fwdOut.src[h].rr.cols() > 0)
-//        {
-//            if(h == 0)
-//            {
-//                p_fwdOut.source_rr = MatrixX3d(0,3);
-//                p_fwdOut.source_nn = MatrixX3d(0,3);
-//            }
-
-//            p_fwdOut.source_rr.conservativeResize(p_fwdOut.source_rr.rows() + p_fwdOut.src[h].rr.rows(),3);
-//            p_fwdOut.source_rr.block(p_fwdOut.source_rr.rows() -  p_fwdOut.src[h].rr.rows(), 0,  p_fwdOut.src[h].rr.rows(), 3) = p_fwdOut.src[h].rr;
-
-//            p_fwdOut.source_nn.conservativeResize(p_fwdOut.source_nn.rows() + p_fwdOut.src[h].nn.rows(),3);
-//            p_fwdOut.source_nn.block(p_fwdOut.source_nn.rows() -  p_fwdOut.src[h].nn.rows(), 0,  p_fwdOut.src[h].nn.rows(), 3) = p_fwdOut.src[h].nn;
-//        }
-
-        printf("[done]\n");
     }
 
+    printf("Clustering finished in %.1f s\n", t_timer.elapsed() / 1000.0);
+
     //
     // Put it all together
     //
@@ -434,6 +463,25 @@ MNEForwardSolution MNEForwardSolution::cluster_forward_solution(AnnotationSet &p
 }
 
 
+//*************************************************************************************************************
+
+void MNEForwardSolution::cluster_replicate(ClusterReplicate &p_replicate)
+{
+    const MatrixXd &t_sensLF = p_replicate.pRegion->matSensLF;
+
+    // one replicate per job, the replicates of a region run in parallel
+    KMeans t_kMeans(QString("sqeuclidean"), QString("sample"), 1, QString("error"), true, 100, p_replicate.iSeed);
+    p_replicate.bSuccess = t_kMeans.calculate(t_sensLF, p_replicate.pRegion->iClusters, p_replicate.roiIdx, p_replicate.ctrs, p_replicate.sumd, p_replicate.D);
+
+    //
+    // Report progress in steps of 10%
+    //
+    qint32 t_iFinished = p_replicate.pFinished->fetchAndAddOrdered(1) + 1;
+    if((t_iFinished * 10) / p_replicate.iNumReplicates != ((t_iFinished - 1) * 10) / p_replicate.iNumReplicates)
+        printf("\t%d%% (%d / %d replicates)\n", (t_iFinished * 100) / p_replicate.iNumReplicates, t_iFinished, p_replicate.iNumReplicates);
+}
+
+
 //*************************************************************************************************************
 
 FiffCov MNEForwardSolution::compute_depth_prior(const MatrixXd &Gain, const FiffInfo &gain_info, bool is_fixed_ori, double exp, double limit, const MatrixXd &patch_areas, bool limit_depth_chs)
@@ -449,20 +497,19 @@ FiffCov MNEForwardSolution::compute_depth_prior(const MatrixXd &Gain, const Fiff
     // Compute the gain matrix
     if(is_fixed_ori)
     {
-        d = (G.array().square()).rowwise().sum(); //ToDo: is this correct - is G squared?
+        d = G.colwise().squaredNorm().transpose();
 //            d = np.sum(G ** 2, axis=0)
     }
     else
     {
         qint32 n_pos = G.cols() / 3;
         d = VectorXd::Zero(n_pos);
-        MatrixXd Gk;
-        for (qint32 k = 0; k < n_pos; ++k)
-        {
-            Gk = G.block(0,3*k, G.rows(), 3);
-            JacobiSVD<MatrixXd> svd(Gk.transpose()*Gk);
-            d[k] = svd.singularValues().maxCoeff();
-        }
+
+        DepthPriorCompute t_compute;
+        t_compute.pGain = &G;
+        t_compute.pDepth = &d;
+
+        Parallel::parallelFor(n_pos, 256, t_compute);
     }
 
     // ToDo Currently the fwd solns never have "patch_areas" defined
@@ -544,6 +591,90 @@ FiffCov MNEForwardSolution::compute_depth_prior(const MatrixXd &Gain, const Fiff
 }
 
 
+//*************************************************************************************************************
+
+void MNEForwardSolution::DepthPriorCompute::operator()(qint32 p_iFirst, qint32 p_iNum) const
+{
+    qint32 t_iRows = pGain->rows();
+    Matrix3d t_matGram;
+    SelfAdjointEigenSolver<Matrix3d> t_eig;
+
+    for(qint32 k = p_iFirst; k < p_iFirst + p_iNum; ++k)
+    {
+        // the three columns of a position are contiguous
+        Map<const VectorXd> x(pGain->data() + 3 * k * t_iRows, t_iRows);
+        Map<const VectorXd> y(x.data() + t_iRows, t_iRows);
+        Map<const VectorXd> z(y.data() + t_iRows, t_iRows);
+
+        t_matGram(0,0) = x.squaredNorm();
+        t_matGram(1,0) = x.dot(y);
+        t_matGram(2,0) = x.dot(z);
+        t_matGram(1,1) = y.squaredNorm();
+        t_matGram(2,1) = y.dot(z);
+        t_matGram(2,2) = z.squaredNorm();
+
+        // only the lower triangle is read; eigenvalues are ascending
+        t_eig.computeDirect(t_matGram, EigenvaluesOnly);
+        (*pDepth)[k] = t_eig.eigenvalues()[2];
+    }
+}
+
+
+//*************************************************************************************************************
+
+void MNEForwardSolution::SurfOriRotate::operator()(qint32 p_iFirst, qint32 p_iNum) const
+{
+    const MNEHemisphere& t_hemisphere = *pHemisphere;
+    qint32 t_iRows = pSol->rows();
+    qint32 t_iGradRows = pSolGrad ? pSolGrad->rows() : 0;
+
+    Vector3d nn;
+    Matrix3d t_matRot;
+    Matrix<double, Dynamic, 3> t_matBlock(t_iRows, 3);
+    Matrix<double, Dynamic, 3> t_matGradBlock(t_iGradRows, 3);
+
+    for(qint32 p = p_iFirst; p < p_iFirst + p_iNum; ++p)
+    {
+        qint32 j = iFirstSource + p;
+
+        if(bUseAveNN)
+        {
+            const VectorXi& t_vIdx = t_hemisphere.pinfo[t_hemisphere.patch_inds[p]];
+            nn.setZero();
+            for(qint32 i = 0; i < t_vIdx.size(); ++i)
+                nn += t_hemisphere.nn.row(t_vIdx[i]).transpose().cast<double>();
+        }
+        else
+            nn = t_hemisphere.nn.row(t_hemisphere.vertno[p]).transpose().cast<double>();
+        nn.normalize();
+
+        //
+        //  Rows ex, ey, ez of a right-handed coordinate system with ez in the direction of nn
+        //
+        double t_dSign = nn[2] >= 0 ? 1.0 : -1.0;
+        double a = -1.0 / (t_dSign + nn[2]);
+        double b = nn[0] * nn[1] * a;
+        t_matRot.row(0) << 1.0 + t_dSign * nn[0] * nn[0] * a, t_dSign * b, -t_dSign * nn[0];
+        t_matRot.row(1) << b, t_dSign + nn[1] * nn[1] * a, -nn[1];
+        t_matRot.row(2) = nn.transpose();
+
+        pSourceNN->block(3*j, 0, 3, 3) = t_matRot.cast<float>();
+
+        // the three columns of a source are contiguous
+        t_matBlock.noalias() = pSol->middleCols(3*j, 3) * t_matRot.transpose();
+        pSol->middleCols(3*j, 3) = t_matBlock;
+
+        // the gradient component c of the three orientations is stored in the columns 9j+c, 9j+3+c and 9j+6+c
+        for(qint32 c = 0; c < 3 && pSolGrad; ++c)
+        {
+            Map<MatrixXd, 0, OuterStride<> > t_matGrad(pSolGrad->data() + (9*j+c)*t_iGradRows, t_iGradRows, 3, OuterStride<>(3*t_iGradRows));
+            t_matGradBlock.noalias() = t_matGrad * t_matRot.transpose();
+            t_matGrad = t_matGradBlock;
+        }
+    }
+}
+
+
 //*************************************************************************************************************
 
 FiffCov MNEForwardSolution::compute_orient_prior(float loose)
@@ -767,6 +898,18 @@ void MNEForwardSolution::prepare_forward(const FiffInfo &p_info, const FiffCov &
 
 bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bool force_fixed, bool surf_ori, const QStringList& include, const QStringList& exclude, bool bExcludeBads)
 {
+    //
+    //   A cached forward solution was prepared with the same options already
+    //
+    QStringList t_qListCacheOptions;
+    t_qListCacheOptions << "fwd" << QString::number((int)force_fixed) << QString::number((int)surf_ori) << include.join(",") << exclude.join(",") << QString::number((int)bExcludeBads);
+    QByteArray t_cacheKey = MNECache::key(p_IODevice, t_qListCacheOptions);
+    if(!t_cacheKey.isEmpty() && MNECache::readForwardSolution(t_cacheKey, fwd))
+    {
+        printf("Read forward solution from the cache (%d sources, %d channels).\n", fwd.nsource, fwd.nchan);
+        return true;
+    }
+
     FiffStream::SPtr t_pStream(new FiffStream(&p_IODevice));
     FiffDirTree t_Tree;
     QList<FiffDirEntry> t_Dir;
@@ -1026,69 +1169,28 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
         }
 
         nuse = 0;
-        qint32 pp = 0;
         fwd.source_rr = MatrixXf::Zero(fwd.nsource,3);
         fwd.source_nn = MatrixXf::Zero(fwd.nsource*3,3);
 
-        qWarning("Warning source_ori: Rotating the source coordinate system haven't been verified --> Singular Vectors U are different from MATLAB!");
+        qWarning("Warning source_ori: The tangential source orientations differ from MATLAB, which takes them from an SVD; the normal orientations are the same.");
+
+        SurfOriRotate t_rotate;
+        t_rotate.bUseAveNN = use_ave_nn;
+        t_rotate.pSourceNN = &fwd.source_nn;
+        t_rotate.pSol = &fwd.sol->data;
+        t_rotate.pSolGrad = fwd.sol_grad->isEmpty() ? 0 : &fwd.sol_grad->data;
 
         for(qint32 k = 0; k < t_SourceSpace.size();++k)
         {
-
             for (qint32 q = 0; q < t_SourceSpace[k].nuse; ++q)
                 fwd.source_rr.block(q+nuse,0,1,3) = t_SourceSpace[k].rr.block(t_SourceSpace[k].vertno(q),0,1,3);
 
-            for (qint32 p = 0; p < t_SourceSpace[k].nuse; ++p)
-            {
-                //
-                //  Project out the surface normal and compute SVD
-                //
-                Vector3f nn;
-                if(use_ave_nn)
-                {
-                    VectorXi t_vIdx = t_SourceSpace[k].pinfo[t_SourceSpace[k].patch_inds[p]];
-                    Matrix3Xf t_nn(3, t_vIdx.size());
-                    for(qint32 i = 0; i < t_vIdx.size(); ++i)
-                        t_nn.col(i) = t_SourceSpace[k].nn.block(t_vIdx[i],0,1,3).transpose();
-                    nn = t_nn.rowwise().sum();
-                    nn.array() /= nn.norm();
-                }
-                else
-                    nn = t_SourceSpace[k].nn.block(t_SourceSpace[k].vertno(p),0,1,3).transpose();
-
-                Matrix3f tmp = Matrix3f::Identity(nn.rows(), nn.rows()) - nn*nn.transpose();
+            t_rotate.pHemisphere = &t_SourceSpace[k];
+            t_rotate.iFirstSource = nuse;
+            Parallel::parallelFor(t_SourceSpace[k].nuse, 256, t_rotate);
 
-                JacobiSVD<MatrixXf> t_svd(tmp, Eigen::ComputeThinU);
-                //Sort singular values and singular vectors
-                VectorXf t_s = t_svd.singularValues();
-                MatrixXf U = t_svd.matrixU();
-                MNEMath::sort<float>(t_s, U);
-
-                //
-                //  Make sure that ez is in the direction of nn
-                //
-                if ((nn.transpose() * U.block(0,2,3,1))(0,0) < 0)
-                    U *= -1;
-                fwd.source_nn.block(pp, 0, 3, 3) = U.transpose();
-                pp += 3;
-            }
             nuse += t_SourceSpace[k].nuse;
         }
-        MatrixXd tmp = fwd.source_nn.transpose().cast<double>();
-        SparseMatrix<double>* surf_rot = MNEMath::make_block_diag(tmp,3);
-
-        fwd.sol->data *= *surf_rot;
-
-        if (!fwd.sol_grad->isEmpty())
-        {
-            SparseMatrix<double> t_matKron;
-            SparseMatrix<double> t_eye(3,3);
-            for (qint32 i = 0; i < 3; ++i)
-                t_eye.insert(i,i) = 1.0f;
-            kroneckerProduct(*surf_rot,t_eye,t_matKron);//kron(surf_rot,eye(3));
-            fwd.sol_grad->data *= t_matKron;
-        }
-        delete surf_rot;
         printf("[done]\n");
     }
     else
@@ -1249,6 +1351,9 @@ bool MNEForwardSolution::read(QIODevice& p_IODevice, MNEForwardSolution& fwd, bo
     //garbage collecting
     t_pStream->device()->close();
 
+    if(!t_cacheKey.isEmpty())
+        MNECache::writeForwardSolution(t_cacheKey, fwd);
+
     return true;
 }
 
@@ -88,6 +88,7 @@
 #include <QFile>
 #include <QSharedPointer>
 #include <QDataStream>
+#include <QAtomicInt>
 
 
 //*************************************************************************************************************
@@ -165,7 +166,8 @@ public:
     //=========================================================================================================
     /**
     * Cluster the forward solution and stores the result to p_fwdOut.
-    * The clustering is done by using the provided annotations
+    * The clustering is done by using the provided annotations. The k-means replicates of all labels run in
+    * parallel on the global thread pool; they are seeded by their position, so the result is reproducible.
     *
     * @param[in] p_AnnotationSet    Annotation set containing the annotation of left & right hemisphere
     * @param[in] p_iClusterSize     Maximal cluster size per roi
@@ -371,6 +373,94 @@ public:
     friend std::ostream& operator<<(std::ostream& out, const MNELIB::MNEForwardSolution &p_MNEForwardSolution);
 
 private:
+    //=========================================================================================================
+    /**
+    * Region (label) of a hemisphere, which is clustered independently.
+    */
+    struct ClusterRegion
+    {
+        qint32 iHemisphere;     /**< Hemisphere of the region. */
+        qint32 iLabelId;        /**< Label id of the region. */
+        QString sName;          /**< Name of the region. */
+        VectorXi vecIdcs;       /**< Source space indices (into vertno) of the region. */
+        MatrixXd matLF;         /**< Lead field of the region, three columns per source. */
+        MatrixXd matSensLF;     /**< Lead field of the region reshaped for clustering, one row per source. */
+        qint32 iClusters;       /**< Number of clusters. */
+    };
+
+    //=========================================================================================================
+    /**
+    * A single k-means replicate of a region, for multi-threaded clustering.
+    */
+    struct ClusterReplicate
+    {
+        const ClusterRegion* pRegion;   /**< Region to cluster. */
+        qint32 iSeed;                   /**< Seed of the random initialization. */
+        QAtomicInt* pFinished;          /**< Number of finished replicates, for progress reporting. */
+        qint32 iNumReplicates;          /**< Total number of replicates, for progress reporting. */
+        bool bSuccess;                  /**< Whether the k-means succeeded. */
+        VectorXi roiIdx;                /**< Cluster index of every source. */
+        MatrixXd ctrs;                  /**< Cluster centroids. */
+        VectorXd sumd;                  /**< Within cluster sums of distances. */
+        MatrixXd D;                     /**< Distances of every source to every centroid. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Runs one k-means replicate of a region.
+    *
+    * @param[in, out] p_replicate   The replicate to compute
+    */
+    static void cluster_replicate(ClusterReplicate &p_replicate);
+
+    //=========================================================================================================
+    /**
+    * Computes the depth prior of a range of source positions of a free orientation gain matrix, for
+    * multi-threaded computation. The positions write to disjoint entries of the depth values.
+    */
+    struct DepthPriorCompute
+    {
+        const MatrixXd* pGain;  /**< Gain matrix, three columns per position. */
+        VectorXd* pDepth;       /**< Depth values to write the positions to. */
+
+        //=====================================================================================================
+        /**
+        * Computes the largest eigenvalue of the 3x3 Gram matrix Gk'*Gk of the positions p_iFirst ...
+        * p_iFirst+p_iNum-1. The Gram matrix is built from the dot products of the three contiguous columns and
+        * decomposed in closed form.
+        *
+        * @param[in] p_iFirst   First position
+        * @param[in] p_iNum     Number of positions
+        */
+        void operator()(qint32 p_iFirst, qint32 p_iNum) const;
+    };
+
+    //=========================================================================================================
+    /**
+    * Rotates a range of sources of a hemisphere to surface-based source orientations, for multi-threaded
+    * computation. The sources write to disjoint rows of the orientations and columns of the gain matrices.
+    */
+    struct SurfOriRotate
+    {
+        const MNEHemisphere* pHemisphere;   /**< Hemisphere of the sources. */
+        bool bUseAveNN;                     /**< Whether the average patch normals are used. */
+        qint32 iFirstSource;                /**< Index of the first source of the hemisphere in the forward solution. */
+        MatrixX3f* pSourceNN;               /**< Source orientations to write the local coordinate systems to, three rows per source. */
+        MatrixXd* pSol;                     /**< Gain matrix to rotate, three columns per source. */
+        MatrixXd* pSolGrad;                 /**< Gain gradient to rotate, nine columns per source; NULL if not available. */
+
+        //=====================================================================================================
+        /**
+        * Rotates the sources p_iFirst ... p_iFirst+p_iNum-1, indices into the used vertices of the hemisphere,
+        * to their local surface coordinate system. The tangential axes are built in closed form from the
+        * surface normal (Duff et al., 2017), the columns of each source are rotated in place.
+        *
+        * @param[in] p_iFirst   First source
+        * @param[in] p_iNum     Number of sources
+        */
+        void operator()(qint32 p_iFirst, qint32 p_iNum) const;
+    };
+
     //=========================================================================================================
     /**
     * Implementation of the read_one function in mne_read_forward_solution.m
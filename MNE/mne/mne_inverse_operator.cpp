@@ -39,6 +39,7 @@
 //=============================================================================================================
 
 #include "mne_inverse_operator.h"
+#include "mne_cache.h"
 #include <fs/label.h>
 
 
@@ -85,9 +86,9 @@ MNEInverseOperator::MNEInverseOperator(QIODevice& p_IODevice)
 
 //*************************************************************************************************************
 
-MNEInverseOperator::MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs)
+MNEInverseOperator::MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs, const QString &svd_method, qint32 svd_rank)
 {
-    *this = MNEInverseOperator::make_inverse_operator(info, forward, p_noise_cov, loose, depth, fixed, limit_depth_chs);
+    *this = MNEInverseOperator::make_inverse_operator(info, forward, p_noise_cov, loose, depth, fixed, limit_depth_chs, svd_method, svd_rank);
 }
 
 
@@ -322,7 +323,7 @@ bool MNEInverseOperator::check_ch_names(const FiffInfo &info) const
 
 //*************************************************************************************************************
 
-MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov &p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs)
+MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov &p_noise_cov, float loose, float depth, bool fixed, bool limit_depth_chs, const QString &svd_method, qint32 svd_rank)
 {
     bool is_fixed_ori = forward.isFixedOrient();
     MNEInverseOperator p_MNEInverseOperator;
@@ -472,23 +473,24 @@ MNEInverseOperator MNEInverseOperator::make_inverse_operator(const FiffInfo &inf
     //
     // 12. Decompose the combined matrix
     //
-    printf("Computing SVD of whitened and weighted lead field matrix.\n");
-    JacobiSVD<MatrixXd> svd(gain, ComputeThinU | ComputeThinV);
-    qDebug("ToDo Sorting Necessary?");
-    VectorXd p_sing = svd.singularValues();
-    MatrixXd t_U = svd.matrixU();
-    MNEMath::sort<double>(p_sing, t_U);
-    FiffNamedMatrix::SDPtr p_eigen_fields = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( svd.matrixU().cols(),
-                                                                                        svd.matrixU().rows(),
+    printf("Computing SVD of whitened and weighted lead field matrix (%s).\n", svd_method.toLatin1().constData());
+    VectorXd p_sing;
+    MatrixXd t_U, t_V;
+    if(!MNEMath::thin_svd(gain, p_sing, t_U, t_V, svd_method, svd_rank))
+    {
+        printf("Error while computing the SVD. Returning empty inverse operator.\n");
+        return p_MNEInverseOperator;
+    }
+
+    // singular values are returned in descending order, no sorting necessary
+    FiffNamedMatrix::SDPtr p_eigen_fields = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( t_U.cols(),
+                                                                                        t_U.rows(),
                                                                                         defaultQStringList,
                                                                                         gain_info.ch_names,
                                                                                         t_U.transpose() ));
 
-    p_sing = svd.singularValues();
-    MatrixXd t_V = svd.matrixV();
-    MNEMath::sort<double>(p_sing, t_V);
-    FiffNamedMatrix::SDPtr p_eigen_leads = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( svd.matrixV().rows(),
-                                                                                       svd.matrixV().cols(),
+    FiffNamedMatrix::SDPtr p_eigen_leads = FiffNamedMatrix::SDPtr(new FiffNamedMatrix( t_V.rows(),
+                                                                                       t_V.cols(),
                                                                                        defaultQStringList,
                                                                                        defaultQStringList,
                                                                                        t_V ));
@@ -738,6 +740,18 @@ MNEInverseOperator MNEInverseOperator::prepare_inverse_operator(qint32 nave ,flo
 
 bool MNEInverseOperator::read_inverse_operator(QIODevice& p_IODevice, MNEInverseOperator& inv)
 {
+    //
+    //   A cached inverse operator of the same file
+    //
+    QStringList t_qListCacheOptions;
+    t_qListCacheOptions << "inv";
+    QByteArray t_cacheKey = MNECache::key(p_IODevice, t_qListCacheOptions);
+    if(!t_cacheKey.isEmpty() && MNECache::readInverseOperator(t_cacheKey, inv))
+    {
+        printf("Read inverse operator decomposition from the cache (%d sources, %d channels).\n", inv.nsource, inv.nchan);
+        return true;
+    }
+
     //
     //   Open the file, create directory
     //
@@ -978,6 +992,9 @@ bool MNEInverseOperator::read_inverse_operator(QIODevice& p_IODevice, MNEInverse
     //   Done!
     //
 
+    if(!t_cacheKey.isEmpty())
+        MNECache::writeInverseOperator(t_cacheKey, inv);
+
     return true;
 }
 
@@ -142,8 +142,10 @@ public:
     * @param[in] depth              float in [0, 1]. Depth weighting coefficients. If None, no depth weighting is performed.
     * @param[in] fixed              Use fixed source orientations normal to the cortical mantle. If True, the loose parameter is ignored.
     * @param[in] limit_depth_chs    If True, use only grad channels in depth weighting (equivalent to MNE C code). If grad chanels aren't present, only mag channels will be used (if no mag, then eeg). If False, use all channels.
+    * @param[in] svd_method         Backend of the SVD of the whitened and weighted lead field: "jacobi", "qr", "gram" or "randomized" (see MNEMath::thin_svd).
+    * @param[in] svd_rank           Number of components kept by the "randomized" SVD; -1 keeps all.
     */
-    MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true);
+    MNEInverseOperator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true, const QString &svd_method = "jacobi", qint32 svd_rank = -1);
 
     //=========================================================================================================
     /**
@@ -199,10 +201,12 @@ public:
     * @param[in] depth              float in [0, 1]. Depth weighting coefficients. If None, no depth weighting is performed.
     * @param[in] fixed              Use fixed source orientations normal to the cortical mantle. If True, the loose parameter is ignored.
     * @param[in] limit_depth_chs    If True, use only grad channels in depth weighting (equivalent to MNE C code). If grad chanels aren't present, only mag channels will be used (if no mag, then eeg). If False, use all channels.
+    * @param[in] svd_method         Backend of the SVD of the whitened and weighted lead field: "jacobi", "qr", "gram" or "randomized" (see MNEMath::thin_svd).
+    * @param[in] svd_rank           Number of components kept by the "randomized" SVD; -1 keeps all.
     *
     * @return the assembled inverse operator
     */
-    static MNEInverseOperator make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true);
+    static MNEInverseOperator make_inverse_operator(const FiffInfo &info, MNEForwardSolution forward, const FiffCov& p_noise_cov, float loose = 0.2f, float depth = 0.8f, bool fixed = false, bool limit_depth_chs = true, const QString &svd_method = "jacobi", qint32 svd_rank = -1);
 
     //=========================================================================================================
     /**
@@ -41,6 +41,7 @@
 #include "mne_sourcespace.h"
 
 #include <utils/mnemath.h>
+#include <utils/parallel.h>
 #include <fs/label.h>
 
 
@@ -546,7 +547,8 @@ bool MNESourceSpace::patch_info(MNEHemisphere &p_Hemisphere)//VectorXi& nearest,
         p_Hemisphere.pinfo.append(t_vPInfo);
     }
 
-    // compute patch indices of the in-use source space vertices
+    // compute patch indices of the in-use source space vertices; the patch vertices are ascending, since they
+    // are taken from the sorted nearest vector, so they are looked up by binary search
     std::vector<qint32> patch_verts;
     patch_verts.reserve(t_vlasti.size());
     for(quint32 i = 0; i < t_vlasti.size(); ++i)
@@ -556,7 +558,9 @@ bool MNESourceSpace::patch_info(MNEHemisphere &p_Hemisphere)//VectorXi& nearest,
     std::vector<qint32>::iterator it;
     for(qint32 i = 0; i < p_Hemisphere.vertno.size(); ++i)
     {
-        it = std::find(patch_verts.begin(), patch_verts.end(), p_Hemisphere.vertno[i]);
+        it = std::lower_bound(patch_verts.begin(), patch_verts.end(), p_Hemisphere.vertno[i]);
+        if(it != patch_verts.end() && *it != p_Hemisphere.vertno[i])
+            it = patch_verts.end();
         p_Hemisphere.patch_inds[i] = it-patch_verts.begin();
     }
 
@@ -572,106 +576,79 @@ bool MNESourceSpace::complete_source_space_info(MNEHemisphere& p_Hemisphere)
     //   Main triangulation
     //
     printf("\tCompleting triangulation info...");
-    p_Hemisphere.tri_cent = MatrixX3d::Zero(p_Hemisphere.ntri,3);
-    p_Hemisphere.tri_nn = MatrixX3d::Zero(p_Hemisphere.ntri,3);
-    p_Hemisphere.tri_area = VectorXd::Zero(p_Hemisphere.ntri);
-
-    Matrix3d r;
-    Vector3d a, b;
-    int k = 0;
-    float size = 0;
-    for (qint32 i = 0; i < p_Hemisphere.ntri; ++i)
-    {
-        for ( qint32 j = 0; j < 3; ++j)
-        {
-            k = p_Hemisphere.tris(i, j);
-
-            r(j,0) = p_Hemisphere.rr(k, 0);
-            r(j,1) = p_Hemisphere.rr(k, 1);
-            r(j,2) = p_Hemisphere.rr(k, 2);
-
-            p_Hemisphere.tri_cent(i, 0) += p_Hemisphere.rr(k, 0);
-            p_Hemisphere.tri_cent(i, 1) += p_Hemisphere.rr(k, 1);
-            p_Hemisphere.tri_cent(i, 2) += p_Hemisphere.rr(k, 2);
-        }
-        p_Hemisphere.tri_cent.row(i) /= 3.0f;
-
-        //cross product {cross((r2-r1),(r3-r1))}
-        a = r.row(1) - r.row(0 );
-        b = r.row(2) - r.row(0);
-        p_Hemisphere.tri_nn(i,0) = a(1)*b(2)-a(2)*b(1);
-        p_Hemisphere.tri_nn(i,1) = a(2)*b(0)-a(0)*b(2);
-        p_Hemisphere.tri_nn(i,2) = a(0)*b(1)-a(1)*b(0);
-
-        //area
-        size = p_Hemisphere.tri_nn.row(i)*p_Hemisphere.tri_nn.row(i).transpose();
-        size = std::pow(size, 0.5f );
-
-        p_Hemisphere.tri_area(i) = size/2.0f;
-        p_Hemisphere.tri_nn.row(i) /= size;
-
-
-    }
+    compute_triangle_info(p_Hemisphere.rr, p_Hemisphere.tris, p_Hemisphere.ntri, true, p_Hemisphere.tri_cent, p_Hemisphere.tri_nn, p_Hemisphere.tri_area);
     printf("[done]\n");
 
-
-//        qDebug() << "p_Hemisphere.tri_cent:" << p_Hemisphere.tri_cent(0,0) << p_Hemisphere.tri_cent(0,1) << p_Hemisphere.tri_cent(0,2);
-//        qDebug() << "p_Hemisphere.tri_cent:" << p_Hemisphere.tri_cent(2,0) << p_Hemisphere.tri_cent(2,1) << p_Hemisphere.tri_cent(2,2);
-
-//        qDebug() << "p_Hemisphere.tri_nn:" << p_Hemisphere.tri_nn(0,0) << p_Hemisphere.tri_nn(0,1) << p_Hemisphere.tri_nn(0,2);
-//        qDebug() << "p_Hemisphere.tri_nn:" << p_Hemisphere.tri_nn(2,0) << p_Hemisphere.tri_nn(2,1) << p_Hemisphere.tri_nn(2,2);
-
     //
-    //   Selected triangles
+    //   Selected triangles, the normals are not normalized as in mne_read_source_spaces.m
     //
     printf("\tCompleting selection triangulation info...");
     if (p_Hemisphere.nuse_tri > 0)
-    {
-        p_Hemisphere.use_tri_cent = MatrixX3d::Zero(p_Hemisphere.nuse_tri,3);
-        p_Hemisphere.use_tri_nn = MatrixX3d::Zero(p_Hemisphere.nuse_tri,3);
-        p_Hemisphere.use_tri_area = VectorXd::Zero(p_Hemisphere.nuse_tri);
+        compute_triangle_info(p_Hemisphere.rr, p_Hemisphere.use_tris, p_Hemisphere.nuse_tri, false, p_Hemisphere.use_tri_cent, p_Hemisphere.use_tri_nn, p_Hemisphere.use_tri_area);
+    printf("[done]\n");
 
+    return true;
+}
 
-        for (qint32 i = 0; i < p_Hemisphere.nuse_tri; ++i)
-        {
-            for ( qint32 j = 0; j < 3; ++j)
-            {
-                k = p_Hemisphere.use_tris(i, j);
 
-                r(j,0) = p_Hemisphere.rr(k, 0);
-                r(j,1) = p_Hemisphere.rr(k, 1);
-                r(j,2) = p_Hemisphere.rr(k, 2);
+//*************************************************************************************************************
 
-                p_Hemisphere.use_tri_cent(i, 0) += p_Hemisphere.rr(k, 0);
-                p_Hemisphere.use_tri_cent(i, 1) += p_Hemisphere.rr(k, 1);
-                p_Hemisphere.use_tri_cent(i, 2) += p_Hemisphere.rr(k, 2);
-            }
-            p_Hemisphere.use_tri_cent.row(i) /= 3.0f;
+void MNESourceSpace::compute_triangle_info(const MatrixX3f &p_matRr, const MatrixX3i &p_matTris, qint32 p_iNumTris, bool p_bNormalize, MatrixX3d &p_matCent, MatrixX3d &p_matNn, VectorXd &p_vecArea)
+{
+    p_matCent = MatrixX3d::Zero(p_iNumTris,3);
+    p_matNn = MatrixX3d::Zero(p_iNumTris,3);
+    p_vecArea = VectorXd::Zero(p_iNumTris);
+
+    TriangleCompute t_compute;
+    t_compute.pRr = &p_matRr;
+    t_compute.pTris = &p_matTris;
+    t_compute.pCent = &p_matCent;
+    t_compute.pNn = &p_matNn;
+    t_compute.pArea = &p_vecArea;
+    t_compute.bNormalize = p_bNormalize;
+
+    Parallel::parallelFor(p_iNumTris, 4096, t_compute);
+}
 
-            //cross product {cross((r2-r1),(r3-r1))}
-            a = r.row(1) - r.row(0 );
-            b = r.row(2) - r.row(0);
-            p_Hemisphere.use_tri_nn(i,0) = a(1)*b(2)-a(2)*b(1);
-            p_Hemisphere.use_tri_nn(i,1) = a(2)*b(0)-a(0)*b(2);
-            p_Hemisphere.use_tri_nn(i,2) = a(0)*b(1)-a(1)*b(0);
 
-            //area
-            size = p_Hemisphere.use_tri_nn.row(i)*p_Hemisphere.use_tri_nn.row(i).transpose();
-            size = std::pow(size, 0.5f );
+//*************************************************************************************************************
 
-            p_Hemisphere.use_tri_area(i) = size/2.0f;
-        }
+void MNESourceSpace::TriangleCompute::operator()(qint32 p_iFirst, qint32 p_iNum) const
+{
+    qint32 n = p_iNum;
+    const MatrixX3f &rr = *pRr;
+    const MatrixX3i &tris = *pTris;
 
+    //
+    // Gather the corners, everything else is done column wise on the whole range
+    //
+    MatrixX3d r1(n,3), r2(n,3), r3(n,3);
+    for(qint32 i = 0; i < n; ++i)
+    {
+        qint32 t = p_iFirst + i;
+        r1.row(i) = rr.row(tris(t,0)).cast<double>();
+        r2.row(i) = rr.row(tris(t,1)).cast<double>();
+        r3.row(i) = rr.row(tris(t,2)).cast<double>();
     }
-    printf("[done]\n");
 
-//        qDebug() << "p_Hemisphere.use_tri_cent:" << p_Hemisphere.use_tri_cent(0,0) << p_Hemisphere.use_tri_cent(0,1) << p_Hemisphere.use_tri_cent(0,2);
-//        qDebug() << "p_Hemisphere.use_tri_cent:" << p_Hemisphere.use_tri_cent(2,0) << p_Hemisphere.use_tri_cent(2,1) << p_Hemisphere.use_tri_cent(2,2);
+    pCent->middleRows(p_iFirst, n) = (r1 + r2 + r3) / 3.0;
 
-//        qDebug() << "p_Hemisphere.use_tri_nn:" << p_Hemisphere.use_tri_nn(0,0) << p_Hemisphere.use_tri_nn(0,1) << p_Hemisphere.use_tri_nn(0,2);
-//        qDebug() << "p_Hemisphere.use_tri_nn:" << p_Hemisphere.use_tri_nn(2,0) << p_Hemisphere.use_tri_nn(2,1) << p_Hemisphere.use_tri_nn(2,2);
+    //cross product {cross((r2-r1),(r3-r1))}
+    r2 -= r1;
+    r3 -= r1;
+    MatrixX3d nn(n,3);
+    nn.col(0) = r2.col(1).cwiseProduct(r3.col(2)) - r2.col(2).cwiseProduct(r3.col(1));
+    nn.col(1) = r2.col(2).cwiseProduct(r3.col(0)) - r2.col(0).cwiseProduct(r3.col(2));
+    nn.col(2) = r2.col(0).cwiseProduct(r3.col(1)) - r2.col(1).cwiseProduct(r3.col(0));
 
-    return true;
+    //area
+    VectorXd size = nn.rowwise().norm();
+    pArea->segment(p_iFirst, n) = size / 2.0;
+
+    if(bNormalize)
+        nn.array().colwise() /= size.array();
+
+    pNn->middleRows(p_iFirst, n) = nn;
 }
 
 
@@ -106,6 +106,9 @@ using namespace FIFFLIB;
 // FORWARD DECLARATIONS
 //=============================================================================================================
 
+class MNECache;
+
+
 //=============================================================================================================
 /**
 * Source Space descritpion
@@ -114,6 +117,8 @@ using namespace FIFFLIB;
 */
 class MNESHARED_EXPORT MNESourceSpace
 {
+    friend class MNECache;
+
 public:
     typedef QSharedPointer<MNESourceSpace> SPtr;            /**< Shared pointer type for MNESourceSpace. */
     typedef QSharedPointer<const MNESourceSpace> ConstSPtr; /**< Const shared pointer type for MNESourceSpace. */
@@ -301,6 +306,45 @@ private:
     */
     static bool complete_source_space_info(MNEHemisphere& p_Hemisphere);
 
+    //=========================================================================================================
+    /**
+    * Computes the triangulation info of a range of triangles, for multi-threaded computation. The triangles
+    * write to disjoint rows of the results.
+    */
+    struct TriangleCompute
+    {
+        const MatrixX3f* pRr;   /**< Vertex locations. */
+        const MatrixX3i* pTris; /**< Triangles. */
+        MatrixX3d* pCent;       /**< Triangle centers to write to. */
+        MatrixX3d* pNn;         /**< Triangle normals to write to. */
+        VectorXd* pArea;        /**< Triangle areas to write to. */
+        bool bNormalize;        /**< Whether the normals are normalized. */
+
+        //=====================================================================================================
+        /**
+        * Computes the triangles p_iFirst ... p_iFirst+p_iNum-1. The corners are gathered once, centers,
+        * cross products and areas are computed column wise on the whole range.
+        *
+        * @param[in] p_iFirst   First triangle
+        * @param[in] p_iNum     Number of triangles
+        */
+        void operator()(qint32 p_iFirst, qint32 p_iNum) const;
+    };
+
+    //=========================================================================================================
+    /**
+    * Computes the centers, normals and areas of triangles, multi-threaded over ranges of triangles.
+    *
+    * @param [in] p_matRr       Vertex locations
+    * @param [in] p_matTris     Triangles
+    * @param [in] p_iNumTris    Number of triangles
+    * @param [in] p_bNormalize  Whether the normals are normalized
+    * @param [out] p_matCent    Triangle centers
+    * @param [out] p_matNn      Triangle normals
+    * @param [out] p_vecArea    Triangle areas
+    */
+    static void compute_triangle_info(const MatrixX3f &p_matRr, const MatrixX3i &p_matTris, qint32 p_iNumTris, bool p_bNormalize, MatrixX3d &p_matCent, MatrixX3d &p_matNn, VectorXd &p_vecArea);
+
     //=========================================================================================================
     /**
     * Implementation of the read_source_space function in e.g. mne_read_source_spaces.m, mne_read_bem_surfaces.m
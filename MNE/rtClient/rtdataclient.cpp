@@ -59,6 +59,7 @@ using namespace RTCLIENTLIB;
 RtDataClient::RtDataClient(QObject *parent)
 : QTcpSocket(parent)
 , m_clientID(-1)
+, m_pLatencyTracer(LatencyTracer::stage("RtDataClient"))
 {
     getClientId();
 }
@@ -83,7 +84,7 @@ qint32 RtDataClient::getClientId()
         FiffStream t_fiffStream(this);
 
         QString t_sCommand("");
-        t_fiffStream.write_rt_command(1, t_sCommand);
+        t_fiffStream.write_rt_command(FIFFV_MNE_RT_GET_CLIENT_ID, t_sCommand);
 
 
         this->waitForReadyRead(100);
@@ -318,7 +319,7 @@ FiffInfo::SPtr RtDataClient::readInfo()
 
 //*************************************************************************************************************
 
-void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind)
+void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind, qint32* p_pSequence)
 {
 //        data = [];
 
@@ -332,10 +333,27 @@ void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t&
 
     kind = t_pTag->kind;
 
-    if(kind == FIFF_DATA_BUFFER)
+    if(p_pSequence)
+        *p_pSequence = -1;
+
+    if(kind == FIFF_DATA_BUFFER || kind == FIFF_MNE_RT_DATA_BUFFER_PACK16 || kind == FIFF_MNE_RT_DATA_BUFFER_PACK24
+            || kind == FIFF_MNE_RT_DATA_BUFFER_LOSSLESS)
     {
-        qint32 nSamples = (t_pTag->size()/4)/p_nChannels;
-        data = MatrixXf(Map< MatrixXf >(t_pTag->toFloat(), p_nChannels, nSamples));
+        //
+        // The client acquires the buffer when it is received; the queue depth are the buffers still waiting
+        // in the socket
+        //
+        qint64 t_iEnter = LatencyTracer::now();
+        qint32 t_iSequence = LatencyTracer::acquire();
+
+        // the stream modes are decoded transparently
+        if(t_pTag->toRtRawBuffer(data, p_nChannels))
+            kind = FIFF_DATA_BUFFER;
+
+        m_pLatencyTracer->record(t_iEnter, t_iSequence, this->bytesAvailable() / (t_pTag->size() + 4*sizeof(qint32)));
+
+        if(p_pSequence)
+            *p_pSequence = t_iSequence;
     }
 //        else
 //            data = tag.data;
@@ -347,6 +365,16 @@ void RtDataClient::readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t&
 void RtDataClient::setClientAlias(const QString &p_sAlias)
 {
     FiffStream t_fiffStream(this);
-    t_fiffStream.write_rt_command(2, p_sAlias);//MNE_RT.MNE_RT_SET_CLIENT_ALIAS, alias);
+    t_fiffStream.write_rt_command(FIFFV_MNE_RT_SET_CLIENT_ALIAS, p_sAlias);
+    this->flush();
+}
+
+
+//*************************************************************************************************************
+
+void RtDataClient::setStreamMode(fiff_int_t p_iStreamMode)
+{
+    FiffStream t_fiffStream(this);
+    t_fiffStream.write_rt_command(FIFFV_MNE_RT_SET_STREAM_MODE, QString::number(p_iStreamMode));
     this->flush();
 }
@@ -54,6 +54,7 @@
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_info.h>
 #include <fiff/fiff_tag.h>
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -81,6 +82,7 @@ namespace RTCLIENTLIB
 //=============================================================================================================
 
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //=============================================================================================================
@@ -135,8 +137,10 @@ public:
     * @param[in] p_nChannels    Number of channels to reshape the received data
     * @param[out] data          The read data - ToDo change this to raw buffer data object
     * @param[out] kind          Data kind
+    * @param[out] p_pSequence   (optional) Latency trace sequence number the received raw buffer was acquired
+    *                           with; -1 if no raw buffer was received
     */
-    void readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind);
+    void readRawBuffer(qint32 p_nChannels, MatrixXf& data, fiff_int_t& kind, qint32* p_pSequence = NULL);
 
     //=========================================================================================================
     /**
@@ -146,9 +150,21 @@ public:
     */
     void setClientAlias(const QString &p_sAlias);
 
+    //=========================================================================================================
+    /**
+    * Requests the raw stream mode, i.e. the encoding of the raw buffers sent by mne_rt_server: full floats
+    * (default), 16 or 24 bit integers with per channel scales, or lossless compressed floats. readRawBuffer
+    * decodes all modes.
+    *
+    * @param[in] p_iStreamMode  The raw stream mode (FIFFV_MNE_RT_STREAM_FLOAT, _PACK16, _PACK24 or _LOSSLESS)
+    */
+    void setStreamMode(fiff_int_t p_iStreamMode);
+
 private:
     qint32 m_clientID;  /**< Corresponding client id of the data client at mne_rt_server */
 
+    LatencyTracer* m_pLatencyTracer;    /**< Traces the reception of the raw buffers. */
+
 signals:
     
 public slots:
@@ -43,6 +43,7 @@
 #include "rtave.h"
 
 #include <utils/ioutils.h>
+#include <utils/latencytracer.h>
 
 #include <iostream>
 
@@ -78,6 +79,8 @@ RtAve::RtAve(quint32 p_iPreStimSamples, quint32 p_iPostStimSamples, FiffInfo::SP
 , m_pFiffInfo(p_pFiffInfo)
 , m_bIsRunning(false)
 , m_bAutoAspect(true)
+, m_fAlpha(0.0f)
+, m_iNumSamples(0)
 {
     qRegisterMetaType<FiffEvoked::SPtr>("FiffEvoked::SPtr");
 }
@@ -93,182 +96,142 @@ RtAve::~RtAve()
 
 //*************************************************************************************************************
 
-void RtAve::append(const MatrixXd &p_DataSegment)
+void RtAve::append(const MatrixXd &p_DataSegment, qint32 p_iSequence)
 {
-//    if(m_pRawMatrixBuffer) // ToDo handle change buffersize
-
+    //
+    //  The data are processed in single precision, they are converted while they are pushed to the buffer
+    //
     if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(128, p_DataSegment.rows(), p_DataSegment.cols()));
+        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(128, p_DataSegment.rows(), p_DataSegment.cols()));
 
-    m_pRawMatrixBuffer->push(&p_DataSegment);
+    m_pRawMatrixBuffer->push(&p_DataSegment, p_iSequence);
 }
 
 
 //*************************************************************************************************************
 
-void RtAve::assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+void RtAve::append(const MatrixXf &p_DataSegment, qint32 p_iSequence)
 {
-    if(m_iPreStimSamples > 0)
-    {
-        // middle of the assembled buffers
-        qint32 t_iMidIdx = p_qListRawMatBuf.size()/2;
-
-        qint32 nrows = p_qListRawMatBuf[t_iMidIdx].second.rows();
-        qint32 ncols = p_qListRawMatBuf[t_iMidIdx].second.cols();
-
-        //Stimulus channel row
-        qint32 t_iRowIdx = m_qListStimChannelIdcs[p_iStimIdx];
-
-//        std::cout << t_iRowIdx
-//                     << ": " << p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx) << std::endl;
-
-        qint32 nSampleCount = 0;
-
-        MatrixXd t_matPostStim(nrows, m_iPostStimSamples);
-        qint32 t_curBufIdx = t_iMidIdx;
-
-        qint32 t_iSize = 0;
-
-        qint32 pos = 0;
-        p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx).maxCoeff(&pos);
-//        std::cout << "Position: " << pos << std::endl;
-
-        //
-        // assemble poststimulus
-        //
-
-        // start from the stimulus itself
-        if(pos > 0)
-        {
-            t_iSize = ncols - pos;
-            if(t_iSize <= m_iPostStimSamples)
-            {
-                t_matPostStim.block(0, 0, nrows, t_iSize) = p_qListRawMatBuf[t_iMidIdx].second.block(0, pos, nrows, t_iSize);
-                nSampleCount += t_iSize;
+//    if(m_pRawMatrixBuffer) // ToDo handle change buffersize
 
-//                qDebug() << "t_matPostStim.block" << nSampleCount;
-            }
-            else
-            {
-                t_matPostStim.block(0, 0, nrows, m_iPostStimSamples) = p_qListRawMatBuf[t_iMidIdx].second.block(0, pos, nrows, m_iPostStimSamples);
-                nSampleCount = m_iPostStimSamples;
+    if(!m_pRawMatrixBuffer)
+        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(128, p_DataSegment.rows(), p_DataSegment.cols()));
 
-//                qDebug() << "t_matPostStim.block" << nSampleCount;
-            }
+    m_pRawMatrixBuffer->push(&p_DataSegment, p_iSequence);
+}
 
-            ++t_curBufIdx;
-        }
 
-        // remaining samples
-        while(nSampleCount < m_iPostStimSamples)
-        {
-            t_iSize = m_iPostStimSamples-nSampleCount;
+//*************************************************************************************************************
 
-            if(ncols <= t_iSize)
-            {
-                t_matPostStim.block(0, nSampleCount, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, ncols);
-                nSampleCount += ncols;
-            }
-            else
-            {
-                t_matPostStim.block(0, nSampleCount, nrows, t_iSize) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, t_iSize);
-                nSampleCount = m_iPostStimSamples;
-            }
+void RtAve::setAverages(qint32 p_iNumAverages)
+{
+    if(p_iNumAverages > 0)
+        m_iNumAverages = p_iNumAverages;
+}
 
-            ++t_curBufIdx;
 
-//            qDebug() << "Sample count" << nSampleCount;
-        }
+//*************************************************************************************************************
 
-        //
-        //Store in right post stimulus buffer vector
-        //
-        m_qListQVectorPostStimBuf[p_iStimIdx].append(t_matPostStim);
-    }
+void RtAve::setExponentialWeighting(float p_fAlpha)
+{
+    if(p_fAlpha >= 0.0f && p_fAlpha <= 1.0f)
+        m_fAlpha = p_fAlpha;
 }
 
 
 //*************************************************************************************************************
 
-void RtAve::assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx)
+void RtAve::appendToHistory(const MatrixXf &p_matRawSegment)
 {
-    if(m_iPreStimSamples > 0)
-    {
-        // middle of the assembled buffers
-        qint32 t_iMidIdx = p_qListRawMatBuf.size()/2;
+    qint32 nrows = p_matRawSegment.rows();
+    qint32 ncols = p_matRawSegment.cols();
 
-        qint32 nrows = p_qListRawMatBuf[t_iMidIdx].second.rows();
-        qint32 ncols = p_qListRawMatBuf[t_iMidIdx].second.cols();
-
-        //Stimulus channel row
-        qint32 t_iRowIdx = m_qListStimChannelIdcs[p_iStimIdx];
+    //
+    // The history has to hold a whole epoch plus the block which completes it
+    //
+    qint32 t_iHistorySize = m_iPreStimSamples + m_iPostStimSamples + 2 * ncols;
+    if(m_matRawHistory.rows() != nrows || m_matRawHistory.cols() < t_iHistorySize)
+        m_matRawHistory.resize(nrows, t_iHistorySize);
 
-//        std::cout << t_iRowIdx
-//                     << ": " << p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx) << std::endl;
+    qint32 t_iHistoryCols = m_matRawHistory.cols();
 
-        qint32 nSampleCount = m_iPreStimSamples;
+    //
+    // Detect rising edges sample by sample
+    //
+    qint32 i, j;
+    for(i = 0; i < m_qListStimChannelIdcs.size(); ++i)
+    {
+        qint32 idx = m_qListStimChannelIdcs[i];
+        float t_fLast = m_qListLastStimValue[i];
+        for(j = 0; j < ncols; ++j)
+        {
+            float t_fValue = p_matRawSegment(idx, j);
+            if(t_fValue > 0 && t_fLast <= 0)
+                m_qListPendingStimuli.append(qMakePair(i, m_iNumSamples + j));
+            t_fLast = t_fValue;
+        }
+        m_qListLastStimValue[i] = t_fLast;
+    }
 
-        MatrixXd t_matPreStim(nrows, m_iPreStimSamples);
-        qint32 t_curBufIdx = t_iMidIdx;
+    //
+    // Copy the block into the ring, in at most two parts
+    //
+    qint32 t_iStart = (qint32)(m_iNumSamples % t_iHistoryCols);
+    qint32 t_iFirst = qMin(ncols, t_iHistoryCols - t_iStart);
+    m_matRawHistory.block(0, t_iStart, nrows, t_iFirst) = p_matRawSegment.leftCols(t_iFirst);
+    if(t_iFirst < ncols)
+        m_matRawHistory.block(0, 0, nrows, ncols - t_iFirst) = p_matRawSegment.rightCols(ncols - t_iFirst);
 
-        qint32 t_iStart = 0;
+    m_iNumSamples += ncols;
+}
 
-        qint32 pos = 0;
-        p_qListRawMatBuf[t_iMidIdx].second.row(t_iRowIdx).maxCoeff(&pos);
-//        std::cout << "Position: " << pos << std::endl;
 
-        //
-        // assemble prestimulus
-        //
+//*************************************************************************************************************
 
-        // start from the stimulus itself
-        if(pos > 0)
-        {
-            t_iStart = m_iPreStimSamples - pos;
-            if(t_iStart >= 0)
-            {
-                t_matPreStim.block(0, t_iStart, nrows, pos) = p_qListRawMatBuf[t_iMidIdx].second.block(0, 0, nrows, pos);
-                nSampleCount -= pos;
+bool RtAve::addEpoch(qint32 p_iStimIdx, qint64 p_iStimSample)
+{
+    qint32 t_iEpochSize = m_iPreStimSamples + m_iPostStimSamples;
+    qint32 t_iHistoryCols = m_matRawHistory.cols();
+    qint64 t_iFirstSample = p_iStimSample - m_iPreStimSamples;
 
-//                qDebug() << "t_matPreStim.block" << nSampleCount;
-            }
-            else
-            {
-                t_matPreStim.block(0, 0, nrows, m_iPreStimSamples) = p_qListRawMatBuf[t_iMidIdx].second.block(0, -t_iStart, nrows, m_iPreStimSamples);
-                nSampleCount = 0;
+    // not recorded or already overwritten
+    if(t_iFirstSample < 0 || t_iFirstSample < m_iNumSamples - t_iHistoryCols)
+        return false;
 
-//                qDebug() << "t_matPreStim.block" << nSampleCount;
-            }
+    //
+    // Cut the epoch into the ring slot to replace
+    //
+    MatrixXf& t_matEpoch = m_qListEpochs[p_iStimIdx][m_qListEpochIdx[p_iStimIdx]];
+    qint32 nrows = m_matRawHistory.rows();
+    bool t_bEvict = m_fAlpha == 0.0f && m_qListNumEpochs[p_iStimIdx] >= m_iNumAverages;
 
-            --t_curBufIdx;
-        }
+    if(t_bEvict)
+        m_qListAveSum[p_iStimIdx] -= t_matEpoch.cast<double>();
+    else if(t_matEpoch.rows() != nrows)
+        t_matEpoch.resize(nrows, t_iEpochSize);
 
-        // remaining samples
-        while(nSampleCount > 0)
-        {
-            t_iStart = nSampleCount - ncols;
+    qint32 t_iStart = (qint32)(t_iFirstSample % t_iHistoryCols);
+    qint32 t_iFirst = qMin(t_iEpochSize, t_iHistoryCols - t_iStart);
+    t_matEpoch.leftCols(t_iFirst) = m_matRawHistory.block(0, t_iStart, nrows, t_iFirst);
+    if(t_iFirst < t_iEpochSize)
+        t_matEpoch.rightCols(t_iEpochSize - t_iFirst) = m_matRawHistory.leftCols(t_iEpochSize - t_iFirst);
 
-            if(t_iStart >= 0)
-            {
-                t_matPreStim.block(0, t_iStart, nrows, ncols) = p_qListRawMatBuf[t_curBufIdx].second.block(0, 0, nrows, ncols);
-                nSampleCount -= ncols;
-            }
-            else
-            {
-                t_matPreStim.block(0, 0, nrows, nSampleCount) = p_qListRawMatBuf[t_curBufIdx].second.block(0, -t_iStart, nrows, nSampleCount);
-                nSampleCount = 0;
-            }
+    //
+    // Update the average
+    //
+    if(m_qListNumEpochs[p_iStimIdx] == 0)
+        m_qListAveSum[p_iStimIdx] = t_matEpoch.cast<double>();
+    else if(m_fAlpha > 0.0f)
+        m_qListAveSum[p_iStimIdx] += m_fAlpha * (t_matEpoch.cast<double>() - m_qListAveSum[p_iStimIdx]);
+    else
+        m_qListAveSum[p_iStimIdx] += t_matEpoch.cast<double>();
 
-            --t_curBufIdx;
+    if(m_fAlpha == 0.0f)
+        m_qListEpochIdx[p_iStimIdx] = (m_qListEpochIdx[p_iStimIdx] + 1) % m_iNumAverages;
 
-//            qDebug() << "Sample count" << nSampleCount;
-        }
+    ++m_qListNumEpochs[p_iStimIdx];
 
-        //
-        //Store in right pre stimulus buffer vector
-        //
-        m_qListQVectorPreStimBuf[p_iStimIdx].append(t_matPreStim);
-    }
+    return m_qListNumEpochs[p_iStimIdx] >= m_iNumAverages;
 }
 
 
@@ -293,37 +256,33 @@ void RtAve::run()
     //
     // Inits & Clears
     //
-    quint32 t_nSamplesPerBuf = 0;
-    QList<QPair<QList<qint32>, MatrixXd> > t_qListRawMatBuf;
-
-    FiffEvoked::SPtr evoked(new FiffEvoked());
-    VectorXd mu;
     qint32 i = 0;
-    qint32 j = 0;
 
-    m_qListQVectorPreStimBuf.clear();
-    m_qListQVectorPostStimBuf.clear();
-    m_qListPreStimAve.clear();
-    m_qListPostStimAve.clear();
-    m_qListStimAve.clear();
+    m_matRawHistory.resize(0, 0);
+    m_iNumSamples = 0;
+    m_qListLastStimValue.clear();
+    m_qListPendingStimuli.clear();
+    m_qListEpochs.clear();
+    m_qListEpochIdx.clear();
+    m_qListNumEpochs.clear();
+    m_qListAveSum.clear();
 
     //
     // get num stim channels
     //
     m_qListStimChannelIdcs.clear();
-    MatrixXd t_mat;
-    QVector<MatrixXd> t_qVecMat;
     for(i = 0; i < m_pFiffInfo->nchan; ++i)
     {
         if(m_pFiffInfo->chs[i].kind == FIFFV_STIM_CH && (m_pFiffInfo->chs[i].ch_name != QString("STI 014")))
         {
             m_qListStimChannelIdcs.append(i);
 
-            m_qListQVectorPreStimBuf.push_back(t_qVecMat);
-            m_qListQVectorPostStimBuf.push_back(t_qVecMat);
-            m_qListPreStimAve.push_back(t_mat);
-            m_qListPostStimAve.push_back(t_mat);
-            m_qListStimAve.push_back(t_mat);
+            m_qListLastStimValue.append(0.0f);
+            // the epochs are allocated with the first trial, the ring is not needed for exponential weighting
+            m_qListEpochs.append(QVector<MatrixXf>(m_fAlpha == 0.0f ? m_iNumAverages : 1));
+            m_qListEpochIdx.append(0);
+            m_qListNumEpochs.append(0);
+            m_qListAveSum.append(MatrixXd());
         }
     }
 
@@ -367,145 +326,73 @@ void RtAve::run()
     t_stimEvoked.last = t_stimEvoked.times[t_stimEvoked.times.size()-1];
 
 
-    qint32 count = 0;
+    MatrixXf rawSegment;
+    qint32 t_iSequence = -1;
+
+    LatencyTracer* t_pTracer = LatencyTracer::stage("RtAve");
 
     //Enter the main loop
     while(m_bIsRunning)
     {
-        if(m_pRawMatrixBuffer)
+        //
+        // Acquire Data; don't block forever, stop() has to be able to end the thread
+        //
+        if(m_pRawMatrixBuffer && m_pRawMatrixBuffer->tryPop(rawSegment, 100, &t_iSequence))
         {
-            //
-            // Acquire Data
-            //
-            MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
-            if(t_nSamplesPerBuf == 0)
-                t_nSamplesPerBuf = rawSegment.cols();
-
-            ++count;
+            qint64 t_iEnter = LatencyTracer::now();
 
             //
-            // Detect Stimuli
+            // Store and detect stimuli
             //
-            QList<qint32> t_qListStimuli;
-            for(i = 0; i < m_qListStimChannelIdcs.size(); ++i)
-            {
-                qint32 idx = m_qListStimChannelIdcs[i];
-                RowVectorXi stimSegment = rawSegment.row(idx).cast<int>();
-                int iMax = stimSegment.maxCoeff();
-
-                if(iMax > 0)
-                    t_qListStimuli.append(i);
-            }
+            this->appendToHistory(rawSegment);
 
             //
-            // Store
+            // Average all stimuli whose post stimulus samples are complete
             //
-            t_qListRawMatBuf.push_back(qMakePair(t_qListStimuli, rawSegment));
-
-            if(t_nSamplesPerBuf*t_qListRawMatBuf.size() > (m_iPreStimSamples+m_iPostStimSamples + (2 * t_nSamplesPerBuf)))
+            i = 0;
+            while(i < m_qListPendingStimuli.size())
             {
-                //
-                // Average
-                //
-//                qDebug() << t_qListRawMatBuf.size()/2;
-//                qDebug() << (float)(m_iPreStimSamples + t_nSamplesPerBuf)/((float)t_nSamplesPerBuf);
-                qint32 t_iMidIdx = t_qListRawMatBuf.size()/2;
+                qint32 t_iStimIndex = m_qListPendingStimuli[i].first;
+                qint64 t_iStimSample = m_qListPendingStimuli[i].second;
 
-                if(t_iMidIdx > 0 && t_qListRawMatBuf[t_iMidIdx].first.size() != 0)
+                if(t_iStimSample + m_iPostStimSamples > m_iNumSamples)
                 {
-                    for(i = 0; i < t_qListRawMatBuf[t_iMidIdx].first.size(); ++i)
-                    {
-                        if(!t_qListRawMatBuf[t_iMidIdx-1].first.contains(t_qListRawMatBuf[t_iMidIdx].first[i]))//make sure that previous buffer does not conatin this stim - prevent multiple detection
-                        {
-                            qint32 t_iStimIndex = t_qListRawMatBuf[t_iMidIdx].first[i];
-
-                            //
-                            // assemble prestimulus
-                            //
-                            this->assemblePreStimulus(t_qListRawMatBuf, t_iStimIndex);
-
-                            //
-                            // assemble poststimulus
-                            //
-                            this->assemblePostStimulus(t_qListRawMatBuf, t_iStimIndex);
-
-//                            qDebug() << "Buffers of pre-stimulus" << t_iStimIndex << ":" << m_qListQVectorPreStimBuf[t_iStimIndex].size();
-                            //
-                            // Prestimulus average
-                            //
-                            if(m_qListQVectorPreStimBuf[t_iStimIndex].size() >= m_iNumAverages)
-                            {
-                                m_qListPreStimAve[t_iStimIndex] = m_qListQVectorPreStimBuf[t_iStimIndex][0];
-                                for(j = 1; j < m_qListQVectorPreStimBuf[t_iStimIndex].size(); ++j)
-                                    m_qListPreStimAve[t_iStimIndex] += m_qListQVectorPreStimBuf[t_iStimIndex][j];
-
-                                m_qListPreStimAve[t_iStimIndex].array() /= (double)m_iNumAverages;
-
-                                m_qListQVectorPreStimBuf[t_iStimIndex].pop_front();
-
-                                qDebug() << "Pre-stim average" << t_iStimIndex;
-                            }
-
-
-//                            qDebug() << "Buffers of post-stimulus" << t_iStimIndex << ":" << m_qListQVectorPostStimBuf[t_iStimIndex].size();
-                            //
-                            // Poststimulus average
-                            //
-                            if(m_qListQVectorPostStimBuf[t_iStimIndex].size() >= m_iNumAverages)
-                            {
-                                m_qListPostStimAve[t_iStimIndex] = m_qListQVectorPostStimBuf[t_iStimIndex][0];
-                                for(j = 1; j < m_qListQVectorPostStimBuf[t_iStimIndex].size(); ++j)
-                                    m_qListPostStimAve[t_iStimIndex] += m_qListQVectorPostStimBuf[t_iStimIndex][j];
-
-                                m_qListPostStimAve[t_iStimIndex].array() /= (double)m_iNumAverages;
-
-                                m_qListQVectorPostStimBuf[t_iStimIndex].pop_front();
-
-                                qDebug() << "Post-stim average" << t_iStimIndex;
-                            }
-
-                            //if averages are available -> buffers are filled and first average is stored
-                            if(m_qListPreStimAve[t_iStimIndex].size() > 0)
-                            {
-                                //
-                                // concatenate pre + post stimulus to full stimulus
-                                //
-                                m_qListStimAve[t_iStimIndex].resize(m_qListPreStimAve[t_iStimIndex].rows(), m_qListPreStimAve[t_iStimIndex].cols() + m_qListPostStimAve[t_iStimIndex].cols());
-                                // Pre
-                                m_qListStimAve[t_iStimIndex].block(0,0,m_qListPreStimAve[t_iStimIndex].rows(),m_qListPreStimAve[t_iStimIndex].cols()) = m_qListPreStimAve[t_iStimIndex];
-                                // Post
-                                m_qListStimAve[t_iStimIndex].block(0,m_qListPreStimAve[t_iStimIndex].cols(),m_qListPostStimAve[t_iStimIndex].rows(),m_qListPostStimAve[t_iStimIndex].cols()) = m_qListPostStimAve[t_iStimIndex];
-
-
-                                //
-                                // Emit evoked
-                                //
-                                FiffEvoked::SPtr t_pEvokedPreStim(new FiffEvoked(t_preStimEvoked));
-                                t_pEvokedPreStim->comment = QString("Stim %1").arg(t_iStimIndex);
-                                t_pEvokedPreStim->data = m_qListPreStimAve[t_iStimIndex];
-                                emit evokedPreStim(t_pEvokedPreStim);
-
-                                FiffEvoked::SPtr t_pEvokedPostStim(new FiffEvoked(t_postStimEvoked));
-                                t_pEvokedPostStim->comment = QString("Stim %1").arg(t_iStimIndex);
-                                t_pEvokedPostStim->data = m_qListPostStimAve[t_iStimIndex];
-                                emit evokedPostStim(t_pEvokedPostStim);
-
-                                FiffEvoked::SPtr t_pEvokedStim(new FiffEvoked(t_stimEvoked));
-                                t_pEvokedStim->comment = QString("Stim %1").arg(t_iStimIndex);
-                                t_pEvokedStim->data = m_qListStimAve[t_iStimIndex];
-                                emit evokedStim(t_pEvokedStim);
-                                qDebug() << "Evoked emitted" << t_pEvokedPreStim->comment;
-                            }
-                        }
-                    }
+                    ++i;
+                    continue;
                 }
 
+                m_qListPendingStimuli.removeAt(i);
+
+                if(!this->addEpoch(t_iStimIndex, t_iStimSample))
+                    continue;
 
                 //
-                //dump oldest buffer
+                // Emit evoked
                 //
-                t_qListRawMatBuf.pop_front();
+                qint32 nave = m_fAlpha > 0.0f ? m_qListNumEpochs[t_iStimIndex] : m_iNumAverages;
+                MatrixXd t_matStimAve = m_fAlpha > 0.0f ? m_qListAveSum[t_iStimIndex] : MatrixXd(m_qListAveSum[t_iStimIndex] / (double)m_iNumAverages);
+
+                FiffEvoked::SPtr t_pEvokedPreStim(new FiffEvoked(t_preStimEvoked));
+                t_pEvokedPreStim->comment = QString("Stim %1").arg(t_iStimIndex);
+                t_pEvokedPreStim->nave = nave;
+                t_pEvokedPreStim->data = t_matStimAve.leftCols(m_iPreStimSamples);
+                emit evokedPreStim(t_pEvokedPreStim);
+
+                FiffEvoked::SPtr t_pEvokedPostStim(new FiffEvoked(t_postStimEvoked));
+                t_pEvokedPostStim->comment = QString("Stim %1").arg(t_iStimIndex);
+                t_pEvokedPostStim->nave = nave;
+                t_pEvokedPostStim->data = t_matStimAve.rightCols(m_iPostStimSamples);
+                emit evokedPostStim(t_pEvokedPostStim);
+
+                FiffEvoked::SPtr t_pEvokedStim(new FiffEvoked(t_stimEvoked));
+                t_pEvokedStim->comment = QString("Stim %1").arg(t_iStimIndex);
+                t_pEvokedStim->nave = nave;
+                t_pEvokedStim->data = t_matStimAve;
+                emit evokedStim(t_pEvokedStim, t_iSequence);
+                qDebug() << "Evoked emitted" << t_pEvokedPreStim->comment;
             }
+
+            t_pTracer->record(t_iEnter, t_iSequence, m_pRawMatrixBuffer->available());
         }
     }
 }
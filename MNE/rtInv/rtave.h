@@ -71,6 +71,7 @@
 #include <QSharedPointer>
 #include <QSet>
 #include <QList>
+#include <QPair>
 #include <QVector>
 
 
@@ -133,11 +134,40 @@ public:
 
     //=========================================================================================================
     /**
-    * Slot to receive incoming data.
+    * Slot to receive incoming double precision data. They are converted to single precision while they are
+    * pushed to the input buffer, without a converted copy.
     *
-    * @param[in] p_DataSegment  Data to estimate the covariance from -> ToDo Replace this by shared data pointer
+    * @param[in] p_DataSegment  Data to estimate the average from
+    * @param[in] p_iSequence    (optional) Latency trace sequence number of the data, -1 if unknown (default)
     */
-    void append(const MatrixXd &p_DataSegment);
+    void append(const MatrixXd &p_DataSegment, qint32 p_iSequence = -1);
+
+    //=========================================================================================================
+    /**
+    * Slot to receive incoming data, the data are processed in single precision.
+    *
+    * @param[in] p_DataSegment  Data to estimate the average from
+    * @param[in] p_iSequence    (optional) Latency trace sequence number of the data, -1 if unknown (default)
+    */
+    void append(const MatrixXf &p_DataSegment, qint32 p_iSequence = -1);
+
+    //=========================================================================================================
+    /**
+    * Sets the number of averaged epochs. Has to be called before start().
+    *
+    * @param[in] p_iNumAverages     Number of epochs to average
+    */
+    void setAverages(qint32 p_iNumAverages);
+
+    //=========================================================================================================
+    /**
+    * Switches to an exponentially weighted average, i.e. ave = ave + alpha * (epoch - ave), which doesn't need
+    * to keep the last epochs. The first average is emitted after the number of averages set by setAverages.
+    * Has to be called before start().
+    *
+    * @param[in] p_fAlpha   Weight of the newest epoch (0 < alpha <= 1); 0 switches back to the moving average
+    */
+    void setExponentialWeighting(float p_fAlpha);
 
     //=========================================================================================================
     /**
@@ -177,8 +207,10 @@ signals:
     * Signal which is emitted when new evoked stimulus data are available.
     *
     * @param[out] p_pEvokedStim     The evoked stimulus data
+    * @param[out] p_iSequence       Latency trace sequence number of the data segment which completed the
+    *                               epoch, -1 if unknown
     */
-    void evokedStim(FIFFLIB::FiffEvoked::SPtr p_pEvokedStim);
+    void evokedStim(FIFFLIB::FiffEvoked::SPtr p_pEvokedStim, qint32 p_iSequence);
 
 protected:
     //=========================================================================================================
@@ -192,21 +224,25 @@ protected:
 private:
     //=========================================================================================================
     /**
-    * Assemble the poststimulus
+    * Copies a data block into the raw history ring and registers the rising edges of the stimulus channels,
+    * sample by sample.
     *
-    * @param[in] p_qListRawMatBuf   List of raw buffers
-    * @param[in] p_iStimIdx         Stimulus index to investigate
+    * @param[in] p_matRawSegment    The data block
     */
-    void assemblePostStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx);
+    void appendToHistory(const MatrixXf &p_matRawSegment);
 
     //=========================================================================================================
     /**
-    * Assemble the prestimulus
+    * Cuts the epoch around a stimulus out of the raw history ring and adds it to the average of the stimulus
+    * channel: the evicted epoch is subtracted from the running sum and the new one is added, so each trial
+    * costs the same no matter how many epochs are averaged.
+    *
+    * @param[in] p_iStimIdx     Stimulus channel index (into m_qListStimChannelIdcs)
+    * @param[in] p_iStimSample  Absolute sample of the stimulus onset
     *
-    * @param[in] p_qListRawMatBuf   List of raw buffers
-    * @param[in] p_iStimIdx         Stimulus index to investigate
+    * @return true if a new average is available, false otherwise
     */
-    void assemblePreStimulus(const QList<QPair<QList<qint32>, MatrixXd> > &p_qListRawMatBuf, qint32 p_iStimIdx);
+    bool addEpoch(qint32 p_iStimIdx, qint64 p_iStimSample);
 
     FiffInfo::SPtr  m_pFiffInfo;        /**< Holds the fiff measurement information. */
 
@@ -218,7 +254,7 @@ private:
     qint32     m_iPreStimSamples;       /**< Amount of samples averaged before the stimulus. */
     qint32     m_iPostStimSamples;      /**< Amount of samples averaged after the stimulus, including the stimulus sample.*/
 
-    CircularMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;   /**< The Circular Raw Matrix Buffer. */
+    CircularMatrixBuffer<float>::SPtr m_pRawMatrixBuffer;    /**< The Circular Raw Matrix Buffer. */
 
     bool m_bAutoAspect; /**< Auto aspect detection on or off. */
 
@@ -227,12 +263,18 @@ private:
 
 //    QList<fiff_int_t>  m_qSetAspectKinds;   /**< List of aspects to average. Each aspect is averaged separetely and released stored in evoked data.*/
 
-    QList<QVector<MatrixXd> > m_qListQVectorPreStimBuf;     /**< assembles the pre stimulus data */
-    QList<QVector<MatrixXd> > m_qListQVectorPostStimBuf;    /**< assembles the post stimulus data */
+    float m_fAlpha;                         /**< Weight of the newest epoch of the exponentially weighted average; 0 for the moving average. */
+
+    MatrixXf m_matRawHistory;               /**< Ring of the last raw samples, the epochs are cut out of it. */
+    qint64 m_iNumSamples;                   /**< Number of samples received so far. */
+
+    QList<float> m_qListLastStimValue;      /**< Last sample of each stimulus channel, to detect rising edges across blocks. */
+    QList<QPair<qint32, qint64> > m_qListPendingStimuli;    /**< Stimuli (channel index, onset sample) waiting for their post stimulus samples. */
 
-    QList<MatrixXd> m_qListPreStimAve;     /**< the current pre stimulus average */
-    QList<MatrixXd> m_qListPostStimAve;    /**< the current post stimulus average */
-    QList<MatrixXd> m_qListStimAve;     /**< the current stimulus average */
+    QList<QVector<MatrixXf> > m_qListEpochs;    /**< Preallocated ring of the averaged epochs for each stimulus channel. */
+    QList<qint32> m_qListEpochIdx;          /**< Next epoch ring slot to overwrite for each stimulus channel. */
+    QList<qint32> m_qListNumEpochs;         /**< Number of epochs added for each stimulus channel. */
+    QList<MatrixXd> m_qListAveSum;          /**< Running sum of the epochs in the ring (moving average) or the average itself (exponential weighting). */
 };
 
 //*************************************************************************************************************
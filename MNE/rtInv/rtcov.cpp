@@ -44,6 +44,8 @@
 
 #include <iostream>
 #include <fiff/fiff_cov.h>
+#include <utils/parallel.h>
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -52,6 +54,15 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QQueue>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
 
 
 //*************************************************************************************************************
@@ -61,6 +72,7 @@
 
 using namespace RTINVLIB;
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -71,6 +83,9 @@ using namespace FIFFLIB;
 RtCov::RtCov(qint32 p_iMaxSamples, FiffInfo::SPtr p_pFiffInfo, QObject *parent)
 : QThread(parent)
 , m_iMaxSamples(p_iMaxSamples)
+, m_iWindowSamples(0)
+, m_dLambda(1.0)
+, m_iNumThreads(1)
 , m_pFiffInfo(p_pFiffInfo)
 , m_bIsRunning(false)
 {
@@ -88,14 +103,56 @@ RtCov::~RtCov()
 
 //*************************************************************************************************************
 
-void RtCov::append(const MatrixXd &p_DataSegment)
+void RtCov::append(const MatrixXd &p_DataSegment, qint32 p_iSequence)
+{
+    //
+    //  The data are processed in single precision, they are converted while they are pushed to the buffer
+    //
+    if(!m_pRawMatrixBuffer)
+        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(32, p_DataSegment.rows(), p_DataSegment.cols()));
+
+    m_pRawMatrixBuffer->push(&p_DataSegment, p_iSequence);
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::append(const MatrixXf &p_DataSegment, qint32 p_iSequence)
 {
 //    if(m_pRawMatrixBuffer) // ToDo handle change buffersize
 
     if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(32, p_DataSegment.rows(), p_DataSegment.cols()));
+        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(32, p_DataSegment.rows(), p_DataSegment.cols()));
+
+    m_pRawMatrixBuffer->push(&p_DataSegment, p_iSequence);
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::setSlidingWindow(qint32 p_iWindowSamples)
+{
+    m_iWindowSamples = p_iWindowSamples > 0 ? p_iWindowSamples : 0;
+    if(m_iWindowSamples > 0)
+        m_dLambda = 1.0;
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::setForgettingFactor(double p_dLambda)
+{
+    m_dLambda = p_dLambda > 0.0 && p_dLambda < 1.0 ? p_dLambda : 1.0;
+    if(m_dLambda < 1.0)
+        m_iWindowSamples = 0;
+}
+
+
+//*************************************************************************************************************
 
-    m_pRawMatrixBuffer->push(&p_DataSegment);
+void RtCov::setThreads(qint32 p_iNumThreads)
+{
+    m_iNumThreads = p_iNumThreads > 0 ? p_iNumThreads : 1;
 }
 
 
@@ -116,35 +173,72 @@ void RtCov::run()
 {
     m_bIsRunning = true;
 
-
     quint32 n_samples = 0;
 
-    FiffCov::SPtr cov(new FiffCov());
-    VectorXd mu;
+    //
+    // Running statistics
+    //
+    double t_dWeight = 0;
+    VectorXd t_vecMean;
+    MatrixXd t_matScatter;
+
+    VectorXd t_vecBlockMean;
+    MatrixXd t_matBlockScatter;
+
+    QQueue<MatrixXf> t_qQueueWindow;
+    qint32 t_iWindowSize = 0;
+
+    bool t_bReset = m_iWindowSamples == 0 && m_dLambda == 1.0;
+
+    MatrixXf rawSegment;
+    qint32 t_iSequence = -1;
+
+    LatencyTracer* t_pTracer = LatencyTracer::stage("RtCov");
 
     while(m_bIsRunning)
     {
-        if(m_pRawMatrixBuffer)
+        // don't block forever, stop() has to be able to end the thread
+        if(m_pRawMatrixBuffer && m_pRawMatrixBuffer->tryPop(rawSegment, 100, &t_iSequence))
         {
-            MatrixXd rawSegment = m_pRawMatrixBuffer->pop();
+            qint64 t_iEnter = LatencyTracer::now();
 
-            if(n_samples == 0)
+            this->blockStatistics(rawSegment, t_vecBlockMean, t_matBlockScatter);
+
+            if(m_dLambda < 1.0 && t_dWeight > 0)
             {
-                mu = rawSegment.rowwise().sum();
-                cov->data = rawSegment * rawSegment.transpose();
+                double t_dForget = pow(m_dLambda, (double)rawSegment.cols());
+                t_dWeight *= t_dForget;
+                t_matScatter *= t_dForget;
             }
-            else
+
+            mergeStatistics(t_dWeight, t_vecMean, t_matScatter, rawSegment.cols(), t_vecBlockMean, t_matBlockScatter);
+
+            //
+            // Drop the oldest blocks which are not needed to fill the window anymore
+            //
+            if(m_iWindowSamples > 0)
             {
-                mu.array() += rawSegment.rowwise().sum().array();
-                cov->data += rawSegment * rawSegment.transpose();
+                t_qQueueWindow.enqueue(rawSegment);
+                t_iWindowSize += rawSegment.cols();
+
+                while(t_iWindowSize - t_qQueueWindow.head().cols() >= m_iWindowSamples)
+                {
+                    MatrixXf t_matOldest = t_qQueueWindow.dequeue();
+                    t_iWindowSize -= t_matOldest.cols();
+
+                    this->blockStatistics(t_matOldest, t_vecBlockMean, t_matBlockScatter);
+                    mergeStatistics(t_dWeight, t_vecMean, t_matScatter, t_matOldest.cols(), t_vecBlockMean, t_matBlockScatter, true);
+                }
             }
+
             n_samples += rawSegment.cols();
 
-            if(n_samples > m_iMaxSamples)
+            if(n_samples > m_iMaxSamples && t_dWeight > 1)
             {
-                mu /= (float)n_samples;
-                cov->data.array() -= n_samples * (mu * mu.transpose()).array();
-                cov->data.array() /= (n_samples - 1);
+                FiffCov::SPtr cov(new FiffCov());
+
+                cov->data = t_matScatter.selfadjointView<Lower>();
+                cov->data.array() /= (t_dWeight - 1);
 
                 cov->kind = FIFFV_MNE_NOISE_COV;
                 cov->diag = false;
@@ -154,29 +248,106 @@ void RtCov::run()
                 cov->names = m_pFiffInfo->ch_names;
                 cov->projs = m_pFiffInfo->projs;
                 cov->bads  = m_pFiffInfo->bads;
-                cov->nfree  = n_samples;
+                cov->nfree  = (qint32)t_dWeight;
 
                 // regularize noise covariance
                 *cov.data() = cov->regularize(*m_pFiffInfo, 0.05, 0.05, 0.1, true);
 
                 emit covCalculated(cov);
 
-                cov = FiffCov::SPtr(new FiffCov());
                 n_samples = 0;
+                if(t_bReset)
+                    t_dWeight = 0;
             }
 
+            t_pTracer->record(t_iEnter, t_iSequence, m_pRawMatrixBuffer->available());
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::blockStatistics(const MatrixXf &p_matBlock, VectorXd &p_vecMean, MatrixXd &p_matScatter) const
+{
+    qint32 nchan = p_matBlock.rows();
+
+    VectorXf t_vecMean = p_matBlock.rowwise().sum() / (float)p_matBlock.cols();
+    MatrixXf t_matCentered = p_matBlock.colwise() - t_vecMean;
+    MatrixXf t_matScatter = MatrixXf::Zero(nchan, nchan);
+
+    if(m_iNumThreads > 1 && nchan >= 2 * m_iNumThreads)
+    {
+        ScatterAccumulate t_accumulate;
+        t_accumulate.pCentered = &t_matCentered;
+        t_accumulate.pScatter = &t_matScatter;
+        t_accumulate.iNumPanels = m_iNumThreads;
+
+        Parallel::parallelFor(m_iNumThreads, 1, t_accumulate);
+    }
+    else
+        t_matScatter.selfadjointView<Lower>().rankUpdate(t_matCentered);
+
+    p_vecMean = t_vecMean.cast<double>();
+    p_matScatter = t_matScatter.cast<double>();
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::ScatterAccumulate::operator()(qint32 p_iFirst, qint32 p_iNum) const
+{
+    qint32 nchan = pCentered->rows();
+
+    for(qint32 k = p_iFirst; k < p_iFirst + p_iNum; ++k)
+    {
+        qint32 t_iFirstRow = (qint32)(nchan * sqrt((double)k / iNumPanels));
+        qint32 t_iEnd = k + 1 == iNumPanels ? nchan : (qint32)(nchan * sqrt((double)(k + 1) / iNumPanels));
+        if(t_iEnd <= t_iFirstRow)
+            continue;
+
+        pScatter->block(t_iFirstRow, 0, t_iEnd - t_iFirstRow, t_iEnd).noalias() = pCentered->middleRows(t_iFirstRow, t_iEnd - t_iFirstRow) * pCentered->topRows(t_iEnd).transpose();
+    }
+}
 
-//            qint32 samples = rawSegment.cols();
-//            VectorXf mu = rawSegment.rowwise().sum().array() / (float)samples;
 
-//            MatrixXf noise_covariance = rawSegment * rawSegment.transpose();// noise_covariance == raw_covariance
-//            noise_covariance.array() -= samples * (mu * mu.transpose()).array();
-//            noise_covariance.array() /= (samples - 1);
+//*************************************************************************************************************
 
-//            std::cout << "Noise Covariance:\n" << noise_covariance.block(0,0,10,10) << std::endl;
+void RtCov::mergeStatistics(double &p_dWeight, VectorXd &p_vecMean, MatrixXd &p_matScatter, double p_dBlockWeight, const VectorXd &p_vecBlockMean, const MatrixXd &p_matBlockScatter, bool p_bRemove)
+{
+    if(!p_bRemove)
+    {
+        if(p_dWeight <= 0)
+        {
+            p_dWeight = p_dBlockWeight;
+            p_vecMean = p_vecBlockMean;
+            p_matScatter = p_matBlockScatter;
+            return;
+        }
 
-//            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
+        double t_dWeight = p_dWeight + p_dBlockWeight;
+        VectorXd t_vecDelta = p_vecBlockMean - p_vecMean;
 
+        p_matScatter += p_matBlockScatter;
+        p_matScatter.selfadjointView<Lower>().rankUpdate(t_vecDelta, p_dWeight * p_dBlockWeight / t_dWeight);
+        p_vecMean += (p_dBlockWeight / t_dWeight) * t_vecDelta;
+        p_dWeight = t_dWeight;
+    }
+    else
+    {
+        double t_dWeight = p_dWeight - p_dBlockWeight;
+        if(t_dWeight <= 0)
+        {
+            p_dWeight = 0;
+            return;
         }
+
+        VectorXd t_vecMean = (p_dWeight * p_vecMean - p_dBlockWeight * p_vecBlockMean) / t_dWeight;
+        VectorXd t_vecDelta = p_vecBlockMean - t_vecMean;
+
+        p_matScatter -= p_matBlockScatter;
+        p_matScatter.selfadjointView<Lower>().rankUpdate(t_vecDelta, -t_dWeight * p_dBlockWeight / p_dWeight);
+        p_vecMean = t_vecMean;
+        p_dWeight = t_dWeight;
     }
 }
@@ -100,7 +100,13 @@ using namespace FIFFLIB;
 
 //=============================================================================================================
 /**
-* Real-time covariance estimation
+* Real-time covariance estimation. Each incoming block is reduced to its mean and its centered scatter matrix
+* (a symmetric rank-k update of the lower triangle) and merged into the running statistics in double precision
+* (Chan et al.), which avoids the cancellation of the sum of squares minus squared sum formula.
+*
+* By default a covariance is estimated from every p_iMaxSamples samples and the statistics are reset. With a
+* sliding window or an exponential forgetting factor the statistics are kept and a fresh covariance is emitted
+* every p_iMaxSamples samples.
 *
 * @brief Real-time covariance estimation
 */
@@ -129,11 +135,49 @@ public:
 
     //=========================================================================================================
     /**
-    * Slot to receive incoming data.
+    * Slot to receive incoming double precision data. They are converted to single precision while they are
+    * pushed to the input buffer, without a converted copy.
+    *
+    * @param[in] p_DataSegment  Data to estimate the covariance from
+    * @param[in] p_iSequence    (optional) Latency trace sequence number of the data, -1 if unknown (default)
+    */
+    void append(const MatrixXd &p_DataSegment, qint32 p_iSequence = -1);
+
+    //=========================================================================================================
+    /**
+    * Slot to receive incoming data, the data are processed in single precision.
+    *
+    * @param[in] p_DataSegment  Data to estimate the covariance from
+    * @param[in] p_iSequence    (optional) Latency trace sequence number of the data, -1 if unknown (default)
+    */
+    void append(const MatrixXf &p_DataSegment, qint32 p_iSequence = -1);
+
+    //=========================================================================================================
+    /**
+    * Estimates the covariance from the last p_iWindowSamples samples (at least; whole blocks are dropped)
+    * instead of resetting after each estimate. Has to be called before start().
     *
-    * @param[in] p_DataSegment  Data to estimate the covariance from -> ToDo Replace this by shared data pointer
+    * @param[in] p_iWindowSamples   Window length in samples; 0 switches the sliding window off
     */
-    void append(const MatrixXd &p_DataSegment);
+    void setSlidingWindow(qint32 p_iWindowSamples);
+
+    //=========================================================================================================
+    /**
+    * Weights the samples exponentially: each new sample down weights the statistics gathered so far by
+    * p_dLambda, instead of resetting after each estimate. Has to be called before start().
+    *
+    * @param[in] p_dLambda  Forgetting factor per sample (0 < lambda < 1, e.g. 0.9999); 1 switches forgetting off
+    */
+    void setForgettingFactor(double p_dLambda);
+
+    //=========================================================================================================
+    /**
+    * Sets the number of threads used to accumulate the scatter matrix of a block. The lower triangle is split
+    * into row panels of equal size which are updated concurrently. Has to be called before start().
+    *
+    * @param[in] p_iNumThreads  Number of threads; 1 accumulates in the RtCov thread
+    */
+    void setThreads(qint32 p_iNumThreads);
 
     //=========================================================================================================
     /**
@@ -151,6 +195,32 @@ public:
     */
     inline bool isRunning();
 
+    //=========================================================================================================
+    /**
+    * Computes the mean and the centered scatter matrix (lower triangle) of a data block. Used by the estimation
+    * thread; public, so the statistics can be checked on their own.
+    *
+    * @param[in] p_matBlock     Data block (channels x samples)
+    * @param[out] p_vecMean     Mean of the block
+    * @param[out] p_matScatter  Centered scatter matrix; only the lower triangle is valid
+    */
+    void blockStatistics(const MatrixXf &p_matBlock, VectorXd &p_vecMean, MatrixXd &p_matScatter) const;
+
+    //=========================================================================================================
+    /**
+    * Merges the statistics of a block into the running statistics or removes them again. Only the lower
+    * triangles of the scatter matrices are used.
+    *
+    * @param[in, out] p_dWeight     Number of (weighted) samples of the running statistics
+    * @param[in, out] p_vecMean     Mean of the running statistics
+    * @param[in, out] p_matScatter  Centered scatter matrix of the running statistics
+    * @param[in] p_dBlockWeight     Number of samples of the block
+    * @param[in] p_vecBlockMean     Mean of the block
+    * @param[in] p_matBlockScatter  Centered scatter matrix of the block
+    * @param[in] p_bRemove          Remove the block statistics instead of merging them
+    */
+    static void mergeStatistics(double &p_dWeight, VectorXd &p_vecMean, MatrixXd &p_matScatter, double p_dBlockWeight, const VectorXd &p_vecBlockMean, const MatrixXd &p_matBlockScatter, bool p_bRemove = false);
+
 signals:
     //=========================================================================================================
     /**
@@ -170,14 +240,38 @@ protected:
     virtual void run();
 
 private:
+    //=========================================================================================================
+    /**
+    * Accumulates row panels of equal area of the lower triangle of a scatter matrix, for multi-threaded
+    * computation: the k-th of n panels ends at row nchan * sqrt(k/n).
+    */
+    struct ScatterAccumulate
+    {
+        const MatrixXf* pCentered;  /**< Centered data block. */
+        MatrixXf* pScatter;         /**< Scatter matrix to write the rows of the panels to. */
+        qint32 iNumPanels;          /**< Number of panels the lower triangle is split into. */
+
+        //=====================================================================================================
+        /**
+        * Computes the rows of the panels p_iFirst ... p_iFirst+p_iNum-1.
+        *
+        * @param[in] p_iFirst   First panel
+        * @param[in] p_iNum     Number of panels
+        */
+        void operator()(qint32 p_iFirst, qint32 p_iNum) const;
+    };
+
     FiffInfo::SPtr  m_pFiffInfo;        /**< Holds the fiff measurement information. */
 
     QMutex      mutex;                  /**< Provides access serialization between threads*/
     bool        m_bIsRunning;           /**< Holds if real-time Covariance estimation is running.*/
 
     quint32      m_iMaxSamples;         /**< Maximal amount of samples received, before covariance is estimated.*/
+    qint32       m_iWindowSamples;      /**< Length of the sliding window; 0 if off.*/
+    double       m_dLambda;             /**< Exponential forgetting factor per sample; 1 if off.*/
+    qint32       m_iNumThreads;         /**< Number of threads accumulating the scatter matrix.*/
 
-    CircularMatrixBuffer<double>::SPtr m_pRawMatrixBuffer;   /**< The Circular Raw Matrix Buffer. */
+    CircularMatrixBuffer<float>::SPtr m_pRawMatrixBuffer;    /**< The Circular Raw Matrix Buffer. */
 };
 
 //*************************************************************************************************************
@@ -41,6 +41,8 @@
 
 #include "rtinvop.h"
 
+#include <utils/latencytracer.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -49,6 +51,7 @@
 
 
 #include <QDebug>
+#include <QElapsedTimer>
 
 
 //*************************************************************************************************************
@@ -57,6 +60,7 @@
 //=============================================================================================================
 
 using namespace RTINVLIB;
+using namespace UTILSLIB;
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -65,8 +69,11 @@ using namespace RTINVLIB;
 
 RtInvOp::RtInvOp(FiffInfo::SPtr &p_pFiffInfo, MNEForwardSolution::SPtr &p_pFwd, QObject *parent)
 : QThread(parent)
+, m_bIsRunning(false)
 , m_pFiffInfo(p_pFiffInfo)
 , m_pFwd(p_pFwd)
+, m_bForwardMegPicked(false)
+, m_iRebuildTime(-1)
 {
     qRegisterMetaType<MNEInverseOperator::SPtr>("MNEInverseOperator::SPtr");
 }
@@ -84,11 +91,34 @@ RtInvOp::~RtInvOp()
 
 void RtInvOp::appendNoiseCov(FiffCov::SPtr p_pNoiseCov)
 {
-    mutex.lock();
-    //Use here a circular buffer
-    m_vecNoiseCov.push_back(p_pNoiseCov);
+    QMutexLocker locker(&mutex);
+
+    // only the newest covariance matters, drop one which wasn't processed yet
+    m_pNoiseCov = p_pNoiseCov;
+    m_waitNoiseCov.wakeOne();
+}
+
 
+//*************************************************************************************************************
+
+qint64 RtInvOp::lastRebuildTime()
+{
+    QMutexLocker locker(&mutex);
+    return m_iRebuildTime;
+}
+
+
+//*************************************************************************************************************
+
+bool RtInvOp::start()
+{
+    mutex.lock();
+    m_bIsRunning = true;
     mutex.unlock();
+
+    QThread::start();
+
+    return true;
 }
 
 
@@ -96,7 +126,11 @@ void RtInvOp::appendNoiseCov(FiffCov::SPtr p_pNoiseCov)
 
 bool RtInvOp::stop()
 {
+    mutex.lock();
     m_bIsRunning = false;
+    m_waitNoiseCov.wakeAll();
+    mutex.unlock();
+
     QThread::wait();
 
     return true;
@@ -107,22 +141,45 @@ bool RtInvOp::stop()
 
 void RtInvOp::run()
 {
-    m_bIsRunning = true;
+    // Restrict forward solution as necessary for MEG; the forward solution doesn't change
+    if(!m_bForwardMegPicked)
+    {
+        m_forwardMeg = m_pFwd->pick_types(true, false);
+        m_bForwardMegPicked = true;
+    }
+
+    QElapsedTimer t_timer;
+    LatencyTracer* t_pTracer = LatencyTracer::stage("RtInvOp");
 
-    while(m_bIsRunning)
+    while(true)
     {
-        if(m_vecNoiseCov.size() > 0)
+        mutex.lock();
+        while(m_bIsRunning && m_pNoiseCov.isNull())
+            m_waitNoiseCov.wait(&mutex);
+
+        if(!m_bIsRunning)
         {
-            // Restrict forward solution as necessary for MEG
-            MNEForwardSolution t_forwardMeg = m_pFwd->pick_types(true, false);
+            mutex.unlock();
+            break;
+        }
 
-            MNEInverseOperator::SPtr t_invOpMeg(new MNEInverseOperator(*m_pFiffInfo.data(), t_forwardMeg, *m_vecNoiseCov[0].data(), 0.2f, 0.8f));
+        FiffCov::SPtr t_pNoiseCov = m_pNoiseCov;
+        m_pNoiseCov.clear();
+        mutex.unlock();
 
-            mutex.lock();
-            m_vecNoiseCov.pop_front();
-            mutex.unlock();
+        t_timer.start();
+        qint64 t_iEnter = LatencyTracer::now();
 
-            emit invOperatorCalculated(t_invOpMeg);
-        }
+        // the Gram route is accurate down to sqrt(eps) of the largest singular value, far below the regularization
+        MNEInverseOperator::SPtr t_invOpMeg(new MNEInverseOperator(*m_pFiffInfo.data(), m_forwardMeg, *t_pNoiseCov.data(), 0.2f, 0.8f, false, true, "gram"));
+
+        qint64 t_iRebuildTime = t_timer.elapsed();
+
+        mutex.lock();
+        m_iRebuildTime = t_iRebuildTime;
+        mutex.unlock();
+
+        emit invOperatorCalculated(t_invOpMeg);
+        t_pTracer->record(t_iEnter);
     }
 }
@@ -67,6 +67,7 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QSharedPointer>
 
 
@@ -99,7 +100,8 @@ using namespace MNELIB;
 
 //=============================================================================================================
 /**
-* Real-time inverse dSPM, sLoreta inverse operator estimation
+* Real-time inverse dSPM, sLoreta inverse operator estimation. The worker sleeps until a noise covariance
+* arrives; covariances which arrive while an operator is built are coalesced, only the newest one is used.
 *
 * @brief Real-time inverse operator estimation
 */
@@ -128,12 +130,22 @@ public:
 
     //=========================================================================================================
     /**
-    * Slot to receive incoming noise covariance estimations.
+    * Slot to receive incoming noise covariance estimations. A pending covariance, which was not processed yet,
+    * is replaced.
     *
     * @param[in] p_pNoiseCov     Noise covariance estimation
     */
     void appendNoiseCov(FiffCov::SPtr p_pNoiseCov);
 
+    //=========================================================================================================
+    /**
+    * Starts the RtInv by starting the producer's thread. The running flag is set before the thread starts, so a
+    * stop() right after start() can't be overridden by the thread.
+    *
+    * @return true if succeeded, false otherwise
+    */
+    virtual bool start();
+
     //=========================================================================================================
     /**
     * Stops the RtInv by stopping the producer's thread.
@@ -150,6 +162,14 @@ public:
     */
     inline bool isRunning();
 
+    //=========================================================================================================
+    /**
+    * Returns the time it took to build the last inverse operator.
+    *
+    * @return the duration of the last rebuild in milliseconds; -1 if no operator was built yet
+    */
+    qint64 lastRebuildTime();
+
 signals:
     //=========================================================================================================
     /**
@@ -170,12 +190,17 @@ protected:
 
 private:
     QMutex      mutex;                  /**< Provides access serialization between threads. */
+    QWaitCondition m_waitNoiseCov;      /**< Wakes the worker when a noise covariance arrives or RtInv is stopped. */
     bool        m_bIsRunning;           /**< Whether RtInv is running. */
 
-    QVector<FiffCov::SPtr> m_vecNoiseCov;/**< Noise covariance matrices. */
+    FiffCov::SPtr m_pNoiseCov;          /**< The newest noise covariance which was not processed yet. */
 
     FiffInfo::SPtr m_pFiffInfo;         /**< The fiff measurement information. */
     MNEForwardSolution::SPtr m_pFwd;    /**< The forward solution. */
+    MNEForwardSolution m_forwardMeg;    /**< The forward solution restricted to MEG, picked once. */
+    bool        m_bForwardMegPicked;    /**< Whether m_forwardMeg was picked. */
+
+    qint64      m_iRebuildTime;         /**< Duration of the last inverse operator rebuild in milliseconds. */
 };
 
 //*************************************************************************************************************
@@ -50,6 +50,7 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QtEndian>
 
 
 //*************************************************************************************************************
@@ -60,6 +61,14 @@
 #include <Eigen/Core>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <string.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE NAMESPACE FSLIB
@@ -194,13 +203,116 @@ public:
     * @return swapped double
     */
     static void swap_doublep(double *source);
+
+    //=========================================================================================================
+    /**
+    * Swaps the byte order of a whole array in place, the bulk version of swap_intp, swap_floatp, etc.
+    *
+    * @param[in, out] p_pData   Array of 2, 4 or 8 byte elements to swap
+    * @param[in] p_iCount       Number of elements
+    */
+    template<typename T>
+    static void swap_array(T* p_pData, qint64 p_iCount);
+
+    //=========================================================================================================
+    /**
+    * Copies an array to a raw buffer in big endian byte order, i.e. the bytes are swapped on little endian hosts.
+    *
+    * @param[in] p_pSource      Array of 2, 4 or 8 byte elements
+    * @param[in] p_iCount       Number of elements
+    * @param[out] p_pDest       Destination buffer of at least p_iCount*sizeof(T) bytes
+    */
+    template<typename T>
+    static void to_big_endian(const T* p_pSource, qint64 p_iCount, char* p_pDest);
+
+    //=========================================================================================================
+    /**
+    * Copies a raw buffer in big endian byte order to an array, the counterpart of to_big_endian. The source
+    * doesn't need to be aligned, so it can point right into a receive buffer.
+    *
+    * @param[in] p_pSource      Source buffer of at least p_iCount*sizeof(T) bytes
+    * @param[in] p_iCount       Number of elements
+    * @param[out] p_pDest       Array of 2, 4 or 8 byte elements
+    */
+    template<typename T>
+    static void from_big_endian(const char* p_pSource, qint64 p_iCount, T* p_pDest);
+
+private:
+    //=========================================================================================================
+    /**
+    * Unsigned integer of the given size, the elements are swapped as such to avoid the per byte shuffling.
+    */
+    template<int Size> struct SwapWord;
 };
 
+template<> struct IOUtils::SwapWord<2> { typedef quint16 Type; };
+template<> struct IOUtils::SwapWord<4> { typedef quint32 Type; };
+template<> struct IOUtils::SwapWord<8> { typedef quint64 Type; };
+
 //*************************************************************************************************************
 //=============================================================================================================
 // INLINE DEFINITIONS
 //=============================================================================================================
 
+template<typename T>
+inline void IOUtils::swap_array(T* p_pData, qint64 p_iCount)
+{
+    typedef typename SwapWord<sizeof(T)>::Type Word;
+    char* t_pBytes = reinterpret_cast<char*>(p_pData);
+    Word t_word;
+
+    for(qint64 i = 0; i < p_iCount; ++i, t_pBytes += sizeof(Word))
+    {
+        memcpy(&t_word, t_pBytes, sizeof(Word));
+        t_word = qbswap(t_word);
+        memcpy(t_pBytes, &t_word, sizeof(Word));
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+inline void IOUtils::to_big_endian(const T* p_pSource, qint64 p_iCount, char* p_pDest)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    memcpy(p_pDest, p_pSource, p_iCount*sizeof(T));
+#else
+    typedef typename SwapWord<sizeof(T)>::Type Word;
+    const char* t_pBytes = reinterpret_cast<const char*>(p_pSource);
+    Word t_word;
+
+    for(qint64 i = 0; i < p_iCount; ++i, t_pBytes += sizeof(Word), p_pDest += sizeof(Word))
+    {
+        memcpy(&t_word, t_pBytes, sizeof(Word));
+        t_word = qbswap(t_word);
+        memcpy(p_pDest, &t_word, sizeof(Word));
+    }
+#endif
+}
+
+
+//*************************************************************************************************************
+
+template<typename T>
+inline void IOUtils::from_big_endian(const char* p_pSource, qint64 p_iCount, T* p_pDest)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    memcpy(p_pDest, p_pSource, p_iCount*sizeof(T));
+#else
+    typedef typename SwapWord<sizeof(T)>::Type Word;
+    char* t_pBytes = reinterpret_cast<char*>(p_pDest);
+    Word t_word;
+
+    for(qint64 i = 0; i < p_iCount; ++i, p_pSource += sizeof(Word), t_pBytes += sizeof(Word))
+    {
+        memcpy(&t_word, p_pSource, sizeof(Word));
+        t_word = qbswap(t_word);
+        memcpy(t_pBytes, &t_word, sizeof(Word));
+    }
+#endif
+}
+
 
 } // NAMESPACE
 
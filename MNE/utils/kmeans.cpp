@@ -59,6 +59,7 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QtGlobal>
 
 
 //*************************************************************************************************************
@@ -74,17 +75,43 @@ using namespace UTILSLIB;
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
-KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit)
+KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit, qint32 seed)
 : m_sDistance(distance)
 , m_sStart(start)
 , m_iReps(replicates)
 , m_sEmptyact(emptyact)
 , m_iMaxit(maxit)
+, m_iSeed(seed)
+, m_iBatchSize(0)
 , m_bOnline(online)
 {
     // Assume one replicate
     if (m_iReps < 1)
         m_iReps = 1;
+
+    if(m_sDistance.compare("cityblock") == 0)
+        m_distance = Cityblock;
+    else if(m_sDistance.compare("cosine") == 0)
+        m_distance = Cosine;
+    else if(m_sDistance.compare("correlation") == 0)
+        m_distance = Correlation;
+    else if(m_sDistance.compare("hamming") == 0)
+        m_distance = Hamming;
+    else
+    {
+        if(m_sDistance.compare("sqeuclidean") != 0)
+            printf("Warning: Unknown distance %s, using sqeuclidean.\n", m_sDistance.toLatin1().constData());
+        m_sDistance = QString("sqeuclidean");
+        m_distance = SqEuclidean;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void KMeans::setMiniBatch(qint32 p_iBatchSize)
+{
+    m_iBatchSize = p_iBatchSize > 0 ? p_iBatchSize : 0;
 }
 
 
@@ -95,25 +122,25 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
     if (kClusters < 1)
         return false;
 
-    //Init random generator
-    srand ( time(NULL) );
+    //Init random generator; qrand is thread-safe and its sequence is per thread
+    qsrand(m_iSeed >= 0 ? (uint)m_iSeed : (uint)time(NULL));
 
 // n points in p dimensional space
     k = kClusters;
     n = X.rows();
     p = X.cols();
 
-    if(m_sDistance.compare("cosine") == 0)
+    if(m_distance == Cosine)
     {
-//        Xnorm = sqrt(sum(X.^2, 2));
+        VectorXd Xnorm = X.rowwise().norm();//sqrt(sum(X.^2, 2));
 //        if any(min(Xnorm) <= eps(max(Xnorm)))
 //            error(['Some points have small relative magnitudes, making them ', ...
 //                   'effectively zero.\nEither remove those points, or choose a ', ...
 //                   'distance other than ''cosine''.']);
 //        end
-//        X = X ./ Xnorm(:,ones(1,p));
+        X = Xnorm.cwiseInverse().asDiagonal() * X;//X = X ./ Xnorm(:,ones(1,p));
     }
-    else if(m_sDistance.compare("correlation")==0)
+    else if(m_distance == Correlation)
     {
         X.array() -= (X.rowwise().sum().array() / (double)p).replicate(1,p); //X - X.rowwise().sum();//.repmat(mean(X,2),1,p);
         MatrixXd Xnorm = (X.array().pow(2).rowwise().sum()).sqrt();//sqrt(sum(X.^2, 2));
@@ -131,12 +158,15 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 //        end
 //    }
 
+    if(m_distance == SqEuclidean)
+        normX2 = X.rowwise().squaredNorm();
+
     // Start
     RowVectorXd Xmins;
     RowVectorXd Xmaxs;
     if (m_sStart.compare("uniform") == 0)
     {
-        if (m_sDistance.compare("hamming") == 0)
+        if (m_distance == Hamming)
         {
             printf("Error: Uniform Start For Hamming\n");
             return false;
@@ -174,14 +204,18 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
             // of the unit hypersphere.  Still need to center them for
             // 'correlation'.  (Re)normalization for 'cosine'/'correlation' is
             // done at each iteration.
-            if (m_sDistance.compare("correlation") == 0)
+            if (m_distance == Correlation)
                 C.array() -= (C.array().rowwise().sum()/p).replicate(1, p).array();
         }
+        else if (m_sStart.compare("plus") == 0)
+        {
+            seedPlusPlus(X, C);
+        }
         else if (m_sStart.compare("sample") == 0)
         {
             C = MatrixXd::Zero(k,p);
             for(qint32 i = 0; i < k; ++i)
-                C.block(i,0,1,p) = X.block(rand() % n, 0, 1, p);
+                C.block(i,0,1,p) = X.block(qrand() % n, 0, 1, p);
             // DEBUG
 //            C.block(0,0,1,p) = X.block(2, 0, 1, p);
 //            C.block(1,0,1,p) = X.block(7, 0, 1, p);
@@ -214,12 +248,20 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 
         try // catch empty cluster errors and move on to next rep
         {
-            // Begin phase one:  batch reassignments
-            bool converged = batchUpdate(X, C, idx);
+            bool converged;
+            if(m_iBatchSize > 0 && m_iBatchSize < n && m_distance == SqEuclidean)
+            {
+                converged = miniBatchUpdate(X, C, idx);
+            }
+            else
+            {
+                // Begin phase one:  batch reassignments
+                converged = batchUpdate(X, C, idx);
 
-            // Begin phase two:  single reassignments
-            if (m_bOnline)
-                converged = onlineUpdate(X, C, idx);
+                // Begin phase two:  single reassignments
+                if (m_bOnline)
+                    converged = onlineUpdate(X, C, idx);
+            }
 
             if (!converged)
                 printf("Failed To Converge during replicate %d\n", rep);
@@ -367,7 +409,7 @@ bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
         // Deal with clusters that have just lost all their members
         VectorXi empties = VectorXi::Zero(changed.rows());
         for(qint32 i = 0; i < changed.rows(); ++i)
-            if(m(i) == 0)
+            if(m[changed[i]] == 0)
                 empties[i] = 1;
 
         if (empties.sum() > 0)
@@ -426,8 +468,11 @@ bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
             MatrixXd C_new;
             VectorXi m_new;
             gcentroids(X, idx, changed, C_new, m_new);
-            C.block(0,0,k,C.cols()) = C_new;
-            m.block(0,0,k,1) = m_new;
+            for(qint32 i = 0; i < changed.rows(); ++i)
+            {
+                C.row(changed[i]) = C_new.row(i);
+                m[changed[i]] = m_new[i];
+            }
             --iter;
             break;
         }
@@ -514,7 +559,8 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
     // Initialize some cluster information prior to phase two
     MatrixXd Xmid1;
     MatrixXd Xmid2;
-    if (m_sDistance.compare("cityblock") == 0)
+    MatrixXd Xsum;
+    if (m_distance == Cityblock)
     {
         Xmid1 = MatrixXd::Zero(k,p);
         Xmid2 = MatrixXd::Zero(k,p);
@@ -556,15 +602,12 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
             }
         }
     }
-    else if (m_sDistance.compare("hamming") == 0)
+    else if (m_distance == Hamming)
     {
-//    Xsum = zeros(k,p);
-//    for i = 1:k
-//        if m(i) > 0
-//            % Sum coords for points in i'th cluster, component-wise
-//            Xsum(i,:) = sum(X(idx==i,:), 1);
-//        end
-//    end
+        // Sum coords for points in each cluster, component-wise
+        Xsum = MatrixXd::Zero(k,p);
+        for(qint32 j = 0; j < idx.rows(); ++j)
+            Xsum.row(idx[j]) += X.row(j);
     }
 
     //
@@ -599,7 +642,7 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
         // point will stay in its own cluster.  Happily, we get
         // Del(i,idx(i)) == 0 automatically for them.
 
-        if (m_sDistance.compare("sqeuclidean") == 0)
+        if (m_distance == SqEuclidean)
         {
             for(qint32 j = 0; j < changed.rows(); ++j)
             {
@@ -618,10 +661,12 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
                 Del.col(i) = ((double)m[i] / ((double)m[i] + sgn.cast<double>().array()));
 
-                Del.col(i).array() *= (X - C.row(i).replicate(n,1)).array().pow(2).rowwise().sum().array();
+                VectorXd t_vecDist = normX2 - 2.0 * X * C.row(i).transpose();
+                t_vecDist.array() += C.row(i).squaredNorm();
+                Del.col(i).array() *= (t_vecDist.array() < 0.0).select(0.0, t_vecDist).array();
             }
         }
-        else if (m_sDistance.compare("cityblock") == 0)
+        else if (m_distance == Cityblock)
         {
             for(qint32 j = 0; j < changed.rows(); ++j)
             {
@@ -650,7 +695,7 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                     Del.col(i) = ((X - C.row(i).replicate(n,1)).array().abs()).rowwise().sum();
             }
         }
-        else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+        else if (m_distance == Cosine || m_distance == Correlation)
         {
             // The points are normalized, centroids are not, so normalize them
             MatrixXd normC = C.array().pow(2).rowwise().sum().sqrt();
@@ -678,31 +723,34 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
                 Del.col(i) = 1 + sgn.cast<double>().array()*
                         (A - (B + 2 * sgn.cast<double>().array() * m[i] * XCi.array() + 1).sqrt());
-
-                std::cout << "Del.col(i)\n" << Del.col(i) << std::endl;
-
-
-
-//                Del(:,i) = 1 + sgn .*...
-//                      (m(i).*normC(i) - sqrt((m(i).*normC(i)).^2 + 2.*sgn.*m(i).*XCi + 1));
             }
         }
-        else if (m_sDistance.compare("hamming") == 0)
+        else if (m_distance == Hamming)
         {
-//            for i = changed
-//                if mod(m(i),2) == 0 % this will never catch singleton clusters
-//                    % coords with an unequal number of 0s and 1s have a
-//                    % different contribution than coords with an equal
-//                    % number
-//                    unequal01 = find(2*Xsum(i,:) ~= m(i));
-//                    numequal01 = p - length(unequal01);
-//                    mbrs = (idx == i);
-//                    Di = abs(X(:,unequal01) - C(repmat(i,n,1),unequal01));
-//                    Del(:,i) = (sum(Di, 2) + mbrs*numequal01) / p;
-//                else
-//                    Del(:,i) = sum(abs(X - C(repmat(i,n,1),:)), 2) / p;
-//                end
-//            end
+            for(qint32 j = 0; j < changed.rows(); ++j)
+            {
+                qint32 i = changed[j];
+                if (m[i] % 2 == 0) // this will never catch singleton clusters
+                {
+                    // coords with an unequal number of 0s and 1s have a
+                    // different contribution than coords with an equal number
+                    Del.col(i) = VectorXd::Zero(n);
+                    qint32 numequal01 = 0;
+                    for(qint32 c = 0; c < p; ++c)
+                    {
+                        if(2 * Xsum(i,c) != m[i])
+                            Del.col(i).array() += (X.col(c).array() - C(i,c)).abs();
+                        else
+                            ++numequal01;
+                    }
+                    for(qint32 l = 0; l < idx.rows(); ++l)
+                        if(idx[l] == i)
+                            Del(l,i) += numequal01;
+                    Del.col(i) /= (double)p;
+                }
+                else
+                    Del.col(i) = (X - C.row(i).replicate(n,1)).array().abs().rowwise().sum() / (double)p;
+            }
         }
 
         // Determine best possible move, if any, for each point.  Next we
@@ -791,12 +839,12 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
         m( oidx ) = m( oidx ) - 1;
 
 
-        if (m_sDistance.compare("sqeuclidean") == 0)
+        if (m_distance == SqEuclidean)
         {
             C.row(nidx[0]) = C.row(nidx[0]).array() + (X.row(moved[0]) - C.row(nidx[0])).array() / m[nidx[0]];
             C.row(oidx) = C.row(oidx).array() - (X.row(moved[0]) - C.row(oidx)).array() / m[oidx];
         }
-        else if (m_sDistance.compare("cityblock") == 0)
+        else if (m_distance == Cityblock)
         {
             VectorXi onidx(2);
             onidx << oidx, nidx[0];//ToDo always right?
@@ -845,19 +893,19 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
                 }
             }
         }
-        else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+        else if (m_distance == Cosine || m_distance == Correlation)
         {
             C.row(nidx[0]).array() += (X.row(moved[0]) - C.row(nidx[0])).array() / m[nidx[0]];
-            C.row(oidx).array() += (X.row(moved[0]) - C.row(oidx)).array() / m[oidx];
+            C.row(oidx).array() -= (X.row(moved[0]) - C.row(oidx)).array() / m[oidx];
         }
-        else if (m_sDistance.compare("hamming") == 0)
+        else if (m_distance == Hamming)
         {
-//                % Update summed coords for points in each cluster.  New
-//                % centroid is the coord median.  All done component-wise.
-//                Xsum(nidx,:) = Xsum(nidx,:) + X(moved,:);
-//                Xsum(oidx,:) = Xsum(oidx,:) - X(moved,:);
-//                C(nidx,:) = .5*sign(2*Xsum(nidx,:) - m(nidx)) + .5;
-//                C(oidx,:) = .5*sign(2*Xsum(oidx,:) - m(oidx)) + .5;
+            // Update summed coords for points in each cluster.  New
+            // centroid is the coord median.  All done component-wise.
+            Xsum.row(nidx[0]) += X.row(moved[0]);
+            Xsum.row(oidx) -= X.row(moved[0]);
+            C.row(nidx[0]) = binaryMedian(Xsum.row(nidx[0]), m[nidx[0]]);
+            C.row(oidx) = binaryMedian(Xsum.row(oidx), m[oidx]);
         }
 
         VectorXi sorted_onidx(1+nidx.rows());
@@ -873,22 +921,20 @@ bool KMeans::onlineUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
 
 //*************************************************************************************************************
 //DISTFUN Calculate point to cluster centroid distances.
-MatrixXd KMeans::distfun(const MatrixXd& X, MatrixXd& C)//, qint32 iter)
+MatrixXd KMeans::distfun(const MatrixXd& X, const MatrixXd& C)//, qint32 iter)
 {
     MatrixXd D = MatrixXd::Zero(n,C.rows());
     qint32 nclusts = C.rows();
 
-    if (m_sDistance.compare("sqeuclidean") == 0)
+    if (m_distance == SqEuclidean)
     {
-        for(qint32 i = 0; i < nclusts; ++i)
-        {
-            D.col(i) = (X.col(0).array() - C(i,0)).pow(2);
-
-            for(qint32 j = 1; j < p; ++j)
-                D.col(i) = D.col(i).array() + (X.col(j).array() - C(i,j)).pow(2);
-        }
+        // ||x||^2 - 2*x*c' + ||c||^2; clamp the cancellation error of nearly identical points, keep NaNs of empty clusters
+        D.noalias() = -2.0 * X * C.transpose();
+        D.colwise() += normX2;
+        D.rowwise() += C.rowwise().squaredNorm().transpose();
+        D = (D.array() < 0.0).select(0.0, D);
     }
-    else if (m_sDistance.compare("cityblock") == 0)
+    else if (m_distance == Cityblock)
     {
         for(qint32 i = 0; i < nclusts; ++i)
         {
@@ -899,31 +945,22 @@ MatrixXd KMeans::distfun(const MatrixXd& X, MatrixXd& C)//, qint32 iter)
             }
         }
     }
-    else if (m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+    else if (m_distance == Cosine || m_distance == Correlation)
     {
         // The points are normalized, centroids are not, so normalize them
-        MatrixXd normC = C.array().pow(2).rowwise().sum().sqrt();
+        VectorXd normC = C.rowwise().norm();
 //        if any(normC < eps(class(normC))) % small relative to unit-length data points
 //            error('Zero cluster centroid created at iteration %d.',iter);
-        for (qint32 i = 0; i < nclusts; ++i)
-        {
-            MatrixXd C_tmp = (C.row(i).array() / normC(i,0)).transpose();
-            D.col(i) = X * C_tmp;//max(1 - X * (C(i,:)./normC(i))', 0);
-            for(qint32 j = 0; j < D.rows(); ++j)
-                if(D(j,i) < 0)
-                    D(j,i) = 0;
-        }
+        MatrixXd C_tmp = normC.cwiseInverse().asDiagonal() * C;
+        D.noalias() = X * C_tmp.transpose();
+        D = 1.0 - D.array();
+        D = (D.array() < 0.0).select(0.0, D);//max(1 - X * (C(i,:)./normC(i))', 0);
+    }
+    else if (m_distance == Hamming)
+    {
+        for(qint32 i = 0; i < nclusts; ++i)
+            D.col(i) = (X - C.row(i).replicate(n,1)).array().abs().rowwise().sum() / (double)p;
     }
-//case 'hamming'
-//    for i = 1:nclusts
-//        D(:,i) = abs(X(:,1) - C(i,1));
-//        for j = 2:p
-//            D(:,i) = D(:,i) + abs(X(:,j) - C(i,j));
-//        end
-//        D(:,i) = D(:,i) / p;
-//        % D(:,i) = sum(abs(X - C(repmat(i,n,1),:)), 2) / p;
-//    end
-//end
     return D;
 } // function
 
@@ -938,73 +975,197 @@ void KMeans::gcentroids(const MatrixXd& X, const VectorXi& index, const VectorXi
     centroids.fill(std::numeric_limits<double>::quiet_NaN());
     counts = VectorXi::Zero(num);
 
-    VectorXi members;
+    // Position of each cluster in clusts, -1 if it's not requested
+    VectorXi pos = VectorXi::Constant(k, -1);
+    for(qint32 i = 0; i < num; ++i)
+        pos[clusts[i]] = i;
 
-    qint32 c;
+    if(m_distance == Cityblock)
+    {
+        // Collect the members of all clusters in a single pass
+        std::vector< std::vector<qint32> > members(num);
+        for(qint32 j = 0; j < index.rows(); ++j)
+            if(pos[index[j]] >= 0)
+                members[pos[index[j]]].push_back(j);
 
-    for(qint32 i = 0; i < num; ++i)
+        for(qint32 i = 0; i < num; ++i)
+        {
+            counts[i] = members[i].size();
+            if(counts[i] == 0)
+                continue;
+
+            // Separate out sorted coords for points in i'th cluster,
+            // and use to compute a fast median, component-wise
+            MatrixXd Xsorted(counts[i],p);
+            for(qint32 j = 0; j < counts[i]; ++j)
+                Xsorted.row(j) = X.row(members[i][j]);
+
+            for(qint32 j = 0; j < Xsorted.cols(); ++j)
+                std::sort(Xsorted.col(j).data(),Xsorted.col(j).data()+Xsorted.rows());
+
+            qint32 nn = floor(0.5*(counts(i)))-1;
+            if (counts[i] % 2 == 0)
+                centroids.row(i) = .5 * (Xsorted.row(nn) + Xsorted.row(nn+1));
+            else
+                centroids.row(i) = Xsorted.row(nn+1);
+        }
+    }
+    else if(m_distance == SqEuclidean || m_distance == Cosine || m_distance == Correlation)
     {
-        c = 0;
-        members = VectorXi::Zero(index.rows());
+        // Sum up the members of all clusters in a single pass; cosine and correlation centroids are unnormalized
+        MatrixXd sums = MatrixXd::Zero(num,p);
         for(qint32 j = 0; j < index.rows(); ++j)
+            if(pos[index[j]] >= 0)
+                ++counts[pos[index[j]]];
+
+        // column by column, X is column major
+        for(qint32 c = 0; c < p; ++c)
         {
-            if(index[j] == clusts[i])
+            for(qint32 j = 0; j < index.rows(); ++j)
             {
-                members[c] = j;
-                ++c;
+                qint32 i = pos[index[j]];
+                if(i >= 0)
+                    sums(i,c) += X(j,c);
             }
         }
-        members.conservativeResize(c);
-        if (c > 0)
+
+        for(qint32 i = 0; i < num; ++i)
+            if(counts[i] > 0)
+                centroids.row(i) = sums.row(i) / (double)counts[i];
+    }
+    else if(m_distance == Hamming)
+    {
+        // Compute a fast median for binary data, component-wise
+        MatrixXd sums = MatrixXd::Zero(num,p);
+        for(qint32 j = 0; j < index.rows(); ++j)
         {
-            counts[i] = c;
-            if(m_sDistance.compare("sqeuclidean") == 0)
+            qint32 i = pos[index[j]];
+            if(i >= 0)
             {
-                //Initialize
-                if(members.rows() > 0)
-                    centroids.row(i) = RowVectorXd::Zero(centroids.cols());
-
-                for(qint32 j = 0; j < members.rows(); ++j)
-                    centroids.row(i).array() += X.row(members[j]).array() / counts[i];
+                sums.row(i) += X.row(j);
+                ++counts[i];
             }
-            else if(m_sDistance.compare("cityblock") == 0)
-            {
-                // Separate out sorted coords for points in i'th cluster,
-                // and use to compute a fast median, component-wise
-                MatrixXd Xsorted(counts[i],p);
-                c = 0;
+        }
 
-                for(qint32 j = 0; j < index.rows(); ++j)
-                {
-                    if(index[j] == clusts[i])
-                    {
-                        Xsorted.row(c) = X.row(j);
-                        ++c;
-                    }
-                }
+        for(qint32 i = 0; i < num; ++i)
+            if(counts[i] > 0)
+                centroids.row(i) = binaryMedian(sums.row(i), counts[i]);
+    }
+}// function
 
-                for(qint32 j = 0; j < Xsorted.cols(); ++j)
-                    std::sort(Xsorted.col(j).data(),Xsorted.col(j).data()+Xsorted.rows());
 
-                qint32 nn = floor(0.5*(counts(i)))-1;
-                if (counts[i] % 2 == 0)
-                    centroids.row(i) = .5 * (Xsorted.row(nn) + Xsorted.row(nn+1));
-                else
-                    centroids.row(i) = Xsorted.row(nn+1);
-            }
-            else if(m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0)
+//*************************************************************************************************************
+
+RowVectorXd KMeans::binaryMedian(const RowVectorXd& sum, qint32 count)
+{
+    // .5*sign(2*sum - count) + .5; a tie gives .5
+    RowVectorXd median(sum.cols());
+    for(qint32 c = 0; c < sum.cols(); ++c)
+        median[c] = 2.0 * sum[c] > count ? 1.0 : 2.0 * sum[c] < count ? 0.0 : 0.5;
+    return median;
+}
+
+
+//*************************************************************************************************************
+
+void KMeans::seedPlusPlus(const MatrixXd& X, MatrixXd& C)
+{
+    C = MatrixXd::Zero(k,p);
+    C.row(0) = X.row(qrand() % n);
+
+    VectorXd minD = distfun(X, C.topRows(1)).col(0);
+
+    for(qint32 i = 1; i < k; ++i)
+    {
+        // Draw the next centroid with a probability proportional to the distance to the closest one
+        double sumD = minD.sum();
+        qint32 sel = qrand() % n;
+        if(sumD > 0)
+        {
+            double r = sumD * ((double)qrand() / ((double)RAND_MAX + 1.0));
+            double cumD = 0;
+            for(sel = 0; sel < n - 1; ++sel)
             {
-                for(qint32 j = 0; j < members.rows(); ++j)
-                    centroids.row(i).array() += X.row(members[j]).array() / counts[i]; // unnormalized
+                cumD += minD[sel];
+                if(cumD > r)
+                    break;
             }
-//            else if(m_sDistance.compare("hamming") == 0)
-//            {
-//                % Compute a fast median for binary data, component-wise
-//                centroids(i,:) = .5*sign(2*sum(X(members,:), 1) - counts(i)) + .5;
-//            }
         }
+
+        C.row(i) = X.row(sel);
+
+        if(i < k - 1)
+            minD = minD.cwiseMin(distfun(X, C.row(i)).col(0));
     }
-}// function
+}
+
+
+//*************************************************************************************************************
+
+bool KMeans::miniBatchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
+{
+    qint32 b = m_iBatchSize;
+
+    // Points and centroids as columns, so the gathered points and the updated centroids are contiguous
+    MatrixXd Xt = X.transpose();
+    MatrixXd Ct = C.transpose();
+
+    VectorXd counts = VectorXd::Zero(k);
+    VectorXi sel(b);
+    VectorXi nidx(b);
+    MatrixXd Xbatch(p,b);
+    MatrixXd Dbatch(b,k);
+    MatrixXd Cprev;
+    bool converged = false;
+
+    for(iter = 1; iter <= m_iMaxit; ++iter)
+    {
+        Cprev = Ct;
+
+        for(qint32 i = 0; i < b; ++i)
+        {
+            sel[i] = qrand() % n;
+            Xbatch.col(i) = Xt.col(sel[i]);
+        }
+
+        // Closest centroids of the batch with fixed centroids; ||x||^2 doesn't change the minimum
+        Dbatch.noalias() = -2.0 * Xbatch.transpose() * Ct;
+        Dbatch.rowwise() += Ct.colwise().squaredNorm();
+
+        for(qint32 i = 0; i < b; ++i)
+            Dbatch.row(i).minCoeff(&nidx[i]);
+
+        // Gradient steps with per-centroid learning rates 1/count
+        for(qint32 i = 0; i < b; ++i)
+        {
+            qint32 c = nidx[i];
+            counts[c] += 1;
+            Ct.col(c) += (Xbatch.col(i) - Ct.col(c)) / counts[c];
+        }
+
+        if((Ct - Cprev).squaredNorm() <= 1e-8 * Ct.squaredNorm())
+        {
+            converged = true;
+            break;
+        }
+    }
+
+    C = Ct.transpose();
+
+    //
+    // Assign all points
+    //
+    MatrixXd D = distfun(X, C);
+    idx = VectorXi::Zero(n);
+    for(qint32 i = 0; i < n; ++i)
+        d[i] = D.row(i).minCoeff(&idx[i]);
+
+    m = VectorXi::Zero(k);
+    for(qint32 i = 0; i < n; ++i)
+        ++m[idx[i]];
+
+    return converged;
+}
 
 
 //*************************************************************************************************************
@@ -1019,7 +1180,7 @@ double KMeans::unifrnd(double a, double b)
     double mu = a2+b2;
     double sig = b2-a2;
 
-    double r = mu + sig * (2.0* (rand() % 1000)/1000 -1.0);
+    double r = mu + sig * (2.0* (qrand() % 1000)/1000 -1.0);
 
     return r;
 }
@@ -98,13 +98,16 @@ public:
     * Constructs a KMeans algorithm object.
     *
     * @param[in] distance   (optional) K-Means distance measure: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming"
-    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "cluster"
+    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "plus" (k-means++), "cluster"
     * @param[in] replicates (optional) Number of K-Means replicates, which are generated. Best is returned.
     * @param[in] emptyact   (optional) What happens if a cluster wents empty: "error" (default), "drop", "singleton"
     * @param[in] online     (optional) If centroids should be updated during iterations: true (default), false
     * @param[in] maxit      (optional) maximal number of iterations per replicate; 100 by default
+    * @param[in] seed       (optional) seed of the random initialization; a negative seed (default) seeds with the
+    *                       current time. The random generator is per thread, so seeded objects running in
+    *                       different threads give reproducible results.
     */
-    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100);
+    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100, qint32 seed = -1);
 
     //=========================================================================================================
     /**
@@ -119,18 +122,64 @@ public:
     */
     bool calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C, VectorXd& sumD, MatrixXd& D);
 
+    //=========================================================================================================
+    /**
+    * Switches to mini-batch k-means (Sculley, 2010): every iteration assigns a random batch of points to their
+    * closest centroids and moves each centroid towards its points with a per-centroid learning rate. The
+    * number of iterations is bounded by maxit. Only applies to the "sqeuclidean" distance.
+    *
+    * @param[in] p_iBatchSize   Number of points per batch; 0 (default) for the full batch and online updates
+    */
+    void setMiniBatch(qint32 p_iBatchSize);
+
 
 private:
     //=========================================================================================================
     /**
-    * Calculate point to cluster centroid distances.
+    * Distance measures; the distance name is resolved once at construction.
+    */
+    enum DistanceMeasure
+    {
+        SqEuclidean,
+        Cityblock,
+        Cosine,
+        Correlation,
+        Hamming
+    };
+
+    //=========================================================================================================
+    /**
+    * Calculate point to cluster centroid distances. The squared euclidean distances are computed as
+    * ||x||^2 - 2*X*C' + ||c||^2, i.e. with a single matrix product.
     *
     * @param[in] X  Input data (rows = points; cols = p dimensional space)
     * @param[in] C  Cluster centroids
     *
     * @return Cluster centroid distances
     */
-    MatrixXd distfun(const MatrixXd& X, MatrixXd& C);//, qint32 iter);
+    MatrixXd distfun(const MatrixXd& X, const MatrixXd& C);//, qint32 iter);
+
+    //=========================================================================================================
+    /**
+    * k-means++ initialization: the first centroid is a random point, each further centroid is a point drawn
+    * with a probability proportional to its distance to the closest centroid chosen so far.
+    *
+    * @param[in] X      Input data
+    * @param[out] C     The initial centroids
+    */
+    void seedPlusPlus(const MatrixXd& X, MatrixXd& C);
+
+    //=========================================================================================================
+    /**
+    * Mini-batch updates of the centroids, followed by the assignment of all points.
+    *
+    * @param[in] X          Input data
+    * @param[in, out] C     Cluster centroids
+    * @param[out] idx       The cluster indeces to which cluster the input points belong to
+    *
+    * @return true if converged, false otherwise
+    */
+    bool miniBatchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx);
 
     //=========================================================================================================
     /**
@@ -157,6 +206,17 @@ private:
     void gcentroids(const MatrixXd& X, const VectorXi& index, const VectorXi& clusts,
                                         MatrixXd& centroids, VectorXi& counts);
 
+    //=========================================================================================================
+    /**
+    * Component-wise median of binary points, the hamming centroid.
+    *
+    * @param[in] sum        Summed coords of the cluster members
+    * @param[in] count      Number of cluster members
+    *
+    * @return The median, 0.5 where zeros and ones are tied
+    */
+    static RowVectorXd binaryMedian(const RowVectorXd& sum, qint32 count);
+
     //=========================================================================================================
     /**
     * Centroids and counts stratified by group.
@@ -183,10 +243,13 @@ private:
 
 
     QString m_sDistance;    /**< Distance measurement to use: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming". */
+    DistanceMeasure m_distance; /**< Distance measure resolved from m_sDistance. */
     QString m_sStart;       /**< Initialization to use: "sample" (default), "uniform", "cluster". */
     qint32 m_iReps;         /**< Number of K-Means replicates, which should be generated. */
     QString m_sEmptyact;    /**< What should be done if a cluster wents empty: "error" (default), "drop", "singleton" */
     qint32 m_iMaxit;        /**< Maximal number of iterations per replicate */
+    qint32 m_iSeed;         /**< Seed of the random initialization; negative to seed with the current time */
+    qint32 m_iBatchSize;    /**< Number of points per mini-batch; 0 for full batch updates */
     bool m_bOnline;         /**< If online update should be performed */
 
     qint32 emptyErrCnt;     /**< Counts the occurence of empty errors */
@@ -198,6 +261,7 @@ private:
 
     MatrixXd Del;           /**< reassignment criterion */
     VectorXd d;             /**< Minimal distances of each point to its centroid */
+    VectorXd normX2;        /**< Squared norms of the points, for the squared euclidean distances */
     VectorXi m;             /**< m number of points belonging to the cluster */
 
     double totsumD;         /**< Total sum of centroid distances */
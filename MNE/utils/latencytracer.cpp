@@ -0,0 +1,385 @@
+//=============================================================================================================
+/**
+* @file     latencytracer.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    LatencyTracer class definition.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "latencytracer.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DATA
+//=============================================================================================================
+
+namespace
+{
+
+QMutex s_qMutexStages;                      /**< Guards the creation of stages. */
+QList<LatencyTracer*> s_qListStages;        /**< All stages, in the order they were created. */
+QAtomicInt s_iNumAcquired(0);               /**< Number of raw buffers acquired so far, read as wrapping unsigned. */
+
+//=============================================================================================================
+/**
+* Monotonic trace clock, started when the library is loaded.
+*/
+struct TraceClock
+{
+    QElapsedTimer timer;
+
+    TraceClock()
+    {
+        timer.start();
+    }
+};
+
+TraceClock s_clock;
+
+
+//*************************************************************************************************************
+
+QString formatMs(qint64 p_iTime)
+{
+    return p_iTime < 0 ? QString("-") : QString::number(p_iTime / 1e6, 'f', 3);
+}
+
+} // NAMESPACE
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+LatencyTracer::LatencyTracer(const QString &p_sName)
+: m_sName(p_sName)
+, m_qVecRecords(RingSize)
+, m_iHead(0)
+, m_iFirst(0)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+LatencyTracer* LatencyTracer::stage(const QString &p_sName)
+{
+    QMutexLocker t_locker(&s_qMutexStages);
+
+    for(qint32 i = 0; i < s_qListStages.size(); ++i)
+        if(s_qListStages[i]->m_sName == p_sName)
+            return s_qListStages[i];
+
+    LatencyTracer* t_pStage = new LatencyTracer(p_sName);
+    s_qListStages.append(t_pStage);
+
+    return t_pStage;
+}
+
+
+//*************************************************************************************************************
+
+qint64 LatencyTracer::now()
+{
+    return s_clock.timer.nsecsElapsed();
+}
+
+
+//*************************************************************************************************************
+
+qint32 LatencyTracer::acquire(const void* p_pKey)
+{
+    qint64 t_iTime = now();
+    qint32 t_iSequence = (quint32)s_iNumAcquired.fetchAndAddOrdered(1) & SequenceMask;
+
+    Acquisition& t_acq = acquisitions()[t_iSequence & (AcqRingSize - 1)];
+    t_acq.iSequence.storeRelease(0);
+    t_acq.pKey = p_pKey;
+    t_acq.iTime = t_iTime;
+    t_acq.iSequence.storeRelease(t_iSequence + 1);
+
+    return t_iSequence;
+}
+
+
+//*************************************************************************************************************
+
+qint32 LatencyTracer::sequence(const void* p_pKey)
+{
+    if(!p_pKey)
+        return -1;
+
+    //
+    // Search from the newest acquisition on: the address of a freed buffer may be reused by a newer one
+    //
+    // slots which were never written don't hold the sequence number, so the lookup may start before the first
+    // acquisition and may cross the wrap around of the sequence numbers
+    quint32 t_uiLast = (quint32)s_iNumAcquired.loadAcquire() - 1;
+    for(quint32 k = 0; k < AcqLookup; ++k)
+    {
+        qint32 t_iSequence = (t_uiLast - k) & SequenceMask;
+        const Acquisition& t_acq = acquisitions()[t_iSequence & (AcqRingSize - 1)];
+        if(t_acq.iSequence.loadAcquire() == t_iSequence + 1 && t_acq.pKey == p_pKey)
+            return t_iSequence;
+    }
+
+    return -1;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyTracer::setKey(qint32 p_iSequence, const void* p_pKey)
+{
+    if(p_iSequence < 0)
+        return;
+
+    Acquisition& t_acq = acquisitions()[p_iSequence & (AcqRingSize - 1)];
+    if(t_acq.iSequence.testAndSetOrdered(p_iSequence + 1, 0))
+    {
+        t_acq.pKey = p_pKey;
+        t_acq.iSequence.storeRelease(p_iSequence + 1);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void LatencyTracer::record(qint64 p_iEnter, qint32 p_iSequence, qint32 p_iQueueDepth)
+{
+    quint32 t_uiHead = m_iHead.load();
+
+    Record& t_record = m_qVecRecords[t_uiHead & (RingSize - 1)];
+    t_record.iEnter = p_iEnter;
+    t_record.iExit = now();
+    t_record.iSequence = p_iSequence;
+    t_record.iQueueDepth = p_iQueueDepth;
+
+    m_iHead.storeRelease(t_uiHead + 1);
+}
+
+
+//*************************************************************************************************************
+
+QList<LatencyTracer::Statistics> LatencyTracer::statistics()
+{
+    QList<LatencyTracer*> t_qListStages;
+    {
+        QMutexLocker t_locker(&s_qMutexStages);
+        t_qListStages = s_qListStages;
+    }
+
+    QList<Statistics> t_qListStatistics;
+    for(qint32 i = 0; i < t_qListStages.size(); ++i)
+        t_qListStatistics.append(t_qListStages[i]->computeStatistics());
+
+    return t_qListStatistics;
+}
+
+
+//*************************************************************************************************************
+
+QString LatencyTracer::report()
+{
+    QList<Statistics> t_qListStatistics = statistics();
+
+    QString t_sReport;
+    t_sReport.append(QString("\t%1 %2 %3 %4 %5 | %6 %7 %8 | %9 %10\r\n")
+                     .arg("Stage", -24).arg("Count", 7)
+                     .arg("p50", 9).arg("p99", 9).arg("max", 9)
+                     .arg("acq p50", 9).arg("acq p99", 9).arg("acq max", 9)
+                     .arg("queue", 7).arg("max", 5));
+
+    for(qint32 i = 0; i < t_qListStatistics.size(); ++i)
+    {
+        const Statistics& t_stat = t_qListStatistics[i];
+        t_sReport.append(QString("\t%1 %2 %3 %4 %5 | %6 %7 %8 | %9 %10\r\n")
+                         .arg(t_stat.sName, -24).arg(t_stat.iCount, 7)
+                         .arg(formatMs(t_stat.iP50), 9).arg(formatMs(t_stat.iP99), 9).arg(formatMs(t_stat.iMax), 9)
+                         .arg(formatMs(t_stat.iAcqP50), 9).arg(formatMs(t_stat.iAcqP99), 9).arg(formatMs(t_stat.iAcqMax), 9)
+                         .arg(t_stat.iQueueMax < 0 ? QString("-") : QString::number(t_stat.dQueueMean, 'f', 2), 7)
+                         .arg(t_stat.iQueueMax < 0 ? QString("-") : QString::number(t_stat.iQueueMax), 5));
+    }
+    t_sReport.append("\t(latencies in ms; acq: since the acquisition of the buffer)\r\n\n");
+
+    return t_sReport;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyTracer::reset()
+{
+    QMutexLocker t_locker(&s_qMutexStages);
+
+    for(qint32 i = 0; i < s_qListStages.size(); ++i)
+        s_qListStages[i]->m_iFirst.storeRelease(s_qListStages[i]->m_iHead.loadAcquire());
+}
+
+
+//*************************************************************************************************************
+
+qint64 LatencyTracer::acquisitionTime(qint32 p_iSequence)
+{
+    if(p_iSequence < 0)
+        return -1;
+
+    const Acquisition& t_acq = acquisitions()[p_iSequence & (AcqRingSize - 1)];
+    if(t_acq.iSequence.loadAcquire() != p_iSequence + 1)
+        return -1;
+
+    qint64 t_iTime = t_acq.iTime;
+
+    // the slot may have been reused while reading the time
+    return t_acq.iSequence.loadAcquire() == p_iSequence + 1 ? t_iTime : -1;
+}
+
+
+//*************************************************************************************************************
+
+LatencyTracer::Statistics LatencyTracer::computeStatistics() const
+{
+    Statistics t_stat;
+    t_stat.sName = m_sName;
+
+    //
+    // The records from the last reset on, at most the size of the ring; the oldest ones may already be
+    // overwritten while they are read, which only blurs the statistics
+    //
+    quint32 t_uiHead = m_iHead.loadAcquire();
+    quint32 t_uiNum = t_uiHead - (quint32)m_iFirst.loadAcquire();
+    if(t_uiNum > RingSize)
+        t_uiNum = RingSize;
+
+    QVector<qint64> t_qVecStage;
+    QVector<qint64> t_qVecAcq;
+    t_qVecStage.reserve(t_uiNum);
+
+    qint64 t_iQueueSum = 0;
+    qint32 t_iQueueCount = 0;
+    t_stat.iQueueMax = -1;
+
+    for(quint32 i = t_uiHead - t_uiNum; i != t_uiHead; ++i)
+    {
+        const Record& t_record = m_qVecRecords[i & (RingSize - 1)];
+
+        t_qVecStage.append(t_record.iExit - t_record.iEnter);
+
+        qint64 t_iAcqTime = acquisitionTime(t_record.iSequence);
+        if(t_iAcqTime >= 0)
+            t_qVecAcq.append(t_record.iExit - t_iAcqTime);
+
+        if(t_record.iQueueDepth >= 0)
+        {
+            t_iQueueSum += t_record.iQueueDepth;
+            ++t_iQueueCount;
+            t_stat.iQueueMax = std::max(t_stat.iQueueMax, t_record.iQueueDepth);
+        }
+    }
+
+    t_stat.iCount = t_qVecStage.size();
+    percentiles(t_qVecStage, t_stat.iP50, t_stat.iP99, t_stat.iMax);
+
+    t_stat.iCountAcq = t_qVecAcq.size();
+    percentiles(t_qVecAcq, t_stat.iAcqP50, t_stat.iAcqP99, t_stat.iAcqMax);
+
+    t_stat.dQueueMean = t_iQueueCount > 0 ? (double)t_iQueueSum / t_iQueueCount : -1.0;
+
+    return t_stat;
+}
+
+
+//*************************************************************************************************************
+
+void LatencyTracer::percentiles(QVector<qint64> &p_qVecTimes, qint64 &p_iP50, qint64 &p_iP99, qint64 &p_iMax)
+{
+    if(p_qVecTimes.isEmpty())
+    {
+        p_iP50 = p_iP99 = p_iMax = -1;
+        return;
+    }
+
+    qint64* t_pBegin = p_qVecTimes.data();
+    qint64* t_pEnd = t_pBegin + p_qVecTimes.size();
+    qint32 t_iLast = p_qVecTimes.size() - 1;
+
+    std::nth_element(t_pBegin, t_pBegin + t_iLast / 2, t_pEnd);
+    p_iP50 = t_pBegin[t_iLast / 2];
+
+    qint32 t_iP99 = (qint32)(0.99 * t_iLast + 0.5);
+    std::nth_element(t_pBegin, t_pBegin + t_iP99, t_pEnd);
+    p_iP99 = t_pBegin[t_iP99];
+
+    p_iMax = *std::max_element(t_pBegin, t_pEnd);
+}
+
+
+//*************************************************************************************************************
+
+LatencyTracer::Acquisition* LatencyTracer::acquisitions()
+{
+    static Acquisition s_acquisitions[AcqRingSize];
+    return s_acquisitions;
+}
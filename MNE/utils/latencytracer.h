@@ -0,0 +1,269 @@
+//=============================================================================================================
+/**
+* @file     latencytracer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    LatencyTracer class declaration.
+*
+*/
+
+#ifndef LATENCYTRACER_H
+#define LATENCYTRACER_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+//=============================================================================================================
+/**
+* Lightweight latency tracing of the real-time pipeline. The producer of raw buffers calls acquire, which
+* assigns the buffer a sequence number and records its acquisition time. Every processing stage owns a tracer,
+* registered by name, and records the time it entered and left the processing of a buffer, the sequence number
+* of the buffer if known and the depth of its input queue. The statistics give the stage latency and, for
+* buffers with a known sequence number, the latency since acquisition as p50/p99/max.
+*
+* Recording doesn't lock: each tracer is a ring of records written by a single thread, the stage's thread, and
+* published by an atomic index; the acquisitions are a ring of their own. The statistics are computed from the
+* last records in the rings while the stages keep on recording. Times are taken from a monotonic clock and are
+* only comparable within a process.
+*
+* @brief Per-stage latency tracing
+*/
+class UTILSSHARED_EXPORT LatencyTracer
+{
+public:
+    //=========================================================================================================
+    /**
+    * Latency statistics of a stage. Times are in nanoseconds, -1 if there are no records.
+    */
+    struct Statistics
+    {
+        QString sName;          /**< Name of the stage. */
+        qint32 iCount;          /**< Number of records the statistics are computed from. */
+        qint64 iP50;            /**< Median of the stage latency. */
+        qint64 iP99;            /**< 99th percentile of the stage latency. */
+        qint64 iMax;            /**< Maximum of the stage latency. */
+        qint32 iCountAcq;       /**< Number of records of buffers with a known acquisition time. */
+        qint64 iAcqP50;         /**< Median of the latency since acquisition, up to leaving the stage. */
+        qint64 iAcqP99;         /**< 99th percentile of the latency since acquisition. */
+        qint64 iAcqMax;         /**< Maximum of the latency since acquisition. */
+        double dQueueMean;      /**< Mean input queue depth, -1 if not recorded. */
+        qint32 iQueueMax;       /**< Maximal input queue depth, -1 if not recorded. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Returns the tracer of a stage; it is created on the first call. Tracers are never destroyed, so stages
+    * keep the pointer. A tracer must be written by a single thread at a time: stages running in several
+    * threads, e.g. one per client, use one tracer per thread.
+    *
+    * @param[in] p_sName    Name of the stage
+    *
+    * @return the tracer
+    */
+    static LatencyTracer* stage(const QString &p_sName);
+
+    //=========================================================================================================
+    /**
+    * Returns the current time of the monotonic trace clock.
+    *
+    * @return the time in nanoseconds
+    */
+    static qint64 now();
+
+    //=========================================================================================================
+    /**
+    * Registers a newly acquired raw buffer.
+    *
+    * @param[in] p_pKey     Address of the buffer data, to look the sequence number up by sequence(); NULL if
+    *                       the buffer is copied on its way
+    *
+    * @return the sequence number of the buffer; the sequence numbers wrap around to 0 after 2^30 buffers
+    */
+    static qint32 acquire(const void* p_pKey = NULL);
+
+    //=========================================================================================================
+    /**
+    * Looks the sequence number of a recently acquired raw buffer up by the address of its data.
+    *
+    * @param[in] p_pKey     Address of the buffer data, as passed to acquire
+    *
+    * @return the sequence number, -1 if the buffer isn't among the recent acquisitions
+    */
+    static qint32 sequence(const void* p_pKey);
+
+    //=========================================================================================================
+    /**
+    * Binds a recently acquired raw buffer to the address of a copy of its data, e.g. after it was popped from
+    * a queue, so that later stages can look its sequence number up by sequence().
+    *
+    * @param[in] p_iSequence    Sequence number of the buffer, as returned by acquire
+    * @param[in] p_pKey         Address of the copied buffer data
+    */
+    static void setKey(qint32 p_iSequence, const void* p_pKey);
+
+    //=========================================================================================================
+    /**
+    * Records the processing of a buffer by the stage. Has to be called by the stage's thread.
+    *
+    * @param[in] p_iEnter       Time the stage started processing the buffer, taken by now()
+    * @param[in] p_iSequence    Sequence number of the buffer, -1 if unknown
+    * @param[in] p_iQueueDepth  Number of buffers waiting in the stage's input queue, -1 if unknown
+    */
+    void record(qint64 p_iEnter, qint32 p_iSequence = -1, qint32 p_iQueueDepth = -1);
+
+    //=========================================================================================================
+    /**
+    * Returns the statistics of all stages, in the order the stages were created.
+    *
+    * @return the statistics
+    */
+    static QList<Statistics> statistics();
+
+    //=========================================================================================================
+    /**
+    * Formats the statistics of all stages as a table, latencies in milliseconds.
+    *
+    * @return the table
+    */
+    static QString report();
+
+    //=========================================================================================================
+    /**
+    * Discards the records so far, the following statistics start from scratch.
+    */
+    static void reset();
+
+private:
+    static const quint32 RingSize = 4096;           /**< Number of records kept per stage; a power of two. */
+    static const quint32 AcqRingSize = 4096;        /**< Number of acquisitions kept; a power of two. */
+    static const quint32 AcqLookup = 64;            /**< Number of recent acquisitions searched by sequence(). */
+    static const quint32 SequenceMask = 0x3fffffff; /**< Sequence numbers wrap around at 2^30, so they stay positive also plus one. */
+
+    //=========================================================================================================
+    /**
+    * Processing of a buffer by a stage.
+    */
+    struct Record
+    {
+        qint64 iEnter;          /**< Time the stage started processing the buffer. */
+        qint64 iExit;           /**< Time the stage finished processing the buffer. */
+        qint32 iSequence;       /**< Sequence number of the buffer, -1 if unknown. */
+        qint32 iQueueDepth;     /**< Input queue depth, -1 if unknown. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Acquisition of a raw buffer. The sequence number is published last, a slot is valid if it holds the
+    * requested sequence number; setKey withdraws it while it rebinds the key.
+    */
+    struct Acquisition
+    {
+        QAtomicInt iSequence;   /**< Sequence number of the buffer plus one, 0 if the slot is empty. */
+        const void* pKey;       /**< Address of the buffer data. */
+        qint64 iTime;           /**< Acquisition time. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Creates the tracer of a stage.
+    *
+    * @param[in] p_sName    Name of the stage
+    */
+    explicit LatencyTracer(const QString &p_sName);
+
+    //=========================================================================================================
+    /**
+    * Returns the acquisition time of a buffer.
+    *
+    * @param[in] p_iSequence    Sequence number of the buffer
+    *
+    * @return the acquisition time, -1 if it isn't among the kept acquisitions
+    */
+    static qint64 acquisitionTime(qint32 p_iSequence);
+
+    //=========================================================================================================
+    /**
+    * Computes the statistics of the stage from its last records.
+    *
+    * @return the statistics
+    */
+    Statistics computeStatistics() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the median, the 99th percentile and the maximum of a list of times. The list is reordered.
+    *
+    * @param[in, out] p_qVecTimes   The times
+    * @param[out] p_iP50            The median
+    * @param[out] p_iP99            The 99th percentile
+    * @param[out] p_iMax            The maximum
+    */
+    static void percentiles(QVector<qint64> &p_qVecTimes, qint64 &p_iP50, qint64 &p_iP99, qint64 &p_iMax);
+
+    //=========================================================================================================
+    /**
+    * Returns the ring of the acquisitions.
+    *
+    * @return the acquisition ring
+    */
+    static Acquisition* acquisitions();
+
+    QString m_sName;                    /**< Name of the stage. */
+    QVector<Record> m_qVecRecords;      /**< Ring of the last records. */
+    QAtomicInt m_iHead;                 /**< Number of records written so far, read as wrapping unsigned; written by the stage only. */
+    QAtomicInt m_iFirst;                /**< First record the statistics are computed from, read as wrapping unsigned; set by reset. */
+};
+
+} // NAMESPACE
+
+#endif // LATENCYTRACER_H
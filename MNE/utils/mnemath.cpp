@@ -49,6 +49,7 @@
 #include <iostream>
 #include <algorithm>    // std::sort
 #include <vector>       // std::vector
+#include <limits>       // std::numeric_limits
 
 //DEBUG fstream
 //#include <fstream>
@@ -381,3 +382,108 @@ MatrixXd MNEMath::rescale(const MatrixXd &data, const RowVectorXf &times, QPair<
 
     return data_out;
 }
+
+
+//*************************************************************************************************************
+
+bool MNEMath::thin_svd(const MatrixXd &A, VectorXd &sing, MatrixXd &U, MatrixXd &V, const QString &method, qint32 rank, qint32 power_iterations)
+{
+    //
+    // Work on the wide orientation (m <= n); a tall matrix is decomposed transposed
+    //
+    if(A.rows() > A.cols())
+    {
+        MatrixXd At = A.transpose();
+        return thin_svd(At, sing, V, U, method, rank, power_iterations);
+    }
+
+    qint32 m = A.rows();
+    qint32 n = A.cols();
+
+    if(method == "jacobi")
+    {
+        JacobiSVD<MatrixXd> t_svd(A, ComputeThinU | ComputeThinV);
+        sing = t_svd.singularValues();
+        U = t_svd.matrixU();
+        V = t_svd.matrixV();
+    }
+    else if(method == "qr")
+    {
+        //
+        // A' = Q*R -> A = R'*Q' = (Ur*S*Vr')*Q', hence U = Ur and V = Q*Vr
+        //
+        HouseholderQR<MatrixXd> t_qr(A.transpose());
+        MatrixXd t_matRt = t_qr.matrixQR().topRows(m).triangularView<Upper>().transpose();
+
+        JacobiSVD<MatrixXd> t_svd(t_matRt, ComputeFullU | ComputeFullV);
+        sing = t_svd.singularValues();
+        U = t_svd.matrixU();
+
+        V = MatrixXd::Zero(n, m);
+        V.topRows(m) = t_svd.matrixV();
+        V.applyOnTheLeft(t_qr.householderQ());
+    }
+    else if(method == "gram")
+    {
+        //
+        // A*A' = U*S^2*U', hence V = A'*U*S^-1
+        //
+        MatrixXd t_matGram = MatrixXd::Zero(m, m);
+        t_matGram.selfadjointView<Lower>().rankUpdate(A);
+
+        SelfAdjointEigenSolver<MatrixXd> t_eig(t_matGram);
+        if(t_eig.info() != Success)
+        {
+            printf("Error in MNEMath::thin_svd: eigen decomposition of the Gram matrix failed.\n");
+            return false;
+        }
+
+        // eigenvalues are ascending, singular values descending
+        sing = t_eig.eigenvalues().reverse();
+        sing = sing.array().max(0.0).sqrt();
+        U = t_eig.eigenvectors().rowwise().reverse();
+
+        double t_dTol = m > 0 ? sing[0] * std::numeric_limits<double>::epsilon() * n : 0;
+        VectorXd t_vecInvSing = VectorXd::Zero(m);
+        for(qint32 i = 0; i < m; ++i)
+            if(sing[i] > t_dTol)
+                t_vecInvSing[i] = 1.0 / sing[i];
+
+        V = A.transpose() * U;
+        V *= t_vecInvSing.asDiagonal();
+    }
+    else if(method == "randomized")
+    {
+        qint32 k = rank > 0 && rank < m ? rank : m;
+        qint32 l = std::min(k + 10, m);
+
+        //
+        // Range finder: orthonormal basis Q of A*Omega, refined by power iterations
+        //
+        MatrixXd t_matY = A * MatrixXd::Random(n, l);
+        MatrixXd t_matQ = HouseholderQR<MatrixXd>(t_matY).householderQ() * MatrixXd::Identity(m, l);
+        for(qint32 i = 0; i < power_iterations; ++i)
+        {
+            MatrixXd t_matZ = A.transpose() * t_matQ;
+            t_matZ = HouseholderQR<MatrixXd>(t_matZ).householderQ() * MatrixXd::Identity(n, l);
+            t_matY = A * t_matZ;
+            t_matQ = HouseholderQR<MatrixXd>(t_matY).householderQ() * MatrixXd::Identity(m, l);
+        }
+
+        MatrixXd t_matB = t_matQ.transpose() * A;
+        MatrixXd t_matUb;
+        if(!thin_svd(t_matB, sing, t_matUb, V, "qr"))
+            return false;
+
+        U = t_matQ * t_matUb.leftCols(k);
+        sing.conservativeResize(k);
+        V.conservativeResize(n, k);
+    }
+    else
+    {
+        printf("Error in MNEMath::thin_svd: unknown method %s.\n", method.toLatin1().constData());
+        return false;
+    }
+
+    return true;
+}
@@ -218,6 +218,34 @@ public:
     */
     static MatrixXd rescale(const MatrixXd &data, const RowVectorXf &times, QPair<QVariant,QVariant> baseline, QString mode);
 
+    //=========================================================================================================
+    /**
+    * Computes the thin singular value decomposition A = U * diag(sing) * V' with a selectable backend. The
+    * singular values are returned in descending order.
+    *
+    * "jacobi"      Two-sided Jacobi SVD; the most accurate and the slowest one.
+    * "qr"          Householder QR of the long side followed by a Jacobi SVD of the small triangular factor;
+    *               as accurate as "jacobi", but the Jacobi sweeps only run on a min(m,n) square matrix.
+    * "gram"        Eigen decomposition of the Gram matrix of the short side (A*A' for m < n). The fastest one
+    *               for very wide or tall matrices; singular values below sqrt(eps) times the largest lose their
+    *               relative accuracy and the columns of the long side belonging to zero singular values are
+    *               set to zero.
+    * "randomized"  Randomized range finder with power iterations, followed by a "qr" decomposition of the
+    *               projected matrix. Returns the leading rank components only.
+    *
+    * @param[in] A                  Matrix to decompose (m x n)
+    * @param[out] sing              The singular values
+    * @param[out] U                 The left singular vectors (m x k)
+    * @param[out] V                 The right singular vectors (n x k)
+    * @param[in] method             "jacobi", "qr", "gram" or "randomized" (optional, default = "jacobi")
+    * @param[in] rank               Number of components of the randomized decomposition; all other methods
+    *                               ignore it (optional, default = -1, i.e. min(m,n))
+    * @param[in] power_iterations   Number of power iterations of the randomized decomposition (optional, default = 2)
+    *
+    * @return true if succeeded, false if the method is unknown
+    */
+    static bool thin_svd(const MatrixXd &A, VectorXd &sing, MatrixXd &U, MatrixXd &V, const QString &method = "jacobi", qint32 rank = -1, qint32 power_iterations = 2);
+
     //=========================================================================================================
     /**
     * Sorts a vector (ascending order) in place and returns the track of the original indeces
@@ -0,0 +1,123 @@
+//=============================================================================================================
+/**
+* @file     parallel.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implementation of the Parallel Class.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "parallel.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <algorithm>
+#include <stdio.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+#include <QThreadPool>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+void Parallel::setNumThreads(qint32 p_iNumThreads)
+{
+    if(p_iNumThreads <= 0)
+    {
+        bool t_bOk = false;
+        p_iNumThreads = qgetenv("MNE_NUM_THREADS").toInt(&t_bOk);
+        if(!t_bOk || p_iNumThreads <= 0)
+            p_iNumThreads = QThread::idealThreadCount();
+    }
+
+    p_iNumThreads = std::max(1, p_iNumThreads);
+    QThreadPool::globalInstance()->setMaxThreadCount(p_iNumThreads);
+    numThreadsRef().storeRelease(p_iNumThreads);
+}
+
+
+//*************************************************************************************************************
+
+qint32 Parallel::numThreads()
+{
+    // Concurrent first calls all apply the same default, the atomic keeps them from racing
+    qint32 t_iNumThreads = numThreadsRef().loadAcquire();
+    if(t_iNumThreads <= 0)
+    {
+        setNumThreads(0);
+        t_iNumThreads = numThreadsRef().loadAcquire();
+    }
+
+    return t_iNumThreads;
+}
+
+
+//*************************************************************************************************************
+
+qint32 Parallel::rangeSize(qint32 p_iSize, qint32 p_iMinRange)
+{
+    qint32 t_iNumRanges = 4 * numThreads();
+
+    return std::max(std::max(p_iMinRange, 1), (p_iSize + t_iNumRanges - 1) / t_iNumRanges);
+}
+
+
+//*************************************************************************************************************
+
+QAtomicInt& Parallel::numThreadsRef()
+{
+    static QAtomicInt s_iNumThreads(0);
+    return s_iNumThreads;
+}
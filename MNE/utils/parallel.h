@@ -0,0 +1,225 @@
+//=============================================================================================================
+/**
+* @file     parallel.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Parallel class declaration.
+*
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QList>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+//=============================================================================================================
+/**
+* Execution layer of the numeric loops of the MNE libraries. The work runs on the global QThreadPool, the one
+* used by QtConcurrent, whose size is taken from the MNE_NUM_THREADS environment variable or set by
+* setNumThreads. Work is either mapped over a list of panels or split into index ranges by parallelFor; both
+* take an execution policy, so single calls can be kept in the calling thread.
+*
+* @brief Thread pool and parallel loops
+*/
+class UTILSSHARED_EXPORT Parallel
+{
+public:
+    //=========================================================================================================
+    /**
+    * Where the work of a call is executed.
+    */
+    enum ExecutionPolicy
+    {
+        Sequential,     /**< In the calling thread. */
+        Concurrent      /**< On the global thread pool, if it has more than one thread. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Sets the number of threads of the global thread pool.
+    *
+    * @param[in] p_iNumThreads  Number of threads; 0 or less to reset to MNE_NUM_THREADS, or the number of cores
+    *                           if it isn't set
+    */
+    static void setNumThreads(qint32 p_iNumThreads);
+
+    //=========================================================================================================
+    /**
+    * Returns the number of threads of the global thread pool. The first call applies MNE_NUM_THREADS.
+    *
+    * @return the number of threads
+    */
+    static qint32 numThreads();
+
+    //=========================================================================================================
+    /**
+    * Returns the size of the ranges an index range is split into: a few per thread, to balance the load, but
+    * at least p_iMinRange.
+    *
+    * @param[in] p_iSize        Size of the index range
+    * @param[in] p_iMinRange    Minimal size of a range
+    *
+    * @return the range size
+    */
+    static qint32 rangeSize(qint32 p_iSize, qint32 p_iMinRange);
+
+    //=========================================================================================================
+    /**
+    * Calls a function for every item of a sequence and waits until all calls returned.
+    *
+    * @param[in, out] p_sequence    The items, e.g. a list of panels
+    * @param[in] p_function         Function or function object called with a reference to an item
+    * @param[in] p_policy           Where to execute the calls
+    */
+    template<typename Sequence, typename MapFunction>
+    static void map(Sequence &p_sequence, MapFunction p_function, ExecutionPolicy p_policy = Concurrent);
+
+    //=========================================================================================================
+    /**
+    * Splits the indices 0 .. p_iSize-1 into ranges and calls a function object for every range, as
+    * p_function(first, num); waits until all calls returned.
+    *
+    * @param[in] p_iSize        Number of indices
+    * @param[in] p_iMinRange    Minimal size of a range
+    * @param[in] p_function     Function object with a const operator()(qint32 first, qint32 num)
+    * @param[in] p_policy       Where to execute the calls
+    */
+    template<typename RangeFunction>
+    static void parallelFor(qint32 p_iSize, qint32 p_iMinRange, const RangeFunction &p_function, ExecutionPolicy p_policy = Concurrent);
+
+private:
+    //=========================================================================================================
+    /**
+    * Index range of a parallelFor call.
+    */
+    struct Range
+    {
+        qint32 iFirst;  /**< First index of the range. */
+        qint32 iNum;    /**< Number of indices of the range. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Adapts a range function object to the item function of map.
+    */
+    template<typename RangeFunction>
+    struct RangeCall
+    {
+        typedef void result_type;           /**< Result type, required by QtConcurrent. */
+        const RangeFunction* pFunction;     /**< The range function. */
+
+        void operator()(Range &p_range) const
+        {
+            (*pFunction)(p_range.iFirst, p_range.iNum);
+        }
+    };
+
+    //=========================================================================================================
+    /**
+    * Returns the configured number of threads, 0 until it is set. Atomic, since the first call of numThreads
+    * may come from several threads at once.
+    *
+    * @return reference to the number of threads
+    */
+    static QAtomicInt& numThreadsRef();
+};
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+template<typename Sequence, typename MapFunction>
+void Parallel::map(Sequence &p_sequence, MapFunction p_function, ExecutionPolicy p_policy)
+{
+    if(p_policy == Concurrent && p_sequence.size() > 1 && numThreads() > 1)
+        QtConcurrent::blockingMap(p_sequence, p_function);
+    else
+        for(typename Sequence::iterator it = p_sequence.begin(); it != p_sequence.end(); ++it)
+            p_function(*it);
+}
+
+
+//*************************************************************************************************************
+
+template<typename RangeFunction>
+void Parallel::parallelFor(qint32 p_iSize, qint32 p_iMinRange, const RangeFunction &p_function, ExecutionPolicy p_policy)
+{
+    if(p_iSize <= 0)
+        return;
+
+    if(p_policy == Sequential || numThreads() <= 1)
+    {
+        p_function(0, p_iSize);
+        return;
+    }
+
+    qint32 t_iRangeSize = rangeSize(p_iSize, p_iMinRange);
+
+    QList<Range> t_qListRanges;
+    for(qint32 i = 0; i < p_iSize; i += t_iRangeSize)
+    {
+        Range t_range;
+        t_range.iFirst = i;
+        t_range.iNum = qMin(t_iRangeSize, p_iSize - i);
+        t_qListRanges.append(t_range);
+    }
+
+    RangeCall<RangeFunction> t_call;
+    t_call.pFunction = &p_function;
+    map(t_qListRanges, t_call, p_policy);
+}
+
+} // NAMESPACE
+
+#endif // PARALLEL_H
@@ -37,6 +37,7 @@ include(../../mne-cpp.pri)
 
 TEMPLATE = lib
 
+QT       += concurrent
 QT       -= gui
 
 DEFINES += UTILS_LIBRARY
@@ -63,12 +64,16 @@ win32 {
 
 SOURCES += kmeans.cpp \
     mnemath.cpp \
-    ioutils.cpp
+    ioutils.cpp \
+    parallel.cpp \
+    latencytracer.cpp
 
 HEADERS +=  kmeans.h\
             utils_global.h \
     mnemath.h \
-    ioutils.h
+    ioutils.h \
+    parallel.h \
+    latencytracer.h
 
 INCLUDEPATH += $${EIGEN_INCLUDE_DIR}
 INCLUDEPATH += $${MNE_INCLUDE_DIR}
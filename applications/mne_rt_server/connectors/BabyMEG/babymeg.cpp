@@ -51,6 +51,7 @@
 #include <fiff/fiff.h>
 #include <fiff/fiff_types.h>
 #include <utils/ioutils.h>
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -97,7 +98,8 @@ BabyMEG::BabyMEG()
     //BabyMEG Inits
     pInfo = new BabyMEGInfo();
     connect(pInfo, &BabyMEGInfo::fiffInfoAvailable, this, &BabyMEG::setFiffInfo);
-    connect(pInfo, &BabyMEGInfo::SendDataPackage, this, &BabyMEG::setFiffData);
+    // direct, the client decodes every package into the same matrix
+    connect(pInfo, &BabyMEGInfo::SendDataMatrix, this, &BabyMEG::setFiffData, Qt::DirectConnection);
     connect(pInfo, &BabyMEGInfo::SendCMDPackage, this, &BabyMEG::setCMDData);
 
     myClient = new BabyMEGClient(6340,this);
@@ -238,30 +240,17 @@ void BabyMEG::setFiffInfo(FiffInfo p_FiffInfo)
 
 //*************************************************************************************************************
 
-void BabyMEG::setFiffData(QByteArray DATA)
+void BabyMEG::setFiffData(const MatrixXf &DATA)
 {
-//    qDebug() << "[BabyMEG] Data Size:"<<DATA.size();
+//    qDebug() << "[BabyMEG] Matrix " << DATA.rows() << "x" << DATA.cols();
 
-    //get the first byte -- the data format
-    int dformat = DATA.left(1).toInt();
-
-    DATA.remove(0,1);
-    qint32 rows = m_FiffInfoBabyMEG.nchan;
-    qint32 cols = (DATA.size()/dformat)/rows;
-
-    qDebug() << "[BabyMEG] Matrix " << rows << "x" << cols << " [Data bytes:" << dformat << "]";
-
-    MatrixXf rawData(Map<MatrixXf>( (float*)DATA.data(),rows, cols ));
-
-    for(qint32 i = 0; i < rows*cols; ++i)
-        IOUtils::swap_floatp(rawData.data()+i);
-
-//   std::cout << "first ten elements \n" << rawData.block(0,0,1,10) << std::endl;
+//   std::cout << "first ten elements \n" << DATA.block(0,0,1,10) << std::endl;
 
     if(!m_pRawMatrixBuffer)
-        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(40, rows, cols));
+        m_pRawMatrixBuffer = CircularMatrixBuffer<float>::SPtr(new CircularMatrixBuffer<float>(40, DATA.rows(), DATA.cols()));
 
-    m_pRawMatrixBuffer->push(&rawData);
+    // the buffer is acquired when it arrives, its sequence number travels with it through the buffer
+    m_pRawMatrixBuffer->push(&DATA, LatencyTracer::acquire());
 
 }
 
@@ -338,17 +327,24 @@ void BabyMEG::run()
     m_bIsRunning = true;
 //    quint32 count = 0;
 
+    LatencyTracer* t_pTracer = LatencyTracer::stage("BabyMEG");
+
     while(m_bIsRunning)
     {
         if(m_pRawMatrixBuffer)
         {
-            QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(m_pRawMatrixBuffer->pop()));
+            QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf);
+            qint32 t_iSequence = -1;
+            m_pRawMatrixBuffer->pop(*t_pRawBuffer, &t_iSequence);
+            qint64 t_iEnter = LatencyTracer::now();
+            LatencyTracer::setKey(t_iSequence, t_pRawBuffer->data());
 
 //            ++count;
 //            printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
 //            std::cout << "first 100 elements \n" << t_rawBuffer.block(0,0,1,100) << std::endl;
 
             emit remitRawBuffer(t_pRawBuffer);
+            t_pTracer->record(t_iEnter, t_iSequence, m_pRawMatrixBuffer->available());
         }
     }
 }
@@ -133,7 +133,7 @@ public:
 
 
     void setFiffInfo(FIFFLIB::FiffInfo);
-    void setFiffData(QByteArray DATA);
+    void setFiffData(const Eigen::MatrixXf &DATA);
     void setCMDData(QByteArray DATA);
 
 protected:
@@ -50,10 +50,28 @@
 #include <QtNetwork/QtNetwork>
 #include <QtEndian>
 
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MNE INCLUDES
+//=============================================================================================================
+
+#include <utils/ioutils.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+
 //*************************************************************************************************************
 
 BabyMEGClient::BabyMEGClient(int myPort, QObject *parent) :
     QThread(parent)
+  , m_iReadPos(0)
+  , m_iWritePos(0)
 {
     connect(this,SIGNAL(DataAcq()),this,SLOT(run()));
     tcpSocket = new QTcpSocket(this);
@@ -201,7 +219,7 @@ void BabyMEGClient::ConnectToBabyMEG()
             qDebug()<< "Send the initial parameter request";
             if (tcpSocket->state()==QAbstractSocket::ConnectedState)
             {
-                buffer.clear();
+                m_iReadPos = m_iWritePos = 0;
 //                SendCommand("INFO");
                 SendCommand("DATA");
             }
@@ -280,21 +298,25 @@ void BabyMEGClient::SendCommandToBabyMEG()
 
 void BabyMEGClient::ReadToBuffer()
 {
-
-    QByteArray dat;
-
-    int numBytes = tcpSocket->bytesAvailable();
+    qint64 numBytes = tcpSocket->bytesAvailable();
 //    qDebug() << "1.byte available: " << numBytes;
     if (numBytes > 0){
-        dat = tcpSocket->read(numBytes); // read all pending data
-//        qDebug()<<"[dat Size]"<<dat.size();
-        if (!dat.isEmpty()){
-            buffer.append(dat); // and append it to your own buffer
-//            qDebug()<<"[ReadToBuffer: Buffer Size]"<<buffer.size();
-        }
-        else
+        reserveRing(m_iWritePos - m_iReadPos + numBytes);
+
+        // read all pending data straight into the ring, in two spans if it wraps around
+        const qint64 t_iSize = m_qByteArrayRing.size();
+        char* t_pRing = m_qByteArrayRing.data();
+        while(numBytes > 0)
         {
-            qDebug()<<"[Empty dat: error]"<<tcpSocket->errorString();
+            qint64 t_iOffset = m_iWritePos & (t_iSize - 1);
+            qint64 t_iRead = tcpSocket->read(t_pRing + t_iOffset, qMin(numBytes, t_iSize - t_iOffset));
+            if (t_iRead <= 0)
+            {
+                qDebug()<<"[Empty dat: error]"<<tcpSocket->errorString();
+                break;
+            }
+            m_iWritePos += t_iRead;
+            numBytes -= t_iRead;
         }
     }
 //    qDebug()<<"read buffer is done!";
@@ -303,172 +325,235 @@ void BabyMEGClient::ReadToBuffer()
     return;
 }
 
+
 //*************************************************************************************************************
 
-void BabyMEGClient::handleBuffer()
+void BabyMEGClient::reserveRing(qint64 p_iBytes)
 {
-    if(buffer.size()>= 8){
-        QByteArray CMD = buffer.left(4);
-        QByteArray DLEN = buffer.mid(4,4);
-        int tmp = MGH_LM_Byte2Int(DLEN);
-//        qDebug() << "First 4 bytes + length" << CMD << "["<<CMD.toHex()<<"]";
-//        qDebug() << "Command[" << CMD <<"]";
-//        qDebug() << "Body Length[" << tmp << "]";
+    const qint64 t_iSize = m_qByteArrayRing.size();
+    if(p_iBytes <= t_iSize)
+        return;
 
-        if (tmp <= (buffer.size() - 8))
-        {
-            buffer.remove(0,8);
-
-            int OPT = 0;
-
-            if (CMD == "INFO")
-                OPT = 1;
-            else if (CMD == "DATR")
-                OPT = 2;
-            else if (CMD == "COMD")
-                OPT = 3;
-            else if (CMD == "QUIT")
-                OPT = 4;
-            else if (CMD == "COMS")
-                OPT = 5;
-            else if (CMD == "QUIS")
-                OPT = 6;
-
-            switch (OPT){
-            case 1:
-                // from buffer get data package
-                {
-                QByteArray PARA = buffer.left(tmp);
-                qDebug()<<"[INFO]"<<PARA;
-                //Parse parameters from PARA string
-                myBabyMEGInfo->MGH_LM_Parse_Para(PARA);
-                buffer.remove(0,tmp);
-                qDebug()<<"INFO has been received!!!!";
-//                qDebug()<<"ACQ Start";
-//                SendCommand("DATA");
-                }
-                break;
-            case 2:
-                // read data package from buffer
-                // Ask for the next data block
+    qint64 t_iNewSize = MinRingSize;
+    while(t_iNewSize < p_iBytes)
+        t_iNewSize *= 2;
 
-                SendCommand("DATA");
-                DispatchDataPackage(tmp);
+    QByteArray t_qByteArrayRing;
+    t_qByteArrayRing.resize(t_iNewSize);
 
-                break;
-            case 3:
-                {
-                QByteArray RESP = buffer.left(tmp);
-                qDebug()<< "5.Readbytes:"<<RESP.size();
-                qDebug() << RESP;
-                }
-                buffer.remove(0,tmp);
+    const qint64 t_iPending = m_iWritePos - m_iReadPos;
+    if(t_iPending > 0)
+        peekRing(m_iReadPos, t_qByteArrayRing.data(), t_iPending);
 
-                break;
-            case 4:  //quit
-                qDebug()<<"Quit";
-
-                SendCommand("QREL");
-                tcpSocket->disconnectFromHost();
-                if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
-                            tcpSocket->waitForDisconnected();
-                SocketIsConnected = false;
-                qDebug()<< "Disconnect Server";
-                qDebug()<< "Client is End!";
-                qDebug()<< "You can close this application or restart to connect Server.";
+    m_qByteArrayRing = t_qByteArrayRing;
+    m_iReadPos = 0;
+    m_iWritePos = t_iPending;
+}
 
-                break;
-            case 5://command short connection
-                {
-                QByteArray RESP = buffer.left(tmp);
-                qDebug()<< "5.Readbytes:"<<RESP.size();
-                qDebug() << RESP;
-                myBabyMEGInfo->MGH_LM_Send_CMDPackage(RESP);
-                }
-                buffer.remove(0,tmp);
-                SendCommand("QUIT");
-                break;
-            case 6:  //quit
-                qDebug()<<"Quit";
-
-                SendCommand("QREL");
-                tcpSocket->disconnectFromHost();
-                if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
-                            tcpSocket->waitForDisconnected();
-                SocketIsConnected = false;
-                qDebug()<< "Disconnect Server";
-                break;
 
-            default:
-                qDebug()<< "Unknow Type";
-                break;
-            }
-        }
-    }// buffer is not empty and larger than 8 bytes
+//*************************************************************************************************************
 
+void BabyMEGClient::peekRing(qint64 p_iPos, char* p_pDest, qint64 p_iBytes) const
+{
+    const qint64 t_iSize = m_qByteArrayRing.size();
+    const qint64 t_iOffset = p_iPos & (t_iSize - 1);
+    const qint64 t_iFirst = qMin(p_iBytes, t_iSize - t_iOffset);
+
+    memcpy(p_pDest, m_qByteArrayRing.constData() + t_iOffset, t_iFirst);
+    memcpy(p_pDest + t_iFirst, m_qByteArrayRing.constData(), p_iBytes - t_iFirst);
 }
 
+
 //*************************************************************************************************************
 
-void BabyMEGClient::DispatchDataPackage(int tmp)
+QByteArray BabyMEGClient::readRing(qint64 p_iBytes)
 {
+    QByteArray t_qByteArray;
+    t_qByteArray.resize(p_iBytes);
+    peekRing(m_iReadPos, t_qByteArray.data(), p_iBytes);
+    m_iReadPos += p_iBytes;
 
-//    qDebug()<<"Acq data from buffer  [buffer size() =" << buffer.size()<<"]";
-    QByteArray DATA = buffer.left(tmp);
-    qDebug()<< "5.Readbytes:"<<DATA.size();
-    myBabyMEGInfo->MGH_LM_Send_DataPackage(DATA);
-//    myBabyMEGInfo->EnQueue(DATA);
-    buffer.remove(0,tmp);
-//    qDebug()<<"Rest buffer  [buffer size() =" << buffer.size()<<"]";
-    numBlock ++;
-    qDebug()<< "Next Block ..." << numBlock;
-//    DATA.clear();
-
-    ReadNextBlock(tmp);
+    return t_qByteArray;
 }
 
+
 //*************************************************************************************************************
 
-void BabyMEGClient::ReadNextBlock(int tmp)
+void BabyMEGClient::decodeRing(qint64 p_iPos, qint64 p_iCount, float* p_pDest) const
 {
-    QByteArray CMD1;
-    QByteArray DLEN1;
-    QByteArray DATA1;
-    int tmp1;
-    while (buffer.size()>=(tmp+8))
-    { // process the extra data block to reduce the load of data buffer
-        CMD1 = buffer.left(4);
-        qDebug()<<"CMD"<< CMD1;
-        if (CMD1 == "DATR")
+    const qint64 t_iSize = m_qByteArrayRing.size();
+
+    while(p_iCount > 0)
+    {
+        qint64 t_iOffset = p_iPos & (t_iSize - 1);
+        qint64 t_iSpan = qMin(p_iCount, (t_iSize - t_iOffset) / (qint64)sizeof(float));
+
+        if(t_iSpan > 0)
+            IOUtils::from_big_endian(m_qByteArrayRing.constData() + t_iOffset, t_iSpan, p_pDest);
+        else
         {
-            DLEN1 = buffer.mid(4,4);
-            tmp1 = MGH_LM_Byte2Int(DLEN1);
-            qDebug() << "[2]First 4 bytes + length" << CMD1 << "["<<CMD1.toHex()<<"]";
-            qDebug() << "[2]Command[" << CMD1 <<"]";
-            qDebug() << "[2]Body Length[" << tmp1 << "]";
-
-            buffer.remove(0,8);
-            DATA1 = buffer.left(tmp1);
-            myBabyMEGInfo->MGH_LM_Send_DataPackage(DATA1);
-//            myBabyMEGInfo->EnQueue(DATA1);
-            buffer.remove(0,tmp1);
-            qDebug()<<"End of DataPackeage" << buffer.left(3);
-            qDebug()<<"[2]Rest buffer  [buffer size() =" << buffer.size()<<"]";
-            numBlock ++;
-            qDebug()<< "[2]Next Block ..." << numBlock;
+            // the float straddles the end of the ring
+            char t_sample[sizeof(float)];
+            peekRing(p_iPos, t_sample, sizeof(float));
+            IOUtils::from_big_endian(t_sample, 1, p_pDest);
+            t_iSpan = 1;
         }
-        else
+
+        p_iPos += t_iSpan*sizeof(float);
+        p_pDest += t_iSpan;
+        p_iCount -= t_iSpan;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void BabyMEGClient::handleBuffer()
+{
+    bool t_bDataRequested = false;
+
+    while(m_iWritePos - m_iReadPos >= 8){
+        // parse the header in place: 4 byte command and 4 byte big endian body length
+        char t_header[8];
+        peekRing(m_iReadPos, t_header, 8);
+        QByteArray CMD = QByteArray::fromRawData(t_header, 4);
+        int tmp = qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(t_header + 4));
+//        qDebug() << "Command[" << CMD <<"]";
+//        qDebug() << "Body Length[" << tmp << "]";
+
+        if (tmp < 0)
         {
-            qDebug()<<"[CMD1]"<<CMD1.toHex();
+            qDebug()<< "Invalid body length" << tmp << "- drop the received data";
+            m_iReadPos = m_iWritePos;
+            return;
+        }
+
+        if (tmp > m_iWritePos - m_iReadPos - 8)
+            return; // wait for the rest of the package
+
+        m_iReadPos += 8;
+
+        int OPT = 0;
+
+        if (CMD == "INFO")
+            OPT = 1;
+        else if (CMD == "DATR")
+            OPT = 2;
+        else if (CMD == "COMD")
+            OPT = 3;
+        else if (CMD == "QUIT")
+            OPT = 4;
+        else if (CMD == "COMS")
+            OPT = 5;
+        else if (CMD == "QUIS")
+            OPT = 6;
+
+        switch (OPT){
+        case 1:
+            // from buffer get data package
+            {
+            QByteArray PARA = readRing(tmp);
+            qDebug()<<"[INFO]"<<PARA;
+            //Parse parameters from PARA string
+            myBabyMEGInfo->MGH_LM_Parse_Para(PARA);
+            qDebug()<<"INFO has been received!!!!";
+            }
+            break;
+        case 2:
+            // Ask for the next data block once, further blocks are already pending
+            if (!t_bDataRequested)
+            {
+                SendCommand("DATA");
+                t_bDataRequested = true;
+            }
+            DispatchDataPackage(tmp);
+
+            break;
+        case 3:
+            {
+            QByteArray RESP = readRing(tmp);
+            qDebug()<< "5.Readbytes:"<<RESP.size();
+            qDebug() << RESP;
+            }
+
+            break;
+        case 4:  //quit
+            qDebug()<<"Quit";
+            m_iReadPos += tmp;
+
+            SendCommand("QREL");
+            tcpSocket->disconnectFromHost();
+            if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
+                        tcpSocket->waitForDisconnected();
+            SocketIsConnected = false;
+            qDebug()<< "Disconnect Server";
+            qDebug()<< "Client is End!";
+            qDebug()<< "You can close this application or restart to connect Server.";
+
+            return;
+        case 5://command short connection
+            {
+            QByteArray RESP = readRing(tmp);
+            qDebug()<< "5.Readbytes:"<<RESP.size();
+            qDebug() << RESP;
+            myBabyMEGInfo->MGH_LM_Send_CMDPackage(RESP);
+            }
+            SendCommand("QUIT");
+            break;
+        case 6:  //quit
+            qDebug()<<"Quit";
+            m_iReadPos += tmp;
+
+            SendCommand("QREL");
+            tcpSocket->disconnectFromHost();
+            if(tcpSocket->state() != QAbstractSocket::UnconnectedState)
+                        tcpSocket->waitForDisconnected();
+            SocketIsConnected = false;
+            qDebug()<< "Disconnect Server";
+
+            return;
+
+        default:
+            qDebug()<< "Unknow Type" << CMD.toHex();
+            m_iReadPos += tmp;
             break;
         }
-        qDebug()<<"[ReadNextBlock:buffer size]"<<buffer.size();
+    }// buffer holds at least a header
+
+}
+
+
+//*************************************************************************************************************
+
+void BabyMEGClient::DispatchDataPackage(int tmp)
+{
+    //get the first byte -- the data format, i.e. the number of bytes per sample
+    char t_cFormat = 0;
+    if (tmp > 0)
+        peekRing(m_iReadPos, &t_cFormat, 1);
+    int dformat = t_cFormat - '0';
+
+    qint32 rows = myBabyMEGInfo->chnNum;
+    if (dformat != (int)sizeof(float) || rows <= 0)
+    {
+        qDebug()<< "Skip data package [Data bytes:" << dformat << "Channels:" << rows << "]";
+        m_iReadPos += tmp;
+        return;
     }
-    DATA1.clear();
-    CMD1.clear();
-    DLEN1.clear();
+    qint32 cols = ((tmp - 1)/dformat)/rows;
+
+    if (m_matRawData.rows() != rows || m_matRawData.cols() != cols)
+        m_matRawData.resize(rows, cols);
+
+    decodeRing(m_iReadPos + 1, (qint64)rows*cols, m_matRawData.data());
+    m_iReadPos += tmp;
+
+    myBabyMEGInfo->MGH_LM_Send_DataMatrix(m_matRawData);
+
+    numBlock ++;
 }
 
+
 //*************************************************************************************************************
 
 void BabyMEGClient::SendCommand(QString s)
@@ -503,7 +588,7 @@ void BabyMEGClient::SendCommand(QString s)
             qDebug()<<"Not in Connected state";
             //re-connect to server
             ConnectToBabyMEG();
-            buffer.clear();
+            m_iReadPos = m_iWritePos = 0;
             SendCommand("DATA");
         }
 //    sleep(1);
@@ -57,6 +57,14 @@
 #include "babymeginfo.h"
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
 class QTcpSocket;
 class QNetworkSession;
 
@@ -86,13 +94,58 @@ public:
     bool DataAcqStartFlag;
     BabyMEGInfo *myBabyMEGInfo;
 
-    QByteArray buffer;
     int numBlock;
     bool DataACK;
 
 private:
     QTcpSocket *tcpSocket;
     QMutex m_qMutex;
+
+    static const qint64 MinRingSize = 1048576;  /**< Initial size of the receive ring, it grows by powers of two. */
+
+    QByteArray m_qByteArrayRing;    /**< Receive ring, packages are parsed in place and never shifted. */
+    qint64 m_iReadPos;              /**< Total number of bytes consumed from the ring. */
+    qint64 m_iWritePos;             /**< Total number of bytes received into the ring. */
+    Eigen::MatrixXf m_matRawData;   /**< Preallocated matrix the data packages are decoded to. */
+
+    //=========================================================================================================
+    /**
+    * Makes sure the ring holds at least the given number of bytes. Growing linearizes the pending bytes,
+    * which happens only until the ring fits the largest package.
+    *
+    * @param[in] p_iBytes   Number of bytes the ring has to hold
+    */
+    void reserveRing(qint64 p_iBytes);
+
+    //=========================================================================================================
+    /**
+    * Copies bytes out of the ring, handling the wrap around.
+    *
+    * @param[in] p_iPos     Stream position of the first byte
+    * @param[out] p_pDest   Destination of at least p_iBytes bytes
+    * @param[in] p_iBytes   Number of bytes to copy
+    */
+    void peekRing(qint64 p_iPos, char* p_pDest, qint64 p_iBytes) const;
+
+    //=========================================================================================================
+    /**
+    * Consumes the given number of bytes from the ring.
+    *
+    * @param[in] p_iBytes   Number of bytes to consume
+    *
+    * @return the consumed bytes
+    */
+    QByteArray readRing(qint64 p_iBytes);
+
+    //=========================================================================================================
+    /**
+    * Byte swaps big endian floats out of the ring straight into the destination, span by span.
+    *
+    * @param[in] p_iPos     Stream position of the first float
+    * @param[in] p_iCount   Number of floats
+    * @param[out] p_pDest   Destination of at least p_iCount floats
+    */
+    void decodeRing(qint64 p_iPos, qint64 p_iCount, float* p_pDest) const;
 signals:
     void DataAcq();
     void error(int socketError, const QString &message);
@@ -175,25 +228,19 @@ public:
     */
     void SetInfo(BabyMEGInfo *pInfo);
     /**
-    * Dispatch the data package
+    * Decode the data package at the read position of the ring and dispatch it
     *
     * @param[in] tmp -- block size
     */
     void DispatchDataPackage(int tmp);
     /**
-    * Read next data block
-    *
-    * @param[in] tmp -- block size
-    */
-    void ReadNextBlock(int tmp);
-    /**
     * Send command with command format as string
     *
     * @param[in] s -- string
     */
     void SendCommand(QString s);
     /**
-    * Handle the data buffer connecting to the TCP socket
+    * Handle all complete packages of the data buffer connecting to the TCP socket
     *
     * @param[in] void
     */
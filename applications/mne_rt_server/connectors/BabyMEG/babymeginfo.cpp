@@ -41,7 +41,8 @@
 //*************************************************************************************************************
 
 BabyMEGInfo::BabyMEGInfo()
-: g_maxlen(500)
+: chnNum(0)
+, g_maxlen(500)
 {
 }
 //*************************************************************************************************************
@@ -53,10 +54,10 @@ void BabyMEGInfo::MGH_LM_Send_CMDPackage(QByteArray DATA)
 }
 //*************************************************************************************************************
 
-void BabyMEGInfo::MGH_LM_Send_DataPackage(QByteArray DATA)
+void BabyMEGInfo::MGH_LM_Send_DataMatrix(const Eigen::MatrixXf &DATA)
 {
-//    qDebug()<<"[BabyMEGInfo]Data Size:"<<DATA.size();
-    emit SendDataPackage(DATA);
+//    qDebug()<<"[BabyMEGInfo]Data Size:"<<DATA.rows()<<"x"<<DATA.cols();
+    emit SendDataMatrix(DATA);
 }
 
 //*************************************************************************************************************
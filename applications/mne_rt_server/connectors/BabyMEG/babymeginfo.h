@@ -96,7 +96,7 @@ public:
 
 signals:
     void fiffInfoAvailable(FIFFLIB::FiffInfo);
-    void SendDataPackage(QByteArray DATA);
+    void SendDataMatrix(const Eigen::MatrixXf &DATA);
     void SendCMDPackage(QByteArray DATA);
 
 public:
@@ -132,11 +132,11 @@ public:
     void MGH_LM_Parse_Para(QByteArray cmdstr);
     //=========================================================================================================
     /**
-    * Send data package
+    * Send decoded data package, connected receivers have to consume it before the next package is decoded
     *
-    * @param[in] DATA - QByteArray contains MEG data.
+    * @param[in] DATA - Matrix contains MEG data (channels x samples).
     */
-    void MGH_LM_Send_DataPackage(QByteArray DATA);
+    void MGH_LM_Send_DataMatrix(const Eigen::MatrixXf &DATA);
     //=========================================================================================================
     /**
     * Send command reply package
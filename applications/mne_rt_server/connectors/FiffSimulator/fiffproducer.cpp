@@ -40,6 +40,7 @@
 
 #include "fiffproducer.h"
 #include "fiffsimulator.h"
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -56,6 +57,7 @@
 //=============================================================================================================
 
 using namespace FiffSimulatorPlugin;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -123,7 +125,8 @@ void FiffProducer::run()
     //
 
     fiff_int_t first, last;
-    MatrixXd data;
+    MatrixXf data;
+    MatrixXf data2;
     MatrixXd times;
 
     first = from;
@@ -159,8 +162,6 @@ void FiffProducer::run()
             printf("error during read_raw_segment\n");
         }
 
-        MatrixXf tmp = data.cast<float>();//(inv_calsMat*data).cast<float>();
-
         if(t_bRestart)
         {
             //
@@ -171,19 +172,14 @@ void FiffProducer::run()
             first = from;
             last = first+t_iDiff-1;
 
-            if (!m_pFiffSimulator->m_RawInfo.read_raw_segment(data,times,first,last))
+            if (!m_pFiffSimulator->m_RawInfo.read_raw_segment(data2,times,first,last))
             {
                 printf("error during read_raw_segment\n");
             }
 
-            MatrixXf tmp2 = data.cast<float>();//(inv_calsMat*data).cast<float>();
-
-            MatrixXf tmp3(tmp.rows(), tmp.cols()+tmp2.cols());
-
-            tmp3.block(0,0,tmp.rows(),tmp.cols()) = tmp;
-            tmp3.block(0,tmp.cols(),tmp.rows(),tmp2.cols()) = tmp2;
-
-            tmp = tmp3;
+            qint32 t_iCols = data.cols();
+            data.conservativeResize(data.rows(), t_iCols+data2.cols());
+            data.block(0,t_iCols,data.rows(),data2.cols()) = data2;
 
             t_bRestart = false;
             first += t_iDiff;
@@ -193,8 +189,8 @@ void FiffProducer::run()
             first += quantum;
         }
 
-        // call blocks until there is free space in the buffer
-        m_pFiffSimulator->m_pRawMatrixBuffer->push(&tmp);
+        // the simulated buffer is acquired when it is read; call blocks until there is free space in the buffer
+        m_pFiffSimulator->m_pRawMatrixBuffer->push(&data, LatencyTracer::acquire());
     }
 
     // close datastream in this thread
@@ -62,6 +62,14 @@
 #include <mne/mne_epoch_data_list.h>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// UTILS INCLUDES
+//=============================================================================================================
+
+#include <utils/latencytracer.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // QT INCLUDES
@@ -81,6 +89,7 @@
 using namespace FiffSimulatorPlugin;
 using namespace FIFFLIB;
 using namespace MNELIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -473,13 +482,22 @@ void FiffSimulator::run()
 
 //    quint32 count = 0;
 
+    LatencyTracer* t_pTracer = LatencyTracer::stage("FiffSimulator");
+
     while(m_bIsRunning)
     {
-        QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(m_pRawMatrixBuffer->pop()));
+        QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf);
+        qint32 t_iSequence = -1;
+        m_pRawMatrixBuffer->pop(*t_pRawBuffer, &t_iSequence);
 //        ++count;
 //        printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
 
+        qint64 t_iEnter = LatencyTracer::now();
+        LatencyTracer::setKey(t_iSequence, t_pRawBuffer->data());
+
         emit remitRawBuffer(t_pRawBuffer);
+        t_pTracer->record(t_iEnter, t_iSequence, m_pRawMatrixBuffer->available());
+
         usleep(uiSamplePeriod);
     }
 }
@@ -44,6 +44,7 @@
 #include "shmemsocket.h"
 #include <fiff/fiff_constants.h>
 #include <fiff/fiff_stream.h>
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -63,6 +64,7 @@
 //=============================================================================================================
 
 using namespace NeuromagPlugin;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -419,11 +421,12 @@ void DacqServer::run()
                     t_nSamplesNew = t_nSamples + m_pNeuromag->m_uiBufferSampleSize - 1;
                     printf("Reading %d ... %d  =  %9.3f ... %9.3f secs...", t_nSamples, t_nSamplesNew, ((float)t_nSamples) / sfreq, ((float)t_nSamplesNew) / sfreq );
                     t_nSamples += m_pNeuromag->m_uiBufferSampleSize;
-                    
+
+                    qint32 t_iSequence = LatencyTracer::acquire();
                     MatrixXf* t_pMatrix = new MatrixXf( (Map<MatrixXi>( (int*) t_pTag->data(), nchan, m_pNeuromag->m_uiBufferSampleSize)).cast<float>());
 
 //                    std::cout << "Matrix Xf " << t_pMatrix->block(0,0,1,4);
-                    m_pNeuromag->m_pRawMatrixBuffer->push(t_pMatrix);
+                    m_pNeuromag->m_pRawMatrixBuffer->push(t_pMatrix, t_iSequence);
 
                     delete t_pMatrix;
                     printf(" [done]\r\n");
@@ -61,6 +61,14 @@
 #include <mne/mne_epoch_data_list.h>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// UTILS INCLUDES
+//=============================================================================================================
+
+#include <utils/latencytracer.h>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // QT INCLUDES
@@ -79,6 +87,7 @@
 using namespace NeuromagPlugin;
 using namespace FIFFLIB;
 using namespace MNELIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -276,16 +285,24 @@ void Neuromag::run()
 
     qint32 count = 0;
 
+    LatencyTracer* t_pTracer = LatencyTracer::stage("Neuromag");
+
     while(m_bIsRunning)
     {
         if(m_pRawMatrixBuffer)
         {
             // Pop available Buffers
-            QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf(m_pRawMatrixBuffer->pop()));
+            QSharedPointer<Eigen::MatrixXf> t_pRawBuffer(new Eigen::MatrixXf);
+            qint32 t_iSequence = -1;
+            m_pRawMatrixBuffer->pop(*t_pRawBuffer, &t_iSequence);
 //            ++count;
 //            printf("%d raw buffer (%d x %d) generated\r\n", count, t_pRawBuffer->rows(), t_pRawBuffer->cols());
 
+            qint64 t_iEnter = LatencyTracer::now();
+            LatencyTracer::setKey(t_iSequence, t_pRawBuffer->data());
+
             emit remitRawBuffer(t_pRawBuffer);
+            t_pTracer->record(t_iEnter, t_iSequence, m_pRawMatrixBuffer->available());
         }
     }
 }
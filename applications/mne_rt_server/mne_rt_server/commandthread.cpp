@@ -67,6 +67,8 @@ CommandThread::CommandThread(int socketDescriptor, qint32 p_iId, QObject *parent
 , socketDescriptor(socketDescriptor)
 , m_bIsRunning(false)
 , m_iThreadID(p_iId)
+, m_pTcpSocket(NULL)
+, m_pSendTimer(NULL)
 {
 
 }
@@ -77,6 +79,7 @@ CommandThread::CommandThread(int socketDescriptor, qint32 p_iId, QObject *parent
 CommandThread::~CommandThread()
 {
     m_bIsRunning = false;
+    QThread::quit();
     QThread::wait();
 }
 
@@ -89,6 +92,10 @@ void CommandThread::attachCommandReply(QByteArray p_blockReply, qint32 p_iID)
     {
         m_qMutex.lock();
         m_qSendBlock.append(p_blockReply);
+
+        // wake up the thread's event loop
+        if(m_pSendTimer)
+            QMetaObject::invokeMethod(m_pSendTimer, "start", Qt::QueuedConnection);
         m_qMutex.unlock();
     }
 }
@@ -113,52 +120,76 @@ void CommandThread::run()
                t_qTcpSocket.peerPort());
     }
 
-    QDataStream t_FiffStreamIn(&t_qTcpSocket);
+    t_qTcpSocket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    QTimer t_qSendTimer;
+    t_qSendTimer.setSingleShot(true);
+    t_qSendTimer.setInterval(0);
+
+    //
+    // Event-driven: the socket and the send timer live in this thread, the slots are called by its event loop
+    //
+    connect(&t_qTcpSocket, &QTcpSocket::readyRead, this, &CommandThread::readProc, Qt::DirectConnection);
+    connect(&t_qTcpSocket, &QTcpSocket::disconnected, this, &CommandThread::quit, Qt::DirectConnection);
+    connect(&t_qSendTimer, &QTimer::timeout, this, &CommandThread::sendData, Qt::DirectConnection);
+
+    m_qMutex.lock();
+    m_pTcpSocket = &t_qTcpSocket;
+    m_pSendTimer = &t_qSendTimer;
+    m_qMutex.unlock();
+
+    // replies attached and commands received before the event loop started
+    sendData();
+    readProc();
+
+    if(m_bIsRunning)
+        exec();
+
+    m_qMutex.lock();
+    m_pSendTimer = NULL;
+    m_qMutex.unlock();
+
+    t_qTcpSocket.disconnectFromHost();
+    if(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState)
+        t_qTcpSocket.waitForDisconnected();
+
+    m_pTcpSocket = NULL;
+}
+
+
+//*************************************************************************************************************
+
+void CommandThread::sendData()
+{
+    m_qMutex.lock();
+    if(m_qSendBlock.size() > 0)
+    {
+        m_pTcpSocket->write(m_qSendBlock);
+        m_qSendBlock.clear();
+    }
+    m_qMutex.unlock();
+
+    if(m_pTcpSocket->bytesToWrite() > 0)
+        m_pTcpSocket->flush();
+}
 
-    qint64 t_iMaxBufSize = 1024;
 
-    while(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
+//*************************************************************************************************************
+
+void CommandThread::readProc()
+{
+    while(m_pTcpSocket->canReadLine())
     {
-        //
-        // Write available data
-        //
-        if(m_qSendBlock.size() > 0)
-        {
-            qint32 t_iBlockSize = m_qSendBlock.size();
-            m_qMutex.lock();
-            qint32 t_iBytesWritten = t_qTcpSocket.write(m_qSendBlock);
-            t_qTcpSocket.waitForBytesWritten();
-            if(t_iBytesWritten == t_iBlockSize)
-                m_qSendBlock.clear();
-            else
-                m_qSendBlock = m_qSendBlock.mid(t_iBytesWritten, t_iBlockSize-t_iBytesWritten);
-            m_qMutex.unlock();
-        }
+        QByteArray t_qByteArrayRaw = m_pTcpSocket->readLine(MaxBufSize);
+        QString t_sCommand = QString(t_qByteArrayRaw).simplified();
 
         //
-        // Read: Wait 100ms for incomming tag header, read and continue
+        // Parse command
         //
-        //ToDo its not the best solution in terms of receiving the command for sure
-        t_qTcpSocket.waitForReadyRead(100);
-
-        if (t_qTcpSocket.bytesAvailable() > 0 && t_qTcpSocket.canReadLine())
-        {
-            QByteArray t_qByteArrayRaw = t_qTcpSocket.readLine(t_iMaxBufSize);
-            QString t_sCommand = QString(t_qByteArrayRaw).simplified();
-
-            //
-            // Parse command
-            //
-            if(!t_sCommand.isEmpty())
-                emit newCommand(t_sCommand, m_iThreadID);
-        }
-        else if(t_qTcpSocket.bytesAvailable() > t_iMaxBufSize)
-        {
-            t_qTcpSocket.readAll();//readAll that QTcpSocket is empty again -> prevent overflow
-        }
+        if(!t_sCommand.isEmpty())
+            emit newCommand(t_sCommand, m_iThreadID);
     }
 
-    t_qTcpSocket.disconnectFromHost();
-    if(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState)
-        t_qTcpSocket.waitForDisconnected();
+    if(m_pTcpSocket->bytesAvailable() > MaxBufSize)
+        m_pTcpSocket->readAll();//readAll that QTcpSocket is empty again -> prevent overflow
 }
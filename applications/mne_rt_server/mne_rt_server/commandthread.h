@@ -44,6 +44,7 @@
 #include <QThread>
 #include <QMutex>
 #include <QTcpSocket>
+#include <QTimer>
 
 
 //*************************************************************************************************************
@@ -73,6 +74,20 @@ signals:
     void newCommand(QString p_sCommand, qint32 p_iThreadID);
 
 private:
+    //=========================================================================================================
+    /**
+    * Writes the attached replies to the socket. Called in the thread's event loop when replies were attached.
+    */
+    void sendData();
+
+    //=========================================================================================================
+    /**
+    * Reads all complete command lines available on the socket and emits them, without waiting for further
+    * data. Called in the thread's event loop when the socket received data.
+    */
+    void readProc();
+
+    static const qint64 MaxBufSize = 1024;  /**< Maximal length of a command line. */
 
     int socketDescriptor;
 
@@ -82,6 +97,9 @@ private:
     QMutex m_qMutex;
     QByteArray m_qSendBlock;
 
+    QTcpSocket* m_pTcpSocket;           /**< The client socket, owned by run(). */
+    QTimer* m_pSendTimer;               /**< Zero timer in the thread's event loop, started to send attached replies. */
+
 };
 
 } // NAMESPACE
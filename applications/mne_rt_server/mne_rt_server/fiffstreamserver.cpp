@@ -43,6 +43,16 @@
 
 #include "mne_rt_server.h"
 
+#include <utils/latencytracer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QSet>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -59,6 +69,7 @@
 
 using namespace RTSERVER;
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -69,6 +80,7 @@ using namespace FIFFLIB;
 FiffStreamServer::FiffStreamServer(QObject *parent)
 : QTcpServer(parent)
 , m_iNextClientId(0)
+, m_pLatencyTracer(LatencyTracer::stage("FiffStreamServer"))
 {
 
 }
@@ -88,11 +100,11 @@ void FiffStreamServer::comClist(Command p_command)
 {
     //ToDo JSON
     QString t_sOutput("");
-    t_sOutput.append("\tID\tAlias\r\n");
+    t_sOutput.append("\tID\tAlias\tDropped\r\n");
     QMap<qint32, FiffStreamThread*>::iterator i;
     for (i = this->m_qClientList.begin(); i != this->m_qClientList.end(); ++i)
     {
-        QString str = QString("\t%1\t%2\r\n").arg(i.key()).arg(i.value()->getAlias());
+        QString str = QString("\t%1\t%2\t%3\r\n").arg(i.key()).arg(i.value()->getAlias()).arg(i.value()->getNumDroppedRawBuffers());
         t_sOutput.append(str);
     }
     t_sOutput.append("\n");
@@ -372,7 +384,31 @@ void FiffStreamServer::forwardMeasInfo(qint32 ID, FiffInfo p_fiffInfo)
 //ToDo increase preformance --> try inline
 void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
 {
-    emit remitRawBuffer(m_pMatRawData);
+    qint64 t_iEnter = LatencyTracer::now();
+
+    QSet<qint32> t_qSetStreamModes;
+    QMap<qint32, FiffStreamThread*>::const_iterator i;
+    for (i = m_qClientList.constBegin(); i != m_qClientList.constEnd(); ++i)
+        if(i.value()->isSendingRawBuffer())
+            t_qSetStreamModes.insert(i.value()->getStreamMode());
+    if(t_qSetStreamModes.isEmpty())
+        return;
+
+    //
+    // Encode once per stream mode, all clients of a mode queue the same (implicitly shared) block
+    //
+    qint32 t_iSequence = LatencyTracer::sequence(m_pMatRawData->data());
+    QSet<qint32>::const_iterator t_itMode;
+    for(t_itMode = t_qSetStreamModes.constBegin(); t_itMode != t_qSetStreamModes.constEnd(); ++t_itMode)
+    {
+        QByteArray t_qRawBufferBlock;
+        t_qRawBufferBlock.reserve(4*sizeof(qint32) + m_pMatRawData->size()*sizeof(float));
+        FiffStream t_FiffStreamOut(&t_qRawBufferBlock, QIODevice::WriteOnly);
+        t_FiffStreamOut.write_rt_raw_buffer(*m_pMatRawData, *t_itMode);
+
+        emit remitRawBuffer(t_qRawBufferBlock, *t_itMode, t_iSequence);
+    }
+    m_pLatencyTracer->record(t_iEnter, t_iSequence);
 }
 
 
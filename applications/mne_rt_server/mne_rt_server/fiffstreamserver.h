@@ -43,6 +43,7 @@
 
 #include <fiff/fiff_info.h>
 #include <rtCommand/commandmanager.h>
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -69,6 +70,7 @@ namespace RTSERVER
 
 using namespace FIFFLIB;
 using namespace RTCOMMANDLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -123,6 +125,13 @@ public:
 
 //public slots: --> in Qt 5 not anymore declared as slot
     void forwardMeasInfo(qint32 ID, FiffInfo p_fiffInfo);
+    //=========================================================================================================
+    /**
+    * Encodes a raw buffer once for each raw stream mode requested by the clients and hands the same block to
+    * all clients of that mode.
+    *
+    * @param[in] m_pMatRawData  The raw buffer
+    */
     void forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
 
 signals:
@@ -132,7 +141,7 @@ signals:
     void stopMeasFiffStreamClient(qint32 ID);
 
     void remitMeasInfo(qint32 ID, FIFFLIB::FiffInfo p_fiffInfo);
-    void remitRawBuffer(QSharedPointer<Eigen::MatrixXf>);
+    void remitRawBuffer(QByteArray p_qRawBufferBlock, qint32 p_iStreamMode, qint32 p_iSequence);
 
     void closeFiffStreamServer();
 
@@ -186,6 +195,8 @@ private:
     QMap<qint32, FiffStreamThread*> m_qClientList;
     qint32                          m_iNextClientId;
 
+    LatencyTracer*                  m_pLatencyTracer;   /**< Traces the forwarding of the raw buffers. */
+
 };
 
 
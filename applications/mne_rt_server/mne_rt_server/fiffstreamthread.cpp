@@ -82,8 +82,14 @@ FiffStreamThread::FiffStreamThread(qint32 id, int socketDescriptor, QObject *par
 , m_iDataClientId(id)
 , m_sDataClientAlias(QString(""))
 , m_bIsSendingRawBuffer(false)
+, m_iStreamMode(FIFFV_MNE_RT_STREAM_FLOAT)
 , m_iSocketDescriptor(socketDescriptor)
 , m_bIsRunning(false)
+, m_pTcpSocket(NULL)
+, m_pSendTimer(NULL)
+, m_iNumQueuedRawBuffers(0)
+, m_iNumDroppedRawBuffers(0)
+, m_pLatencyTracer(LatencyTracer::stage(QString("FiffStreamThread %1").arg(id)))
 {
 }
 
@@ -98,6 +104,7 @@ FiffStreamThread::~FiffStreamThread()
         t_pFiffStreamServer->m_qClientList.remove(m_iDataClientId);
 
     m_bIsRunning = false;
+    QThread::quit();
     QThread::wait();
 }
 
@@ -110,12 +117,12 @@ void FiffStreamThread::startMeas(qint32 ID)
     {
         qDebug() << "Activate raw buffer sending.";
 
-        m_qMutex.lock();
         // ToDo send start meas
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_qBlock;
+        FiffStream t_FiffStreamOut(&t_qBlock, QIODevice::WriteOnly);
         t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        enqueue(t_qBlock, false);
         m_bIsSendingRawBuffer = true;
-        m_qMutex.unlock();
     }
 }
 
@@ -129,11 +136,11 @@ void FiffStreamThread::stopMeas(qint32 ID)
     {
         qDebug() << "stop raw buffer sending.";
 
-        m_qMutex.lock();
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
         m_bIsSendingRawBuffer = false;
-        m_qMutex.unlock();
+        QByteArray t_qBlock;
+        FiffStream t_FiffStreamOut(&t_qBlock, QIODevice::WriteOnly);
+        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        enqueue(t_qBlock, false);
     }
 }
 
@@ -164,6 +171,21 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
             printf("FiffStreamClient (ID %d): send client ID %d\r\n\n", m_iDataClientId, m_iDataClientId);
             writeClientId();
         }
+        else if(t_iCmd == MNE_RT_SET_STREAM_MODE)
+        {
+            //
+            // Set raw stream mode
+            //
+            bool t_bOk;
+            qint32 t_iMode = QString(p_pTag->mid(4, p_pTag->size()-4)).toInt(&t_bOk);
+            if(t_bOk && t_iMode >= FIFFV_MNE_RT_STREAM_FLOAT && t_iMode <= FIFFV_MNE_RT_STREAM_LOSSLESS)
+            {
+                m_iStreamMode = t_iMode;
+                printf("FiffStreamClient (ID %d): new stream mode = %d\r\n\n", m_iDataClientId, m_iStreamMode);
+            }
+            else
+                printf("FiffStreamClient (ID %d): unknown stream mode\r\n\n", m_iDataClientId);
+        }
         else
         {
             printf("FiffStreamClient (ID %d): unknown command\r\n\n", m_iDataClientId);
@@ -178,44 +200,83 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
 
 //*************************************************************************************************************
 
-void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
+void FiffStreamThread::sendRawBuffer(QByteArray p_qRawBufferBlock, qint32 p_iStreamMode, qint32 p_iSequence)
 {
-    if(m_bIsSendingRawBuffer)
+    if(m_bIsSendingRawBuffer && p_iStreamMode == m_iStreamMode)
     {
-//        qDebug() << "Send RawBuffer to client";
+        qint64 t_iEnter = LatencyTracer::now();
 
-        m_qMutex.lock();
+        enqueue(p_qRawBufferBlock, true);
 
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
+        // raw buffers waiting in the send queue, besides the one just added
+        m_pLatencyTracer->record(t_iEnter, p_iSequence, qMax(m_iNumQueuedRawBuffers - 1, 0));
+    }
+}
 
-        m_qMutex.unlock();
 
+//*************************************************************************************************************
+
+void FiffStreamThread::enqueue(const QByteArray &p_qBlock, bool p_bRawBuffer)
+{
+    SendBlock t_sendBlock;
+    t_sendBlock.qBlock = p_qBlock;
+    t_sendBlock.bRawBuffer = p_bRawBuffer;
+
+    m_qMutex.lock();
+    if(p_bRawBuffer)
+    {
+        if(m_iNumQueuedRawBuffers >= MaxQueuedRawBuffers)
+        {
+            //
+            // Slow consumer: drop the oldest queued raw buffer, the blocks in the queue weren't touched yet
+            //
+            for(qint32 i = 0; i < m_qQueueSendBlocks.size(); ++i)
+            {
+                if(m_qQueueSendBlocks[i].bRawBuffer)
+                {
+                    m_qQueueSendBlocks.removeAt(i);
+                    --m_iNumQueuedRawBuffers;
+                    break;
+                }
+            }
+            if(m_iNumDroppedRawBuffers++ == 0)
+                printf("FiffStreamClient (ID %d): client is too slow, dropping raw buffers\r\n\n", m_iDataClientId);
+        }
+        ++m_iNumQueuedRawBuffers;
     }
-//    else
-//    {
-//        qDebug() << "Send RawBuffer is not activated";
-//    }
+    m_qQueueSendBlocks.enqueue(t_sendBlock);
+
+    // wake up the thread's event loop
+    if(m_pSendTimer)
+        QMetaObject::invokeMethod(m_pSendTimer, "start", Qt::QueuedConnection);
+    m_qMutex.unlock();
 }
 
 
 //*************************************************************************************************************
 
-void FiffStreamThread::sendData(QTcpSocket& p_qTcpSocket)
+void FiffStreamThread::sendData()
 {
-    if(p_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
+    QTcpSocket& p_qTcpSocket = *m_pTcpSocket;
+
+    while(p_qTcpSocket.bytesToWrite() < MaxBytesToWrite)
     {
         m_qMutex.lock();
-        qint32 t_iBlockSize = m_qSendBlock.size();
-        if(t_iBlockSize > 0)
+        if(m_qQueueSendBlocks.isEmpty())
         {
-//            qDebug() << "data available" << t_iBlockSize;
-            qint32 t_iBytesWritten = p_qTcpSocket.write(m_qSendBlock);
-            qDebug()<<"[Block to write]"<<t_iBlockSize<<"[bytes has been Written]"<<t_iBytesWritten;
-            p_qTcpSocket.waitForBytesWritten();
+            m_qMutex.unlock();
+            break;
         }
+        SendBlock t_sendBlock = m_qQueueSendBlocks.dequeue();
+        if(t_sendBlock.bRawBuffer)
+            --m_iNumQueuedRawBuffers;
         m_qMutex.unlock();
+
+        p_qTcpSocket.write(t_sendBlock.qBlock);
     }
+
+    if(p_qTcpSocket.bytesToWrite() > 0)
+        p_qTcpSocket.flush();
 }
 
 
@@ -225,9 +286,8 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
 {
     if(ID == m_iDataClientId)
     {
-        m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_qBlock;
+        FiffStream t_FiffStreamOut(&t_qBlock, QIODevice::WriteOnly);
 
 //        qint32 init_info[2];
 //        init_info[0] = FIFF_MNE_RT_CLIENT_ID;
@@ -238,9 +298,9 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
 //FiffStream::start_writing_raw
 
         p_fiffInfo.writeToStream(&t_FiffStreamOut);
-        m_qMutex.unlock();
+        enqueue(t_qBlock, false);
 
-//        qDebug() << "MeasInfo Blocksize: " << m_qSendBlock.size();
+//        qDebug() << "MeasInfo Blocksize: " << t_qBlock.size();
     }
 }
 
@@ -249,36 +309,32 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo)
 
 void FiffStreamThread::writeClientId()
 {
-    FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+    QByteArray t_qBlock;
+    FiffStream t_FiffStreamOut(&t_qBlock, QIODevice::WriteOnly);
 
     t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    enqueue(t_qBlock, false);
 }
 
 
 //*************************************************************************************************************
 
-void FiffStreamThread::readProc(QTcpSocket& p_qTcpSocket)
+void FiffStreamThread::readProc()
 {
-    FiffStream t_FiffStreamIn(&p_qTcpSocket);
-
-    //
-    // Read: Wait 10ms for incomming tag header, read and continue
-    //
-    p_qTcpSocket.waitForReadyRead(10);
+    FiffStream t_FiffStreamIn(m_pTcpSocket);
 
-    if (p_qTcpSocket.bytesAvailable() >= (int)sizeof(qint32)*4)
+    while(m_pTcpSocket->bytesAvailable() >= (int)sizeof(qint32)*4)
     {
-        qDebug() << "goes to read bytes " ;
-        FiffTag::SPtr t_pTag;
-        FiffTag::read_tag_info(&t_FiffStreamIn, t_pTag, false);
-
         //
-        // wait until tag size data are available and read the data
+        // Wait for the next readyRead until the whole tag is available
         //
-        while (p_qTcpSocket.bytesAvailable() < t_pTag->size())
-        {
-            p_qTcpSocket.waitForReadyRead(10);
-        }
+        QByteArray t_qByteArrayHeader = m_pTcpSocket->peek(sizeof(qint32)*4);
+        qint32 t_iSize = qFromBigEndian<qint32>((const uchar*)t_qByteArrayHeader.constData() + 2*sizeof(qint32));
+        if(m_pTcpSocket->bytesAvailable() < (int)sizeof(qint32)*4 + t_iSize)
+            break;
+
+        FiffTag::SPtr t_pTag;
+        FiffTag::read_tag_info(&t_FiffStreamIn, t_pTag, false);
         FiffTag::read_tag_data(&t_FiffStreamIn, t_pTag);
 
         //
@@ -322,66 +378,39 @@ void FiffStreamThread::run()
                t_qTcpSocket.peerPort());
     }
 
-    FiffStream t_FiffStreamIn(&t_qTcpSocket);
+    t_qTcpSocket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
 
-//    int i = 0;
-    while(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
-    {
-        //
-        // Write available data
-        //
-        m_qMutex.lock();
-        qint32 t_iBlockSize = m_qSendBlock.size();
-//        qDebug() << "data available" << t_iBlockSize;
-        if(t_iBlockSize > 0)
-        {
-            qint32 t_iBytesWritten = t_qTcpSocket.write(m_qSendBlock);
-//            qDebug() << ++i<< "[wrote bytes] " << t_iBytesWritten;
-            t_qTcpSocket.waitForBytesWritten();
-            if(t_iBytesWritten == t_iBlockSize)
-            {
-                m_qSendBlock.clear();
-            }
-            else
-            {
-                //we have to store bytes which were not written to the socket, due to writing limit
-                //m_qSendBlock = m_qSendBlock.mid(t_iBytesWritten, t_iBlockSize-t_iBytesWritten);
-                m_qSendBlock.remove(0,t_iBytesWritten); //higher performance then mid
-            }
-        }
-        m_qMutex.unlock();
+    QTimer t_qSendTimer;
+    t_qSendTimer.setSingleShot(true);
+    t_qSendTimer.setInterval(0);
 
-        //
-        // Read: Wait 10ms for incomming tag header, read and continue
-        //
-        t_qTcpSocket.waitForReadyRead(10);
+    //
+    // Event-driven: the socket and the send timer live in this thread, the slots are called by its event loop
+    //
+    connect(&t_qTcpSocket, &QTcpSocket::readyRead, this, &FiffStreamThread::readProc, Qt::DirectConnection);
+    connect(&t_qTcpSocket, &QTcpSocket::bytesWritten, this, &FiffStreamThread::sendData, Qt::DirectConnection);
+    connect(&t_qTcpSocket, &QTcpSocket::disconnected, this, &FiffStreamThread::quit, Qt::DirectConnection);
+    connect(&t_qSendTimer, &QTimer::timeout, this, &FiffStreamThread::sendData, Qt::DirectConnection);
 
-        if (t_qTcpSocket.bytesAvailable() >= (int)sizeof(qint32)*4)
-        {
-//            qDebug() << "goes to read bytes " ;
-            FiffTag::SPtr t_pTag;
-            FiffTag::read_tag_info(&t_FiffStreamIn, t_pTag, false);
+    m_qMutex.lock();
+    m_pTcpSocket = &t_qTcpSocket;
+    m_pSendTimer = &t_qSendTimer;
+    m_qMutex.unlock();
 
-            //
-            // wait until tag size data are available and read the data
-            //
-            while (t_qTcpSocket.bytesAvailable() < t_pTag->size())
-            {
-                t_qTcpSocket.waitForReadyRead(10);
-            }
-            FiffTag::read_tag_data(&t_FiffStreamIn, t_pTag);
+    // blocks queued before the event loop started
+    sendData();
+    readProc();
 
-            //
-            // Parse the tag
-            //
-            if(t_pTag->kind == FIFF_MNE_RT_COMMAND)
-            {
-                parseCommand(t_pTag);
-            }
-        }
-    }
+    if(m_bIsRunning)
+        exec();
+
+    m_qMutex.lock();
+    m_pSendTimer = NULL;
+    m_qMutex.unlock();
 
     t_qTcpSocket.disconnectFromHost();
     if(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState)
         t_qTcpSocket.waitForDisconnected();
+
+    m_pTcpSocket = NULL;
 }
@@ -43,6 +43,7 @@
 
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_info.h>
+#include <utils/latencytracer.h>
 
 
 //*************************************************************************************************************
@@ -52,7 +53,10 @@
 
 #include <QThread>
 #include <QTcpSocket>
+#include <QTimer>
 #include <QMutex>
+#include <QQueue>
+#include <QByteArray>
 #include <QSharedPointer>
 
 
@@ -70,6 +74,7 @@ namespace RTSERVER
 //=============================================================================================================
 
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -91,6 +96,30 @@ public:
 
     inline QString getAlias();
 
+    //=========================================================================================================
+    /**
+    * Returns whether the client is set to accept raw buffers.
+    *
+    * @return true if raw buffers are sent to the client, false otherwise
+    */
+    inline bool isSendingRawBuffer();
+
+    //=========================================================================================================
+    /**
+    * Returns the raw stream mode requested by the client, i.e. the encoding of the raw buffers it receives.
+    *
+    * @return the raw stream mode (FIFFV_MNE_RT_STREAM_*)
+    */
+    inline qint32 getStreamMode();
+
+    //=========================================================================================================
+    /**
+    * Returns the number of raw buffers which were dropped since the client is too slow.
+    *
+    * @return the number of dropped raw buffers
+    */
+    inline qint32 getNumDroppedRawBuffers();
+
 //    void deactivateRawBufferSending();
 
 
@@ -98,31 +127,75 @@ public:
 
     void writeClientId();
 
-    void sendData(QTcpSocket& p_qTcpSocket);
+    //=========================================================================================================
+    /**
+    * Hands the queued blocks to the socket, as long as the socket's write buffer is below MaxBytesToWrite, and
+    * flushes the socket without blocking. Called in the thread's event loop when blocks were queued and when
+    * the socket wrote data.
+    */
+    void sendData();
 
 signals:
     void error(QTcpSocket::SocketError socketError);
 
 private:
+    //=========================================================================================================
+    /**
+    * An encoded block waiting to be sent. Raw buffer blocks are encoded once by the FiffStreamServer and shared
+    * (implicitly) by all clients.
+    */
+    struct SendBlock
+    {
+        QByteArray qBlock;      /**< The encoded tags. */
+        bool bRawBuffer;        /**< Whether the block is a raw buffer, which may be dropped. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Appends a block to the send queue. When MaxQueuedRawBuffers raw buffers are queued already, the oldest
+    * queued raw buffer is dropped, so a stalled client neither delays the others nor accumulates memory.
+    *
+    * @param[in] p_qBlock       The encoded block
+    * @param[in] p_bRawBuffer   Whether the block is a raw buffer
+    */
+    void enqueue(const QByteArray &p_qBlock, bool p_bRawBuffer);
+
+    static const qint32 MaxQueuedRawBuffers = 16;       /**< Maximal number of raw buffers queued for a client. */
+    static const qint64 MaxBytesToWrite = 4*1024*1024;  /**< Maximal size of the socket's write buffer before no further blocks are handed to it. */
+
     qint32 m_iDataClientId;
     QString m_sDataClientAlias;
 
     int m_iSocketDescriptor;
 
     QMutex m_qMutex;
-    QByteArray m_qSendBlock;
+    QQueue<SendBlock> m_qQueueSendBlocks;   /**< Blocks waiting to be handed to the socket, in sending order. */
+    qint32 m_iNumQueuedRawBuffers;          /**< Number of raw buffers in the send queue. */
+    qint32 m_iNumDroppedRawBuffers;         /**< Number of raw buffers dropped since the client was too slow. */
 
     bool m_bIsSendingRawBuffer;
+    qint32 m_iStreamMode;               /**< Raw stream mode requested by the client (FIFFV_MNE_RT_STREAM_*). */
 
     bool m_bIsRunning;
 
+    QTcpSocket* m_pTcpSocket;           /**< The client socket, owned by run(). */
+    QTimer* m_pSendTimer;               /**< Zero timer in the thread's event loop, started to send newly queued blocks. */
+
+    LatencyTracer* m_pLatencyTracer;    /**< Traces the queuing of the raw buffers sent to this client. */
+
 //public slots: --> in Qt 5 not anymore declared as slot
     void startMeas(qint32 ID);
     void stopMeas(qint32 ID);
     void sendMeasurementInfo(qint32 ID, FiffInfo p_fiffInfo);
-    void sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
+    void sendRawBuffer(QByteArray p_qRawBufferBlock, qint32 p_iStreamMode, qint32 p_iSequence);
     //void readToBuffer1();
-    void readProc(QTcpSocket& p_qTcpSocket);
+
+    //=========================================================================================================
+    /**
+    * Reads and parses all complete tags available on the socket, without waiting for further data. Called in
+    * the thread's event loop when the socket received data.
+    */
+    void readProc();
 };
 
 
@@ -138,6 +211,24 @@ inline QString FiffStreamThread::getAlias()
 }
 
 
+inline bool FiffStreamThread::isSendingRawBuffer()
+{
+    return m_bIsSendingRawBuffer;
+}
+
+
+inline qint32 FiffStreamThread::getStreamMode()
+{
+    return m_iStreamMode;
+}
+
+
+inline qint32 FiffStreamThread::getNumDroppedRawBuffers()
+{
+    return m_iNumDroppedRawBuffers;
+}
+
+
 } // NAMESPACE
 
 #endif //FIFFSTREAMTHREAD_H
@@ -51,6 +51,7 @@ namespace RTSERVER
 
 #define MNE_RT_GET_CLIENT_ID        1       /**< Request client id at mne_rt_server */
 #define MNE_RT_SET_CLIENT_ALIAS     2       /**< Set client alias at mne_rt_server */
+#define MNE_RT_SET_STREAM_MODE      3       /**< Set raw stream mode (FIFFV_MNE_RT_STREAM_*) at mne_rt_server */
 
 } // NAMESPACE
 
@@ -42,6 +42,8 @@
 
 #include "IConnector.h"
 
+#include <utils/latencytracer.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -67,6 +69,7 @@
 //=============================================================================================================
 
 using namespace RTSERVER;
+using namespace UTILSLIB;
 
 
 const char* connectorDir = "/mne_rt_server_plugins";        /**< holds directory to connectors.*/
@@ -281,6 +284,62 @@ void MNERTServer::comHelp(Command p_command)
 }
 
 
+//*************************************************************************************************************
+
+void MNERTServer::comLatency(Command p_command)
+{
+    if(!p_command.isJson())
+    {
+        m_commandManager["latency"].reply(LatencyTracer::report());
+        return;
+    }
+
+    QList<LatencyTracer::Statistics> t_qListStatistics = LatencyTracer::statistics();
+
+    QJsonObject t_qJsonObjectStages;
+    for(qint32 i = 0; i < t_qListStatistics.size(); ++i)
+    {
+        const LatencyTracer::Statistics& t_stat = t_qListStatistics[i];
+
+        // latencies in ms; null if the stage has no records to compute them from
+        bool t_bStage = t_stat.iCount > 0;
+        bool t_bAcq = t_stat.iCountAcq > 0;
+        bool t_bQueue = t_stat.iQueueMax >= 0;
+
+        QJsonObject t_qJsonObjectStage;
+        t_qJsonObjectStage.insert(QString("count"), QJsonValue(t_stat.iCount));
+        t_qJsonObjectStage.insert(QString("p50"), t_bStage ? QJsonValue(t_stat.iP50 / 1e6) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("p99"), t_bStage ? QJsonValue(t_stat.iP99 / 1e6) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("max"), t_bStage ? QJsonValue(t_stat.iMax / 1e6) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("acq_count"), QJsonValue(t_stat.iCountAcq));
+        t_qJsonObjectStage.insert(QString("acq_p50"), t_bAcq ? QJsonValue(t_stat.iAcqP50 / 1e6) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("acq_p99"), t_bAcq ? QJsonValue(t_stat.iAcqP99 / 1e6) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("acq_max"), t_bAcq ? QJsonValue(t_stat.iAcqMax / 1e6) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("queue_mean"), t_bQueue ? QJsonValue(t_stat.dQueueMean) : QJsonValue());
+        t_qJsonObjectStage.insert(QString("queue_max"), t_bQueue ? QJsonValue(t_stat.iQueueMax) : QJsonValue());
+
+        t_qJsonObjectStages.insert(t_stat.sName, t_qJsonObjectStage);
+    }
+
+    QJsonObject t_qJsonObjectRoot;
+    t_qJsonObjectRoot.insert("latency", t_qJsonObjectStages);
+    QJsonDocument p_qJsonDocument(t_qJsonObjectRoot);
+
+    m_commandManager["latency"].reply(p_qJsonDocument.toJson());
+}
+
+
+//*************************************************************************************************************
+
+void MNERTServer::comLatencyReset(Command p_command)
+{
+    Q_UNUSED(p_command);
+
+    LatencyTracer::reset();
+    m_commandManager["latency-reset"].reply("\tlatency statistics reset\r\n\n");
+}
+
+
 //*************************************************************************************************************
 
 void MNERTServer::init()
@@ -332,6 +391,14 @@ void MNERTServer::init()
             "           \"description\": \"Prints and sends this list.\","
             "           \"parameters\": {}"
             "        },"
+            "       \"latency\": {"
+            "           \"description\": \"Prints and sends the latency statistics (p50/p99/max) and queue depths of the pipeline stages.\","
+            "           \"parameters\": {}"
+            "        },"
+            "       \"latency-reset\": {"
+            "           \"description\": \"Restarts the latency statistics.\","
+            "           \"parameters\": {}"
+            "        },"
             "       \"measinfo\": {"
             "           \"description\": \"Sends the measurement info to the specified FiffStreamClient.\","
             "           \"parameters\": {"
@@ -381,4 +448,6 @@ void MNERTServer::init()
     //connect slots
     QObject::connect(&m_commandManager["help"], &Command::executed, this, &MNERTServer::comHelp);
     QObject::connect(&m_commandManager["close"], &Command::executed, this, &MNERTServer::comClose);
+    QObject::connect(&m_commandManager["latency"], &Command::executed, this, &MNERTServer::comLatency);
+    QObject::connect(&m_commandManager["latency-reset"], &Command::executed, this, &MNERTServer::comLatencyReset);
 }
@@ -131,6 +131,18 @@ private:
     */
     void comHelp(Command p_command);
 
+    //=========================================================================================================
+    /**
+    * Is called when signal latency is executed: sends the latency statistics of the pipeline stages.
+    */
+    void comLatency(Command p_command);
+
+    //=========================================================================================================
+    /**
+    * Is called when signal latency-reset is executed: restarts the latency statistics.
+    */
+    void comLatencyReset(Command p_command);
+
 
 
     FiffStreamServer    m_fiffStreamServer;     /**< Fiff stream server. */
@@ -376,10 +376,12 @@ void BabyMeg::run()
 {
 
     MatrixXf matValue;
+    qint32 t_iSequence;
     while(true)
     {
         //pop matrix
-        matValue = m_pRawMatrixBuffer_In->pop();
+        m_pRawMatrixBuffer_In->pop(matValue, &t_iSequence);
+        m_pRTMSA_BabyMeg->setSequence(t_iSequence);
 
 //        std::cout << "matValue " << matValue.block(0,0,1,50) << std::endl;
 
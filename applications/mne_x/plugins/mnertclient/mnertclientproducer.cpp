@@ -164,6 +164,7 @@ void MneRtClientProducer::run()
     MatrixXf t_matRawBuffer;
 
     fiff_int_t kind;
+    qint32 t_iSequence;
 
     qint32 from = 0;
     qint32 to = -1;
@@ -202,7 +203,7 @@ void MneRtClientProducer::run()
 //                }
 //            }
 
-            m_pRtDataClient->readRawBuffer(m_pMneRtClient->m_pFiffInfo->nchan, t_matRawBuffer, kind);
+            m_pRtDataClient->readRawBuffer(m_pMneRtClient->m_pFiffInfo->nchan, t_matRawBuffer, kind, &t_iSequence);
 
             if(kind == FIFF_DATA_BUFFER)
             {
@@ -210,7 +211,7 @@ void MneRtClientProducer::run()
 //                printf("Reading %d ... %d  =  %9.3f ... %9.3f secs...", from, to, ((float)from)/m_pMneRtClient->m_pFiffInfo->sfreq, ((float)to)/m_pMneRtClient->m_pFiffInfo->sfreq);
                 from += t_matRawBuffer.cols();
 
-                m_pMneRtClient->m_pRawMatrixBuffer_In->push(&t_matRawBuffer);
+                m_pMneRtClient->m_pRawMatrixBuffer_In->push(&t_matRawBuffer, t_iSequence);
             }
             else if(FIFF_DATA_BUFFER == FIFF_BLOCK_END)
                 m_bFlagMeasuring = false;
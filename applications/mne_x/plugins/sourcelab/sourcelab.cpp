@@ -44,6 +44,8 @@
 #include <xMeas/Measurement/realtimesamplearray.h>
 #include <xMeas/Measurement/realtimemultisamplearray_new.h>
 
+#include <utils/latencytracer.h>
+
 #include "FormFiles/sourcelabsetupwidget.h"
 #include "FormFiles/sourcelabrunwidget.h"
 
@@ -67,6 +69,7 @@ using namespace SourceLabPlugin;
 using namespace FIFFLIB;
 using namespace MNEX;
 using namespace XMEASLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -127,6 +130,8 @@ bool SourceLab::stop()
 
     m_bReceiveData = false;
 
+    qDebug("Latency of the real-time pipeline:\n%s", qPrintable(LatencyTracer::report()));
+
     return true;
 }
 
@@ -198,7 +203,7 @@ void SourceLab::update(Subject* pSubject)
                 t_mat.col(i) = pRTMSANew->getMultiSampleArray()[i];
 
             getAcceptorMeasurementBuffer(pRTMSANew->getID()).staticCast<CircularMatrixBuffer<double> >()
-                    ->push(&t_mat);
+                    ->push(&t_mat, pRTMSANew->getSequence());
         }
 
     }
@@ -207,7 +212,7 @@ void SourceLab::update(Subject* pSubject)
 
 //*************************************************************************************************************
 
-void SourceLab::appendEvoked(FiffEvoked::SPtr p_pEvoked)
+void SourceLab::appendEvoked(FiffEvoked::SPtr p_pEvoked, qint32 p_iSequence)
 {
     if(p_pEvoked->comment == QString("Stim %1").arg(m_iStimChan))
     {
@@ -215,6 +220,7 @@ void SourceLab::appendEvoked(FiffEvoked::SPtr p_pEvoked)
 
         mutex.lock();
         m_qVecEvokedData.push_back(p_pEvoked);
+        m_qVecEvokedSequence.push_back(p_iSequence);
         mutex.unlock();
     }
 }
@@ -325,6 +331,8 @@ void SourceLab::run()
 //    bool bMatInit = false;
 //    QVector<MatrixXd> t_evokedDataVec;
 
+    LatencyTracer* t_pTracer = LatencyTracer::stage("SourceLab");
+
     while(m_bIsRunning)
     {
         qint32 nrows = m_pSourceLabBuffer->rows();
@@ -332,14 +340,18 @@ void SourceLab::run()
         if(nrows > 0) // check if init
         {
             /* Dispatch the inputs */
-            MatrixXd t_mat = m_pSourceLabBuffer->pop();
+            MatrixXd t_mat;
+            qint32 t_iRawSequence;
+            m_pSourceLabBuffer->pop(t_mat, &t_iRawSequence);
 
             //Add to covariance estimation
-            m_pRtCov->append(t_mat);
-            m_pRtAve->append(t_mat);
+            m_pRtCov->append(t_mat, t_iRawSequence);
+            m_pRtAve->append(t_mat, t_iRawSequence);
 
             if(m_pMinimumNorm && m_qVecEvokedData.size() > 0)
             {
+                qint64 t_iEnter = LatencyTracer::now();
+
                 FiffEvoked t_evoked = *m_qVecEvokedData[0].data();
                 SourceEstimate sourceEstimate = m_pMinimumNorm->calculateInverse(t_evoked);
 
@@ -351,7 +363,12 @@ void SourceLab::run()
 
                 mutex.lock();
                 m_qVecEvokedData.pop_front();
+                qint32 t_iSequence = m_qVecEvokedSequence.takeFirst();
+                qint32 t_iQueueDepth = m_qVecEvokedData.size();
                 mutex.unlock();
+
+                // sensor to source estimate latency
+                t_pTracer->record(t_iEnter, t_iSequence, t_iQueueDepth);
             }
 
 //            if(m_pMinimumNorm && t_mat.cols() > 0)
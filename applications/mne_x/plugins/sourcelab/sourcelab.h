@@ -140,9 +140,10 @@ public:
     /**
     * Append evoked
     *
-    * @param[in] p_pEvoked  The evoked to be appended
+    * @param[in] p_pEvoked      The evoked to be appended
+    * @param[in] p_iSequence    Latency trace sequence number of the raw buffer which completed the evoked
     */
-    void appendEvoked(FiffEvoked::SPtr p_pEvoked);
+    void appendEvoked(FiffEvoked::SPtr p_pEvoked, qint32 p_iSequence);
 
     //=========================================================================================================
     /**
@@ -203,6 +204,7 @@ private:
 
     RtAve::SPtr                 m_pRtAve;           /**< Real-time average. */
     QVector<FiffEvoked::SPtr>   m_qVecEvokedData;   /**< Evoked data set */
+    QVector<qint32>             m_qVecEvokedSequence;   /**< Sequence number of the raw buffer which completed each evoked data set, for the latency tracing. */
     qint32 m_iStimChan;                             /**< Stimulus Channel to use for source estimation */
 
     MinimumNorm::SPtr           m_pMinimumNorm;     /**< Minimum Norm Estimation. */
@@ -67,6 +67,7 @@ RealTimeMultiSampleArrayNew::RealTimeMultiSampleArrayNew()
 : MltChnMeasurement()
 , m_dSamplingRate(0)
 , m_ucMultiArraySize(10)
+, m_iSequence(-1)
 {
 
 }
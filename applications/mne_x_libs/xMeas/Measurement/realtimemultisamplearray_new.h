@@ -180,6 +180,23 @@ public:
     */
     inline const QVector< VectorXd >& getMultiSampleArray();
 
+    //=========================================================================================================
+    /**
+    * Sets the latency trace sequence number of the raw buffer the following sample vectors belong to.
+    *
+    * @param [in] iSequence the sequence number, -1 if unknown.
+    */
+    inline void setSequence(qint32 iSequence);
+
+    //=========================================================================================================
+    /**
+    * Returns the latency trace sequence number of the raw buffer the newest sample vector belongs to. Observers
+    * read it while they are notified, it belongs to the multi sample array they are notified of.
+    *
+    * @return the sequence number, -1 if unknown.
+    */
+    inline qint32 getSequence() const;
+
     //=========================================================================================================
     /**
     * Attaches a value to the sample array vector.
@@ -204,6 +221,7 @@ private:
     double                      m_dSamplingRate;    /**< Sampling rate of the RealTimeSampleArray.*/
     VectorXd                    m_vecValue;         /**< The current attached sample vector.*/
     unsigned char               m_ucMultiArraySize; /**< Sample size of the multi sample array.*/
+    qint32                      m_iSequence;        /**< Latency trace sequence number of the current samples.*/
     QVector< VectorXd >         m_matSamples;       /**< The multi sample array.*/
     QList<RealTimeSampleArrayChInfo> m_qListChInfo; /**< Channel info list.*/
 };
@@ -279,6 +297,22 @@ inline const QVector< VectorXd >& RealTimeMultiSampleArrayNew::getMultiSampleArr
     return m_matSamples;
 }
 
+
+//*************************************************************************************************************
+
+inline void RealTimeMultiSampleArrayNew::setSequence(qint32 iSequence)
+{
+    m_iSequence = iSequence;
+}
+
+
+//*************************************************************************************************************
+
+inline qint32 RealTimeMultiSampleArrayNew::getSequence() const
+{
+    return m_iSequence;
+}
+
 } // NAMESPACE
 
 #endif // REALTIMEMULTISAMPLEARRAYNEW_H
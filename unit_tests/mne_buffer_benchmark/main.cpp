@@ -0,0 +1,281 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implements the main() application function.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <generics/circularmatrixbuffer.h>
+#include <generics/lockfreematrixbuffer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+#include <QtAlgorithms>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace IOBuffer;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Produces numbered blocks into a CircularMatrixBuffer or a LockFreeMatrixBuffer and stamps the time each
+* block was handed to the buffer.
+*/
+template<class BufferType>
+class Producer : public QThread
+{
+public:
+    Producer(BufferType& p_Buffer, QVector<qint64>& p_qVecSent, const QElapsedTimer& p_Timer)
+    : m_Buffer(p_Buffer)
+    , m_qVecSent(p_qVecSent)
+    , m_Timer(p_Timer)
+    {
+    }
+
+protected:
+    virtual void run();
+
+private:
+    BufferType& m_Buffer;
+    QVector<qint64>& m_qVecSent;
+    const QElapsedTimer& m_Timer;
+};
+
+
+//=============================================================================================================
+/**
+* Consumes the numbered blocks, checks their order and stamps the time each block was received.
+*/
+template<class BufferType>
+class Consumer : public QThread
+{
+public:
+    Consumer(BufferType& p_Buffer, QVector<qint64>& p_qVecReceived, const QElapsedTimer& p_Timer)
+    : m_Buffer(p_Buffer)
+    , m_qVecReceived(p_qVecReceived)
+    , m_Timer(p_Timer)
+    , m_iErrors(0)
+    {
+    }
+
+    qint32 errors() const { return m_iErrors; }
+
+protected:
+    virtual void run();
+
+private:
+    BufferType& m_Buffer;
+    QVector<qint64>& m_qVecReceived;
+    const QElapsedTimer& m_Timer;
+    qint32 m_iErrors;
+};
+
+
+//*************************************************************************************************************
+
+template<>
+void Producer<CircularMatrixBuffer<float> >::run()
+{
+    MatrixXf t_matBlock(m_Buffer.rows(), m_Buffer.cols());
+    for(qint32 i = 0; i < m_qVecSent.size(); ++i)
+    {
+        t_matBlock.setConstant((float)i);
+        m_qVecSent[i] = m_Timer.nsecsElapsed();
+        m_Buffer.push(&t_matBlock);
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<>
+void Consumer<CircularMatrixBuffer<float> >::run()
+{
+    MatrixXf t_matBlock(m_Buffer.rows(), m_Buffer.cols());
+    for(qint32 i = 0; i < m_qVecReceived.size(); ++i)
+    {
+        m_Buffer.pop(t_matBlock);
+        m_qVecReceived[i] = m_Timer.nsecsElapsed();
+        if(t_matBlock(0,0) != (float)i)
+            ++m_iErrors;
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<>
+void Producer<LockFreeMatrixBuffer<float> >::run()
+{
+    for(qint32 i = 0; i < m_qVecSent.size(); ++i)
+    {
+        MatrixXf* t_pSlot;
+        while(!(t_pSlot = m_Buffer.acquireWrite()))
+            QThread::yieldCurrentThread();
+
+        t_pSlot->setConstant((float)i);
+        m_qVecSent[i] = m_Timer.nsecsElapsed();
+        m_Buffer.commitWrite();
+    }
+}
+
+
+//*************************************************************************************************************
+
+template<>
+void Consumer<LockFreeMatrixBuffer<float> >::run()
+{
+    for(qint32 i = 0; i < m_qVecReceived.size(); ++i)
+    {
+        const MatrixXf* t_pSlot;
+        while(!(t_pSlot = m_Buffer.acquireRead()))
+            QThread::yieldCurrentThread();
+
+        m_qVecReceived[i] = m_Timer.nsecsElapsed();
+        if((*t_pSlot)(0,0) != (float)i)
+            ++m_iErrors;
+        m_Buffer.releaseRead();
+    }
+}
+
+
+//*************************************************************************************************************
+/**
+* Runs a producer and a consumer thread on the buffer and prints throughput and latency percentiles.
+*
+* @param [in] p_sName       Name to print.
+* @param [in] p_Buffer      The buffer to benchmark.
+* @param [in] p_iNumBlocks  Number of blocks to transfer.
+*/
+template<class BufferType>
+void runBenchmark(const char* p_sName, BufferType& p_Buffer, qint32 p_iNumBlocks)
+{
+    QElapsedTimer t_Timer;
+    QVector<qint64> t_qVecSent(p_iNumBlocks);
+    QVector<qint64> t_qVecReceived(p_iNumBlocks);
+
+    Producer<BufferType> t_Producer(p_Buffer, t_qVecSent, t_Timer);
+    Consumer<BufferType> t_Consumer(p_Buffer, t_qVecReceived, t_Timer);
+
+    t_Timer.start();
+    t_Consumer.start();
+    t_Producer.start();
+    t_Producer.wait();
+    t_Consumer.wait();
+    qint64 t_iTotal = t_Timer.nsecsElapsed();
+
+    QVector<qint64> t_qVecLatency(p_iNumBlocks);
+    for(qint32 i = 0; i < p_iNumBlocks; ++i)
+        t_qVecLatency[i] = t_qVecReceived[i] - t_qVecSent[i];
+    qSort(t_qVecLatency.begin(), t_qVecLatency.end());
+
+    double t_dSeconds = t_iTotal / 1e9;
+    double t_dMBytes = (double)p_iNumBlocks * p_Buffer.rows() * p_Buffer.cols() * sizeof(float) / (1024.0 * 1024.0);
+
+    printf("%s\n", p_sName);
+    printf("    throughput: %10.1f blocks/s  %10.1f MB/s\n", p_iNumBlocks / t_dSeconds, t_dMBytes / t_dSeconds);
+    printf("    latency [us]: median %8.1f  99%% %8.1f  99.9%% %8.1f  max %8.1f\n",
+           t_qVecLatency[p_iNumBlocks / 2] / 1e3,
+           t_qVecLatency[(qint32)(p_iNumBlocks * 0.99)] / 1e3,
+           t_qVecLatency[(qint32)(p_iNumBlocks * 0.999)] / 1e3,
+           t_qVecLatency[p_iNumBlocks - 1] / 1e3);
+    printf("    order errors: %d\n", t_Consumer.errors());
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    // Vector View sized blocks: 306 channels x 100 samples (10 ms at 10 kHz)
+    //
+    qint32 t_iRows = 306;
+    qint32 t_iCols = 100;
+    qint32 t_iSlots = 16;
+    qint32 t_iNumBlocks = 20000;
+
+    printf("Transferring %d blocks of %d x %d floats through %d slots\n\n", t_iNumBlocks, t_iRows, t_iCols, t_iSlots);
+
+    CircularMatrixBuffer<float> t_circularBuffer(t_iSlots, t_iRows, t_iCols);
+    runBenchmark("CircularMatrixBuffer (semaphores)", t_circularBuffer, t_iNumBlocks);
+
+    LockFreeMatrixBuffer<float> t_lockFreeBuffer(t_iSlots, t_iRows, t_iCols);
+    runBenchmark("LockFreeMatrixBuffer (lock-free SPSC)", t_lockFreeBuffer, t_iNumBlocks);
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Benchmark of the conversion to surface-based source orientations.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <mne/mne.h>
+#include <utils/mnemath.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+#include <algorithm>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace MNELIB;
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The former conversion to surface-based source orientations of MNEForwardSolution::read: an SVD of the
+* tangent plane projector per source and a sparse block diagonal rotation of the gain matrix.
+*
+* @param [in] fwd           The forward solution in Cartesian source orientations.
+* @param [out] source_nn    The local coordinate systems, three rows per source.
+*
+* @return the rotated gain matrix
+*/
+MatrixXd surfOriReference(const MNEForwardSolution& fwd, MatrixXf& source_nn)
+{
+    bool use_ave_nn = fwd.src[0].patch_inds.size() > 0;
+
+    source_nn = MatrixXf::Zero(fwd.nsource*3,3);
+    qint32 pp = 0;
+    for(qint32 k = 0; k < fwd.src.size(); ++k)
+    {
+        for (qint32 p = 0; p < fwd.src[k].nuse; ++p)
+        {
+            Vector3f nn;
+            if(use_ave_nn)
+            {
+                VectorXi t_vIdx = fwd.src[k].pinfo[fwd.src[k].patch_inds[p]];
+                Matrix3Xf t_nn(3, t_vIdx.size());
+                for(qint32 i = 0; i < t_vIdx.size(); ++i)
+                    t_nn.col(i) = fwd.src[k].nn.block(t_vIdx[i],0,1,3).transpose();
+                nn = t_nn.rowwise().sum();
+                nn.array() /= nn.norm();
+            }
+            else
+                nn = fwd.src[k].nn.block(fwd.src[k].vertno(p),0,1,3).transpose();
+
+            Matrix3f tmp = Matrix3f::Identity(nn.rows(), nn.rows()) - nn*nn.transpose();
+
+            JacobiSVD<MatrixXf> t_svd(tmp, Eigen::ComputeThinU);
+            VectorXf t_s = t_svd.singularValues();
+            MatrixXf U = t_svd.matrixU();
+            MNEMath::sort<float>(t_s, U);
+
+            if ((nn.transpose() * U.block(0,2,3,1))(0,0) < 0)
+                U *= -1;
+            source_nn.block(pp, 0, 3, 3) = U.transpose();
+            pp += 3;
+        }
+    }
+    MatrixXd tmp = source_nn.transpose().cast<double>();
+    SparseMatrix<double>* surf_rot = MNEMath::make_block_diag(tmp,3);
+
+    MatrixXd t_matSol = fwd.sol->data * (*surf_rot);
+    delete surf_rot;
+
+    return t_matSol;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QString t_sFileName = argc > 1 ? QString(argv[1]) : QString("./MNE-sample-data/MEG/sample/sample_audvis-meg-eeg-oct-6-fwd.fif");
+
+    if(!MNECache::directory().isEmpty())
+        printf("Warning: the forward solution cache is enabled, the read times include cache hits.\n");
+
+    //
+    // Read the forward solution in Cartesian and in surface-based source orientations
+    //
+    QFile t_fileFwdCart(t_sFileName);
+    QElapsedTimer t_Timer;
+    t_Timer.start();
+    MNEForwardSolution t_fwdCart(t_fileFwdCart, false, false);
+    qint64 t_iTimeCart = t_Timer.elapsed();
+
+    QFile t_fileFwdSurf(t_sFileName);
+    t_Timer.start();
+    MNEForwardSolution t_fwdSurf(t_fileFwdSurf, false, true);
+    qint64 t_iTimeSurf = t_Timer.elapsed();
+
+    if(t_fwdCart.isEmpty() || t_fwdSurf.isEmpty())
+    {
+        printf("Could not read the forward solution %s.\n", t_sFileName.toUtf8().constData());
+        return 1;
+    }
+
+    //
+    // Former conversion, applied to the Cartesian forward solution
+    //
+    MatrixXf t_matSourceNNRef;
+    t_Timer.start();
+    MatrixXd t_matSolRef = surfOriReference(t_fwdCart, t_matSourceNNRef);
+    qint64 t_iTimeRef = t_Timer.elapsed();
+
+    printf("\n%d channels x %d sources\n\n", t_fwdCart.nchan, t_fwdCart.nsource);
+    printf("%-40s %12s\n", "", "time [ms]");
+    printf("%-40s %12d\n", "read, Cartesian orientations", (qint32)t_iTimeCart);
+    printf("%-40s %12d\n", "read, surface orientations", (qint32)t_iTimeSurf);
+    printf("%-40s %12d\n", "  conversion (read difference)", (qint32)(t_iTimeSurf - t_iTimeCart));
+    printf("%-40s %12d\n", "  former conversion (SVD, sparse)", (qint32)t_iTimeRef);
+
+    //
+    // The normals have to match the former conversion; the tangential axes may differ, but rotating back has to
+    // give the Cartesian gain matrix
+    //
+    double t_dNormalErr = 0;
+    double t_dSolNormalErr = 0;
+    MatrixXd t_matSolBack(t_fwdSurf.sol->data.rows(), t_fwdSurf.sol->data.cols());
+    for(qint32 j = 0; j < t_fwdSurf.nsource; ++j)
+    {
+        Matrix3d t_matRot = t_fwdSurf.source_nn.block(3*j, 0, 3, 3).cast<double>();
+        t_dNormalErr = std::max(t_dNormalErr, (double)(t_fwdSurf.source_nn.row(3*j+2) - t_matSourceNNRef.row(3*j+2)).norm());
+        t_matSolBack.middleCols(3*j, 3) = t_fwdSurf.sol->data.middleCols(3*j, 3) * t_matRot;
+    }
+    for(qint32 j = 0; j < t_fwdSurf.nsource; ++j)
+        t_dSolNormalErr = std::max(t_dSolNormalErr, (t_fwdSurf.sol->data.col(3*j+2) - t_matSolRef.col(3*j+2)).norm() / t_matSolRef.col(3*j+2).norm());
+    double t_dSolErr = (t_matSolBack - t_fwdCart.sol->data).norm() / t_fwdCart.sol->data.norm();
+
+    printf("\n%-50s %12.3e\n", "max. normal deviation from the former conversion", t_dNormalErr);
+    printf("%-50s %12.3e\n", "max. rel. normal gain deviation", t_dSolNormalErr);
+    printf("%-50s %12.3e\n", "rel. error of the gain rotated back to Cartesian", t_dSolErr);
+
+    return 0;
+}
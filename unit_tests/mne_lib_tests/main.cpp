@@ -113,5 +113,61 @@ int main(int argc, char *argv[])
     testStart(testName);
     testResult = t_MneLibTests.checkFwdRead();
     testEnd(testName,testResult);
+
+    //
+    // RAP MUSIC test
+    //
+    testName = QString("RAP MUSIC");
+    testStart(testName);
+    testResult = t_MneLibTests.checkRapMusic();
+    testEnd(testName,testResult);
+
+    //
+    // Raw reader test
+    //
+    testName = QString("Raw Reader");
+    testStart(testName);
+    testResult = t_MneLibTests.checkRawReader();
+    testEnd(testName,testResult);
+
+    //
+    // Lock-free Matrix Buffer test
+    //
+    testName = QString("Lock-free Matrix Buffer");
+    testStart(testName);
+    testResult = t_MneLibTests.checkLockFreeMatrixBuffer();
+    testEnd(testName,testResult);
+
+    //
+    // RtCov test
+    //
+    testName = QString("RtCov");
+    testStart(testName);
+    testResult = t_MneLibTests.checkRtCov();
+    testEnd(testName,testResult);
+
+    //
+    // KMeans test
+    //
+    testName = QString("KMeans");
+    testStart(testName);
+    testResult = t_MneLibTests.checkKMeans();
+    testEnd(testName,testResult);
+
+    //
+    // Byte Swap test
+    //
+    testName = QString("Byte Swap");
+    testStart(testName);
+    testResult = t_MneLibTests.checkByteSwap();
+    testEnd(testName,testResult);
+
+    //
+    // Real-Time Raw Buffer test
+    //
+    testName = QString("Real-Time Raw Buffer");
+    testStart(testName);
+    testResult = t_MneLibTests.checkRtRawBuffer();
+    testEnd(testName,testResult);
     return a.exec();
 }
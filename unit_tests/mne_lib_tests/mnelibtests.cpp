@@ -49,13 +49,83 @@
 #include <mne/mne.h>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// FIFF INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_raw_reader.h>
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_tag.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INVERSE INCLUDES
+//=============================================================================================================
+
+#include <inverse/rapMusic/rapmusic.h>
+#include <inverse/rapMusic/gold/rapmusic_gold.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// GENERICS INCLUDES
+//=============================================================================================================
+
+#include <generics/lockfreematrixbuffer.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QThread>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// RTINV INCLUDES
+//=============================================================================================================
+
+#include <rtInv/rtcov.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// UTILS INCLUDES
+//=============================================================================================================
+
+#include <utils/kmeans.h>
+#include <utils/ioutils.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // USED NAMESPACES
 //=============================================================================================================
 
 using namespace MNEUNITTESTS;
+using namespace FIFFLIB;
 using namespace MNELIB;
+using namespace INVERSELIB;
+using namespace IOBuffer;
+using namespace RTINVLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -132,3 +202,833 @@ bool MNELibTests::checkFwdRead()
         return false;
     }
 }
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkRapMusic()
+{
+    qint32 nchan = 60;
+    qint32 nsamp = 200;
+
+    srand(1);
+
+    for(qint32 t_iCase = 0; t_iCase < 2; ++t_iCase)
+    {
+        bool t_bPairs = t_iCase == 1;
+        qint32 nsource = t_bPairs ? 40 : 150;
+        qint32 t_iSource1 = 5;
+        qint32 t_iSource2 = 30;
+
+        //
+        // Simulated lead field with free orientations and two active dipoles, correlated for the pair scan
+        //
+        MatrixXd t_matG = MatrixXd::Random(nchan, 3*nsource);
+        Vector3d t_vecOri1 = Vector3d::Random();
+        Vector3d t_vecOri2 = Vector3d::Random();
+
+        MatrixXd t_matData = 0.05 * MatrixXd::Random(nchan, nsamp);
+        for(qint32 t = 0; t < nsamp; ++t)
+        {
+            double a = sin(0.1*t);
+            double b = t_bPairs ? a : cos(0.23*t);
+            t_matData.col(t) += a * t_matG.middleCols(3*t_iSource1, 3) * t_vecOri1 + b * t_matG.middleCols(3*t_iSource2, 3) * t_vecOri2;
+        }
+
+        QStringList t_qListNames;
+        for(qint32 i = 0; i < nchan; ++i)
+            t_qListNames << QString("CH %1").arg(i);
+
+        MNEForwardSolution t_Fwd;
+        t_Fwd.sol = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(nchan, 3*nsource, t_qListNames, QStringList(), t_matG));
+        t_Fwd.source_ori = FIFFV_MNE_FREE_ORI;
+        t_Fwd.nsource = nsource;
+        t_Fwd.nchan = nchan;
+
+        RapMusic t_RapMusic(t_Fwd, 3, 0.5, t_bPairs);
+
+        QList<RapMusic::Dipole> t_qListDipoles, t_qListDipolesGold;
+        if(!t_RapMusic.scan(t_matData, t_qListDipoles) || !RapMusicGold::scan(t_matG, 3, t_matData, 3, 0.5, t_bPairs, t_qListDipolesGold))
+        {
+            emit checkupFailed(2);
+            return false;
+        }
+
+        if(t_qListDipoles.isEmpty() || t_qListDipoles.size() != t_qListDipolesGold.size())
+        {
+            printf("Number of dipoles not correct!\n");
+            emit checkupFailed(2);
+            return false;
+        }
+
+        for(qint32 i = 0; i < t_qListDipoles.size(); ++i)
+        {
+            const RapMusic::Dipole &t_dipole = t_qListDipoles[i];
+            const RapMusic::Dipole &t_gold = t_qListDipolesGold[i];
+            double t_dOri = fabs(t_dipole.vecMoment1.normalized().dot(t_gold.vecMoment1.normalized()));
+
+            printf("%s: source %d/%d, correlation %f/%f\n", t_bPairs ? "Pair scan" : "Single source scan", t_dipole.iIdx1, t_gold.iIdx1, t_dipole.dCorr, t_gold.dCorr);
+
+            if(t_dipole.iIdx1 != t_gold.iIdx1 || t_dipole.iIdx2 != t_gold.iIdx2 || fabs(t_dipole.dCorr - t_gold.dCorr) > 1e-8 || t_dOri < 1 - 1e-8)
+            {
+                printf("Dipole %d doesn't match the reference!\n", i);
+                emit checkupFailed(2);
+                return false;
+            }
+        }
+
+        //
+        // The simulated dipoles have to be found first
+        //
+        const RapMusic::Dipole &t_first = t_qListDipoles[0];
+        bool t_bFound = t_bPairs ? t_first.iIdx1 == t_iSource1 && t_first.iIdx2 == t_iSource2
+                                 : (t_first.iIdx1 == t_iSource1 || t_first.iIdx1 == t_iSource2) && t_qListDipoles.size() > 1
+                                   && (t_qListDipoles[1].iIdx1 == t_iSource1 || t_qListDipoles[1].iIdx1 == t_iSource2);
+        if(!t_bFound)
+        {
+            printf("Simulated dipoles not found!\n");
+            emit checkupFailed(2);
+            return false;
+        }
+    }
+
+    //
+    // Pair scans of lead fields above the limit have to be refused instead of allocating the scan matrices
+    //
+    qint32 t_iCols = RAPMUSIC_MAX_PAIR_COLUMNS + 3;
+    QStringList t_qListNames;
+    for(qint32 i = 0; i < nchan; ++i)
+        t_qListNames << QString("CH %1").arg(i);
+
+    MNEForwardSolution t_FwdLarge;
+    t_FwdLarge.sol = FiffNamedMatrix::SDPtr(new FiffNamedMatrix(nchan, t_iCols, t_qListNames, QStringList(), MatrixXd::Random(nchan, t_iCols)));
+    t_FwdLarge.source_ori = FIFFV_MNE_FREE_ORI;
+    t_FwdLarge.nsource = t_iCols / 3;
+    t_FwdLarge.nchan = nchan;
+
+    RapMusic t_RapMusicLarge;
+    QList<RapMusic::Dipole> t_qListDipoles;
+    if(t_RapMusicLarge.init(t_FwdLarge, 3, 0.5, true) || t_RapMusicLarge.scan(MatrixXd::Random(nchan, nsamp), t_qListDipoles))
+    {
+        printf("Pair scan above the column limit wasn't refused!\n");
+        emit checkupFailed(2);
+        return false;
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkRawReader()
+{
+    QFile t_fileRaw("./MNE-sample-data/MEG/sample/sample_audvis_raw.fif");
+
+    FiffRawData raw(t_fileRaw);
+    if(raw.isEmpty())
+    {
+        printf("Raw data not read!\n");
+        emit checkupFailed(3);
+        return false;
+    }
+
+    fiff_int_t from = raw.first_samp;
+    fiff_int_t to = qMin(raw.first_samp + 9999, raw.last_samp);
+
+    for(qint32 t_iCase = 0; t_iCase < 2; ++t_iCase)
+    {
+        bool t_bMapped = t_iCase == 1;
+        if(t_bMapped && !raw.mapFile())
+        {
+            printf("Raw file not mapped!\n");
+            emit checkupFailed(3);
+            return false;
+        }
+
+        MatrixXd t_matSegment, t_matTimes;
+        if(!raw.read_raw_segment(t_matSegment, t_matTimes, from, to))
+        {
+            emit checkupFailed(3);
+            return false;
+        }
+        double eps = 1e-12 * t_matSegment.cwiseAbs().maxCoeff();
+
+        //
+        // With an odd chunk size the chunks start within and at the last sample of the raw buffers
+        //
+        FiffRawReader t_reader(raw, 333, 0, defaultRowVectorXi, from, to);
+        qint32 t_iCol = 0;
+        while(t_reader.readNext())
+        {
+            const MatrixXd &t_matChunk = t_reader.data();
+            if(t_reader.first() != from + t_iCol || t_iCol + t_matChunk.cols() > t_matSegment.cols()
+                    || (t_matChunk - t_matSegment.middleCols(t_iCol, t_matChunk.cols())).cwiseAbs().maxCoeff() > eps)
+            {
+                printf("Chunk %d - %d doesn't match the segment!\n", t_reader.first(), t_reader.last());
+                emit checkupFailed(3);
+                return false;
+            }
+            t_iCol += t_matChunk.cols();
+        }
+
+        if(t_iCol != t_matSegment.cols())
+        {
+            printf("Chunks hold %d instead of %d samples!\n", t_iCol, (qint32)t_matSegment.cols());
+            emit checkupFailed(3);
+            return false;
+        }
+
+        printf("%s: samples %d - %d read in chunks of 333 match the segment\n", t_bMapped ? "Mapped" : "Tag based", from, to);
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Producer of the lock-free buffer check: writes matrices filled with their index, waits while the buffer is full.
+*
+* @param[in] p_pBuffer  The buffer to write to
+* @param[in] p_iCount   Number of matrices to write
+*/
+static void produceMatrices(LockFreeMatrixBuffer<float>* p_pBuffer, qint32 p_iCount)
+{
+    for(qint32 i = 0; i < p_iCount; ++i)
+    {
+        MatrixXf* t_pSlot;
+        while((t_pSlot = p_pBuffer->acquireWrite()) == NULL)
+            QThread::yieldCurrentThread();
+        t_pSlot->setConstant((float)i);
+        p_pBuffer->commitWrite();
+    }
+}
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkLockFreeMatrixBuffer()
+{
+    //
+    // Single thread: full and empty states, order across several wrap arounds
+    //
+    LockFreeMatrixBuffer<float> t_buffer(3, 4, 5);
+    MatrixXf t_matIn(4, 5), t_matOut, t_matWrong(5, 4);
+
+    if(t_buffer.acquireRead() != NULL || t_buffer.pop(t_matOut) || t_buffer.push(&t_matWrong))
+    {
+        printf("Empty buffer not handled!\n");
+        emit checkupFailed(4);
+        return false;
+    }
+
+    qint32 t_iPushed = 0, t_iPopped = 0;
+    for(qint32 t_iRound = 0; t_iRound < 7; ++t_iRound)
+    {
+        // fill up, the buffer takes three matrices
+        while(true)
+        {
+            t_matIn.setConstant((float)t_iPushed);
+            if(!t_buffer.push(&t_matIn))
+                break;
+            ++t_iPushed;
+        }
+
+        if(t_buffer.available() != 3 || t_iPushed - t_iPopped != 3)
+        {
+            printf("Buffer holds %d instead of 3 matrices!\n", t_buffer.available());
+            emit checkupFailed(4);
+            return false;
+        }
+
+        // drain two of them, the slots wrap around with every round
+        for(qint32 i = 0; i < 2; ++i)
+        {
+            if(!t_buffer.pop(t_matOut) || t_matOut.rows() != 4 || t_matOut.cols() != 5 || (t_matOut.array() != (float)t_iPopped).any())
+            {
+                printf("Matrix %d popped out of order!\n", t_iPopped);
+                emit checkupFailed(4);
+                return false;
+            }
+            ++t_iPopped;
+        }
+    }
+
+    //
+    // Producer and consumer thread
+    //
+    qint32 t_iCount = 20000;
+    LockFreeMatrixBuffer<float> t_bufferSpsc(8, 16, 10);
+    QFuture<void> t_future = QtConcurrent::run(produceMatrices, &t_bufferSpsc, t_iCount);
+
+    for(qint32 i = 0; i < t_iCount; ++i)
+    {
+        const MatrixXf* t_pSlot;
+        while((t_pSlot = t_bufferSpsc.acquireRead()) == NULL)
+            QThread::yieldCurrentThread();
+
+        bool t_bOk = (t_pSlot->array() == (float)i).all();
+        t_bufferSpsc.releaseRead();
+
+        if(!t_bOk)
+        {
+            printf("Matrix %d received out of order or torn!\n", i);
+            t_future.waitForFinished();
+            emit checkupFailed(4);
+            return false;
+        }
+    }
+    t_future.waitForFinished();
+
+    if(t_bufferSpsc.available() != 0)
+    {
+        printf("Buffer not empty after all matrices were received!\n");
+        emit checkupFailed(4);
+        return false;
+    }
+
+    printf("%d matrices passed in order from the producer to the consumer thread\n", t_iCount);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkRtCov()
+{
+    qint32 nchan = 24;
+    qint32 nsamp = 150;
+    qint32 nblocks = 6;
+
+    srand(2);
+
+    //
+    // Correlated channels with a large offset, which the centering has to cope with
+    //
+    MatrixXd t_matMix = MatrixXd::Random(nchan, nchan);
+    MatrixXd t_matData = t_matMix * MatrixXd::Random(nchan, nblocks * nsamp);
+    t_matData.colwise() += 50.0 * VectorXd::Random(nchan);
+    MatrixXf t_matDataFloat = t_matData.cast<float>();
+
+    RtCov t_rtCovSingle(nblocks * nsamp, FiffInfo::SPtr(new FiffInfo));
+    RtCov t_rtCovThreads(nblocks * nsamp, FiffInfo::SPtr(new FiffInfo));
+    t_rtCovThreads.setThreads(4);
+
+    double t_dWeight = 0;
+    VectorXd t_vecMean, t_vecBlockMean, t_vecBlockMeanThreads;
+    MatrixXd t_matScatter, t_matBlockScatter, t_matBlockScatterThreads;
+
+    for(qint32 b = 0; b < nblocks; ++b)
+    {
+        MatrixXf t_matBlock = t_matDataFloat.middleCols(b * nsamp, nsamp);
+        t_rtCovSingle.blockStatistics(t_matBlock, t_vecBlockMean, t_matBlockScatter);
+        t_rtCovThreads.blockStatistics(t_matBlock, t_vecBlockMeanThreads, t_matBlockScatterThreads);
+
+        MatrixXd t_matDiff = t_matBlockScatterThreads.triangularView<Lower>();
+        t_matDiff -= t_matBlockScatter.triangularView<Lower>();
+        if(t_matDiff.cwiseAbs().maxCoeff() > 1e-4 * t_matBlockScatter.cwiseAbs().maxCoeff())
+        {
+            printf("Scatter matrix of the row panels doesn't match!\n");
+            emit checkupFailed(5);
+            return false;
+        }
+
+        RtCov::mergeStatistics(t_dWeight, t_vecMean, t_matScatter, nsamp, t_vecBlockMean, t_matBlockScatter);
+    }
+
+    //
+    // All blocks, then the window without the first two blocks
+    //
+    for(qint32 t_iCase = 0; t_iCase < 2; ++t_iCase)
+    {
+        qint32 t_iFirst = 0;
+        if(t_iCase == 1)
+        {
+            for(qint32 b = 0; b < 2; ++b)
+            {
+                t_rtCovSingle.blockStatistics(t_matDataFloat.middleCols(b * nsamp, nsamp), t_vecBlockMean, t_matBlockScatter);
+                RtCov::mergeStatistics(t_dWeight, t_vecMean, t_matScatter, nsamp, t_vecBlockMean, t_matBlockScatter, true);
+            }
+            t_iFirst = 2 * nsamp;
+        }
+
+        MatrixXd t_matSamples = t_matDataFloat.rightCols(nblocks * nsamp - t_iFirst).cast<double>();
+        VectorXd t_vecMeanRef = t_matSamples.rowwise().mean();
+        MatrixXd t_matCentered = t_matSamples.colwise() - t_vecMeanRef;
+        MatrixXd t_matCovRef = t_matCentered * t_matCentered.transpose() / (t_matSamples.cols() - 1);
+
+        MatrixXd t_matCov = t_matScatter.selfadjointView<Lower>();
+        t_matCov /= t_dWeight - 1;
+
+        double t_dErr = (t_matCov - t_matCovRef).cwiseAbs().maxCoeff() / t_matCovRef.cwiseAbs().maxCoeff();
+        double t_dErrMean = (t_vecMean - t_vecMeanRef).cwiseAbs().maxCoeff() / t_vecMeanRef.cwiseAbs().maxCoeff();
+
+        printf("%s: %d samples, relative error covariance %g, mean %g\n", t_iCase == 0 ? "Merged" : "Window", (qint32)t_dWeight, t_dErr, t_dErrMean);
+
+        if(t_dWeight != t_matSamples.cols() || t_dErr > 1e-4 || t_dErrMean > 1e-6)
+        {
+            printf("Covariance doesn't match the two pass reference!\n");
+            emit checkupFailed(5);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Reference of the KMeans distances, computed point by point from the raw data.
+*
+* @param[in] X          Input data (rows = points)
+* @param[in] C          Cluster centroids
+* @param[in] distance   0 sqeuclidean, 1 cityblock, 2 cosine, 3 correlation, 4 hamming
+*
+* @return Point to centroid distances
+*/
+static MatrixXd kmeansDistances(const MatrixXd& X, const MatrixXd& C, qint32 distance)
+{
+    MatrixXd D(X.rows(), C.rows());
+    for(qint32 i = 0; i < X.rows(); ++i)
+    {
+        for(qint32 j = 0; j < C.rows(); ++j)
+        {
+            RowVectorXd x = X.row(i);
+            RowVectorXd c = C.row(j);
+            if(distance == 3)
+            {
+                x.array() -= x.mean();
+                c.array() -= c.mean();
+            }
+
+            if(distance == 0)
+                D(i,j) = (x - c).squaredNorm();
+            else if(distance == 1)
+                D(i,j) = (x - c).cwiseAbs().sum();
+            else if(distance == 2 || distance == 3)
+                D(i,j) = std::max(1.0 - x.dot(c) / (x.norm() * c.norm()), 0.0);
+            else
+                D(i,j) = (x - c).cwiseAbs().sum() / x.cols();
+        }
+    }
+    return D;
+}
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkKMeans()
+{
+    const char* t_sDistances[] = {"sqeuclidean", "cityblock", "cosine", "correlation", "hamming"};
+    const char* t_sStarts[] = {"sample", "plus", "plus"};
+    qint32 k = 4;
+    qint32 npts = 60;
+    qint32 n = k * npts;
+
+    srand(6);
+
+    //
+    // Blobs around the scaled unit vectors with an offset, their directions are apart as well; binary
+    // prototypes with a few flipped bits for hamming
+    //
+    qint32 p = 6;
+    MatrixXd t_matBlobs = 0.3 * MatrixXd::Random(n, p);
+    t_matBlobs.array() += 1.0;
+    qint32 pBin = 24;
+    MatrixXd t_matPrototypes = (MatrixXd::Random(k, pBin).array() > 0.0).cast<double>();
+    MatrixXd t_matBinary(n, pBin);
+    VectorXi t_vecTruth(n);
+    for(qint32 i = 0; i < n; ++i)
+    {
+        t_vecTruth[i] = i / npts;
+        t_matBlobs(i, t_vecTruth[i]) += 10.0;
+        for(qint32 c = 0; c < pBin; ++c)
+            t_matBinary(i,c) = rand() % 20 == 0 ? 1.0 - t_matPrototypes(t_vecTruth[i],c) : t_matPrototypes(t_vecTruth[i],c);
+    }
+
+    for(qint32 t_iDist = 0; t_iDist < 5; ++t_iDist)
+    {
+        // the third run of each distance is mini-batch k-means, which applies to sqeuclidean only
+        for(qint32 t_iRun = 0; t_iRun < (t_iDist == 0 ? 3 : 2); ++t_iRun)
+        {
+            const MatrixXd& X = t_iDist == 4 ? t_matBinary : t_matBlobs;
+
+            VectorXi idx, idxRerun;
+            MatrixXd C, CRerun, D, DRerun;
+            VectorXd sumD, sumDRerun;
+
+            KMeans t_kMeans(t_sDistances[t_iDist], t_sStarts[t_iRun], 5, "error", true, 100, 42);
+            KMeans t_kMeansRerun(t_sDistances[t_iDist], t_sStarts[t_iRun], 5, "error", true, 100, 42);
+            if(t_iRun == 2)
+            {
+                t_kMeans.setMiniBatch(32);
+                t_kMeansRerun.setMiniBatch(32);
+            }
+
+            QString t_sCase = QString("%1, %2%3").arg(t_sDistances[t_iDist]).arg(t_sStarts[t_iRun]).arg(t_iRun == 2 ? ", mini-batch" : "");
+
+            if(!t_kMeans.calculate(X, k, idx, C, sumD, D) || !t_kMeansRerun.calculate(X, k, idxRerun, CRerun, sumDRerun, DRerun))
+            {
+                printf("KMeans (%s) failed!\n", t_sCase.toLatin1().constData());
+                emit checkupFailed(6);
+                return false;
+            }
+
+            // The same seed has to give the same clustering
+            if(idx != idxRerun || C != CRerun)
+            {
+                printf("KMeans (%s) isn't reproducible with a fixed seed!\n", t_sCase.toLatin1().constData());
+                emit checkupFailed(6);
+                return false;
+            }
+
+            // Every blob has to end up in a cluster of its own
+            VectorXi t_vecLabel = VectorXi::Constant(k, -1);
+            bool t_bPartition = true;
+            for(qint32 i = 0; i < n; ++i)
+            {
+                if(t_vecLabel[t_vecTruth[i]] < 0)
+                    t_vecLabel[t_vecTruth[i]] = idx[i];
+                t_bPartition = t_bPartition && t_vecLabel[t_vecTruth[i]] == idx[i];
+            }
+            for(qint32 i = 0; i < k; ++i)
+                for(qint32 j = i + 1; j < k; ++j)
+                    t_bPartition = t_bPartition && t_vecLabel[i] != t_vecLabel[j];
+
+            // Centroids of the members: mean, median, the mean of the normalized points or the binary median
+            MatrixXd t_matCRef(k, X.cols());
+            for(qint32 j = 0; j < k; ++j)
+            {
+                MatrixXd t_matMembers(n, X.cols());
+                qint32 count = 0;
+                for(qint32 i = 0; i < n; ++i)
+                    if(idx[i] == j)
+                        t_matMembers.row(count++) = X.row(i);
+                t_matMembers.conservativeResize(count, X.cols());
+
+                if(t_iDist == 3)
+                    t_matMembers.colwise() -= t_matMembers.rowwise().mean();
+                if(t_iDist == 2 || t_iDist == 3)
+                {
+                    VectorXd t_vecNorms = t_matMembers.rowwise().norm();
+                    t_matMembers = t_vecNorms.cwiseInverse().asDiagonal() * t_matMembers;
+                }
+
+                for(qint32 c = 0; c < X.cols(); ++c)
+                {
+                    VectorXd t_vecCoords = t_matMembers.col(c);
+                    std::sort(t_vecCoords.data(), t_vecCoords.data() + count);
+                    if(t_iDist == 1 || t_iDist == 4)
+                        t_matCRef(j,c) = 0.5 * (t_vecCoords[(count - 1) / 2] + t_vecCoords[count / 2]);
+                    else
+                        t_matCRef(j,c) = t_vecCoords.mean();
+                }
+            }
+
+            // Cosine and correlation centroids are defined up to their scale
+            MatrixXd t_matC = C;
+            if(t_iDist == 2 || t_iDist == 3)
+            {
+                VectorXd t_vecNorms = C.rowwise().norm();
+                t_matC = t_vecNorms.cwiseInverse().asDiagonal() * C;
+                t_vecNorms = t_matCRef.rowwise().norm();
+                t_matCRef = t_vecNorms.cwiseInverse().asDiagonal() * t_matCRef;
+            }
+            // Mini-batch centroids are running averages of the sampled points
+            double t_dTolC = t_iRun == 2 ? 0.1 : 1e-9;
+            double t_dErrC = (t_matC - t_matCRef).cwiseAbs().maxCoeff();
+
+            // Distances of the final centroids, each point assigned to the closest one, sum of the member distances
+            MatrixXd t_matDRef = kmeansDistances(X, C, t_iDist);
+            double t_dErrD = (D - t_matDRef).cwiseAbs().maxCoeff() / t_matDRef.cwiseAbs().maxCoeff();
+
+            VectorXd t_vecSumDRef = VectorXd::Zero(k);
+            bool t_bNearest = true;
+            for(qint32 i = 0; i < n; ++i)
+            {
+                t_vecSumDRef[idx[i]] += t_matDRef(i, idx[i]);
+                t_bNearest = t_bNearest && t_matDRef(i, idx[i]) <= t_matDRef.row(i).minCoeff() + 1e-12;
+            }
+            double t_dErrSumD = (sumD - t_vecSumDRef).cwiseAbs().maxCoeff() / t_vecSumDRef.cwiseAbs().maxCoeff();
+
+            printf("%s: error centroids %g, distances %g, sums %g\n", t_sCase.toLatin1().constData(), t_dErrC, t_dErrD, t_dErrSumD);
+
+            if(!t_bPartition || !t_bNearest || t_dErrC > t_dTolC || t_dErrD > 1e-9 || t_dErrSumD > 1e-9)
+            {
+                printf("KMeans (%s) doesn't match the reference!\n", t_sCase.toLatin1().constData());
+                emit checkupFailed(6);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Checks byte by byte that a raw buffer holds the elements of an array in big endian byte order.
+*
+* @param[in] p_pSource  The array
+* @param[in] p_iCount   Number of elements
+* @param[in] p_pBytes   The raw buffer
+*
+* @return true if the raw buffer is the big endian copy of the array
+*/
+template<typename T>
+static bool isBigEndianCopy(const T* p_pSource, qint64 p_iCount, const char* p_pBytes)
+{
+    const char* t_pSource = reinterpret_cast<const char*>(p_pSource);
+
+    for(qint64 i = 0; i < p_iCount; ++i, t_pSource += sizeof(T), p_pBytes += sizeof(T))
+        for(size_t k = 0; k < sizeof(T); ++k)
+            if(p_pBytes[k] != t_pSource[Q_BYTE_ORDER == Q_BIG_ENDIAN ? k : sizeof(T) - 1 - k])
+                return false;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+//=============================================================================================================
+/**
+* Byte order round trips of an array: to_big_endian to an unaligned raw buffer and from_big_endian back, and
+* swap_array twice in place.
+*
+* @param[in] p_pSource  The array
+* @param[in] p_iCount   Number of elements
+*
+* @return true if the byte orders are right and both round trips are bit exact
+*/
+template<typename T>
+static bool checkByteOrder(const T* p_pSource, qint64 p_iCount)
+{
+    qint64 t_iBytes = p_iCount*sizeof(T);
+
+    // one byte off, the big endian copy is unaligned
+    QByteArray t_qByteArrayBig(t_iBytes + 1, 0);
+    char* t_pBig = t_qByteArrayBig.data() + 1;
+
+    IOUtils::to_big_endian(p_pSource, p_iCount, t_pBig);
+    if(!isBigEndianCopy(p_pSource, p_iCount, t_pBig))
+        return false;
+
+    QVector<T> t_qVecBack(p_iCount);
+    IOUtils::from_big_endian(t_pBig, p_iCount, t_qVecBack.data());
+    if(memcmp(t_qVecBack.data(), p_pSource, t_iBytes) != 0)
+        return false;
+
+    // swap_array reverses the bytes of every element, whatever the host byte order
+    QVector<T> t_qVecSwap(p_iCount);
+    memcpy(t_qVecSwap.data(), p_pSource, t_iBytes);
+    IOUtils::swap_array(t_qVecSwap.data(), p_iCount);
+
+    const char* t_pSource = reinterpret_cast<const char*>(p_pSource);
+    const char* t_pSwap = reinterpret_cast<const char*>(t_qVecSwap.data());
+    for(qint64 i = 0; i < t_iBytes; i += sizeof(T))
+        for(size_t k = 0; k < sizeof(T); ++k)
+            if(t_pSwap[i + k] != t_pSource[i + sizeof(T) - 1 - k])
+                return false;
+
+    IOUtils::swap_array(t_qVecSwap.data(), p_iCount);
+
+    return memcmp(t_qVecSwap.data(), p_pSource, t_iBytes) == 0;
+}
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkByteSwap()
+{
+    //
+    // Arrays of pseudo random bits, odd counts; the first elements are the special floating point values
+    //
+    qint32 n = 1001;
+    QVector<qint16> t_qVecShort(n);
+    QVector<qint32> t_qVecInt(n);
+    QVector<qint64> t_qVecLong(n);
+    QVector<float> t_qVecFloat(n);
+    QVector<double> t_qVecDouble(n);
+
+    quint32 t_iBits = 12345;
+    for(qint32 i = 0; i < n; ++i)
+    {
+        quint32 t_iHigh = t_iBits = t_iBits*1664525u + 1013904223u;
+        quint32 t_iLow = t_iBits = t_iBits*1664525u + 1013904223u;
+
+        t_qVecShort[i] = (qint16)(t_iHigh >> 16);
+        t_qVecInt[i] = (qint32)t_iHigh;
+        t_qVecLong[i] = (qint64)(((quint64)t_iHigh << 32) | t_iLow);
+        t_qVecFloat[i] = (float)(qint32)t_iHigh * 1e-6f;
+        t_qVecDouble[i] = (double)t_qVecLong[i] * 1e-12;
+    }
+
+    t_qVecFloat[0] = -0.0f;
+    t_qVecFloat[1] = std::numeric_limits<float>::infinity();
+    t_qVecFloat[2] = std::numeric_limits<float>::quiet_NaN();
+    t_qVecFloat[3] = std::numeric_limits<float>::denorm_min();
+    t_qVecDouble[0] = -0.0;
+    t_qVecDouble[1] = -std::numeric_limits<double>::infinity();
+    t_qVecDouble[2] = std::numeric_limits<double>::quiet_NaN();
+    t_qVecDouble[3] = std::numeric_limits<double>::denorm_min();
+
+    const char* t_sFailed = !checkByteOrder(t_qVecShort.data(), n) ? "short" :
+                            !checkByteOrder(t_qVecInt.data(), n) ? "int" :
+                            !checkByteOrder(t_qVecLong.data(), n) ? "long" :
+                            !checkByteOrder(t_qVecFloat.data(), n) ? "float" :
+                            !checkByteOrder(t_qVecDouble.data(), n) ? "double" : NULL;
+    if(t_sFailed)
+    {
+        printf("Byte order round trip of %s failed!\n", t_sFailed);
+        emit checkupFailed(7);
+        return false;
+    }
+
+    //
+    // write_double: 8 byte elements, more than fit into the 64 kB scratch buffer of write_big_endian
+    //
+    qint32 t_iNumDoubles = 20*n;
+    QVector<double> t_qVecValues(t_iNumDoubles);
+    for(qint32 i = 0; i < t_iNumDoubles; ++i)
+        t_qVecValues[i] = t_qVecDouble[i % n];
+
+    QByteArray t_qByteArrayFile;
+    {
+        FiffStream t_streamOut(&t_qByteArrayFile, QIODevice::WriteOnly);
+        t_streamOut.write_double(FIFF_MNE_COV_EIGENVALUES, t_qVecValues.data(), t_iNumDoubles);
+    }
+
+    if(t_qByteArrayFile.size() != 16 + 8*t_iNumDoubles
+            || !isBigEndianCopy(t_qVecValues.data(), t_iNumDoubles, t_qByteArrayFile.constData() + 16))
+    {
+        printf("write_double didn't write the doubles in big endian byte order!\n");
+        emit checkupFailed(7);
+        return false;
+    }
+
+    FiffStream t_streamIn(&t_qByteArrayFile, QIODevice::ReadOnly);
+    FiffTag::SPtr t_pTag;
+    if(!FiffTag::read_tag(&t_streamIn, t_pTag) || t_pTag->kind != FIFF_MNE_COV_EIGENVALUES || !t_pTag->toDouble()
+            || t_pTag->size() != 8*t_iNumDoubles || memcmp(t_pTag->toDouble(), t_qVecValues.data(), 8*t_iNumDoubles) != 0)
+    {
+        printf("Doubles written by write_double not read back bit exact!\n");
+        emit checkupFailed(7);
+        return false;
+    }
+
+    printf("%d elements of each size and %d doubles of a fiff tag round tripped bit exact\n", n, t_iNumDoubles);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MNELibTests::checkRtRawBuffer()
+{
+    //
+    // MEG like channels of different amplitudes, a channel of zeros and a stim channel; two samples of the
+    // first channel are not finite
+    //
+    qint32 nchan = 8;
+    qint32 nsamp = 250;
+    qint32 t_iStimChan = nchan - 1;
+    qint32 t_iZeroChan = nchan - 2;
+
+    srand(7);
+    MatrixXf t_matRaw(nchan, nsamp);
+    for(qint32 c = 0; c < nchan; ++c)
+    {
+        float t_fAmplitude = (float)pow(10.0, c - 14.0);
+        for(qint32 s = 0; s < nsamp; ++s)
+        {
+            if(c == t_iStimChan)
+                t_matRaw(c,s) = (float)((s / 50) % 4);
+            else if(c == t_iZeroChan)
+                t_matRaw(c,s) = 0.0f;
+            else
+                t_matRaw(c,s) = t_fAmplitude * (float)(sin(0.05*(c+1)*s) + 0.2*((double)rand()/RAND_MAX - 0.5));
+        }
+    }
+    t_matRaw(0,10) = std::numeric_limits<float>::quiet_NaN();
+    t_matRaw(0,20) = -std::numeric_limits<float>::infinity();
+
+    fiff_int_t t_iModes[] = {FIFFV_MNE_RT_STREAM_FLOAT, FIFFV_MNE_RT_STREAM_PACK16, FIFFV_MNE_RT_STREAM_PACK24, FIFFV_MNE_RT_STREAM_LOSSLESS};
+    const char* t_sModes[] = {"float", "pack16", "pack24", "lossless"};
+
+    for(qint32 m = 0; m < 4; ++m)
+    {
+        QByteArray t_qByteArrayTag;
+        {
+            FiffStream t_streamOut(&t_qByteArrayTag, QIODevice::WriteOnly);
+            t_streamOut.write_rt_raw_buffer(t_matRaw, t_iModes[m]);
+        }
+
+        FiffStream t_streamIn(&t_qByteArrayTag, QIODevice::ReadOnly);
+        FiffTag::SPtr t_pTag;
+        MatrixXf t_matDecoded;
+        if(!FiffTag::read_tag(&t_streamIn, t_pTag) || !t_pTag->toRtRawBuffer(t_matDecoded, nchan)
+                || t_matDecoded.rows() != nchan || t_matDecoded.cols() != nsamp)
+        {
+            printf("Raw buffer not decoded in %s mode!\n", t_sModes[m]);
+            emit checkupFailed(8);
+            return false;
+        }
+
+        if(t_iModes[m] == FIFFV_MNE_RT_STREAM_FLOAT || t_iModes[m] == FIFFV_MNE_RT_STREAM_LOSSLESS)
+        {
+            if(memcmp(t_matDecoded.data(), t_matRaw.data(), t_matRaw.size()*sizeof(float)) != 0)
+            {
+                printf("Raw buffer not bit exact in %s mode!\n", t_sModes[m]);
+                emit checkupFailed(8);
+                return false;
+            }
+            continue;
+        }
+
+        //
+        // Packed integers: non-finite samples become zeros, the scales are taken from the finite samples; the
+        // 24 bit step is close to the float precision, which is allowed for on top of the step
+        //
+        float t_fMax = t_iModes[m] == FIFFV_MNE_RT_STREAM_PACK24 ? 8388607.0f : 32767.0f;
+        for(qint32 c = 0; c < nchan; ++c)
+        {
+            float t_fMaxAbs = 0.0f;
+            for(qint32 s = 0; s < nsamp; ++s)
+                if(std::fabs(t_matRaw(c,s)) <= std::numeric_limits<float>::max())
+                    t_fMaxAbs = std::max(t_fMaxAbs, std::fabs(t_matRaw(c,s)));
+            float t_fStep = c == t_iStimChan || c == t_iZeroChan ? 0.0f : t_fMaxAbs / t_fMax;
+
+            for(qint32 s = 0; s < nsamp; ++s)
+            {
+                float t_fRaw = t_matRaw(c,s);
+                float t_fDecoded = t_matDecoded(c,s);
+                bool t_bFinite = std::fabs(t_fRaw) <= std::numeric_limits<float>::max();
+
+                if(!(std::fabs(t_fDecoded) <= std::numeric_limits<float>::max())
+                        || (!t_bFinite && t_fDecoded != 0.0f)
+                        || (t_bFinite && std::fabs(t_fDecoded - t_fRaw) > t_fStep + std::fabs(t_fRaw)*std::numeric_limits<float>::epsilon()))
+                {
+                    printf("Channel %d sample %d: %g decoded as %g in %s mode, step %g!\n", c, s, t_fRaw, t_fDecoded, t_sModes[m], t_fStep);
+                    emit checkupFailed(8);
+                    return false;
+                }
+            }
+        }
+    }
+
+    printf("Raw buffer of %d channels x %d samples round tripped in all stream modes\n", nchan, nsamp);
+
+    return true;
+}
@@ -90,6 +90,84 @@ public:
     */
     bool checkFwdRead();
 
+    //=========================================================================================================
+    /**
+    * Test ID #2
+    *
+    * Checks the RAP MUSIC scan against its reference implementation on a simulated lead field, for single
+    * sources and for correlated source pairs
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkRapMusic();
+
+    //=========================================================================================================
+    /**
+    * Test ID #3
+    *
+    * Checks that the chunks of FiffRawReader concatenate to the segment read by read_raw_segment, with the
+    * tag based and with the memory mapped reading
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkRawReader();
+
+    //=========================================================================================================
+    /**
+    * Test ID #4
+    *
+    * Checks the order and the wrap around of the lock-free matrix buffer, in a single thread and with a
+    * producer and a consumer thread
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkLockFreeMatrixBuffer();
+
+    //=========================================================================================================
+    /**
+    * Test ID #5
+    *
+    * Checks the block statistics of RtCov, merged and removed again as in the sliding window, against a two
+    * pass covariance of the same samples
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkRtCov();
+
+    //=========================================================================================================
+    /**
+    * Test ID #6
+    *
+    * Clusters well separated blobs with every KMeans distance, k-means++ seeding and mini-batch updates, and
+    * checks the result against distances and centroids computed directly from the points
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkKMeans();
+
+    //=========================================================================================================
+    /**
+    * Test ID #7
+    *
+    * Round trips arrays of every element size through IOUtils::to_big_endian and from_big_endian and through
+    * swap_array, and doubles through FiffStream::write_double and FiffTag::read_tag
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkByteSwap();
+
+    //=========================================================================================================
+    /**
+    * Test ID #8
+    *
+    * Round trips a raw buffer with a stim channel and NaN/Inf samples through FiffStream::write_rt_raw_buffer
+    * and FiffTag::toRtRawBuffer in every raw stream mode: float and lossless are bit exact, pack16/pack24
+    * keep the stim channel exact and the other channels within their scale step
+    *
+    * @return true if successful false otherwise
+    */
+    bool checkRtRawBuffer();
+
 signals:
     void checkupFailed(int ID);
 
@@ -0,0 +1,198 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Benchmark of the real-time raw stream modes.
+*
+*/
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QString t_sFileName = argc > 1 ? QString(argv[1]) : QString("./MNE-sample-data/MEG/sample/sample_audvis_raw.fif");
+    qint32 t_iNumBlocks = argc > 2 ? QString(argv[2]).toInt() : 100;
+
+    //
+    // Blocks as sent by the FiffSimulator connector
+    //
+    QFile t_fileRaw(t_sFileName);
+    FiffRawData t_raw(t_fileRaw);
+    if(t_raw.info.nchan == 0)
+    {
+        printf("Could not read the raw data %s.\n", t_sFileName.toUtf8().constData());
+        return 1;
+    }
+
+    const qint32 t_iBlockSize = 1000;
+    t_iNumBlocks = qMin(t_iNumBlocks, (t_raw.last_samp - t_raw.first_samp + 1) / t_iBlockSize);
+
+    QList<MatrixXf> t_qListBlocks;
+    MatrixXd t_matTimes;
+    for(qint32 i = 0; i < t_iNumBlocks; ++i)
+    {
+        MatrixXf t_matBlock;
+        fiff_int_t from = t_raw.first_samp + i*t_iBlockSize;
+        if(!t_raw.read_raw_segment(t_matBlock, t_matTimes, from, from + t_iBlockSize - 1))
+        {
+            printf("Could not read the raw segment %d.\n", from);
+            return 1;
+        }
+        t_qListBlocks.append(t_matBlock);
+    }
+
+    //
+    // Encode and decode all blocks in each stream mode
+    //
+    const char* t_sModes[] = { "float", "int16", "int24", "lossless" };
+    fiff_int_t t_iModes[] = { FIFFV_MNE_RT_STREAM_FLOAT, FIFFV_MNE_RT_STREAM_PACK16, FIFFV_MNE_RT_STREAM_PACK24,
+                              FIFFV_MNE_RT_STREAM_LOSSLESS };
+
+    double t_dSeconds = (double)t_iNumBlocks*t_iBlockSize / t_raw.info.sfreq;
+    double t_dFloatBytes = 0;
+
+    printf("\n%d channels, %d blocks of %d samples, %.1f s\n\n", t_raw.info.nchan, t_iNumBlocks, t_iBlockSize, t_dSeconds);
+    printf("%-10s %12s %8s %14s %12s %12s %14s\n", "mode", "bytes/block", "ratio", "wire [kB/s]", "encode [ms]",
+           "decode [ms]", "max rel error");
+
+    for(qint32 m = 0; m < 4; ++m)
+    {
+        qint64 t_iBytes = 0;
+        qint64 t_iEncodeNs = 0;
+        qint64 t_iDecodeNs = 0;
+        double t_dMaxRelErr = 0;
+        bool t_bExact = true;
+
+        QElapsedTimer t_Timer;
+        for(qint32 i = 0; i < t_qListBlocks.size(); ++i)
+        {
+            const MatrixXf& t_matBlock = t_qListBlocks[i];
+
+            QByteArray t_qByteArrayBlock;
+            t_Timer.start();
+            {
+                FiffStream t_FiffStreamOut(&t_qByteArrayBlock, QIODevice::WriteOnly);
+                t_FiffStreamOut.write_rt_raw_buffer(t_matBlock, t_iModes[m]);
+            }
+            t_iEncodeNs += t_Timer.nsecsElapsed();
+            t_iBytes += t_qByteArrayBlock.size();
+
+            MatrixXf t_matDecoded;
+            t_Timer.start();
+            {
+                FiffStream t_FiffStreamIn(&t_qByteArrayBlock, QIODevice::ReadOnly);
+                FiffTag::SPtr t_pTag;
+                FiffTag::read_tag(&t_FiffStreamIn, t_pTag);
+                if(!t_pTag->toRtRawBuffer(t_matDecoded, t_matBlock.rows()))
+                {
+                    printf("Could not decode block %d in mode %s.\n", i, t_sModes[m]);
+                    return 1;
+                }
+            }
+            t_iDecodeNs += t_Timer.nsecsElapsed();
+
+            //
+            // Error relative to the range of each channel
+            //
+            for(qint32 c = 0; c < t_matBlock.rows(); ++c)
+            {
+                float t_fRange = t_matBlock.row(c).cwiseAbs().maxCoeff();
+                float t_fErr = (t_matDecoded.row(c) - t_matBlock.row(c)).cwiseAbs().maxCoeff();
+                if(t_fErr != 0)
+                    t_bExact = false;
+                if(t_fRange > 0)
+                    t_dMaxRelErr = qMax(t_dMaxRelErr, (double)(t_fErr / t_fRange));
+            }
+        }
+
+        if(m == 0)
+            t_dFloatBytes = (double)t_iBytes;
+
+        printf("%-10s %12.0f %8.2f %14.1f %12.3f %12.3f %14s\n", t_sModes[m],
+               (double)t_iBytes / t_iNumBlocks,
+               t_dFloatBytes / t_iBytes,
+               t_iBytes / t_dSeconds / 1024.0,
+               t_iEncodeNs / 1.0e6 / t_iNumBlocks,
+               t_iDecodeNs / 1.0e6 / t_iNumBlocks,
+               t_bExact ? "exact" : QString::number(t_dMaxRelErr, 'e', 2).toUtf8().constData());
+    }
+
+    printf("\nwire: bytes per second of data streamed in real time; encode/decode: CPU time per block\n");
+
+    return 0;
+}
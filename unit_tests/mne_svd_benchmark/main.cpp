@@ -0,0 +1,168 @@
+//=============================================================================================================
+/**
+* @file     main.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     May, 2013
+*
+* @section  LICENSE
+*
+* Copyright (C) 2013, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of the Massachusetts General Hospital nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MASSACHUSETTS GENERAL HOSPITAL BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Implements the main() application function.
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/mnemath.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <stdio.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Methods
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Builds the regularized inverse V * diag(s/(s^2+lambda2)) * U' the way prepare_inverse_operator and
+* assemble_kernel combine the decomposition.
+*
+* @param [in] sing      The singular values.
+* @param [in] U         The left singular vectors.
+* @param [in] V         The right singular vectors.
+* @param [in] lambda2   The regularization parameter.
+*
+* @return the regularized inverse
+*/
+MatrixXd regularizedInverse(const VectorXd& sing, const MatrixXd& U, const MatrixXd& V, double lambda2)
+{
+    VectorXd t_vecReginv = sing.array() / (sing.array().square() + lambda2);
+    return V * t_vecReginv.asDiagonal() * U.transpose();
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* The function main marks the entry point of the program.
+* By default, main has the storage class extern.
+*
+* @param [in] argc (argument count) is an integer that indicates how many arguments were entered on the command line when the program was started.
+* @param [in] argv (argument vector) is an array of pointers to arrays of character objects. The array objects are null-terminated strings, representing the arguments that were entered on the command line when the program was started.
+* @return the value that was set to exit() (which is 0 if exit() is called via quit()).
+*/
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //
+    // Lead field sized problem: 306 channels x sources, optionally given as first argument
+    //
+    qint32 t_iChannels = 306;
+    qint32 t_iSources = argc > 1 ? QString(argv[1]).toInt() : 3 * 8196;
+    qint32 t_iRank = 100;
+    double t_dLambda2 = 1.0 / 9.0;
+
+    //
+    // Synthetic whitened lead field with a decaying spectrum, scaled to trace(G*G') = nchan
+    //
+    MatrixXd t_matGain = MatrixXd::Random(t_iChannels, t_iChannels);
+    for(qint32 i = 0; i < t_iChannels; ++i)
+        t_matGain.col(i) *= exp(-0.05 * i);
+    t_matGain = t_matGain * MatrixXd::Random(t_iChannels, t_iSources);
+    t_matGain *= sqrt(t_iChannels) / t_matGain.norm();
+
+    printf("Decomposing a %d x %d lead field; lambda2 = %.3f, randomized rank = %d\n\n", t_iChannels, t_iSources, t_dLambda2, t_iRank);
+
+    QStringList t_qListMethods;
+    t_qListMethods << "jacobi" << "qr" << "gram" << "randomized";
+
+    VectorXd t_vecSingRef;
+    MatrixXd t_matInvRef;
+
+    printf("%-12s %12s %16s %16s %16s\n", "method", "time [ms]", "sing rel. err", "inverse rel. err", "reconstr. err");
+    for(qint32 i = 0; i < t_qListMethods.size(); ++i)
+    {
+        VectorXd t_vecSing;
+        MatrixXd t_matU, t_matV;
+
+        QElapsedTimer t_Timer;
+        t_Timer.start();
+        if(!MNEMath::thin_svd(t_matGain, t_vecSing, t_matU, t_matV, t_qListMethods[i], t_iRank))
+            return 1;
+        qint64 t_iTime = t_Timer.elapsed();
+
+        MatrixXd t_matInv = regularizedInverse(t_vecSing, t_matU, t_matV, t_dLambda2);
+
+        // jacobi is the reference
+        if(i == 0)
+        {
+            t_vecSingRef = t_vecSing;
+            t_matInvRef = t_matInv;
+        }
+
+        qint32 k = t_vecSing.size();
+        double t_dSingErr = (t_vecSing - t_vecSingRef.head(k)).norm() / t_vecSingRef.head(k).norm();
+        double t_dInvErr = (t_matInv - t_matInvRef).norm() / t_matInvRef.norm();
+        double t_dRecErr = (t_matGain - t_matU * t_vecSing.asDiagonal() * t_matV.transpose()).norm() / t_matGain.norm();
+
+        printf("%-12s %12d %16.3e %16.3e %16.3e\n", t_qListMethods[i].toLatin1().constData(), (qint32)t_iTime, t_dSingErr, t_dInvErr, t_dRecErr);
+    }
+
+    return 0;
+}
@@ -39,7 +39,11 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     mne_lib_tests \
-    mne_rt_tests
+    mne_rt_tests \
+    mne_buffer_benchmark \
+    mne_svd_benchmark \
+    mne_forward_benchmark \
+    mne_rt_stream_benchmark
 
 contains(MNECPP_CONFIG, isGui) {
     SUBDIRS += \